@@ -26,6 +26,7 @@ cache_stream_sink::~cache_stream_sink() {
 
 std::streamsize cache_stream_sink::write (const char* c, std::streamsize bufsize) {
   if (out_file) {
+    fileio::fixed_size_cache_manager::get_instance().add_spilled_bytes(bufsize);
     return out_file->write(c, bufsize);
   } else {
     bool write_success = out_block->write_bytes_to_memory_cache(c, bufsize);
@@ -35,6 +36,7 @@ std::streamsize cache_stream_sink::write (const char* c, std::streamsize bufsize
       // In memory cache is full, write out to disk.
       // switch to a file handle
       out_file = out_block->write_to_file();
+      fileio::fixed_size_cache_manager::get_instance().add_spilled_bytes(bufsize);
       return out_file->write(c, bufsize);
     }
   }
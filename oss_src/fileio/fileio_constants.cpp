@@ -105,11 +105,22 @@ EXPORT size_t FILEIO_MAXIMUM_CACHE_CAPACITY_PER_FILE = 128 * 1024 * 1024;
 EXPORT size_t FILEIO_MAXIMUM_CACHE_CAPACITY = 2LL * 1024 * 1024 * 1024;
 EXPORT size_t FILEIO_READER_BUFFER_SIZE = 16 * 1024;
 EXPORT size_t FILEIO_WRITER_BUFFER_SIZE = 96 * 1024;
+EXPORT size_t FILEIO_PARALLEL_GZIP_DECOMPRESSION = 1;
+EXPORT size_t FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE = 8 * 1024 * 1024;
+EXPORT size_t FILEIO_MEMORY_GOVERNOR_BUDGET = 0;
+EXPORT size_t FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE = 256 * 1024 * 1024;
 
 REGISTER_GLOBAL(int64_t, FILEIO_MAXIMUM_CACHE_CAPACITY, true); 
 REGISTER_GLOBAL(int64_t, FILEIO_MAXIMUM_CACHE_CAPACITY_PER_FILE, true) 
 REGISTER_GLOBAL(int64_t, FILEIO_READER_BUFFER_SIZE, false);
 REGISTER_GLOBAL(int64_t, FILEIO_WRITER_BUFFER_SIZE, false); 
+REGISTER_GLOBAL(int64_t, FILEIO_PARALLEL_GZIP_DECOMPRESSION, true);
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE,
+                            true,
+                            +[](int64_t val){ return val >= 64 * 1024; });
+REGISTER_GLOBAL(int64_t, FILEIO_MEMORY_GOVERNOR_BUDGET, true);
+REGISTER_GLOBAL(int64_t, FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE, true);
 
 
 static constexpr char CACHE_PREFIX[] = "cache://";
@@ -67,6 +67,30 @@ extern size_t FILEIO_READER_BUFFER_SIZE;
  */
 extern size_t FILEIO_WRITER_BUFFER_SIZE;
 
+/**
+ * If true, gzip files are decompressed on background threads, in parallel
+ * where the file is made of several gzip members.
+ */
+extern size_t FILEIO_PARALLEL_GZIP_DECOMPRESSION;
+
+/**
+ * The number of compressed bytes read at a time by the parallel gzip
+ * decompressor, and split among the cores.
+ */
+extern size_t FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE;
+
+/**
+ * The number of bytes the memory_governor splits between the memory
+ * intensive operators and the caches. 0 disables the governor.
+ */
+extern size_t FILEIO_MEMORY_GOVERNOR_BUDGET;
+
+/**
+ * The smallest share of the memory budget an operator is started with.
+ * Operators which would get less are queued.
+ */
+extern size_t FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE;
+
 /**
  * The alternative ssl certificate file and directory.
  */
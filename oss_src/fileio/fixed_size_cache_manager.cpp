@@ -7,6 +7,7 @@
  */
 #include <fileio/fileio_constants.hpp>
 #include <fileio/fixed_size_cache_manager.hpp>
+#include <fileio/memory_governor.hpp>
 #include <logger/assertions.hpp>
 #include <iostream>
 #include <iomanip>
@@ -15,6 +16,16 @@
 namespace graphlab {
 
 namespace fileio {
+
+/**
+ * The capacity of the cache: FILEIO_MAXIMUM_CACHE_CAPACITY, or less if the
+ * memory governor needs the memory for working memory.
+ */
+static size_t maximum_cache_capacity() {
+  return memory_governor::get_instance().cache_capacity(
+      memory_consumer::FILEIO_CACHE, FILEIO_MAXIMUM_CACHE_CAPACITY);
+}
+
 /*************************************************************************/
 /*                                                                       */
 /*                         Cache Block implementation                    */
@@ -38,15 +49,16 @@ namespace fileio {
       new_capacity = std::max(new_capacity, capacity * 2);
       new_capacity = std::min(new_capacity, maximum_capacity);
       size_t current_cache_utilization = owning_cache_manager->get_cache_utilization();
+      size_t cache_capacity = maximum_cache_capacity();
       // will we exceed capacity?
       if (current_cache_utilization + (new_capacity - capacity) > 
-          FILEIO_MAXIMUM_CACHE_CAPACITY) {
+          cache_capacity) {
 
         // resizing will cause us to go over the maximum cache limit
         // try again with the minimal queried size.
         new_capacity = queried_capacity;
         if (current_cache_utilization + (new_capacity - capacity) > 
-            FILEIO_MAXIMUM_CACHE_CAPACITY) {
+            cache_capacity) {
           // yup. we will still exceed capacity. FAIL.
           return false;
         }
@@ -72,7 +84,10 @@ namespace fileio {
     filename = get_temp_name_prefer_hdfs();
     logstream(LOG_DEBUG) << "Flushing to " << filename << std::endl;
     auto fout = std::make_shared<fileio_impl::general_fstream_sink>(filename);
-    if (data) fout->write(data, size);
+    if (data) {
+      fout->write(data, size);
+      owning_cache_manager->add_spilled_bytes(size);
+    }
     release_memory();
     return fout;
   }
@@ -155,17 +170,18 @@ namespace fileio {
   std::shared_ptr<cache_block> fixed_size_cache_manager::new_cache(cache_id_type cache_id) {
     std::lock_guard<graphlab::mutex> lck(mutex);
     logstream_ontick(5, LOG_INFO) << "Cache Utilization:" << get_cache_utilization() << std::endl;
+    size_t cache_capacity = maximum_cache_capacity();
     // if we have exceeded, we try to evict
-    if (current_cache_utilization.value >= FILEIO_MAXIMUM_CACHE_CAPACITY) try_cache_evict();
+    if (current_cache_utilization.value >= cache_capacity) try_cache_evict();
     // read the current cache utilization.
     size_t current_utilization = current_cache_utilization.value;
     // this will the maximum capacity of the new entry
     size_t new_entry_max_capacity = 0;
-    if (current_utilization < FILEIO_MAXIMUM_CACHE_CAPACITY) {
+    if (current_utilization < cache_capacity) {
       // if we have less than new_max_block_capacity available,
       // give less capacity.
       new_entry_max_capacity = std::min<size_t>(FILEIO_MAXIMUM_CACHE_CAPACITY_PER_FILE,
-                                                FILEIO_MAXIMUM_CACHE_CAPACITY - 
+                                                cache_capacity - 
                                                 current_utilization);
     } 
 
@@ -242,6 +242,21 @@ class fixed_size_cache_manager {
     return current_cache_utilization.value;
   }
 
+  /**
+   * Returns the number of bytes of cached files written to disk so far,
+   * because the cache was full.
+   */
+  inline size_t get_spilled_bytes() {
+    return spilled_bytes.value;
+  }
+
+  /**
+   * Counts bytes of cached files written to disk.
+   */
+  inline void add_spilled_bytes(size_t bytes) {
+    spilled_bytes.inc(bytes);
+  }
+
  private:
   fixed_size_cache_manager();
 
@@ -258,6 +273,8 @@ class fixed_size_cache_manager {
 
   atomic<size_t> current_cache_utilization;
 
+  atomic<size_t> spilled_bytes;
+
   graphlab::mutex mutex;
   std::unordered_map<std::string, std::shared_ptr<cache_block> > cache_blocks;
 
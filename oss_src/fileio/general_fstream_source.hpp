@@ -17,6 +17,8 @@
 namespace graphlab {
 namespace fileio_impl {
 
+class parallel_gzip_decompressor;
+
 /**
  * Implements a general file stream source device which wraps the
  * union_fstream, and provides automatic gzip decompression capabilities.
@@ -29,6 +31,8 @@ class general_fstream_source {
   std::shared_ptr<union_fstream> in_file;
   /// The source device must be copyable; thus the shared_ptr.
   std::shared_ptr<boost::iostreams::gzip_decompressor> decompressor;
+  /// Used instead of the decompressor if FILEIO_PARALLEL_GZIP_DECOMPRESSION
+  std::shared_ptr<parallel_gzip_decompressor> parallel_decompressor;
 
   /// The underlying stream inside the in_file (std stream or hdfs stream)
   std::shared_ptr<std::istream> underlying_stream;
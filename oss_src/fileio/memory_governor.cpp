@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <logger/logger.hpp>
+#include <fileio/fileio_constants.hpp>
+#include <fileio/memory_governor.hpp>
+
+namespace graphlab {
+
+/// The number of grants held by the current thread
+static __thread size_t thread_num_grants = 0;
+
+const char* memory_consumer_name(memory_consumer consumer) {
+  switch(consumer) {
+   case memory_consumer::GROUPBY: return "groupby";
+   case memory_consumer::JOIN: return "join";
+   case memory_consumer::SORT: return "sort";
+   case memory_consumer::FILEIO_CACHE: return "fileio_cache";
+   case memory_consumer::DECODED_BLOCK_CACHE: return "decoded_block_cache";
+   default: return "unknown";
+  }
+}
+
+/**************************************************************************/
+/*                                                                        */
+/*                              memory_grant                              */
+/*                                                                        */
+/**************************************************************************/
+
+memory_grant::memory_grant(memory_consumer consumer, size_t requested, bool governed)
+    : m_consumer(consumer), m_requested(requested), m_governed(governed) { }
+
+memory_grant::~memory_grant() {
+  if (m_governed) memory_governor::get_instance().release(*this);
+}
+
+size_t memory_grant::bytes() const {
+  if (!m_governed) return m_requested;
+  const auto& governor = memory_governor::get_instance();
+  return std::min(m_requested, governor.fair_share(governor.m_num_grants.value));
+}
+
+/**************************************************************************/
+/*                                                                        */
+/*                             memory_governor                            */
+/*                                                                        */
+/**************************************************************************/
+
+memory_governor& memory_governor::get_instance() {
+  static memory_governor governor;
+  return governor;
+}
+
+bool memory_governor::enabled() const {
+  return fileio::FILEIO_MEMORY_GOVERNOR_BUDGET > 0;
+}
+
+size_t memory_governor::working_memory() const {
+  return fileio::FILEIO_MEMORY_GOVERNOR_BUDGET / 4 * 3;
+}
+
+size_t memory_governor::fair_share(size_t n) const {
+  return working_memory() / std::max<size_t>(n, 1);
+}
+
+size_t memory_governor::reserved_bytes() const {
+  return std::min<size_t>(m_requested_bytes, working_memory());
+}
+
+std::unique_ptr<memory_grant> memory_governor::acquire(memory_consumer consumer,
+                                                       size_t requested_bytes) {
+  if (!enabled()) {
+    return std::unique_ptr<memory_grant>(
+        new memory_grant(consumer, requested_bytes, false));
+  }
+  {
+    std::lock_guard<mutex> guard(m_lock);
+    if (thread_num_grants == 0) {
+      bool queued = false;
+      // admit the operator if it is alone, or if everyone still gets
+      // the minimum grant size.
+      while (m_num_grants.value > 0 &&
+             fair_share(m_num_grants.value + 1) < fileio::FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE) {
+        if (!queued) {
+          queued = true;
+          ++m_num_waiting;
+          ++m_num_queued;
+          logstream(LOG_INFO) << "Out of working memory. Queueing "
+                              << memory_consumer_name(consumer) << std::endl;
+        }
+        m_released.wait(m_lock);
+      }
+      if (queued) --m_num_waiting;
+    }
+    m_num_grants.inc();
+    m_requested_bytes.inc(requested_bytes);
+    m_grants_by_consumer[(size_t)consumer].inc();
+  }
+  ++thread_num_grants;
+  return std::unique_ptr<memory_grant>(
+      new memory_grant(consumer, requested_bytes, true));
+}
+
+void memory_governor::release(const memory_grant& grant) {
+  std::lock_guard<mutex> guard(m_lock);
+  m_num_grants.dec();
+  m_requested_bytes.dec(grant.requested_bytes());
+  m_grants_by_consumer[(size_t)grant.consumer()].dec();
+  if (thread_num_grants > 0) --thread_num_grants;
+  m_released.broadcast();
+}
+
+size_t memory_governor::cache_capacity(memory_consumer cache,
+                                       size_t configured_capacity) {
+  m_configured_capacity[(size_t)cache].exchange(configured_capacity);
+  if (!enabled()) return configured_capacity;
+
+  size_t budget = fileio::FILEIO_MEMORY_GOVERNOR_BUDGET;
+  size_t available = budget - reserved_bytes();
+  size_t total_configured = m_configured_capacity[(size_t)memory_consumer::FILEIO_CACHE].value +
+      m_configured_capacity[(size_t)memory_consumer::DECODED_BLOCK_CACHE].value;
+  if (total_configured <= available) return configured_capacity;
+  // split what is available in proportion to the configured capacities
+  return (double)configured_capacity / total_configured * available;
+}
+
+memory_governor::governor_stats memory_governor::get_stats() const {
+  governor_stats ret;
+  ret.budget = fileio::FILEIO_MEMORY_GOVERNOR_BUDGET;
+  ret.reserved_bytes = enabled() ? reserved_bytes() : m_requested_bytes.value;
+  for (size_t i = 0; i < (size_t)memory_consumer::NUM_CONSUMERS; ++i) {
+    ret.num_grants[i] = m_grants_by_consumer[i].value;
+  }
+  std::lock_guard<mutex> guard(m_lock);
+  ret.num_waiting = m_num_waiting;
+  ret.num_queued = m_num_queued;
+  return ret;
+}
+
+} // namespace graphlab
@@ -0,0 +1,171 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_FILEIO_MEMORY_GOVERNOR_HPP
+#define GRAPHLAB_FILEIO_MEMORY_GOVERNOR_HPP
+#include <memory>
+#include <parallel/pthread_tools.hpp>
+#include <parallel/atomic.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup fileio
+ * The users of memory known to the \ref memory_governor.
+ */
+enum class memory_consumer: size_t {
+  GROUPBY = 0,
+  JOIN = 1,
+  SORT = 2,
+  FILEIO_CACHE = 3,
+  DECODED_BLOCK_CACHE = 4,
+  NUM_CONSUMERS = 5
+};
+
+/**
+ * Returns a printable name for a memory_consumer.
+ */
+const char* memory_consumer_name(memory_consumer consumer);
+
+/**
+ * \ingroup fileio
+ * HEURISTIC: the number of bytes a buffered cell is assumed to take, used
+ * to turn a number of buffered rows into the bytes requested from the
+ * \ref memory_governor, and back.
+ */
+constexpr size_t CELL_SIZE_ESTIMATE = 64;
+
+/**
+ * \ingroup fileio
+ *
+ * Working memory granted to a memory intensive operator (a groupby, a join
+ * or a sort) by the \ref memory_governor, for the lifetime of the object.
+ *
+ * The size of the grant is not fixed: it shrinks as other operators are
+ * granted memory, and grows back as they finish. Operators which buffer
+ * rows should read \ref bytes every time they decide whether to spill.
+ *
+ * A grant must be destroyed by the thread which acquired it.
+ */
+class memory_grant {
+ public:
+  ~memory_grant();
+
+  memory_grant(const memory_grant&) = delete;
+  memory_grant& operator=(const memory_grant&) = delete;
+
+  /**
+   * The number of bytes the operator may use right now. Never more than
+   * the number of bytes requested.
+   */
+  size_t bytes() const;
+
+  /// The number of bytes requested
+  size_t requested_bytes() const { return m_requested; }
+
+  memory_consumer consumer() const { return m_consumer; }
+
+ private:
+  friend class memory_governor;
+  memory_grant(memory_consumer consumer, size_t requested, bool governed);
+
+  memory_consumer m_consumer;
+  size_t m_requested;
+  /// False if the governor was disabled when the grant was acquired
+  bool m_governed;
+};
+
+/**
+ * \ingroup fileio
+ *
+ * A global singleton dividing a single memory budget,
+ * FILEIO_MEMORY_GOVERNOR_BUDGET bytes, between everything which buffers
+ * data in memory:
+ *
+ *  - The memory intensive operators (groupby, join and sort) acquire a
+ *    \ref memory_grant before they start buffering. Three quarters of the
+ *    budget are split evenly between the running operators; an operator
+ *    never gets more than it requested.
+ *  - The caches (the fileio cache and the decoded block cache) ask for
+ *    their capacity through \ref cache_capacity, and get what the operators
+ *    have not reserved (at least a quarter of the budget), split in
+ *    proportion to their configured capacities. A cache which finds itself
+ *    over its capacity evicts, which spills the fileio cache to disk.
+ *
+ * Admission control: an operator whose share would fall below
+ * FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE waits in \ref acquire until enough
+ * operators finish. The queries which need working memory are thus queued
+ * when the server is saturated, rather than all running with tiny buffers
+ * (or all running out of memory). A thread which already holds a grant is
+ * never queued, since the grant it holds may be what the others are waiting
+ * for.
+ *
+ * If FILEIO_MEMORY_GOVERNOR_BUDGET is 0, the governor is disabled: grants
+ * are for the requested size, caches get their configured capacity and
+ * nothing is queued.
+ */
+class memory_governor {
+ public:
+  static memory_governor& get_instance();
+
+  /// True if FILEIO_MEMORY_GOVERNOR_BUDGET is set
+  bool enabled() const;
+
+  /**
+   * Grants up to requested_bytes of working memory to an operator. Blocks
+   * while the server is saturated.
+   */
+  std::unique_ptr<memory_grant> acquire(memory_consumer consumer,
+                                        size_t requested_bytes);
+
+  /**
+   * Returns the number of bytes a cache may hold right now, given the
+   * capacity it is configured with.
+   */
+  size_t cache_capacity(memory_consumer cache, size_t configured_capacity);
+
+  struct governor_stats {
+    size_t budget = 0;
+    /// The memory reserved by the running operators
+    size_t reserved_bytes = 0;
+    /// The number of grants held, by consumer
+    size_t num_grants[(size_t)memory_consumer::NUM_CONSUMERS] = {0};
+    /// The number of operators waiting for a grant
+    size_t num_waiting = 0;
+    /// The number of operators which have had to wait so far
+    size_t num_queued = 0;
+  };
+
+  governor_stats get_stats() const;
+
+ private:
+  memory_governor() = default;
+  friend class memory_grant;
+
+  /// The memory split between the operators
+  size_t working_memory() const;
+  /// The share of the working memory of an operator, when n are running
+  size_t fair_share(size_t n) const;
+  /// The memory reserved by the running operators
+  size_t reserved_bytes() const;
+  void release(const memory_grant& grant);
+
+  atomic<size_t> m_num_grants;
+  /// The sum of the requested sizes of the grants
+  atomic<size_t> m_requested_bytes;
+  atomic<size_t> m_grants_by_consumer[(size_t)memory_consumer::NUM_CONSUMERS];
+  /// The last configured capacity of each cache
+  atomic<size_t> m_configured_capacity[(size_t)memory_consumer::NUM_CONSUMERS];
+
+  mutable mutex m_lock;
+  conditional m_released;
+  size_t m_num_waiting = 0;
+  size_t m_num_queued = 0;
+};
+
+} // namespace graphlab
+#endif
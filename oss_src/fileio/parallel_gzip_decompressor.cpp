@@ -0,0 +1,366 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <zlib.h>
+#include <logger/logger.hpp>
+#include <fileio/fileio_constants.hpp>
+#include <fileio/parallel_gzip_decompressor.hpp>
+
+namespace graphlab {
+namespace fileio_impl {
+
+/**
+ * A zlib inflate stream which decodes one gzip member at a time.
+ */
+class inflate_stream {
+ public:
+  enum status { MEMBER_END, NEED_INPUT, FAILED };
+
+  inflate_stream() {
+    memset(&z, 0, sizeof(z));
+    // 16 + MAX_WBITS: expect a gzip header and trailer
+    if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) {
+      log_and_throw("Cannot initialize gzip decompression");
+    }
+  }
+
+  ~inflate_stream() { inflateEnd(&z); }
+
+  inflate_stream(const inflate_stream&) = delete;
+  inflate_stream& operator=(const inflate_stream&) = delete;
+
+  /// Prepares the stream for the next member
+  void reset() { inflateReset(&z); }
+
+  /**
+   * Inflates from in until the end of the current member, or until the
+   * input runs out, appending to out. consumed is set to the number of
+   * input bytes used.
+   */
+  status inflate_some(const char* in, size_t len, size_t& consumed, std::string& out) {
+    const size_t OUTPUT_STEP = 256 * 1024;
+    len = std::min<size_t>(len, std::numeric_limits<uInt>::max());
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+    z.avail_in = len;
+    status ret = FAILED;
+    while (true) {
+      size_t old_size = out.size();
+      out.resize(old_size + OUTPUT_STEP);
+      z.next_out = reinterpret_cast<Bytef*>(&out[old_size]);
+      z.avail_out = OUTPUT_STEP;
+      int err = inflate(&z, Z_NO_FLUSH);
+      out.resize(old_size + OUTPUT_STEP - z.avail_out);
+      if (err == Z_STREAM_END) {
+        ret = MEMBER_END;
+        break;
+      } else if (err == Z_OK || err == Z_BUF_ERROR) {
+        // no more input and all pending output flushed
+        if (z.avail_in == 0 && z.avail_out > 0) {
+          ret = NEED_INPUT;
+          break;
+        }
+        if (err == Z_BUF_ERROR && z.avail_in > 0) break;
+      } else {
+        break;
+      }
+    }
+    consumed = len - z.avail_in;
+    return ret;
+  }
+
+ private:
+  z_stream z;
+};
+
+namespace {
+
+/// Runs smaller than this are not worth a thread
+const size_t MIN_RUN_SIZE = 256 * 1024;
+
+/**
+ * The gzip members of a window decoded by one thread.
+ */
+struct inflate_run {
+  /// The offset of the first member in the window
+  size_t begin = 0;
+  /// The offset at which the run stopped
+  size_t end = 0;
+  std::string output;
+  bool failed = false;
+  /// Set if the data after a member is not a gzip member
+  bool trailing_garbage = false;
+  /// The stream of a member cut by the end of the window
+  std::shared_ptr<inflate_stream> incomplete;
+};
+
+inline bool has_gzip_magic(const std::string& window, size_t pos) {
+  return (unsigned char)window[pos] == 0x1f &&
+      (pos + 1 == window.size() || (unsigned char)window[pos + 1] == 0x8b);
+}
+
+/**
+ * True if a plausible gzip header (deflate, no reserved flags) starts at pos.
+ */
+inline bool looks_like_gzip_header(const std::string& window, size_t pos) {
+  return pos + 10 <= window.size() &&
+      (unsigned char)window[pos] == 0x1f &&
+      (unsigned char)window[pos + 1] == 0x8b &&
+      window[pos + 2] == 8 &&
+      ((unsigned char)window[pos + 3] & 0xe0) == 0;
+}
+
+/**
+ * If a bgzip member starts at pos, returns its compressed size, stored in
+ * the "BC" extra subfield of its header. Returns 0 otherwise.
+ */
+size_t bgzip_member_size(const std::string& window, size_t pos) {
+  auto byte = [&](size_t i) { return (size_t)(unsigned char)window[pos + i]; };
+  if (!looks_like_gzip_header(window, pos) || !(byte(3) & 4)) return 0;
+  if (pos + 12 > window.size()) return 0;
+  size_t xlen = byte(10) | (byte(11) << 8);
+  if (pos + 12 + xlen > window.size()) return 0;
+  for (size_t i = 12; i + 4 <= 12 + xlen; ) {
+    size_t slen = byte(i + 2) | (byte(i + 3) << 8);
+    if (byte(i) == 'B' && byte(i + 1) == 'C' && slen == 2 && i + 6 <= 12 + xlen) {
+      return (byte(i + 4) | (byte(i + 5) << 8)) + 1;
+    }
+    i += 4 + slen;
+  }
+  return 0;
+}
+
+/**
+ * Picks the offsets at which at most num_threads threads start inflating,
+ * the first being begin, which must be a member boundary.
+ */
+std::vector<size_t> find_run_starts(const std::string& window, size_t begin,
+                                    size_t num_threads) {
+  std::vector<size_t> starts{begin};
+  size_t nruns = std::min<size_t>(num_threads,
+                                  (window.size() - begin) / MIN_RUN_SIZE);
+  if (nruns <= 1) return starts;
+  size_t step = (window.size() - begin) / nruns;
+
+  if (bgzip_member_size(window, begin) > 0) {
+    // follow the chain of block sizes
+    size_t pos = begin;
+    size_t member_size = 0;
+    while ((member_size = bgzip_member_size(window, pos)) > 0 &&
+           pos + member_size < window.size()) {
+      pos += member_size;
+      if (pos >= starts.back() + step) starts.push_back(pos);
+    }
+  } else {
+    for (size_t i = 1; i < nruns; ++i) {
+      size_t pos = std::max(begin + i * step, starts.back() + 1);
+      while (pos < window.size() && !looks_like_gzip_header(window, pos)) {
+        auto next = memchr(window.data() + pos + 1, 0x1f, window.size() - pos - 1);
+        pos = next ? (const char*)next - window.data() : window.size();
+      }
+      if (pos >= window.size()) break;
+      starts.push_back(pos);
+    }
+  }
+  return starts;
+}
+
+/**
+ * Inflates consecutive members from run.begin, until reaching or passing
+ * stop_at at a member boundary, or until the end of the window.
+ */
+void inflate_members(const std::string& window, size_t stop_at, inflate_run& run) {
+  auto stream = std::make_shared<inflate_stream>();
+  size_t pos = run.begin;
+  while (pos < stop_at && pos < window.size()) {
+    if (pos > run.begin) {
+      if (!has_gzip_magic(window, pos)) {
+        run.trailing_garbage = true;
+        break;
+      }
+      stream->reset();
+    }
+    size_t consumed = 0;
+    auto status = stream->inflate_some(window.data() + pos, window.size() - pos,
+                                       consumed, run.output);
+    pos += consumed;
+    if (status == inflate_stream::NEED_INPUT) {
+      run.incomplete = stream;
+      break;
+    } else if (status == inflate_stream::FAILED) {
+      run.failed = true;
+      break;
+    }
+  }
+  run.end = pos;
+}
+
+} // anonymous namespace
+
+parallel_gzip_decompressor::parallel_gzip_decompressor(
+    std::shared_ptr<std::istream> compressed, size_t num_threads)
+    : compressed(compressed), num_threads(std::max<size_t>(num_threads, 1)),
+      bytes_read(0), num_runs(0) {
+  background.launch([this]() { decompress_all(); });
+}
+
+parallel_gzip_decompressor::~parallel_gzip_decompressor() {
+  lock.lock();
+  stopped = true;
+  cond.broadcast();
+  lock.unlock();
+  background.join();
+}
+
+std::streamsize parallel_gzip_decompressor::read(char* c, std::streamsize bufsize) {
+  std::lock_guard<mutex> guard(lock);
+  while (chunks.empty() && !done) cond.wait(lock);
+  if (chunks.empty()) {
+    if (!error.empty()) log_and_throw(error);
+    return -1;
+  }
+
+  std::streamsize num_read = 0;
+  while (num_read < bufsize && !chunks.empty()) {
+    const std::string& front = chunks.front();
+    size_t n = std::min<size_t>(bufsize - num_read, front.size() - front_position);
+    memcpy(c + num_read, front.data() + front_position, n);
+    num_read += n;
+    front_position += n;
+    queued_bytes -= n;
+    if (front_position == front.size()) {
+      chunks.pop_front();
+      front_position = 0;
+      cond.broadcast();
+    }
+  }
+  return num_read;
+}
+
+size_t parallel_gzip_decompressor::get_bytes_read() const {
+  return bytes_read.value;
+}
+
+size_t parallel_gzip_decompressor::get_num_runs() const {
+  return num_runs.value;
+}
+
+bool parallel_gzip_decompressor::push_chunk(std::string&& chunk) {
+  // bounds the decompressed data waiting to be read, to this plus the
+  // output of one window
+  const size_t MAX_QUEUED_BYTES = 4 * fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE;
+  if (chunk.empty()) return true;
+  std::lock_guard<mutex> guard(lock);
+  while (queued_bytes >= MAX_QUEUED_BYTES && !stopped) cond.wait(lock);
+  if (stopped) return false;
+  queued_bytes += chunk.size();
+  chunks.push_back(std::move(chunk));
+  cond.broadcast();
+  return true;
+}
+
+size_t parallel_gzip_decompressor::decompress_window(const std::string& window) {
+  size_t pos = 0;
+  if (carry) {
+    std::string output;
+    auto status = carry->inflate_some(window.data(), window.size(), pos, output);
+    if (status == inflate_stream::FAILED) log_and_throw("Invalid gzip stream");
+    if (status == inflate_stream::MEMBER_END) carry.reset();
+    if (!push_chunk(std::move(output)) || carry) return window.size();
+    if (pos == window.size()) return pos;
+  } else if (!has_gzip_magic(window, pos)) {
+    log_and_throw("Not a gzip stream");
+  }
+
+  if (!has_gzip_magic(window, pos)) {
+    logstream(LOG_WARNING) << "Ignoring trailing garbage after the gzip stream" << std::endl;
+    finished = true;
+    return window.size();
+  }
+
+  std::vector<size_t> starts = find_run_starts(window, pos, num_threads);
+  std::vector<inflate_run> runs(starts.size());
+  num_runs.inc(runs.size());
+  auto run_stop = [&](size_t i) {
+    return i + 1 < starts.size() ? starts[i + 1] : window.size();
+  };
+  {
+    thread_group threads;
+    for (size_t i = 1; i < runs.size(); ++i) {
+      runs[i].begin = starts[i];
+      threads.launch([&, i]() { inflate_members(window, run_stop(i), runs[i]); });
+    }
+    runs[0].begin = starts[0];
+    inflate_members(window, run_stop(0), runs[0]);
+    threads.join();
+  }
+
+  // Run i + 1 started on a member boundary only if run i ended on it.
+  for (size_t i = 0; i < runs.size(); ++i) {
+    auto& run = runs[i];
+    if (run.failed) log_and_throw("Invalid gzip stream");
+    if (!push_chunk(std::move(run.output))) return window.size();
+    if (run.trailing_garbage) {
+      logstream(LOG_WARNING) << "Ignoring trailing garbage after the gzip stream" << std::endl;
+      finished = true;
+      return window.size();
+    }
+    if (run.incomplete) {
+      carry = run.incomplete;
+      return window.size();
+    }
+    if (run.end != run_stop(i)) return run.end;
+  }
+  return window.size();
+}
+
+void parallel_gzip_decompressor::decompress_all() {
+  try {
+    std::string window;
+    bool eof = false;
+    while (!finished) {
+      {
+        std::lock_guard<mutex> guard(lock);
+        if (stopped) break;
+      }
+      if (!eof) {
+        size_t old_size = window.size();
+        window.resize(old_size + fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE);
+        compressed->read(&window[old_size], fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE);
+        size_t count = compressed->gcount();
+        window.resize(old_size + count);
+        bytes_read.inc(count);
+        eof = !compressed->good();
+      }
+      if (window.empty()) {
+        // the stream ended exactly at the end of the last window
+        if (carry) log_and_throw("Unexpected end of gzip stream");
+        break;
+      }
+      window.erase(0, decompress_window(window));
+      if (eof && carry) log_and_throw("Unexpected end of gzip stream");
+    }
+  } catch (std::string& e) {
+    std::lock_guard<mutex> guard(lock);
+    error = e;
+  } catch (std::exception& e) {
+    std::lock_guard<mutex> guard(lock);
+    error = e.what();
+  } catch (...) {
+    std::lock_guard<mutex> guard(lock);
+    error = "Unknown error decompressing gzip stream";
+  }
+  std::lock_guard<mutex> guard(lock);
+  done = true;
+  cond.broadcast();
+}
+
+} // namespace fileio_impl
+} // namespace graphlab
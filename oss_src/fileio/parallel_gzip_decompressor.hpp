@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef FILEIO_PARALLEL_GZIP_DECOMPRESSOR_HPP
+#define FILEIO_PARALLEL_GZIP_DECOMPRESSOR_HPP
+#include <memory>
+#include <string>
+#include <deque>
+#include <istream>
+#include <parallel/pthread_tools.hpp>
+#include <parallel/atomic.hpp>
+
+namespace graphlab {
+namespace fileio_impl {
+
+class inflate_stream;
+
+/**
+ * Decompresses a gzip stream on background threads, ahead of the reader.
+ *
+ * A background thread reads the compressed stream in windows of
+ * FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE bytes, and keeps a few windows of
+ * decompressed data ready for \ref read.
+ *
+ * A gzip file may be a sequence of independently compressed members
+ * (e.g. bgzip, or concatenated gzip files). Each window is cut at member
+ * boundaries into one run per thread, and the runs are inflated in
+ * parallel:
+ *  - bgzip members record their compressed size, so the boundaries are
+ *    exact.
+ *  - Otherwise, the boundaries are guessed by searching for gzip headers.
+ *    A run is only kept if the run before it ended exactly on its first
+ *    member; otherwise the window is cut where the run before it ended.
+ * A member which does not end in the window (e.g. a plain single member
+ * gzip file) is inflated sequentially across windows. Such files are not
+ * decompressed in parallel, but the decompression still overlaps with the
+ * work of the reader.
+ *
+ * The parallel_gzip_decompressor is NOT thread-safe.
+ */
+class parallel_gzip_decompressor {
+ public:
+  /**
+   * Starts decompressing the stream. The stream must not be used by anyone
+   * else until the decompressor is destroyed. Each window is inflated by at
+   * most num_threads threads.
+   */
+  explicit parallel_gzip_decompressor(std::shared_ptr<std::istream> compressed,
+                                      size_t num_threads = thread::cpu_count());
+
+  /**
+   * Stops the background thread.
+   */
+  ~parallel_gzip_decompressor();
+
+  parallel_gzip_decompressor(const parallel_gzip_decompressor&) = delete;
+  parallel_gzip_decompressor& operator=(const parallel_gzip_decompressor&) = delete;
+
+  /**
+   * Reads up to bufsize decompressed bytes into the buffer provided.
+   * Blocks until some bytes are available. Returns the number of bytes read,
+   * or -1 at the end of the stream. Throws if the stream is not a valid
+   * gzip stream.
+   */
+  std::streamsize read(char* c, std::streamsize bufsize);
+
+  /**
+   * Returns the number of compressed bytes read from the stream so far.
+   */
+  size_t get_bytes_read() const;
+
+  /**
+   * Returns the number of runs inflated so far. A window which was not
+   * split counts as one run; a window holding only the rest of a member
+   * carried from the window before counts as none.
+   */
+  size_t get_num_runs() const;
+
+ private:
+  /// The background thread
+  void decompress_all();
+
+  /**
+   * Inflates a window of compressed data, which starts with the remainder
+   * of the carried member if there is one, and pushes the result to the
+   * queue. Returns the number of bytes of the window consumed.
+   */
+  size_t decompress_window(const std::string& window);
+
+  /// Waits for room in the queue, and pushes a chunk. False if stopped.
+  bool push_chunk(std::string&& chunk);
+
+  std::shared_ptr<std::istream> compressed;
+  size_t num_threads;
+  atomic<size_t> bytes_read;
+  atomic<size_t> num_runs;
+
+  /// A member which is still being inflated at the end of the last window
+  std::shared_ptr<inflate_stream> carry;
+  /// Set by the background thread when the rest of the stream is ignored
+  bool finished = false;
+
+  mutex lock;
+  conditional cond;
+  std::deque<std::string> chunks;
+  /// Position in chunks.front() of the next byte to read
+  size_t front_position = 0;
+  /// The number of bytes in chunks
+  size_t queued_bytes = 0;
+  bool done = false;
+  bool stopped = false;
+  std::string error;
+
+  thread background;
+};
+
+} // namespace fileio_impl
+} // namespace graphlab
+#endif
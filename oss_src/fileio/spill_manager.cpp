@@ -0,0 +1,197 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <logger/logger.hpp>
+#include <logger/assertions.hpp>
+#include <fileio/temp_files.hpp>
+#include <fileio/spill_manager.hpp>
+
+namespace graphlab {
+
+/**************************************************************************/
+/*                                                                        */
+/*                         spill_accounting_scope                         */
+/*                                                                        */
+/**************************************************************************/
+
+/// The innermost scope open on the thread
+static __thread spill_accounting_scope* current_scope = nullptr;
+
+spill_accounting_scope::spill_accounting_scope(std::shared_ptr<atomic<size_t>> counter)
+    : m_counter(counter), m_parent(current_scope) {
+  current_scope = this;
+}
+
+spill_accounting_scope::~spill_accounting_scope() {
+  DASSERT_TRUE(current_scope == this);
+  current_scope = m_parent;
+}
+
+/**************************************************************************/
+/*                                                                        */
+/*                              spill_session                             */
+/*                                                                        */
+/**************************************************************************/
+
+spill_session::spill_session(memory_consumer consumer, const std::string& description)
+    : m_consumer(consumer), m_description(description) {
+  // a nested materialization may open a scope with the same counter
+  for (auto scope = current_scope; scope != nullptr; scope = scope->m_parent) {
+    if (std::find(m_query_counters.begin(), m_query_counters.end(),
+                  scope->m_counter) == m_query_counters.end()) {
+      m_query_counters.push_back(scope->m_counter);
+    }
+  }
+  spill_manager::get_instance().add_session(this);
+}
+
+spill_session::~spill_session() {
+  spill_manager::get_instance().remove_session(this);
+  if (m_num_runs.value > 0) {
+    logstream(LOG_INFO) << m_description << " spilled " << m_spilled_bytes.value
+                        << " bytes in " << m_num_runs.value << " runs" << std::endl;
+  }
+}
+
+size_t spill_session::open_run() {
+  return spill_manager::get_instance().choose_directory();
+}
+
+void spill_session::set_memory_budget(size_t bytes) {
+  std::lock_guard<mutex> guard(m_memory_lock);
+  m_memory_budget = bytes;
+}
+
+size_t spill_session::memory_budget() const {
+  std::lock_guard<mutex> guard(m_memory_lock);
+  return m_memory_budget;
+}
+
+size_t spill_session::memory_bytes() const {
+  std::lock_guard<mutex> guard(m_memory_lock);
+  return m_memory_bytes;
+}
+
+bool spill_session::reserve_memory(size_t bytes) {
+  std::lock_guard<mutex> guard(m_memory_lock);
+  if (m_memory_bytes + bytes > m_memory_budget) return false;
+  m_memory_bytes += bytes;
+  return true;
+}
+
+void spill_session::release_memory(size_t bytes) {
+  std::lock_guard<mutex> guard(m_memory_lock);
+  m_memory_bytes -= std::min(m_memory_bytes, bytes);
+}
+
+void spill_session::close_run(size_t directory, size_t bytes) {
+  m_spilled_bytes.inc(bytes);
+  m_num_runs.inc();
+  for (auto& counter: m_query_counters) counter->inc(bytes);
+  spill_manager::get_instance().add_spilled_bytes(m_consumer, directory, bytes);
+}
+
+/**************************************************************************/
+/*                                                                        */
+/*                              spill_manager                             */
+/*                                                                        */
+/**************************************************************************/
+
+spill_manager& spill_manager::get_instance() {
+  static spill_manager* manager = new spill_manager();
+  return *manager;
+}
+
+void spill_manager::update_directories(size_t num_directories) {
+  if (m_directories.size() < num_directories) m_directories.resize(num_directories);
+}
+
+size_t spill_manager::choose_directory() {
+  // the temp directories may be reconfigured at runtime
+  size_t num_directories = std::max<size_t>(num_temp_directories(), 1);
+  std::lock_guard<mutex> guard(m_lock);
+  update_directories(num_directories);
+  size_t best = m_next_directory % num_directories;
+  for (size_t i = 1; i < num_directories; ++i) {
+    size_t candidate = (m_next_directory + i) % num_directories;
+    const auto& c = m_directories[candidate];
+    const auto& b = m_directories[best];
+    if (c.num_runs < b.num_runs ||
+        (c.num_runs == b.num_runs && c.bytes < b.bytes)) {
+      best = candidate;
+    }
+  }
+  m_next_directory = best + 1;
+  ++m_directories[best].num_runs;
+  return best;
+}
+
+std::string spill_manager::get_run_name(size_t directory) {
+  return get_temp_name_in_directory(directory);
+}
+
+void spill_manager::release_run(size_t directory, size_t bytes) {
+  std::lock_guard<mutex> guard(m_lock);
+  ASSERT_LT(directory, m_directories.size());
+  auto& info = m_directories[directory];
+  if (info.num_runs > 0) --info.num_runs;
+  info.bytes -= std::min(info.bytes, bytes);
+}
+
+void spill_manager::add_spilled_bytes(memory_consumer consumer,
+                                      size_t directory,
+                                      size_t bytes) {
+  std::lock_guard<mutex> guard(m_lock);
+  ASSERT_LT(directory, m_directories.size());
+  m_directories[directory].bytes += bytes;
+  m_spilled_bytes[(size_t)consumer] += bytes;
+  ++m_num_runs[(size_t)consumer];
+  m_total_spilled_bytes.inc(bytes);
+}
+
+void spill_manager::add_session(spill_session* session) {
+  std::lock_guard<mutex> guard(m_lock);
+  m_sessions.push_back(session);
+}
+
+void spill_manager::remove_session(spill_session* session) {
+  std::lock_guard<mutex> guard(m_lock);
+  auto iter = std::find(m_sessions.begin(), m_sessions.end(), session);
+  if (iter != m_sessions.end()) m_sessions.erase(iter);
+}
+
+spill_manager::spill_stats spill_manager::get_stats() const {
+  auto paths = get_temp_directories();
+  spill_stats ret;
+  std::lock_guard<mutex> guard(m_lock);
+  for (size_t i = 0; i < (size_t)memory_consumer::NUM_CONSUMERS; ++i) {
+    ret.spilled_bytes[i] = m_spilled_bytes[i];
+    ret.num_runs[i] = m_num_runs[i];
+  }
+  for (size_t i = 0; i < paths.size(); ++i) {
+    directory_stats dir;
+    dir.path = paths[i];
+    if (i < m_directories.size()) {
+      dir.num_runs = m_directories[i].num_runs;
+      dir.bytes = m_directories[i].bytes;
+    }
+    ret.directories.push_back(dir);
+  }
+  for (const auto* session: m_sessions) {
+    session_stats s;
+    s.consumer = session->consumer();
+    s.description = session->description();
+    s.spilled_bytes = session->spilled_bytes();
+    s.num_runs = session->num_runs();
+    s.memory_bytes = session->memory_bytes();
+    ret.sessions.push_back(s);
+  }
+  return ret;
+}
+
+} // namespace graphlab
@@ -0,0 +1,217 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_FILEIO_SPILL_MANAGER_HPP
+#define GRAPHLAB_FILEIO_SPILL_MANAGER_HPP
+#include <memory>
+#include <string>
+#include <vector>
+#include <parallel/mutex.hpp>
+#include <parallel/atomic.hpp>
+#include <fileio/memory_governor.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup fileio
+ *
+ * Attributes the spills of the operators run by the calling thread to a
+ * query. While the scope lives, the spill_sessions created on the thread
+ * add the bytes they write to temp storage to counter, as well as to the
+ * counters of the scopes enclosing it.
+ *
+ * Scopes must be destroyed in the reverse order of their creation, on the
+ * thread which created them.
+ */
+class spill_accounting_scope {
+ public:
+  explicit spill_accounting_scope(std::shared_ptr<atomic<size_t>> counter);
+  ~spill_accounting_scope();
+
+  spill_accounting_scope(const spill_accounting_scope&) = delete;
+  spill_accounting_scope& operator=(const spill_accounting_scope&) = delete;
+
+ private:
+  friend class spill_session;
+  std::shared_ptr<atomic<size_t>> m_counter;
+  spill_accounting_scope* m_parent;
+};
+
+/**
+ * \ingroup fileio
+ *
+ * The spills of one memory intensive operator (a groupby, a join or a
+ * sort): the runs it wrote to temp storage, and their size on disk.
+ *
+ * The operator may also keep spilled rows in memory (in the cache://
+ * files of the fileio cache), up to its memory budget, normally the
+ * memory grant of the operator. Only what does not fit in the budget is
+ * written to the temp directories.
+ *
+ * A session is listed by the \ref spill_manager while it lives, so that
+ * the spills of the running queries can be monitored. Its spills are also
+ * added to the queries of the \ref spill_accounting_scope open on the
+ * thread creating it.
+ */
+class spill_session {
+ public:
+  spill_session(memory_consumer consumer, const std::string& description);
+  ~spill_session();
+
+  spill_session(const spill_session&) = delete;
+  spill_session& operator=(const spill_session&) = delete;
+
+  memory_consumer consumer() const { return m_consumer; }
+
+  const std::string& description() const { return m_description; }
+
+  /// The bytes written to temp storage by the session
+  size_t spilled_bytes() const { return m_spilled_bytes.value; }
+
+  /// The number of runs written by the session
+  size_t num_runs() const { return m_num_runs.value; }
+
+  /**
+   * Sets the bytes of spilled rows the session may keep in memory. 0 (the
+   * default) writes every spill to the temp directories.
+   */
+  void set_memory_budget(size_t bytes);
+
+  size_t memory_budget() const;
+
+  /// The bytes of spilled rows kept in memory, taken by \ref reserve_memory
+  size_t memory_bytes() const;
+
+  /**
+   * Takes bytes from the memory budget, to keep spilled rows in memory.
+   * Returns false, taking nothing, if they do not fit.
+   */
+  bool reserve_memory(size_t bytes);
+
+  /// Returns bytes taken by \ref reserve_memory
+  void release_memory(size_t bytes);
+
+  /**
+   * Picks the temp directory of a new run of the session. Every run
+   * opened must be closed by \ref close_run.
+   */
+  size_t open_run();
+
+  /**
+   * Records that a run opened by \ref open_run was written, with bytes
+   * bytes on disk. The bytes are counted as held on the directory until
+   * \ref release_run is called.
+   */
+  void close_run(size_t directory, size_t bytes);
+
+ private:
+  memory_consumer m_consumer;
+  std::string m_description;
+  atomic<size_t> m_spilled_bytes;
+  atomic<size_t> m_num_runs;
+  mutable mutex m_memory_lock;
+  size_t m_memory_budget = 0;
+  size_t m_memory_bytes = 0;
+  /// The counters of the queries the session runs in
+  std::vector<std::shared_ptr<atomic<size_t>>> m_query_counters;
+};
+
+/**
+ * \ingroup fileio
+ *
+ * A global singleton placing the runs spilled by the memory intensive
+ * operators on the temp directories (CACHE_FILE_LOCATIONS, see
+ * \ref get_temp_directories), and accounting for them.
+ *
+ * The runs are striped across the temp directories: a new run goes to the
+ * directory holding the fewest runs not yet released, then the fewest
+ * bytes, so that the spills of an operator, and of concurrent operators,
+ * are spread over all the disks rather than queued on one of them.
+ */
+class spill_manager {
+ public:
+  static spill_manager& get_instance();
+
+  /**
+   * Picks the temp directory of a new run. The run is held on the
+   * directory until \ref release_run is called.
+   */
+  size_t choose_directory();
+
+  /**
+   * Returns a temp file name on the temp directory chosen by
+   * \ref choose_directory, to be used as the prefix of the files of a run.
+   */
+  std::string get_run_name(size_t directory);
+
+  /**
+   * Releases a run placed by \ref choose_directory, once its files are
+   * deleted. bytes is the size it was accounted with, 0 if it was never
+   * closed.
+   */
+  void release_run(size_t directory, size_t bytes);
+
+  struct directory_stats {
+    std::string path;
+    /// The runs placed on the directory which are not released
+    size_t num_runs = 0;
+    /// The bytes of these runs
+    size_t bytes = 0;
+  };
+
+  struct session_stats {
+    memory_consumer consumer;
+    std::string description;
+    size_t spilled_bytes = 0;
+    size_t num_runs = 0;
+    /// The bytes of spilled rows kept in memory
+    size_t memory_bytes = 0;
+  };
+
+  struct spill_stats {
+    /// The bytes spilled so far, by consumer
+    size_t spilled_bytes[(size_t)memory_consumer::NUM_CONSUMERS] = {0};
+    /// The runs written so far, by consumer
+    size_t num_runs[(size_t)memory_consumer::NUM_CONSUMERS] = {0};
+    std::vector<directory_stats> directories;
+    /// The sessions alive, oldest first
+    std::vector<session_stats> sessions;
+  };
+
+  spill_stats get_stats() const;
+
+  /// The bytes spilled so far by all the operators
+  size_t total_spilled_bytes() const { return m_total_spilled_bytes.value; }
+
+ private:
+  spill_manager() = default;
+  friend class spill_session;
+
+  void add_session(spill_session* session);
+  void remove_session(spill_session* session);
+  void add_spilled_bytes(memory_consumer consumer, size_t directory, size_t bytes);
+
+  /// Grows m_directories to num_directories entries
+  void update_directories(size_t num_directories);
+
+  struct directory_info {
+    size_t num_runs = 0;
+    size_t bytes = 0;
+  };
+
+  mutable mutex m_lock;
+  std::vector<directory_info> m_directories;
+  /// Breaks the ties between equally loaded directories
+  size_t m_next_directory = 0;
+  std::vector<spill_session*> m_sessions;
+  size_t m_spilled_bytes[(size_t)memory_consumer::NUM_CONSUMERS] = {0};
+  size_t m_num_runs[(size_t)memory_consumer::NUM_CONSUMERS] = {0};
+  atomic<size_t> m_total_spilled_bytes;
+};
+
+} // namespace graphlab
+#endif
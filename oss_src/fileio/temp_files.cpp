@@ -296,16 +296,11 @@ EXPORT void reap_unused_temp_files() {
 }
 
 
-EXPORT std::string get_temp_name(const std::string& prefix, bool _prefer_hdfs) {
-  std::lock_guard<mutex> lg(get_temp_info().lock);
-
-  // Local system temp dir
-  fs::path path(get_current_process_temp_directory(get_temp_info().temp_file_counter++));
-  // hdfs temp dir
-  fs::path hdfs_path(get_current_process_hdfs_temp_directory());
-  if (_prefer_hdfs && !hdfs_path.empty()) {
-    path = hdfs_path;
-  }
+/**
+ * Returns a temp file name in the directory path, which is created if it
+ * does not exist. The temp info lock must be held.
+ */
+static std::string get_temp_name_in_path(fs::path path, const std::string& prefix) {
   // create the directories if they do not exist
   create_current_process_temp_directory(path.string());
   
@@ -322,8 +317,26 @@ EXPORT std::string get_temp_name(const std::string& prefix, bool _prefer_hdfs) {
   get_temp_info().tempfile_history.insert(ret);
 
   return ret;
+}
+
+EXPORT std::string get_temp_name(const std::string& prefix, bool _prefer_hdfs) {
+  std::lock_guard<mutex> lg(get_temp_info().lock);
+
+  // Local system temp dir
+  fs::path path(get_current_process_temp_directory(get_temp_info().temp_file_counter++));
+  // hdfs temp dir
+  fs::path hdfs_path(get_current_process_hdfs_temp_directory());
+  if (_prefer_hdfs && !hdfs_path.empty()) {
+    path = hdfs_path;
+  }
+  return get_temp_name_in_path(path, prefix);
 };
 
+std::string get_temp_name_in_directory(size_t idx, const std::string& prefix) {
+  std::lock_guard<mutex> lg(get_temp_info().lock);
+  return get_temp_name_in_path(get_current_process_temp_directory(idx), prefix);
+}
+
 std::string get_temp_name_prefer_hdfs(const std::string& prefix) {
   bool prefer_hdfs = true;
   return get_temp_name(prefix, prefer_hdfs);
@@ -400,6 +413,35 @@ void delete_temp_files(std::vector<std::string> files) {
   }
 }
 
+std::pair<size_t, size_t> get_current_process_temp_usage() {
+  std::vector<fs::path> directories;
+  {
+    std::lock_guard<mutex> lg(get_temp_info().lock);
+    directories.assign(get_temp_info().process_temp_directories.begin(),
+                       get_temp_info().process_temp_directories.end());
+  }
+  size_t num_files = 0;
+  size_t num_bytes = 0;
+  for (auto& path: directories) {
+    if (fileio::get_protocol(path.string()) == "hdfs") continue;
+    // files come and go while we look. Failures are ok.
+    try {
+      auto diriter = fs::recursive_directory_iterator(path,
+                                                      fs::symlink_option::no_recurse);
+      auto enditer = fs::recursive_directory_iterator();
+      for (; diriter != enditer; ++diriter) {
+        boost::system::error_code ec;
+        if (!fs::is_regular_file(diriter->path(), ec)) continue;
+        size_t size = fs::file_size(diriter->path(), ec);
+        if (ec) continue;
+        ++num_files;
+        num_bytes += size;
+      }
+    } catch (...) { }
+  }
+  return {num_files, num_bytes};
+}
+
 void reap_current_process_temp_files() {
   // remove all if possible. Ignore exceptions
   // We go straight to delete_path_impl here to avoid the reference counting
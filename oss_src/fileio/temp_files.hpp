@@ -9,6 +9,7 @@
 #define FILEIO_TEMP_FILE_HPP 
 #include <string>
 #include <vector>
+#include <utility>
 
 namespace graphlab {
 
@@ -50,6 +51,13 @@ std::string get_temp_name(const std::string& prefix="", bool _prefer_hdfs=false)
  */
 std::string get_temp_name_prefer_hdfs(const std::string& prefix="");
 
+/**
+ * Same as get_temp_name but returns a temp file on the local temp
+ * directory idx (see \ref get_temp_directories). idx can be any value, in
+ * which case the indices loop around.
+ */
+std::string get_temp_name_in_directory(size_t idx, const std::string& prefix="");
+
 /**
  * Deletes the temporary file with the name s. 
  * Returns true on success, false on failure (file does not exist, 
@@ -98,5 +106,11 @@ std::vector<std::string> get_temp_directories();
  * Returns the number of temp directories
  */
 size_t num_temp_directories();
+
+/**
+ * Returns the number of files, and their total size in bytes, in the
+ * local temp directories of the current process.
+ */
+std::pair<size_t, size_t> get_current_process_temp_usage();
 } // namespace graphlab
 #endif
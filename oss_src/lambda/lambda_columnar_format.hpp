@@ -0,0 +1,410 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_LAMBDA_LAMBDA_COLUMNAR_FORMAT_HPP
+#define GRAPHLAB_LAMBDA_LAMBDA_COLUMNAR_FORMAT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <logger/logger.hpp>
+#include <logger/assertions.hpp>
+#include <flexible_type/flexible_type.hpp>
+#include <serialization/serialization_includes.hpp>
+#include <sframe/sframe_rows.hpp>
+
+namespace graphlab {
+namespace lambda {
+
+/**
+ * \ingroup lambda
+ *
+ * Columnar wire format used to ship batches of rows between the
+ * lambda_master and the lambda workers over shared memory.
+ *
+ * Serializing \ref sframe_rows through an oarchive writes every value as a
+ * tagged flexible_type, which the worker must deserialize into
+ * flexible_types before converting each one into a python object.
+ * The columnar format instead lays out every column as typed buffers, so
+ * that the receiver can read values straight out of the received buffer
+ * (e.g. build a python int directly from an int64_t) without materializing
+ * any intermediate flexible_type.
+ *
+ * Layout of a block. Every field is a uint64_t unless noted otherwise, and
+ * every section starts at a multiple of 8 bytes from the block start:
+ * \verbatim
+ *   version | num_rows | num_columns | block_size
+ *   for each column:
+ *     encoding | null_count | payload_size
+ *     null bitmap: (num_rows + 63) / 64 words, only if null_count > 0.
+ *                  Bit i set means row i is missing (FLEX_UNDEFINED).
+ *     payload:
+ *       INTEGER: int64_t[num_rows]
+ *       FLOAT:   double[num_rows]
+ *       STRING:  offsets[num_rows + 1] followed by the string bytes
+ *       GENERIC: offsets[num_rows + 1] followed by each value serialized
+ *                as a flexible_type
+ *       (null rows hold 0 / empty entries)
+ * \endverbatim
+ *
+ * A column is encoded as INTEGER, FLOAT or STRING if all of its non
+ * missing values are of that type, and as GENERIC otherwise.
+ *
+ * Blocks are written at an 8 byte aligned offset of an oarchive buffer
+ * (see \ref write_columnar_block), so a \ref columnar_block_view over a
+ * malloc'ed receive buffer can read the typed arrays in place.
+ */
+
+enum class columnar_encoding: uint64_t {
+  INTEGER = 0,
+  FLOAT = 1,
+  STRING = 2,
+  GENERIC = 3
+};
+
+static const uint64_t COLUMNAR_FORMAT_VERSION = 1;
+
+static const size_t COLUMNAR_ALIGNMENT = sizeof(uint64_t);
+
+/// Rounds an offset up to the columnar alignment.
+inline size_t columnar_align(size_t off) {
+  return (off + COLUMNAR_ALIGNMENT - 1) / COLUMNAR_ALIGNMENT * COLUMNAR_ALIGNMENT;
+}
+
+namespace columnar_impl {
+
+inline void pad(oarchive& oarc) {
+  size_t padding = columnar_align(oarc.off) - oarc.off;
+  if (padding > 0) {
+    char zeros[COLUMNAR_ALIGNMENT] = {0};
+    oarc.write(zeros, padding);
+  }
+}
+
+inline void patch(oarchive& oarc, size_t pos, uint64_t value) {
+  memcpy(oarc.buf + pos, &value, sizeof(value));
+}
+
+inline size_t num_bitmap_words(size_t num_rows) {
+  return (num_rows + 63) / 64;
+}
+
+template <typename Accessor>
+inline columnar_encoding choose_encoding(size_t num_rows, Accessor value) {
+  flex_type_enum type = flex_type_enum::UNDEFINED;
+  for (size_t i = 0; i < num_rows; ++i) {
+    flex_type_enum t = value(i).get_type();
+    if (t == flex_type_enum::UNDEFINED) continue;
+    if (type == flex_type_enum::UNDEFINED) type = t;
+    else if (type != t) return columnar_encoding::GENERIC;
+  }
+  switch(type) {
+   case flex_type_enum::UNDEFINED:
+   case flex_type_enum::INTEGER:
+     return columnar_encoding::INTEGER;
+   case flex_type_enum::FLOAT:
+     return columnar_encoding::FLOAT;
+   case flex_type_enum::STRING:
+     return columnar_encoding::STRING;
+   default:
+     return columnar_encoding::GENERIC;
+  }
+}
+
+/**
+ * Writes one column of num_rows values, where value(i) returns the i-th
+ * flexible_type of the column.
+ */
+template <typename Accessor>
+inline void write_column(oarchive& oarc, size_t num_rows, Accessor value) {
+  columnar_encoding encoding = choose_encoding(num_rows, value);
+
+  std::vector<uint64_t> null_bitmap(num_bitmap_words(num_rows), 0);
+  uint64_t null_count = 0;
+  for (size_t i = 0; i < num_rows; ++i) {
+    if (value(i).get_type() == flex_type_enum::UNDEFINED) {
+      null_bitmap[i / 64] |= (uint64_t(1) << (i % 64));
+      ++null_count;
+    }
+  }
+
+  oarc.direct_assign<uint64_t>((uint64_t)encoding);
+  oarc.direct_assign<uint64_t>(null_count);
+  size_t payload_size_pos = oarc.off;
+  oarc.direct_assign<uint64_t>(0);
+  if (null_count > 0) {
+    oarc.write(reinterpret_cast<const char*>(null_bitmap.data()),
+               null_bitmap.size() * sizeof(uint64_t));
+  }
+
+  size_t payload_start = oarc.off;
+  switch(encoding) {
+   case columnar_encoding::INTEGER:
+     for (size_t i = 0; i < num_rows; ++i) {
+       const flexible_type& v = value(i);
+       oarc.direct_assign<int64_t>(v.get_type() == flex_type_enum::INTEGER ?
+                                   v.get<flex_int>() : 0);
+     }
+     break;
+   case columnar_encoding::FLOAT:
+     for (size_t i = 0; i < num_rows; ++i) {
+       const flexible_type& v = value(i);
+       oarc.direct_assign<double>(v.get_type() == flex_type_enum::FLOAT ?
+                                  v.get<flex_float>() : 0.0);
+     }
+     break;
+   case columnar_encoding::STRING:
+   case columnar_encoding::GENERIC:
+     {
+       // reserve the offsets, write the values, then fill in the offsets.
+       size_t offsets_pos = oarc.off;
+       oarc.advance((num_rows + 1) * sizeof(uint64_t));
+       size_t bytes_start = oarc.off;
+       patch(oarc, offsets_pos, 0);
+       for (size_t i = 0; i < num_rows; ++i) {
+         const flexible_type& v = value(i);
+         if (v.get_type() != flex_type_enum::UNDEFINED) {
+           if (encoding == columnar_encoding::STRING) {
+             const flex_string& s = v.get<flex_string>();
+             oarc.write(s.data(), s.size());
+           } else {
+             oarc << v;
+           }
+         }
+         patch(oarc, offsets_pos + (i + 1) * sizeof(uint64_t), oarc.off - bytes_start);
+       }
+       pad(oarc);
+     }
+     break;
+  }
+  patch(oarc, payload_size_pos, oarc.off - payload_start);
+}
+
+template <typename ColumnWriter>
+inline void write_block(oarchive& oarc, size_t num_rows, size_t num_columns,
+                        ColumnWriter write_column_fn) {
+  ASSERT_TRUE(oarc.out == NULL);
+  pad(oarc);
+  size_t block_start = oarc.off;
+  oarc.direct_assign<uint64_t>(COLUMNAR_FORMAT_VERSION);
+  oarc.direct_assign<uint64_t>(num_rows);
+  oarc.direct_assign<uint64_t>(num_columns);
+  oarc.direct_assign<uint64_t>(0);
+  for (size_t j = 0; j < num_columns; ++j) write_column_fn(j);
+  patch(oarc, block_start + 3 * sizeof(uint64_t), oarc.off - block_start);
+}
+
+} // namespace columnar_impl
+
+
+/**
+ * Writes the rows as a columnar block into a buffer backed oarchive,
+ * after padding the archive to an aligned offset.
+ */
+inline void write_columnar_block(oarchive& oarc, const sframe_rows& rows) {
+  const auto& columns = rows.cget_columns();
+  size_t num_rows = rows.num_rows();
+  columnar_impl::write_block(oarc, num_rows, columns.size(), [&](size_t j) {
+    const std::vector<flexible_type>& column = *columns[j];
+    columnar_impl::write_column(oarc, num_rows,
+                                [&](size_t i) -> const flexible_type& { return column[i]; });
+  });
+}
+
+/**
+ * \overload
+ * Writes a single column block.
+ */
+inline void write_columnar_block(oarchive& oarc, const std::vector<flexible_type>& column) {
+  columnar_impl::write_block(oarc, column.size(), 1, [&](size_t) {
+    columnar_impl::write_column(oarc, column.size(),
+                                [&](size_t i) -> const flexible_type& { return column[i]; });
+  });
+}
+
+
+/**
+ * \ingroup lambda
+ *
+ * Read only view over one column of a columnar block.
+ * Does not own or copy any data.
+ */
+class columnar_column_view {
+ public:
+  columnar_column_view() = default;
+
+  inline columnar_encoding encoding() const { return m_encoding; }
+
+  inline size_t size() const { return m_num_rows; }
+
+  inline size_t null_count() const { return m_null_count; }
+
+  inline bool is_null(size_t i) const {
+    return m_null_bitmap != nullptr &&
+        (m_null_bitmap[i / 64] & (uint64_t(1) << (i % 64)));
+  }
+
+  /// The values of an INTEGER column. Missing rows are 0.
+  inline const int64_t* int_data() const {
+    DASSERT_TRUE(m_encoding == columnar_encoding::INTEGER);
+    return reinterpret_cast<const int64_t*>(m_data);
+  }
+
+  /// The values of a FLOAT column. Missing rows are 0.
+  inline const double* float_data() const {
+    DASSERT_TRUE(m_encoding == columnar_encoding::FLOAT);
+    return reinterpret_cast<const double*>(m_data);
+  }
+
+  /// The bytes of row i of a STRING or GENERIC column.
+  inline const char* bytes_at(size_t i) const {
+    return m_bytes + m_offsets[i];
+  }
+
+  /// The number of bytes of row i of a STRING or GENERIC column.
+  inline size_t bytes_length(size_t i) const {
+    return m_offsets[i + 1] - m_offsets[i];
+  }
+
+  /**
+   * Returns row i as a flexible_type.
+   */
+  inline flexible_type value_at(size_t i) const {
+    if (is_null(i)) return FLEX_UNDEFINED;
+    switch(m_encoding) {
+     case columnar_encoding::INTEGER:
+       return flex_int(int_data()[i]);
+     case columnar_encoding::FLOAT:
+       return flex_float(float_data()[i]);
+     case columnar_encoding::STRING:
+       return flex_string(bytes_at(i), bytes_length(i));
+     case columnar_encoding::GENERIC:
+     default:
+       {
+         flexible_type ret;
+         iarchive iarc(bytes_at(i), bytes_length(i));
+         iarc >> ret;
+         return ret;
+       }
+    }
+  }
+
+  /**
+   * Decodes the whole column into out.
+   */
+  inline void decode(std::vector<flexible_type>& out) const {
+    out.resize(m_num_rows);
+    for (size_t i = 0; i < m_num_rows; ++i) out[i] = value_at(i);
+  }
+
+ private:
+  friend class columnar_block_view;
+
+  columnar_encoding m_encoding = columnar_encoding::INTEGER;
+  size_t m_num_rows = 0;
+  size_t m_null_count = 0;
+  const uint64_t* m_null_bitmap = nullptr;
+  const char* m_data = nullptr;
+  const uint64_t* m_offsets = nullptr;
+  const char* m_bytes = nullptr;
+};
+
+
+/**
+ * \ingroup lambda
+ *
+ * Read only view over a columnar block written by \ref write_columnar_block.
+ * The buffer must be 8 byte aligned and outlive the view.
+ *
+ * \code
+ * iarchive iarc(buf, len);
+ * iarc >> header_fields;
+ * columnar_block_view block(buf + columnar_align(iarc.off), len - columnar_align(iarc.off));
+ * const int64_t* values = block.column(0).int_data();
+ * \endcode
+ */
+class columnar_block_view {
+ public:
+  columnar_block_view() = default;
+
+  /**
+   * Parses the block header at buf. Throws if the buffer does not hold a
+   * valid block.
+   */
+  columnar_block_view(const char* buf, size_t len) {
+    ASSERT_TRUE(((size_t)buf) % COLUMNAR_ALIGNMENT == 0);
+    size_t off = 0;
+    auto read_word = [&]() -> uint64_t {
+      if (off + sizeof(uint64_t) > len) {
+        log_and_throw("Truncated columnar lambda block");
+      }
+      uint64_t ret;
+      memcpy(&ret, buf + off, sizeof(ret));
+      off += sizeof(ret);
+      return ret;
+    };
+    uint64_t version = read_word();
+    if (version != COLUMNAR_FORMAT_VERSION) {
+      log_and_throw("Unsupported columnar lambda block version " + std::to_string(version));
+    }
+    m_num_rows = read_word();
+    size_t num_columns = read_word();
+    m_block_size = read_word();
+    if (m_block_size > len) log_and_throw("Truncated columnar lambda block");
+
+    m_columns.resize(num_columns);
+    for (auto& col : m_columns) {
+      col.m_num_rows = m_num_rows;
+      col.m_encoding = (columnar_encoding)read_word();
+      col.m_null_count = read_word();
+      size_t payload_size = read_word();
+      if (col.m_null_count > 0) {
+        col.m_null_bitmap = reinterpret_cast<const uint64_t*>(buf + off);
+        off += columnar_impl::num_bitmap_words(m_num_rows) * sizeof(uint64_t);
+      }
+      if (off + payload_size > m_block_size) {
+        log_and_throw("Truncated columnar lambda block");
+      }
+      switch(col.m_encoding) {
+       case columnar_encoding::INTEGER:
+       case columnar_encoding::FLOAT:
+         col.m_data = buf + off;
+         break;
+       case columnar_encoding::STRING:
+       case columnar_encoding::GENERIC:
+         col.m_offsets = reinterpret_cast<const uint64_t*>(buf + off);
+         col.m_bytes = buf + off + (m_num_rows + 1) * sizeof(uint64_t);
+         break;
+       default:
+         log_and_throw("Invalid columnar lambda block encoding");
+      }
+      off += payload_size;
+    }
+  }
+
+  inline size_t num_rows() const { return m_num_rows; }
+
+  inline size_t num_columns() const { return m_columns.size(); }
+
+  /// Size of the block in bytes.
+  inline size_t size_bytes() const { return m_block_size; }
+
+  inline const columnar_column_view& column(size_t i) const {
+    DASSERT_LT(i, m_columns.size());
+    return m_columns[i];
+  }
+
+ private:
+  size_t m_num_rows = 0;
+  size_t m_block_size = 0;
+  std::vector<columnar_column_view> m_columns;
+};
+
+} // namespace lambda
+} // namespace graphlab
+
+#endif
@@ -15,6 +15,12 @@ size_t DEFAULT_NUM_PYLAMBDA_WORKERS = 16;
 
 size_t DEFAULT_NUM_GRAPH_LAMBDA_WORKERS = 16;
 
+size_t LAMBDA_COLUMNAR_WIRE_FORMAT = 1;
+
+size_t LAMBDA_MAX_INFLIGHT_BATCHES = 4;
+
+size_t LAMBDA_SHM_SLOTS_PER_WORKER = 2;
+
 REGISTER_GLOBAL_WITH_CHECKS(int64_t,
                             DEFAULT_NUM_PYLAMBDA_WORKERS,
                             true, 
@@ -24,4 +30,19 @@ REGISTER_GLOBAL_WITH_CHECKS(int64_t,
                             DEFAULT_NUM_GRAPH_LAMBDA_WORKERS,
                             true, 
                             +[](int64_t val){ return val >= 1; });
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            LAMBDA_COLUMNAR_WIRE_FORMAT,
+                            true,
+                            +[](int64_t val){ return val == 0 || val == 1; });
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            LAMBDA_MAX_INFLIGHT_BATCHES,
+                            true,
+                            +[](int64_t val){ return val >= 1; });
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            LAMBDA_SHM_SLOTS_PER_WORKER,
+                            true,
+                            +[](int64_t val){ return val >= 1; });
 }
@@ -21,6 +21,27 @@ extern size_t DEFAULT_NUM_PYLAMBDA_WORKERS;
  */
 extern size_t DEFAULT_NUM_GRAPH_LAMBDA_WORKERS;
 
+/**
+ * If true, rows sent to the lambda workers over shared memory (and the
+ * results sent back) use the columnar wire format instead of serialized
+ * flexible_types.
+ */
+extern size_t LAMBDA_COLUMNAR_WIRE_FORMAT;
+
+/**
+ * Maximum number of batches a lambda transform keeps in flight at once.
+ * While these are evaluated by the lambda workers, the pipeline thread
+ * reads and dispatches the next batches. 1 evaluates synchronously.
+ */
+extern size_t LAMBDA_MAX_INFLIGHT_BATCHES;
+
+/**
+ * Number of shared memory segments each pylambda worker serves. A worker
+ * receives and decodes the batch of one segment while it evaluates the
+ * batch of another, so that it does not idle between batches.
+ */
+extern size_t LAMBDA_SHM_SLOTS_PER_WORKER;
+
 }
 
 #endif
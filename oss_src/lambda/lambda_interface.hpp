@@ -19,6 +19,10 @@ namespace lambda {
 enum class bulk_eval_serialized_tag:char {
   BULK_EVAL_ROWS = 0,
   BULK_EVAL_DICT_ROWS = 1,
+  /// As BULK_EVAL_ROWS, with the rows and the result in the columnar format.
+  BULK_EVAL_COLUMNAR_ROWS = 2,
+  /// As BULK_EVAL_DICT_ROWS, with the rows and the result in the columnar format.
+  BULK_EVAL_COLUMNAR_DICT_ROWS = 3,
 };
 
 GENERATE_INTERFACE_AND_PROXY(lambda_evaluator_interface, lambda_evaluator_proxy,
@@ -28,7 +32,7 @@ GENERATE_INTERFACE_AND_PROXY(lambda_evaluator_interface, lambda_evaluator_proxy,
       (std::vector<flexible_type>, bulk_eval_rows, (size_t)(const sframe_rows&)(bool)(int))
       (std::vector<flexible_type>, bulk_eval_dict, (size_t)(const std::vector<std::string>&)(const std::vector<std::vector<flexible_type>>&)(bool)(int))
       (std::vector<flexible_type>, bulk_eval_dict_rows, (size_t)(const std::vector<std::string>&)(const sframe_rows&)(bool)(int))
-      (std::string, initialize_shared_memory_comm, )
+      (std::vector<std::string>, initialize_shared_memory_comm, )
     )
 } // namespace lambda
 } // namespace graphlab
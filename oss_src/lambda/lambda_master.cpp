@@ -8,10 +8,12 @@
 #include <lambda/lambda_master.hpp>
 #include <lambda/lambda_utils.hpp>
 #include <parallel/lambda_omp.hpp>
+#include <parallel/thread_pool.hpp>
 #include <fileio/temp_files.hpp>
 #include <algorithm>
 #include <lambda/lambda_constants.hpp>
 #include <shmipc/shmipc.hpp>
+#include <lambda/lambda_columnar_format.hpp>
 
 namespace graphlab { namespace lambda {
 
@@ -22,6 +24,8 @@ namespace graphlab { namespace lambda {
 
 std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
 
+std::atomic<bool> lambda_master::instantiated(false);
+
   lambda_master& lambda_master::get_instance() {
     static lambda_master instance(std::min<size_t>(DEFAULT_NUM_PYLAMBDA_WORKERS,
                                                      std::max<size_t>(thread::cpu_count(), 1)));
@@ -36,6 +40,7 @@ std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
     m_worker_pool.reset(new worker_pool<lambda_evaluator_proxy>(nworkers,
                                                                 lambda_worker_binary_and_args,
                                                                 worker_addresses));
+    instantiated = true;
     if (nworkers < thread::cpu_count()) {
       logprogress_stream << "Using default " << nworkers << " lambda workers.\n";
       logprogress_stream << "To maximize the degree of parallelism, add the following code to the beginning of the program:\n";
@@ -46,21 +51,86 @@ std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
     /*
      * Create an interprocess shared memory connection if possible.
      */
+    typedef std::pair<void*, std::vector<std::string>> worker_addresses_type;
     auto shared_memory_setup = [](std::shared_ptr<lambda_evaluator_proxy> proxy) {
       return std::make_pair((void*)(proxy.get()), proxy->initialize_shared_memory_comm());
     };
-    std::vector<std::pair<void*, std::string>> shared_memory_addresses = 
-        m_worker_pool->call_all_workers<std::pair<void*, std::string>>(shared_memory_setup);
+    std::vector<worker_addresses_type> shared_memory_addresses = 
+        m_worker_pool->call_all_workers<worker_addresses_type>(shared_memory_setup);
 
-    for (auto shared_memory_address: shared_memory_addresses) {
-      // for each worker, try to connect and store the addresses
-      if (!shared_memory_address.second.empty()) {
+    // for each worker, try to connect to each of its segments. The slots
+    // are interleaved across the workers.
+    size_t max_slots = 0;
+    for (const auto& worker_addresses: shared_memory_addresses) {
+      max_slots = std::max(max_slots, worker_addresses.second.size());
+    }
+    for (size_t i = 0; i < max_slots; ++i) {
+      for (const auto& worker_addresses: shared_memory_addresses) {
+        if (i >= worker_addresses.second.size()) continue;
         std::shared_ptr<shmipc::client> client = std::make_shared<shmipc::client>();
-        if (client->connect(shared_memory_address.second)) {
-          m_shared_memory_worker_connections[shared_memory_address.first] = client;
+        if (client->connect(worker_addresses.second[i])) {
+          m_shm_slots.emplace_back(new shm_slot);
+          m_shm_slots.back()->worker = worker_addresses.first;
+          m_shm_slots.back()->client = client;
+        }
+      }
+    }
+    m_num_working_shm_slots = m_shm_slots.size();
+
+    // enough threads to fill every slot (or every worker)
+    m_dispatch_pool.reset(new thread_pool(std::max(m_shm_slots.size(), nworkers)));
+  }
+
+  lambda_master::~lambda_master() { }
+
+  size_t lambda_master::num_available_workers() {
+    size_t available = m_worker_pool->num_available_workers();
+    std::lock_guard<graphlab::mutex> guard(m_shm_slot_mutex);
+    size_t busy = 0;
+    for (const auto& worker_busy: m_busy_shm_slots) {
+      if (worker_busy.second > 0) ++busy;
+    }
+    return available - std::min(available, busy);
+  }
+
+  void lambda_master::launch_dispatch(const boost::function<void (void)>& fn) {
+    m_dispatch_pool->launch(fn);
+  }
+
+  lambda_master::shm_slot* lambda_master::acquire_shm_slot() {
+    std::unique_lock<graphlab::mutex> guard(m_shm_slot_mutex);
+    while (m_num_working_shm_slots > 0) {
+      shm_slot* best = nullptr;
+      size_t best_busy = (size_t)(-1);
+      for (const auto& slot: m_shm_slots) {
+        if (slot->busy || slot->client == nullptr) continue;
+        size_t busy = m_busy_shm_slots[slot->worker];
+        if (busy < best_busy) {
+          best = slot.get();
+          best_busy = busy;
         }
       }
+      if (best != nullptr) {
+        best->busy = true;
+        ++m_busy_shm_slots[best->worker];
+        return best;
+      }
+      m_shm_slot_cond.wait(guard);
+    }
+    return nullptr;
+  }
+
+  void lambda_master::release_shm_slot(shm_slot* slot, bool good) {
+    std::lock_guard<graphlab::mutex> guard(m_shm_slot_mutex);
+    slot->busy = false;
+    --m_busy_shm_slots[slot->worker];
+    if (!good) {
+      // never use it again, and fall back to regular IPC
+      slot->client.reset();
+      --m_num_working_shm_slots;
+      logstream(LOG_WARNING) << "Unexpected SHMIPC failure. Falling back to CPPIPC" << std::endl;
     }
+    m_shm_slot_cond.notify_all();
   }
 
   size_t lambda_master::make_lambda(const std::string& lambda_str) {
@@ -146,14 +216,15 @@ std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
    * will also take over management of the buffer inside of "arguments" and
    * free it when done.
    *
-   * Results will be deserialized into the ret.
+   * The results are read from the reply archive by read_result, which is
+   * called as read_result(iarchive&) while the receive buffer is still alive.
    *
    * This function may throw exceptions if remote exceptions were raised.
    */
-  template <typename RetType>
+  template <typename ReadFn>
   static bool shm_call(const std::shared_ptr<shmipc::client>& shmclient,
                        oarchive& arguments,
-                       RetType& ret) {
+                       ReadFn read_result) {
     // send the message
     bool shmok = shmipc::large_send(*shmclient, arguments.buf, arguments.off);
     if (shmok == false) {
@@ -179,10 +250,11 @@ std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
     char good_call;
     iarc >> good_call;
     if (good_call) {
-      iarc >> ret;
+      read_result(iarc);
     } else {
       std::string message;
       iarc >> message;
+      free(buf);
       throw message;
     }
     free(buf);
@@ -190,6 +262,45 @@ std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
     return true;
   }
 
+  /**
+   * Reads a result serialized as a std::vector<flexible_type>.
+   */
+  static std::function<void(iarchive&)> read_serialized_result(std::vector<flexible_type>& out) {
+    return [&out](iarchive& iarc) { iarc >> out; };
+  }
+
+  /**
+   * Reads a result written as a single column columnar block.
+   */
+  static std::function<void(iarchive&)> read_columnar_result(std::vector<flexible_type>& out) {
+    return [&out](iarchive& iarc) {
+      size_t block_start = columnar_align(iarc.off);
+      columnar_block_view block(iarc.buf + block_start, iarc.len - block_start);
+      ASSERT_EQ(block.num_columns(), 1);
+      block.column(0).decode(out);
+    };
+  }
+
+
+  bool lambda_master::shm_bulk_eval(oarchive& arguments,
+                                    const std::function<void(iarchive&)>& read_result) {
+    shm_slot* slot = acquire_shm_slot();
+    if (slot == nullptr) {
+      free(arguments.buf);
+      arguments.buf = nullptr;
+      return false;
+    }
+    bool good = false;
+    try {
+      good = shm_call(slot->client, arguments, read_result);
+    } catch (...) {
+      // an exception raised by the lambda: the slot still works
+      release_shm_slot(slot, true);
+      throw;
+    }
+    release_shm_slot(slot, good);
+    return good;
+  }
 
   /**
    * \overload with sframe rows
@@ -200,34 +311,35 @@ std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
                                   bool skip_undefined,
                                   int seed) {
 
-    auto worker_proxy = m_worker_pool->get_worker();
-    auto worker_guard = m_worker_pool->get_worker_guard(worker_proxy);
-
-    // catch and reinterpret comm failure
-    try {
-      auto shmclient_iter = m_shared_memory_worker_connections.find(worker_proxy.get());
-      if (shmclient_iter != m_shared_memory_worker_connections.end() &&
-          shmclient_iter->second.get() != nullptr) {
-        auto& shmclient = shmclient_iter->second;
-        oarchive oarc;
+    // Serialize the request before taking a worker, so that the worker
+    // does not sit idle while the batch is being encoded.
+    oarchive oarc;
+    std::function<void(iarchive&)> read_result;
+    if (m_num_working_shm_slots > 0) {
+      if (LAMBDA_COLUMNAR_WIRE_FORMAT) {
+        oarc << (char)(bulk_eval_serialized_tag::BULK_EVAL_COLUMNAR_ROWS)
+             << lambda_hash
+             << skip_undefined
+             << seed;
+        write_columnar_block(oarc, args);
+        read_result = read_columnar_result(out);
+      } else {
         oarc << (char)(bulk_eval_serialized_tag::BULK_EVAL_ROWS)
              << lambda_hash
              << args
              << skip_undefined
              << seed;
-        bool good = shm_call(shmclient, oarc, out);
-        // if shmcall was good, return. 
-        if (good) return;
-
-        // otherwise shmcall was bad. reset the client so we don't ever use
-        // it again and fall back to regular IPC.
-        // (note. we cannot delete it from the
-        // m_shared_memory_worker_connections map because of concurency 
-        // issues. There may be parallel access to it and locking seems 
-        // overkill.
-        shmclient.reset();
-        logstream(LOG_WARNING) << "Unexpected SHMIPC failure. Falling back to CPPIPC" << std::endl;
-      } 
+        read_result = read_serialized_result(out);
+      }
+    }
+
+    if (oarc.buf != nullptr && shm_bulk_eval(oarc, read_result)) return;
+
+    auto worker_proxy = m_worker_pool->get_worker();
+    auto worker_guard = m_worker_pool->get_worker_guard(worker_proxy);
+
+    // catch and reinterpret comm failure
+    try {
       out = worker_proxy->bulk_eval_rows(lambda_hash, args, skip_undefined, seed);
     } catch (cppipc::ipcexception e) {
       throw reinterpret_comm_failure(e);
@@ -256,31 +368,36 @@ std::vector<std::string> lambda_master::lambda_worker_binary_and_args = {};
                                   const sframe_rows& rows,
                                   std::vector<flexible_type>& out,
                                   bool skip_undefined, int seed) {
-    auto worker_proxy = m_worker_pool->get_worker();
-    auto worker_guard = m_worker_pool->get_worker_guard(worker_proxy);
-    // catch and reinterpret comm failure
-    try {
-      auto shmclient_iter = m_shared_memory_worker_connections.find(worker_proxy.get());
-      if (shmclient_iter != m_shared_memory_worker_connections.end() &&
-          shmclient_iter->second.get() != nullptr) {
-        auto& shmclient = shmclient_iter->second;
-        oarchive oarc;
+    // Serialize the request before taking a worker, so that the worker
+    // does not sit idle while the batch is being encoded.
+    oarchive oarc;
+    std::function<void(iarchive&)> read_result;
+    if (m_num_working_shm_slots > 0) {
+      if (LAMBDA_COLUMNAR_WIRE_FORMAT) {
+        oarc << (char)(bulk_eval_serialized_tag::BULK_EVAL_COLUMNAR_DICT_ROWS)
+             << lambda_hash
+             << keys
+             << skip_undefined
+             << seed;
+        write_columnar_block(oarc, rows);
+        read_result = read_columnar_result(out);
+      } else {
         oarc << (char)(bulk_eval_serialized_tag::BULK_EVAL_DICT_ROWS)
              << lambda_hash
-             << keys 
+             << keys
              << rows
              << skip_undefined
              << seed;
-        bool good = shm_call(shmclient, oarc, out);
-        // everything good. return
-        if (good) return;
+        read_result = read_serialized_result(out);
+      }
+    }
 
+    if (oarc.buf != nullptr && shm_bulk_eval(oarc, read_result)) return;
 
-        // shmcall was bad... reset the client so we don't ever use it again
-        // and fall back to regular IPC
-        shmclient.reset();
-        logstream(LOG_WARNING) << "Unexpected SHMIPC failure. Falling back to CPPIPC" << std::endl;
-      } 
+    auto worker_proxy = m_worker_pool->get_worker();
+    auto worker_guard = m_worker_pool->get_worker_guard(worker_proxy);
+    // catch and reinterpret comm failure
+    try {
       out = worker_proxy->bulk_eval_dict_rows(lambda_hash, keys, rows, skip_undefined, seed);
     } catch (cppipc::ipcexception e) {
       throw reinterpret_comm_failure(e);
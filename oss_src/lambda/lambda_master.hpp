@@ -9,12 +9,18 @@
 #define GRAPHLAB_LAMBDA_LAMBDA_MASTER_HPP
 
 #include <map>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <boost/function.hpp>
 #include <globals/globals.hpp>
 #include <lambda/lambda_interface.hpp>
 #include <lambda/worker_pool.hpp>
 
 namespace graphlab {
 
+class thread_pool;
+
 namespace shmipc {
   class client;
 }
@@ -36,6 +42,12 @@ namespace lambda {
    * The evaluation functions can be called in parallel. When this happens,
    * the master evenly allocates the jobs to workers who has the shortest job queue.
    *
+   * Workers connected by shared memory serve LAMBDA_SHM_SLOTS_PER_WORKER
+   * segments (slots) each. A worker is thus sent a batch in one slot while it
+   * evaluates the batch of another, and several batches are in flight per
+   * worker. Slots are handed out to the workers with the fewest busy slots
+   * first.
+   *
    * \code
    *
    * std::vector<flexible_type> args{0,1,2,3,4};
@@ -119,6 +131,22 @@ namespace lambda {
 
     inline size_t num_workers() { return m_worker_pool->num_workers(); }
 
+    /// The number of workers not evaluating a lambda right now
+    size_t num_available_workers();
+
+    /**
+     * Runs fn on one of the dispatch threads, a pool with one thread per
+     * slot of the workers. Used to keep batches in flight without a thread
+     * per batch.
+     */
+    void launch_dispatch(const boost::function<void (void)>& fn);
+
+    /**
+     * Returns true if the instance (and its workers) has been created.
+     * Unlike get_instance(), never starts the workers.
+     */
+    static bool is_instantiated() { return instantiated; }
+
     static void set_lambda_worker_binary(const std::vector<std::string>& path) { 
       lambda_worker_binary_and_args = path;
       std::ostringstream ss;
@@ -139,6 +167,8 @@ namespace lambda {
     static const std::vector<std::string>& get_lambda_worker_binary() {
       return lambda_worker_binary_and_args;
     };
+
+    ~lambda_master();
     
    private:
 
@@ -148,9 +178,43 @@ namespace lambda {
 
     lambda_master& operator=(lambda_master const&) = delete;
 
+    /// A shared memory segment of a worker, carrying one batch at a time.
+    struct shm_slot {
+      void* worker = nullptr;
+      std::shared_ptr<shmipc::client> client;
+      bool busy = false;
+    };
+
+    /**
+     * Takes a free slot, preferring the workers with the fewest busy slots.
+     * Waits if all slots are busy. Returns nullptr if there is no working
+     * slot.
+     */
+    shm_slot* acquire_shm_slot();
+
+    /**
+     * Returns a slot taken by acquire_shm_slot. If good is false the slot
+     * failed, and is never used again.
+     */
+    void release_shm_slot(shm_slot* slot, bool good);
+
+    /**
+     * Sends a serialized bulk_eval request through a shared memory slot.
+     * Returns false (having freed the request) if no slot could carry it.
+     */
+    bool shm_bulk_eval(oarchive& arguments,
+                       const std::function<void(iarchive&)>& read_result);
+
    private:
     std::shared_ptr<worker_pool<lambda_evaluator_proxy>> m_worker_pool;
-    std::map<void*, std::shared_ptr<shmipc::client>> m_shared_memory_worker_connections;
+
+    std::vector<std::unique_ptr<shm_slot>> m_shm_slots;
+    std::map<void*, size_t> m_busy_shm_slots;
+    std::atomic<size_t> m_num_working_shm_slots;
+    graphlab::mutex m_shm_slot_mutex;
+    graphlab::conditional m_shm_slot_cond;
+
+    std::unique_ptr<thread_pool> m_dispatch_pool;
 
     std::unordered_map<size_t, size_t> m_lambda_object_counter;
     graphlab::mutex m_mtx;
@@ -159,6 +223,8 @@ namespace lambda {
      */
     static std::vector<std::string> lambda_worker_binary_and_args;    
 
+    static std::atomic<bool> instantiated;
+
   };
 
 } // end lambda
@@ -14,6 +14,7 @@
 #include <flexible_type/flexible_type.hpp>
 #include <exceptions/error_types.hpp>
 #include <lambda/python_import_modules.hpp>
+#include <lambda/lambda_columnar_format.hpp>
 
 namespace graphlab {
 
@@ -196,6 +197,28 @@ inline python::object PyObject_FromFlex(const flexible_type& flex_value) {
   return flex_value.apply_visitor(PyObjectVisitor());
 }
 
+/**
+ * \ingroup lambda
+ *
+ * Convert row i of a columnar column into boost python object, reading
+ * integers, floats and strings directly from the column buffers.
+ * Throws exception on failure.
+ */
+inline python::object PyObject_FromColumnar(const columnar_column_view& column, size_t i) {
+  if (column.is_null(i)) return python::object();
+  switch(column.encoding()) {
+   case columnar_encoding::INTEGER:
+     return python::object(python::handle<>(PyInt_FromSsize_t(column.int_data()[i])));
+   case columnar_encoding::FLOAT:
+     return python::object(python::handle<>(PyFloat_FromDouble(column.float_data()[i])));
+   case columnar_encoding::STRING:
+     return python::object(python::handle<>(
+         PyString_FromStringAndSize(column.bytes_at(i), column.bytes_length(i))));
+   default:
+     return PyObject_FromFlex(column.value_at(i));
+  }
+}
+
 /*
  * \ingroup lambda
  *
@@ -16,6 +16,7 @@
 #include <fileio/fs_utils.hpp>
 #include <util/cityhash_gl.hpp>
 #include <shmipc/shmipc.hpp>
+#include <lambda/lambda_columnar_format.hpp>
 
 namespace graphlab {
 
@@ -24,9 +25,9 @@ namespace lambda {
   namespace python = boost::python;
 
   pylambda_evaluator::~pylambda_evaluator() {
-    if (m_shared_memory_listener.active()) {
+    if (m_shared_memory_listening) {
       m_shared_memory_thread_terminating = true;
-      m_shared_memory_listener.join();
+      m_shared_memory_listeners.join();
     }
   }
 
@@ -220,6 +221,80 @@ namespace lambda {
   }
 
 
+  std::vector<flexible_type> pylambda_evaluator::bulk_eval_columnar(
+    size_t lambda_hash,
+    const columnar_block_view& rows,
+    bool skip_undefined,
+    int seed) {
+
+    python_thread_guard py_thread_guard;
+
+    set_lambda(lambda_hash);
+
+    py_set_random_seed(seed);
+
+    std::vector<flexible_type> ret(rows.num_rows());
+    if (rows.num_columns() == 0) return ret;
+    const auto& column = rows.column(0);
+    try {
+      for (size_t i = 0; i < rows.num_rows(); ++i) {
+        if (skip_undefined && column.is_null(i)) {
+          ret[i] = FLEX_UNDEFINED;
+        } else {
+          python::object input = PyObject_FromColumnar(column, i);
+          python::object output = m_current_lambda->operator()(input);
+          PyObject_AsFlex(output, ret[i]);
+        }
+      }
+    } catch (python::error_already_set const& e) {
+      std::string error_string = parse_python_error();
+      throw(error_string);
+    } catch (std::exception& e) {
+      throw(std::string(e.what()));
+    } catch (...) {
+      throw("Unknown exception from python lambda evaluation.");
+    }
+    return ret;
+  }
+
+  std::vector<flexible_type> pylambda_evaluator::bulk_eval_dict_columnar(
+    size_t lambda_hash,
+    const std::vector<std::string>& keys,
+    const columnar_block_view& rows,
+    bool skip_undefined,
+    int seed) {
+
+    python_thread_guard py_thread_guard;
+
+    set_lambda(lambda_hash);
+    py_set_random_seed(seed);
+    std::vector<flexible_type> ret(rows.num_rows());
+    python::dict input;
+    try {
+      DASSERT_EQ(keys.size(), rows.num_columns());
+      // create the python keys once for the whole batch.
+      std::vector<python::object> py_keys;
+      for (const auto& key : keys) py_keys.push_back(python::object(key));
+      for (size_t i = 0; i < rows.num_rows(); ++i) {
+        input.clear();
+        for (size_t j = 0; j < py_keys.size(); ++j) {
+          input[py_keys[j]] = PyObject_FromColumnar(rows.column(j), i);
+        }
+        python::object output = m_current_lambda->operator()(input);
+        PyObject_AsFlex(output, ret[i]);
+      }
+    } catch (python::error_already_set const& e) {
+      std::string error_string = parse_python_error();
+      throw(error_string);
+    } catch (std::exception& e) {
+      throw(std::string(e.what()));
+    } catch (...) {
+      throw("Unknown exception from python lambda evaluation.");
+    }
+    return ret;
+  }
+
+
   void pylambda_evaluator::set_lambda(size_t lambda_hash) {
     if (m_current_lambda_hash == lambda_hash) return;
 
@@ -232,8 +307,8 @@ namespace lambda {
     m_current_lambda_hash = lambda_hash;
   }
 
-  std::vector<flexible_type> 
-  pylambda_evaluator::bulk_eval_rows_serialized(const char* ptr, size_t len) {
+  void pylambda_evaluator::bulk_eval_rows_serialized(const char* ptr, size_t len,
+                                                     oarchive& result) {
     iarchive iarc(ptr, len);
     char c;
     iarc >> c;
@@ -243,7 +318,8 @@ namespace lambda {
       bool skip_undefined;
       int seed;
       iarc >> lambda_hash >> rows >> skip_undefined >> seed;
-      return bulk_eval_rows(lambda_hash, rows, skip_undefined, seed);
+      auto ret = bulk_eval_rows(lambda_hash, rows, skip_undefined, seed);
+      result << (char)(1) << ret;
     } else if (c == (char)bulk_eval_serialized_tag::BULK_EVAL_DICT_ROWS) {
       size_t lambda_hash;
       std::vector<std::string> keys;
@@ -251,64 +327,96 @@ namespace lambda {
       bool skip_undefined;
       int seed;
       iarc >> lambda_hash >> keys >> values >> skip_undefined >> seed;
-      return bulk_eval_dict_rows(lambda_hash, keys, values, skip_undefined, seed);
+      auto ret = bulk_eval_dict_rows(lambda_hash, keys, values, skip_undefined, seed);
+      result << (char)(1) << ret;
+    } else if (c == (char)bulk_eval_serialized_tag::BULK_EVAL_COLUMNAR_ROWS) {
+      size_t lambda_hash;
+      bool skip_undefined;
+      int seed;
+      iarc >> lambda_hash >> skip_undefined >> seed;
+      size_t block_start = columnar_align(iarc.off);
+      columnar_block_view rows(ptr + block_start, len - block_start);
+      auto ret = bulk_eval_columnar(lambda_hash, rows, skip_undefined, seed);
+      result << (char)(1);
+      write_columnar_block(result, ret);
+    } else if (c == (char)bulk_eval_serialized_tag::BULK_EVAL_COLUMNAR_DICT_ROWS) {
+      size_t lambda_hash;
+      std::vector<std::string> keys;
+      bool skip_undefined;
+      int seed;
+      iarc >> lambda_hash >> keys >> skip_undefined >> seed;
+      size_t block_start = columnar_align(iarc.off);
+      columnar_block_view rows(ptr + block_start, len - block_start);
+      auto ret = bulk_eval_dict_columnar(lambda_hash, keys, rows, skip_undefined, seed);
+      result << (char)(1);
+      write_columnar_block(result, ret);
     } else {
       logstream(LOG_FATAL) << "Invalid serialized result" << std::endl;
     }
   }
 
-  std::string pylambda_evaluator::initialize_shared_memory_comm() {
-    if (m_shared_memory_server) {
-      if (!m_shared_memory_listener.active()) {
-        m_shared_memory_listener.launch(
-            [=]() {
-            while(!m_shared_memory_server->wait_for_connect(3)) {
-              if (m_shared_memory_thread_terminating) return;
-            }
-            char* receive_buffer = nullptr;
-            size_t receive_buffer_length = 0;  
-            size_t message_length = 0;
-            char* send_buffer = nullptr;
-            size_t send_buffer_length= 0 ;
-            while(1) {
-              bool has_data = 
-                  shmipc::large_receive(*m_shared_memory_server,
-                                        &receive_buffer, 
-                                        &receive_buffer_length, 
-                                        message_length, 
-                                        3 /* timeout */);
-              if (!has_data) {
-                if (m_shared_memory_thread_terminating) break;
-                else continue;
-              } else {
-                oarchive oarc;
-                oarc.buf = send_buffer;
-                oarc.len = send_buffer_length;
-                try {
-                  auto ret = bulk_eval_rows_serialized(receive_buffer, message_length);
-                  oarc << (char)(1) << ret;
-                } catch (std::string& s) {
-                  oarc << (char)(0) << s;
-                } catch (const char* s) {
-                  oarc << (char)(0) << std::string(s);
-                } catch (...) {
-                  oarc << (char)(0) << std::string("Unknown Runtime Exception");
-                }
-                shmipc::large_send(*m_shared_memory_server,
-                                   oarc.buf,
-                                   oarc.off);
-                send_buffer = oarc.buf;
-                send_buffer_length = oarc.len;
-              }
-            }
-            if (receive_buffer) free(receive_buffer);
-            if (send_buffer) free(send_buffer);
-            });
+  /**
+   * Serves the bulk_eval requests sent to a shared memory server until the
+   * evaluator terminates.
+   */
+  void pylambda_evaluator::serve_shared_memory(graphlab::shmipc::server* server) {
+    while(!server->wait_for_connect(3)) {
+      if (m_shared_memory_thread_terminating) return;
+    }
+    char* receive_buffer = nullptr;
+    size_t receive_buffer_length = 0;  
+    size_t message_length = 0;
+    char* send_buffer = nullptr;
+    size_t send_buffer_length= 0 ;
+    while(1) {
+      bool has_data = 
+          shmipc::large_receive(*server,
+                                &receive_buffer, 
+                                &receive_buffer_length, 
+                                message_length, 
+                                3 /* timeout */);
+      if (!has_data) {
+        if (m_shared_memory_thread_terminating) break;
+        else continue;
+      } else {
+        oarchive oarc;
+        oarc.buf = send_buffer;
+        oarc.len = send_buffer_length;
+        try {
+          bulk_eval_rows_serialized(receive_buffer, message_length, oarc);
+        } catch (std::string& s) {
+          oarc.off = 0;
+          oarc << (char)(0) << s;
+        } catch (const char* s) {
+          oarc.off = 0;
+          oarc << (char)(0) << std::string(s);
+        } catch (...) {
+          oarc.off = 0;
+          oarc << (char)(0) << std::string("Unknown Runtime Exception");
+        }
+        shmipc::large_send(*server,
+                           oarc.buf,
+                           oarc.off);
+        send_buffer = oarc.buf;
+        send_buffer_length = oarc.len;
+      }
+    }
+    if (receive_buffer) free(receive_buffer);
+    if (send_buffer) free(send_buffer);
+  }
+
+  std::vector<std::string> pylambda_evaluator::initialize_shared_memory_comm() {
+    std::vector<std::string> ret;
+    if (!m_shared_memory_listening) {
+      for (auto server: m_shared_memory_servers) {
+        m_shared_memory_listeners.launch([=]() { serve_shared_memory(server); });
       }
-      return m_shared_memory_server->get_shared_memory_name();
-    } else {
-      return "";
+      m_shared_memory_listening = true;
     }
+    for (auto server: m_shared_memory_servers) {
+      ret.push_back(server->get_shared_memory_name());
+    }
+    return ret;
   }
 } // end of namespace lambda
 } // end of namespace graphlab
@@ -26,8 +26,10 @@ namespace shmipc {
   class server;
 }
 class sframe_rows;
+class oarchive;
 
 namespace lambda {
+class columnar_block_view;
 /**
  * \ingroup lambda
  *
@@ -52,8 +54,9 @@ class pylambda_evaluator : public lambda_evaluator_interface {
   /**
    * Construct an empty evaluator.
    */
-  inline pylambda_evaluator(graphlab::shmipc::server* shared_memory_server = nullptr) { 
-    m_shared_memory_server = shared_memory_server;
+  inline pylambda_evaluator(
+      const std::vector<graphlab::shmipc::server*>& shared_memory_servers = {}) {
+    m_shared_memory_servers = shared_memory_servers;
     m_current_lambda_hash = (size_t)(-1); 
   };
 
@@ -107,9 +110,12 @@ class pylambda_evaluator : public lambda_evaluator_interface {
 
   /**
    * Initializes shared memory communication via SHMIPC.
-   * Returns the shared memory address to connect to.
+   * Returns the shared memory addresses to connect to, one per segment.
+   * Each segment is served by its own thread, so that a batch can be
+   * received and decoded in one segment while the batch of another is
+   * being evaluated.
    */
-  std::string initialize_shared_memory_comm();
+  std::vector<std::string> initialize_shared_memory_comm();
 
  private:
 
@@ -126,14 +132,36 @@ class pylambda_evaluator : public lambda_evaluator_interface {
   flexible_type eval(size_t lambda_hash, const flexible_type& arg);
 
   /**
-   * Redirects to either bulk_eval_rows or bulk_eval_dict_rows.
-   * First byte in the string is a bulk_eval_serialized_tag byte to denote
-   * whether this call is going to bulk_eval_rows or bulk_eval_dict_rows.
+   * Same as bulk_eval_rows, but reads the first column of the rows directly
+   * from a columnar block, without decoding it into flexible_types.
+   */
+  std::vector<flexible_type> bulk_eval_columnar(size_t lambda_hash,
+      const columnar_block_view& rows, bool skip_undefined, int seed);
+
+  /**
+   * Same as bulk_eval_dict_rows, but reads the rows directly from a
+   * columnar block, without decoding them into flexible_types.
+   */
+  std::vector<flexible_type> bulk_eval_dict_columnar(size_t lambda_hash,
+      const std::vector<std::string>& keys,
+      const columnar_block_view& rows, bool skip_undefined, int seed);
+
+  /**
+   * Redirects to bulk_eval_rows, bulk_eval_dict_rows or their columnar
+   * versions. First byte in the string is a bulk_eval_serialized_tag byte
+   * to denote which function this call is going to.
    *
-   * Deserializes the remaining parameters from the string 
-   * and calls the function accordingly.
+   * Deserializes the remaining parameters from the string,
+   * calls the function accordingly, and writes a successful reply
+   * (in the wire format of the request) into the result archive.
+   */
+  void bulk_eval_rows_serialized(const char* ptr, size_t len, oarchive& result);
+
+  /**
+   * Serves the requests sent to one shared memory server. Run by one
+   * listener thread per server.
    */
-  std::vector<flexible_type> bulk_eval_rows_serialized(const char* ptr, size_t len);
+  void serve_shared_memory(graphlab::shmipc::server* server);
 
   /**
    * The unpickled python lambda object.
@@ -141,8 +169,9 @@ class pylambda_evaluator : public lambda_evaluator_interface {
   boost::python::api::object* m_current_lambda = NULL;
   std::map<size_t, boost::python::api::object*> m_lambda_hash;
   size_t m_current_lambda_hash;
-  graphlab::shmipc::server* m_shared_memory_server;
-  graphlab::thread m_shared_memory_listener;
+  std::vector<graphlab::shmipc::server*> m_shared_memory_servers;
+  graphlab::thread_group m_shared_memory_listeners;
+  bool m_shared_memory_listening = false;
   volatile bool m_shared_memory_thread_terminating = false;
 };
   } // end of lambda namespace
@@ -8,6 +8,7 @@
 #include <boost/program_options.hpp>
 #include <cppipc/server/comm_server.hpp>
 #include <lambda/pylambda.hpp>
+#include <lambda/lambda_constants.hpp>
 #include <lambda/python_api.hpp>
 #include <shmipc/shmipc.hpp>
 #include <lambda/graph_pylambda.hpp>
@@ -130,8 +131,15 @@ int _pylambda_worker_main(const char* _root_path, const char* _server_address) {
 
     LOG_DEBUG_WITH_PID("Python GIL released.");
     
-    graphlab::shmipc::server shm_comm_server;
-    bool has_shm = shm_comm_server.bind();
+    // one shared memory segment per batch the worker can hold at once
+    std::vector<std::unique_ptr<graphlab::shmipc::server>> shm_comm_servers;
+    std::vector<graphlab::shmipc::server*> shm_comm_server_ptrs;
+    bool has_shm = true;
+    for (size_t i = 0; i < std::max<size_t>(graphlab::LAMBDA_SHM_SLOTS_PER_WORKER, 1); ++i) {
+      shm_comm_servers.emplace_back(new graphlab::shmipc::server);
+      has_shm = has_shm && shm_comm_servers.back()->bind();
+      shm_comm_server_ptrs.push_back(shm_comm_servers.back().get());
+    }
 
     LOG_DEBUG_WITH_PID("shm_comm_server bind: has_shm=" << has_shm);
 
@@ -140,7 +148,7 @@ int _pylambda_worker_main(const char* _root_path, const char* _server_address) {
 
     server.register_type<graphlab::lambda::lambda_evaluator_interface>([&](){
         if (has_shm) {
-          auto n = new graphlab::lambda::pylambda_evaluator(&shm_comm_server);
+          auto n = new graphlab::lambda::pylambda_evaluator(shm_comm_server_ptrs);
           LOG_DEBUG_WITH_PID("creation of pylambda_evaluator with SHM complete.");
           return n;
         } else {
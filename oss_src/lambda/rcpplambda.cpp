@@ -175,8 +175,8 @@ std::vector<flexible_type> rcpplambda_evaluator::bulk_eval_dict_rows(size_t lamb
 
 }
 
-std::string rcpplambda_evaluator::initialize_shared_memory_comm() {
-    return "";
+std::vector<std::string> rcpplambda_evaluator::initialize_shared_memory_comm() {
+    return {};
 }
 
 // not implemented yet
@@ -83,7 +83,7 @@ class rcpplambda_evaluator : public lambda_evaluator_interface {
             const sframe_rows& values,
             bool skip_undefined, int seed);
 
-    std::string initialize_shared_memory_comm();
+    std::vector<std::string> initialize_shared_memory_comm();
 
   private:
 
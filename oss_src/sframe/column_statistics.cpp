@@ -0,0 +1,305 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <logger/logger.hpp>
+#include <parallel/lambda_omp.hpp>
+#include <parallel/pthread_tools.hpp>
+#include <sketches/hyperloglog.hpp>
+#include <sframe/sarray.hpp>
+#include <sframe/column_statistics.hpp>
+
+namespace graphlab {
+
+const char* COLUMN_STATISTICS_METADATA_KEY = "__statistics__";
+
+/*
+ * Statistics are written as a list of key=value pairs separated by ';'.
+ */
+std::string column_statistics::to_string() const {
+  std::stringstream ss;
+  ss << std::setprecision(17);
+  ss << "rows=" << num_rows
+     << ";undefined=" << num_undefined
+     << ";distinct=" << num_distinct
+     << ";sorted=" << (sorted ? 1 : 0);
+  if (has_range()) {
+    ss << ";type=" << (int)min_value.get_type();
+    if (min_value.get_type() == flex_type_enum::INTEGER) {
+      ss << ";min=" << min_value.get<flex_int>()
+         << ";max=" << max_value.get<flex_int>();
+    } else {
+      ss << ";min=" << min_value.get<flex_float>()
+         << ";max=" << max_value.get<flex_float>();
+    }
+  }
+  return ss.str();
+}
+
+bool column_statistics::from_string(const std::string& s, column_statistics& stats) {
+  std::map<std::string, std::string> fields;
+  std::stringstream ss(s);
+  std::string field;
+  while (std::getline(ss, field, ';')) {
+    size_t eq = field.find('=');
+    if (eq == std::string::npos) return false;
+    fields[field.substr(0, eq)] = field.substr(eq + 1);
+  }
+  for (auto key: {"rows", "undefined", "distinct", "sorted"}) {
+    if (fields.count(key) == 0) return false;
+  }
+  try {
+    column_statistics ret;
+    ret.num_rows = std::stoull(fields["rows"]);
+    ret.num_undefined = std::stoull(fields["undefined"]);
+    ret.num_distinct = std::stoull(fields["distinct"]);
+    ret.sorted = fields["sorted"] == "1";
+    if (fields.count("type") && fields.count("min") && fields.count("max")) {
+      auto type = (flex_type_enum)std::stoi(fields["type"]);
+      if (type == flex_type_enum::INTEGER) {
+        ret.min_value = flex_int(std::stoll(fields["min"]));
+        ret.max_value = flex_int(std::stoll(fields["max"]));
+      } else if (type == flex_type_enum::FLOAT) {
+        ret.min_value = flex_float(std::stod(fields["min"]));
+        ret.max_value = flex_float(std::stod(fields["max"]));
+      }
+    }
+    stats = ret;
+    return true;
+  } catch (std::exception&) {
+    return false;
+  }
+}
+
+namespace {
+
+/// True if the values of the type can be tested for sortedness
+bool is_orderable(flex_type_enum type) {
+  return type == flex_type_enum::INTEGER ||
+         type == flex_type_enum::FLOAT ||
+         type == flex_type_enum::STRING ||
+         type == flex_type_enum::DATETIME;
+}
+
+/// True if the min and max values of the type are kept
+bool has_range(flex_type_enum type) {
+  return type == flex_type_enum::INTEGER || type == flex_type_enum::FLOAT;
+}
+
+bool is_nan(const flexible_type& v) {
+  return v.get_type() == flex_type_enum::FLOAT && std::isnan(v.get<flex_float>());
+}
+
+/**
+ * A cache of the statistics computed in this process, by index file.
+ * When full, it is simply emptied.
+ */
+const size_t STATISTICS_CACHE_SIZE = 4096;
+mutex statistics_cache_lock;
+std::map<std::string, column_statistics>& statistics_cache() {
+  static auto* cache = new std::map<std::string, column_statistics>();
+  return *cache;
+}
+
+std::string cache_key(const index_file_information& index) {
+  size_t num_rows = 0;
+  for (auto len: index.segment_sizes) num_rows += len;
+  return index.index_file + "@" + std::to_string(num_rows);
+}
+
+bool find_cached_statistics(const index_file_information& index,
+                            column_statistics& stats) {
+  if (index.index_file.empty()) return false;
+  std::lock_guard<mutex> guard(statistics_cache_lock);
+  auto iter = statistics_cache().find(cache_key(index));
+  if (iter == statistics_cache().end()) return false;
+  stats = iter->second;
+  return true;
+}
+
+} // anonymous namespace
+
+void segment_statistics::add(const flexible_type& val) {
+  ++num_rows;
+  if (!distinct) distinct.reset(new sketches::hyperloglog(hll_bits));
+  distinct->add(val);
+  if (val.get_type() == flex_type_enum::UNDEFINED || is_nan(val)) {
+    if (val.get_type() == flex_type_enum::UNDEFINED) ++num_undefined;
+    else ++num_nan;
+    ascending = descending = false;
+    return;
+  }
+  auto type = val.get_type();
+  if (value_type == flex_type_enum::UNDEFINED) value_type = type;
+  else if (type != value_type) mixed_types = true;
+  // values of different types have no range, and are not ordered
+  if (mixed_types) return;
+  if (has_range(type)) {
+    if (min_value.get_type() == flex_type_enum::UNDEFINED || val < min_value) {
+      min_value = val;
+    }
+    if (max_value.get_type() == flex_type_enum::UNDEFINED || val > max_value) {
+      max_value = val;
+    }
+  }
+  if (is_orderable(type) && (ascending || descending)) {
+    if (last_value.get_type() != flex_type_enum::UNDEFINED) {
+      if (val < last_value) ascending = false;
+      if (val > last_value) descending = false;
+    } else {
+      first_value = val;
+    }
+    last_value = val;
+  }
+}
+
+column_statistics combine_segment_statistics(const std::vector<segment_statistics>& segments) {
+  column_statistics stats;
+  size_t hll_bits = segments.empty() ? 12 : segments[0].hll_bits;
+  sketches::hyperloglog distinct(hll_bits);
+  flex_type_enum value_type = flex_type_enum::UNDEFINED;
+  bool mixed_types = false;
+  bool ascending = true, descending = true;
+  flexible_type last_value;
+  size_t num_nan = 0;
+  for (auto& seg: segments) {
+    DASSERT_EQ(seg.hll_bits, hll_bits);
+    num_nan += seg.num_nan;
+    stats.num_rows += seg.num_rows;
+    stats.num_undefined += seg.num_undefined;
+    if (seg.distinct) distinct.combine(*seg.distinct);
+    if (seg.value_type != flex_type_enum::UNDEFINED) {
+      if (value_type == flex_type_enum::UNDEFINED) value_type = seg.value_type;
+      else if (seg.value_type != value_type) mixed_types = true;
+    }
+    mixed_types = mixed_types || seg.mixed_types;
+    if (seg.min_value.get_type() != flex_type_enum::UNDEFINED) {
+      if (!stats.has_range() || seg.min_value < stats.min_value) stats.min_value = seg.min_value;
+      if (stats.max_value.get_type() == flex_type_enum::UNDEFINED ||
+          seg.max_value > stats.max_value) {
+        stats.max_value = seg.max_value;
+      }
+    }
+    if (seg.num_rows == 0) continue;
+    ascending = ascending && seg.ascending;
+    descending = descending && seg.descending;
+    // the order must also hold across the segment boundary
+    if (last_value.get_type() != flex_type_enum::UNDEFINED &&
+        seg.first_value.get_type() != flex_type_enum::UNDEFINED) {
+      if (seg.first_value < last_value) ascending = false;
+      if (seg.first_value > last_value) descending = false;
+    }
+    if (seg.last_value.get_type() != flex_type_enum::UNDEFINED) last_value = seg.last_value;
+  }
+  bool orderable = !mixed_types && is_orderable(value_type);
+  stats.num_distinct = std::min<size_t>(stats.num_rows, std::llround(distinct.estimate()));
+  if (stats.num_rows > 0 && stats.num_distinct == 0) stats.num_distinct = 1;
+  stats.sorted = stats.num_rows > 0 && orderable && (ascending || descending);
+  // NaN is not ordered, so a column holding one has no range
+  if (num_nan > 0 || mixed_types) {
+    stats.min_value = flexible_type();
+    stats.max_value = flexible_type();
+  }
+  return stats;
+}
+
+column_statistics compute_column_statistics(const sarray<flexible_type>& column) {
+  auto reader = column.get_reader(thread::cpu_count());
+  std::vector<segment_statistics> segments;
+  for (size_t i = 0; i < reader->num_segments(); ++i) segments.emplace_back();
+  parallel_for(0, reader->num_segments(), [&](size_t segment_id) {
+    auto& seg = segments[segment_id];
+    auto end = reader->end(segment_id);
+    for (auto iter = reader->begin(segment_id); iter != end; ++iter) {
+      seg.add(*iter);
+    }
+  });
+  return combine_segment_statistics(segments);
+}
+
+bool find_column_statistics(const std::shared_ptr<sarray<flexible_type>>& column,
+                            column_statistics& stats) {
+  std::string saved;
+  if (column->get_metadata(COLUMN_STATISTICS_METADATA_KEY, saved) &&
+      column_statistics::from_string(saved, stats) &&
+      stats.num_rows == column->size()) {
+    return true;
+  }
+  return find_cached_statistics(column->get_index_info(), stats);
+}
+
+column_statistics get_column_statistics(const std::shared_ptr<sarray<flexible_type>>& column) {
+  column_statistics stats;
+  if (find_column_statistics(column, stats)) return stats;
+
+  stats = compute_column_statistics(*column);
+  logstream(LOG_INFO) << "Statistics of column " << column->get_index_file()
+                      << ": " << stats.to_string() << std::endl;
+  auto index = column->get_index_info();
+  if (!index.index_file.empty()) {
+    std::lock_guard<mutex> guard(statistics_cache_lock);
+    if (statistics_cache().size() >= STATISTICS_CACHE_SIZE) statistics_cache().clear();
+    statistics_cache()[cache_key(index)] = stats;
+  }
+  return stats;
+}
+
+void add_known_column_statistics(const index_file_information& column,
+                                 std::map<std::string, std::string>& metadata) {
+  if (metadata.count(COLUMN_STATISTICS_METADATA_KEY)) return;
+  column_statistics stats;
+  if (find_cached_statistics(column, stats)) {
+    metadata[COLUMN_STATISTICS_METADATA_KEY] = stats.to_string();
+  }
+}
+
+size_t estimate_num_groups(const column_statistics& key) {
+  // all the missing values form a single group
+  return std::min(key.num_rows, key.num_distinct + (key.num_undefined > 0 ? 1 : 0));
+}
+
+size_t estimate_join_rows(size_t num_left, size_t distinct_left,
+                          size_t num_right, size_t distinct_right,
+                          bool keep_left, bool keep_right) {
+  if (num_left == 0 || num_right == 0) {
+    return (keep_left ? num_left : 0) + (keep_right ? num_right : 0);
+  }
+  distinct_left = std::max<size_t>(1, distinct_left);
+  distinct_right = std::max<size_t>(1, distinct_right);
+  // every key of the side with fewer distinct keys matches num_rows /
+  // num_distinct rows of the other side
+  double matched = (double)num_left * num_right / std::max(distinct_left, distinct_right);
+  double rows = matched;
+  // the outer joins add the rows of the keys which do not match
+  if (keep_left) {
+    if (distinct_left > distinct_right) {
+      rows += (double)num_left * (distinct_left - distinct_right) / distinct_left;
+    }
+  }
+  if (keep_right) {
+    if (distinct_right > distinct_left) {
+      rows += (double)num_right * (distinct_right - distinct_left) / distinct_right;
+    }
+  }
+  if (rows >= (double)std::numeric_limits<size_t>::max()) {
+    return std::numeric_limits<size_t>::max();
+  }
+  return (size_t)rows;
+}
+
+bool key_ranges_disjoint(const column_statistics& left,
+                         const column_statistics& right) {
+  if (!left.has_range() || !right.has_range()) return false;
+  // missing values are equal to each other
+  if (left.num_undefined > 0 && right.num_undefined > 0) return false;
+  return left.max_value < right.min_value || right.max_value < left.min_value;
+}
+
+} // namespace graphlab
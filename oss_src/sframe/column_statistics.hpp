@@ -0,0 +1,173 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_COLUMN_STATISTICS_HPP
+#define GRAPHLAB_SFRAME_COLUMN_STATISTICS_HPP
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <flexible_type/flexible_type.hpp>
+#include <sketches/hyperloglog.hpp>
+
+namespace graphlab {
+template <typename T>
+class sarray;
+struct index_file_information;
+
+/**
+ * \ingroup sframe_physical
+ * \addtogroup sframe_main Main SFrame Objects
+ * \{
+ */
+
+/**
+ * Summary statistics of a column, used to estimate the cost of the
+ * operators reading it.
+ *
+ * The statistics of a column are gathered while it is written: the
+ * sarray_group_format_writer_v2 of flexible_type columns accumulates the
+ * statistics of each segment as its blocks are flushed, and stores those of
+ * the column in its metadata on close. Saving a column copies them, so
+ * every materialized or saved column, and every column loaded back, has
+ * them. Columns written with SFRAME_COST_BASED_OPTIMIZATION off, or in an
+ * older version, have none; \ref get_column_statistics computes those by a
+ * parallel scan and keeps them for the lifetime of the process.
+ * The operators only use statistics which are already known
+ * (\ref find_column_statistics), and never scan a column just to plan
+ * themselves.
+ */
+struct column_statistics {
+  /// The number of rows
+  size_t num_rows = 0;
+  /// The number of missing values
+  size_t num_undefined = 0;
+  /// An estimate of the number of distinct values (a hyperloglog estimate)
+  size_t num_distinct = 0;
+  /**
+   * The smallest and largest values, for integer and float columns only.
+   * Undefined if not known.
+   */
+  flexible_type min_value;
+  flexible_type max_value;
+  /**
+   * True if the values are in ascending or descending order, and none is
+   * missing. The equal values of a sorted column are thus contiguous.
+   */
+  bool sorted = false;
+
+  /// True if the min and max values are known
+  bool has_range() const {
+    return min_value.get_type() != flex_type_enum::UNDEFINED;
+  }
+
+  /// Returns the statistics in the form stored in the column metadata
+  std::string to_string() const;
+
+  /**
+   * Parses statistics written by \ref to_string. Returns false if the
+   * string is not valid.
+   */
+  static bool from_string(const std::string& s, column_statistics& stats);
+};
+
+/**
+ * The key of the column metadata holding the statistics.
+ */
+extern const char* COLUMN_STATISTICS_METADATA_KEY;
+
+/**
+ * Accumulates the statistics of the values of one segment of a column, in
+ * row order. The statistics of a column combine those of its segments, in
+ * segment order (\ref combine_segment_statistics).
+ */
+struct segment_statistics {
+  /**
+   * hll_bits is the precision of the estimate of the number of distinct
+   * values. The sketch is only allocated by the first value.
+   */
+  explicit segment_statistics(size_t hll_bits = 12): hll_bits(hll_bits) { }
+
+  /// Adds the next value of the segment
+  void add(const flexible_type& val);
+
+  size_t hll_bits;
+  size_t num_rows = 0;
+  size_t num_undefined = 0;
+  size_t num_nan = 0;
+  std::unique_ptr<sketches::hyperloglog> distinct;
+  /// The type of the values, or UNDEFINED if there is none yet
+  flex_type_enum value_type = flex_type_enum::UNDEFINED;
+  /// True if the values have more than one type
+  bool mixed_types = false;
+  flexible_type min_value;
+  flexible_type max_value;
+  flexible_type first_value;
+  flexible_type last_value;
+  bool ascending = true;
+  bool descending = true;
+};
+
+/**
+ * Returns the statistics of a column from those of its segments, given in
+ * segment order. All the segments must use the same hll_bits.
+ */
+column_statistics combine_segment_statistics(const std::vector<segment_statistics>& segments);
+
+/**
+ * Computes the statistics of a column by scanning it.
+ */
+column_statistics compute_column_statistics(const sarray<flexible_type>& column);
+
+/**
+ * Returns the statistics of a column: the statistics saved with it, or
+ * cached by an earlier call, or else computed by scanning the column.
+ */
+column_statistics get_column_statistics(const std::shared_ptr<sarray<flexible_type>>& column);
+
+/**
+ * Returns in stats the statistics of a column if they are known without
+ * scanning the column. Returns false otherwise.
+ */
+bool find_column_statistics(const std::shared_ptr<sarray<flexible_type>>& column,
+                            column_statistics& stats);
+
+/**
+ * Adds the statistics known of a column, if any, to the metadata written
+ * for a copy of the column.
+ */
+void add_known_column_statistics(const index_file_information& column,
+                                 std::map<std::string, std::string>& metadata);
+
+/**
+ * Estimates the number of groups of a groupby on a single key column.
+ */
+size_t estimate_num_groups(const column_statistics& key);
+
+/**
+ * Estimates the number of rows of an equi-join of num_left rows with
+ * distinct_left distinct keys, and num_right rows with distinct_right
+ * distinct keys, assuming the keys of the side with fewer distinct keys
+ * all appear in the other side.
+ *
+ * If keep_left (keep_right) is set, the rows of the left (right) side
+ * which match no row are kept, as in a left (right) outer join.
+ */
+size_t estimate_join_rows(size_t num_left, size_t distinct_left,
+                          size_t num_right, size_t distinct_right,
+                          bool keep_left = false, bool keep_right = false);
+
+/**
+ * Returns true if the statistics prove that no value of one column is
+ * equal to a value of the other: both ranges are known and do not overlap.
+ */
+bool key_ranges_disjoint(const column_statistics& left,
+                         const column_statistics& right);
+
+/// \}
+} // namespace graphlab
+#endif
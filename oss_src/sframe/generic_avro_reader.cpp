@@ -164,9 +164,32 @@ namespace graphlab {
     bool has_more = reader->read(p);
     flexible_type record = flex_undefined();
 
-    if (p.second.type() != avro::AVRO_NULL)
+    if (p.second.type() == avro::AVRO_RECORD && !selected_fields.empty()) {
+      const auto& avro_record = p.second.value<avro::GenericRecord>();
+      flex_dict fields;
+      fields.reserve(selected_fields.size());
+      for (const auto& field : selected_fields) {
+        fields.push_back({ flex_string(field.first),
+                           datum_to_flexible_type(avro_record.fieldAt(field.second)) });
+      }
+      record = std::move(fields);
+    } else if (p.second.type() != avro::AVRO_NULL) {
       record = datum_to_flexible_type(p.second);
+    }
     
     return { has_more, record };
   }
+
+  void generic_avro_reader::select_fields(const std::vector<std::string>& fields) {
+    if (schema_type != avro::AVRO_RECORD && !fields.empty())
+      log_and_throw(std::string("Fields can only be selected from an Avro record"));
+
+    selected_fields.clear();
+    for (const auto& name : fields) {
+      size_t index = 0;
+      if (!schema.root()->nameIndex(name, index))
+        log_and_throw(std::string("Avro schema has no field ") + name);
+      selected_fields.push_back({ name, index });
+    }
+  }
 }
@@ -72,6 +72,8 @@ namespace graphlab {
     avro::EncoderPtr encoder;
     std::stringstream buffer;
     std::unique_ptr<avro::OutputStream> output;
+    /// The (name, index) of the record fields to read. Empty reads all.
+    std::vector<std::pair<std::string, size_t>> selected_fields;
   
   public:
     /**
@@ -122,6 +124,14 @@ namespace graphlab {
      * to be read, and the second is the record converted to a flexible_type.
      */
     std::pair<bool, flexible_type> read_one_flexible_type();
+
+    /**
+     * Restricts the records returned by read_one_flexible_type to the given
+     * fields, in the given order. Only valid if the schema is a record.
+     * The other fields are still decoded by the Avro library, but are never
+     * converted to flexible_type. Throws if a field is not in the schema.
+     */
+    void select_fields(const std::vector<std::string>& fields);
   private:
     flexible_type datum_to_flexible_type(const avro::GenericDatum& datum);
   };
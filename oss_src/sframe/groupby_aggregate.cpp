@@ -163,7 +163,9 @@ sframe groupby_aggregate(const sframe& source,
 
 
   groupby_aggregate_impl::group_aggregate_container
-      container(max_buffer_size, nsegments);
+      container(max_buffer_size, nsegments,
+                std::vector<flex_type_enum>(column_types.begin(),
+                                            column_types.begin() + keys.size()));
 
   // ok the input sframe (frame_with_relevant_cols) contains all the values
   // we care about. However, the challenge here is to figure out how the keys
@@ -178,6 +180,7 @@ sframe groupby_aggregate(const sframe& source,
 
     container.define_group(column_numbers, group.second);
   }
+  container.acquire_memory_grant(frame_with_relevant_cols.num_columns());
   // done. now we can begin parallel processing
 
   // shuffle the rows based on the value of the key column.
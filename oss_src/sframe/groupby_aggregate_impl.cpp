@@ -8,7 +8,6 @@
 #include <unordered_set>
 #include <queue>
 #include <sframe/groupby_aggregate_impl.hpp>
-#include <sframe/sarray_reader_buffer.hpp>
 #include <parallel/lambda_omp.hpp>
 #include <util/cityhash_gl.hpp>
 #include <sframe/groupby_aggregate.hpp>
@@ -50,6 +49,34 @@ void groupby_element::save(oarchive& oarc) const {
   }
 }
 
+void groupby_element::save_spill_row(std::vector<flexible_type>& row) const {
+  row.resize(key.size() + values.size());
+  std::copy(key.begin(), key.end(), row.begin());
+  oarchive oarc;
+  for (size_t i = 0;i < values.size(); ++i) {
+    values[i]->save(oarc);
+    row[key.size() + i] = flex_string(oarc.buf, oarc.off);
+    oarc.off = 0;
+  }
+  free(oarc.buf);
+}
+
+void groupby_element::load_spill_row(std::vector<flexible_type>& row,
+                                     const std::vector<group_descriptor>& group_desc) {
+  DASSERT_GE(row.size(), group_desc.size());
+  size_t num_keys = row.size() - group_desc.size();
+  key.resize(num_keys);
+  std::move(row.begin(), row.begin() + num_keys, key.begin());
+  values.resize(group_desc.size());
+  for (size_t i = 0;i < values.size(); ++i) {
+    const flex_string& state = row[num_keys + i].get<flex_string>();
+    iarchive iarc(state.c_str(), state.length());
+    values[i].reset(group_desc[i].aggregator->new_instance());
+    values[i]->load(iarc);
+  }
+  compute_hash();
+}
+
 void groupby_element::load(iarchive& iarc,
                            const std::vector<group_descriptor>& group_desc) {
   iarc >> key;
@@ -220,12 +247,20 @@ size_t groupby_element::hash() const {
 /*                                                                          */
 /****************************************************************************/
 group_aggregate_container::group_aggregate_container(size_t max_buffer_size,
-                                                     size_t num_segments):
-    max_buffer_size(max_buffer_size), segments(num_segments) {
-  intermediate_buffer.open_for_write(num_segments);
-  for (size_t i = 0;i < segments.size(); ++i) {
-    segments[i].outiter = intermediate_buffer.get_output_iterator(i);
-  }
+                                                     size_t num_segments,
+                                                     const std::vector<flex_type_enum>& key_types):
+    max_buffer_size(max_buffer_size), segments(num_segments), key_types(key_types),
+    session(memory_consumer::GROUPBY, "groupby") { }
+
+void group_aggregate_container::open_intermediate_buffer() {
+  std::call_once(intermediate_buffer_opened, [&]() {
+    // the keys keep their types. The partial states are serialized.
+    std::vector<flex_type_enum> column_types = key_types;
+    column_types.resize(key_types.size() + group_descriptors.size(),
+                        flex_type_enum::STRING);
+    intermediate_buffer.reset(
+        new spill_partitions(session, column_types, segments.size()));
+  });
 }
 
 void group_aggregate_container::define_group(std::vector<size_t> column_numbers,
@@ -236,6 +271,21 @@ void group_aggregate_container::define_group(std::vector<size_t> column_numbers,
   group_descriptors.push_back(desc);
 }
 
+void group_aggregate_container::acquire_memory_grant(size_t num_columns) {
+  row_size_estimate = CELL_SIZE_ESTIMATE * std::max<size_t>(num_columns, 1);
+  grant = memory_governor::get_instance().acquire(
+      memory_consumer::GROUPBY,
+      max_buffer_size * segments.size() * row_size_estimate);
+  // the flushed groups stay in memory while they fit in the grant
+  session.set_memory_budget(grant->bytes());
+}
+
+size_t group_aggregate_container::segment_buffer_limit() const {
+  if (grant == nullptr) return max_buffer_size;
+  size_t rows = grant->bytes() / row_size_estimate / segments.size();
+  return std::max<size_t>(1, std::min(rows, max_buffer_size));
+}
+
 void group_aggregate_container::add(const std::vector<flexible_type>& val,
                                     size_t num_keys) {
   size_t hash = groupby_element::hash_key(val, num_keys);
@@ -272,7 +322,7 @@ void group_aggregate_container::add(const std::vector<flexible_type>& val,
   segments[target_segment].fine_grain_locks[hash % 128].unlock();
   segments[target_segment].refctr.dec();
   // element not found
-  if (segments[target_segment].elements.size() >= max_buffer_size) {
+  if (segments[target_segment].elements.size() >= segment_buffer_limit()) {
     flush_segment(target_segment);
   }
 }
@@ -317,7 +367,7 @@ void group_aggregate_container::add(const sframe_rows::row& val,
   segments[target_segment].fine_grain_locks[hash % 128].unlock();
   segments[target_segment].refctr.dec();
   // element not found
-  if (segments[target_segment].elements.size() >= max_buffer_size) {
+  if (segments[target_segment].elements.size() >= segment_buffer_limit()) {
     flush_segment(target_segment);
   }
 }
@@ -355,57 +405,48 @@ void group_aggregate_container::flush_segment(size_t segmentid) {
     }
   }
   // ok. now we can write! lock the file
+  open_intermediate_buffer();
   std::unique_lock<graphlab::mutex> filelock(segments[segmentid].file_lock);
-  oarchive oarc;
+  std::vector<flexible_type> row;
   for (auto& item: local_sorted) {
-    oarc << item;
-    // write into the iterator
-    *(segments[segmentid].outiter) = std::string(oarc.buf, oarc.off);
-    ++(segments[segmentid].outiter);
-    oarc.off = 0;
+    item.save_spill_row(row);
+    intermediate_buffer->write(segmentid, row, row_size_estimate);
   }
-  free(oarc.buf);
   segments[segmentid].chunk_size.push_back(local_sorted.size());
 }
 
 void group_aggregate_container::group_and_write(sframe& out) {
   for (size_t i = 0 ;i < segments.size(); ++i) flush_segment(i);
 
-  intermediate_buffer.close();
-  std::shared_ptr<sarray<std::string>::reader_type> reader = std::move(intermediate_buffer.get_reader());
+  // nothing was added
+  if (intermediate_buffer == nullptr) return;
+  intermediate_buffer->close();
 
   logstream(LOG_INFO) << "Groupby output segment balance: ";
-  for (size_t i = 0; i < reader->num_segments() ; ++i) {
-    logstream(LOG_INFO) << reader->segment_length(i) << " ";
+  for (size_t i = 0; i < intermediate_buffer->num_partitions() ; ++i) {
+    logstream(LOG_INFO) << intermediate_buffer->partition_length(i) << " ";
   }
   logstream(LOG_INFO) << std::endl;
 
-  parallel_for(0, reader->num_segments(),
+  parallel_for(0, intermediate_buffer->num_partitions(),
                [&](size_t i) {
-                this->group_and_write_segment(out, reader, i);
+                this->group_and_write_segment(out, i);
                });
 }
 
 void group_aggregate_container::group_and_write_segment(sframe& out,
-                                                        std::shared_ptr<sarray<std::string>::reader_type> reader,
                                                         size_t segmentid) {
-
-  // prepare the begin row and end row for each chunk.
-  size_t segment_start = 0;
-  for (size_t i = 0; i < segmentid; ++i) {
-    segment_start += reader->segment_length(i);
-  }
-
   // each chunk stores a sequential read of the segments,
   // and elements in each chunk are already sorted.
-  std::vector<sarray_reader_buffer<std::string> > chunks;
+  std::vector<spill_reader> chunks;
 
-  size_t prev_row_start = segment_start;
+  size_t prev_row_start = 0;
   for (size_t i = 0; i < segments[segmentid].chunk_size.size(); ++i) {
     size_t row_start = prev_row_start;
     size_t row_end = row_start + segments[segmentid].chunk_size[i];
     prev_row_start = row_end;
-    chunks.push_back(sarray_reader_buffer<std::string>(reader, row_start, row_end));
+    chunks.push_back(intermediate_buffer->get_reader(segmentid, row_start, row_end,
+                                                     DEFAULT_SARRAY_READER_BUFFER_SIZE));
   }
 
   // here is where we are going to write to
@@ -422,7 +463,7 @@ void group_aggregate_container::group_and_write_segment(sframe& out,
   for (size_t i = 0; i < chunks.size(); ++i) {
     if (chunks[i].has_next()) {
       std::pair<groupby_element, size_t> pqelem;
-      pqelem.first = std::move(groupby_element(chunks[i].next(), group_descriptors));
+      pqelem.first.load_spill_row(chunks[i].next(), group_descriptors);
       pqelem.second = i;
       pq.push_back(std::move(pqelem));
     }
@@ -443,7 +484,7 @@ void group_aggregate_container::group_and_write_segment(sframe& out,
     // refill
     if (chunks[id].has_next()) {
       std::pair<groupby_element, size_t> pqelem;
-      pqelem.first = std::move(groupby_element(chunks[id].next(), group_descriptors));
+      pqelem.first.load_spill_row(chunks[id].next(), group_descriptors);
       pqelem.second = id;
       pq.push_back(std::move(pqelem));
       std::push_heap(pq.begin(), pq.end(), std::greater<pq_value_type>());
@@ -459,7 +500,7 @@ void group_aggregate_container::group_and_write_segment(sframe& out,
       // refill
       if (chunks[id].has_next()) {
         std::pair<groupby_element, size_t> pqelem;
-        pqelem.first = std::move(groupby_element(chunks[id].next(), group_descriptors));
+        pqelem.first.load_spill_row(chunks[id].next(), group_descriptors);
         pqelem.second = id;
         pq.push_back(std::move(pqelem));
         std::push_heap(pq.begin(), pq.end(), std::greater<pq_value_type>());
@@ -477,5 +518,76 @@ void group_aggregate_container::group_and_write_segment(sframe& out,
   }
 }
 
+/****************************************************************************/
+/*                                                                          */
+/*                         sorted_group_aggregator                          */
+/*                                                                          */
+/****************************************************************************/
+sorted_group_aggregator::sorted_group_aggregator(sframe& out, size_t num_keys):
+    segments(out.num_segments()), num_keys(num_keys) {
+  for (size_t i = 0;i < segments.size(); ++i) {
+    segments[i].outiter = out.get_output_iterator(i);
+  }
+}
+
+void sorted_group_aggregator::define_group(std::vector<size_t> column_numbers,
+                                           std::shared_ptr<group_aggregate_value> aggregator) {
+  group_descriptor desc;
+  desc.column_numbers = column_numbers;
+  desc.aggregator = aggregator;
+  group_descriptors.push_back(desc);
+}
+
+void sorted_group_aggregator::add(const sframe_rows::row& val, size_t segmentid) {
+  DASSERT_LT(segmentid, segments.size());
+  auto& seg = segments[segmentid];
+  bool same_key = seg.current != nullptr;
+  for (size_t i = 0; same_key && i < num_keys; ++i) {
+    const auto& a = seg.current->key[i];
+    const auto& b = val[i];
+    same_key = a.get_type() == b.get_type() &&
+        (a.get_type() == flex_type_enum::UNDEFINED || a == b);
+  }
+  if (!same_key) {
+    if (seg.current != nullptr) {
+      if (seg.head == nullptr) seg.head = std::move(seg.current);
+      else write(*seg.current, seg.outiter);
+    }
+    std::vector<flexible_type> key(num_keys);
+    for (size_t i = 0; i < num_keys; ++i) key[i] = val[i];
+    seg.current.reset(new groupby_element(std::move(key), group_descriptors));
+  }
+  seg.current->add_element(val, group_descriptors);
+}
+
+void sorted_group_aggregator::finalize() {
+  std::unique_ptr<groupby_element> carry;
+  for (auto& seg: segments) {
+    for (auto* group: {&seg.head, &seg.current}) {
+      if (*group == nullptr) continue;
+      if (carry != nullptr &&
+          flexible_type_vector_equality(carry->key, (*group)->key)) {
+        *carry += **group;
+      } else {
+        if (carry != nullptr) write(*carry, segments.back().outiter);
+        carry = std::move(*group);
+      }
+      group->reset();
+    }
+  }
+  if (carry != nullptr) write(*carry, segments.back().outiter);
+}
+
+void sorted_group_aggregator::write(const groupby_element& group,
+                                    sframe::iterator& outiter) {
+  std::vector<flexible_type> emission_vector(group.key.size() + group.values.size());
+  for (size_t i = 0;i < group.key.size(); ++i) emission_vector[i] = group.key[i];
+  for (size_t i = 0;i < group.values.size(); ++i) {
+    emission_vector[i + group.key.size()] = group.values[i]->emit();
+  }
+  *outiter = emission_vector;
+  ++outiter;
+}
+
 } // namespace groupby_aggregate_impl
 } // namespace graphlab
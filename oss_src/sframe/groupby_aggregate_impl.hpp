@@ -9,13 +9,16 @@
 #define GRAPHLAB_SFRAME_GROUPBY_AGGREGATE_IMPL_HPP
 
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <cstdint>
 #include <functional>
 #include <unordered_set>
 #include <sframe/sframe.hpp>
+#include <sframe/spill_partitions.hpp>
 #include <util/cityhash_gl.hpp>
 #include <parallel/mutex.hpp>
+#include <fileio/memory_governor.hpp>
 #include <sframe/group_aggregate_value.hpp>
 #include <graphlab/util/hopscotch_map.hpp>
 
@@ -80,6 +83,19 @@ struct groupby_element {
   /// Writes the group result into an output archive
   void save(oarchive& oarc) const;
 
+  /**
+   * Writes the group as a row of a spill: the key, then the serialized
+   * partial state of each aggregated value.
+   */
+  void save_spill_row(std::vector<flexible_type>& row) const;
+
+  /**
+   * Loads the group from a row written by \ref save_spill_row. The row is
+   * moved from.
+   */
+  void load_spill_row(std::vector<flexible_type>& row,
+                      const std::vector<group_descriptor>& group_desc);
+
   /**
    * Loads the group result from an input archive and a group
    * operation descriptor
@@ -157,9 +173,13 @@ namespace groupby_aggregate_impl {
 class group_aggregate_container {
 
  public:
-   /// construct with given sarray and the segmentid as sink.
+   /**
+    * Constructs a container holding up to max_buffer_size groups in
+    * each of num_segments segments, grouping keys of the given types.
+    */
    group_aggregate_container(size_t max_buffer_size,
-                             size_t num_segments);
+                             size_t num_segments,
+                             const std::vector<flex_type_enum>& key_types);
 
    /// Deleted copy constructor
    group_aggregate_container(const group_aggregate_container& other) = delete;
@@ -174,6 +194,14 @@ class group_aggregate_container {
    void define_group(std::vector<size_t> column_numbers,
                      std::shared_ptr<group_aggregate_value> aggregator);
 
+   /**
+    * Acquires working memory from the memory governor for the rows held in
+    * memory, assuming rows of num_columns columns, and limits the rows held
+    * to what fits in it. The segments are then flushed earlier while the
+    * grant is shrunk. Blocks while the server is out of working memory.
+    */
+   void acquire_memory_grant(size_t num_columns);
+
    /// Add a new element to the container.
    void add(const std::vector<flexible_type>& val,
             size_t num_keys);
@@ -199,8 +227,6 @@ class group_aggregate_container {
 
      /// Locks on the below structures
      graphlab::mutex file_lock;
-     /// The temporary storage for the grouped values
-     sarray<std::string>::iterator outiter;
      /// Storing the size of each sorted chunk.
      std::vector<size_t> chunk_size;
    };
@@ -208,15 +234,81 @@ class group_aggregate_container {
    /// Writes the content into the sarray segment backend.
    void flush_segment(size_t segmentid);
 
+   /// The number of groups a segment may hold before it is flushed
+   size_t segment_buffer_limit() const;
+
    size_t max_buffer_size;
+   std::unique_ptr<memory_grant> grant;
+   size_t row_size_estimate = 0;
    std::vector<segment_information> segments;
-   sarray<std::string> intermediate_buffer;
-   std::unique_ptr<sarray<std::string>::reader_type> reader;
+   std::vector<flex_type_enum> key_types;
+   spill_session session;
+   /**
+    * The sorted chunks flushed by the segments, one partition per segment.
+    * A row holds the key and the partial state of every group operation
+    * (see groupby_element::save_spill_row).
+    */
+   std::unique_ptr<spill_partitions> intermediate_buffer;
+   std::once_flag intermediate_buffer_opened;
+
+   /// Opens the intermediate buffer once all the groups are defined
+   void open_intermediate_buffer();
 
    /// Sort all elements in the container and writes to the output.
-   void group_and_write_segment(sframe& out,
-                                std::shared_ptr<sarray<std::string>::reader_type> reader,
-                                size_t segmentid);
+   void group_and_write_segment(sframe& out, size_t segmentid);
+};
+
+
+/**
+ * Aggregates the groups of a stream whose equal keys are contiguous (a
+ * stream sorted on the key), in a single pass and constant memory.
+ *
+ * The stream is processed in parallel segments of consecutive rows, one
+ * per segment of the output. Every group which ends within a segment is
+ * written to it as soon as it ends. The first and last group of each
+ * segment may continue in the neighbouring segments: they are held until
+ * \ref finalize, which merges them in segment order.
+ */
+class sorted_group_aggregator {
+ public:
+   /**
+    * Writes the groups to out, which must be open for writing. The keys
+    * are the first num_keys columns of the rows added.
+    */
+   sorted_group_aggregator(sframe& out, size_t num_keys);
+
+   sorted_group_aggregator(const sorted_group_aggregator& other) = delete;
+   sorted_group_aggregator& operator=(const sorted_group_aggregator& other) = delete;
+
+   /**
+    * Adds a new group operation which groups the values of a column
+    */
+   void define_group(std::vector<size_t> column_numbers,
+                     std::shared_ptr<group_aggregate_value> aggregator);
+
+   /**
+    * Adds the next row of a segment. The segments must be consecutive
+    * ranges of the stream, in the order of their ids.
+    */
+   void add(const sframe_rows::row& val, size_t segmentid);
+
+   /// Writes the groups spanning segment boundaries.
+   void finalize();
+
+ private:
+   struct segment_information {
+     sframe::iterator outiter;
+     /// The first group of the segment, once it has ended
+     std::unique_ptr<groupby_element> head;
+     /// The group being aggregated
+     std::unique_ptr<groupby_element> current;
+   };
+
+   void write(const groupby_element& group, sframe::iterator& outiter);
+
+   std::vector<group_descriptor> group_descriptors;
+   std::vector<segment_information> segments;
+   size_t num_keys;
 };
 
 
@@ -5,10 +5,51 @@
  * This software may be modified and distributed under the terms
  * of the BSD license. See the LICENSE file for details.
  */
+#include <set>
 #include <sframe/join.hpp>
+#include <sframe/column_statistics.hpp>
+#include <fileio/memory_governor.hpp>
 
 namespace graphlab {
 
+/**
+ * Returns an empty sframe with the columns of sf.
+ */
+static sframe empty_like(const sframe& sf) {
+  sframe ret;
+  ret.open_for_write(sf.column_names(), sf.column_types(), "", 1);
+  ret.close();
+  return ret;
+}
+
+/**
+ * Estimates the number of distinct keys made of the given columns, from
+ * the statistics of each column.
+ */
+static size_t estimate_num_keys(const std::vector<column_statistics>& key_stats,
+                                size_t num_rows) {
+  double num_keys = 1;
+  for (const auto& stats: key_stats) num_keys *= std::max<size_t>(1, stats.num_distinct);
+  return std::min<double>(num_rows, num_keys);
+}
+
+/**
+ * Fills key_stats with the statistics of the given columns, if they are
+ * all known without scanning the columns. Returns false otherwise: a join
+ * never scans its inputs only to plan itself.
+ */
+static bool find_key_statistics(const sframe& sf,
+                                const std::vector<size_t>& positions,
+                                std::vector<column_statistics>& key_stats) {
+  key_stats.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); ++i) {
+    if (!find_column_statistics(sf.select_column(positions[i]), key_stats[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
 sframe join(sframe& sf_left, 
             sframe& sf_right,
             std::string join_type,
@@ -50,6 +91,46 @@ sframe join(sframe& sf_left,
     log_and_throw("Invalid join type given!");
   }
 
+  std::vector<column_statistics> left_stats, right_stats;
+  if (SFRAME_COST_BASED_OPTIMIZATION &&
+      sf_left.num_rows() > 0 && sf_right.num_rows() > 0 &&
+      find_key_statistics(sf_left, left_join_positions, left_stats) &&
+      find_key_statistics(sf_right, right_join_positions, right_stats)) {
+    logstream(LOG_INFO) << "Estimated join output: "
+                        << estimate_join_rows(
+                            sf_left.num_rows(),
+                            estimate_num_keys(left_stats, sf_left.num_rows()),
+                            sf_right.num_rows(),
+                            estimate_num_keys(right_stats, sf_right.num_rows()),
+                            in_join_type == LEFT_JOIN || in_join_type == FULL_JOIN,
+                            in_join_type == RIGHT_JOIN || in_join_type == FULL_JOIN)
+                        << " rows" << std::endl;
+    // An inner join on keys whose ranges do not overlap is empty: join
+    // empty frames, which only makes the output columns.
+    if (in_join_type == INNER_JOIN) {
+      for (size_t i = 0; i < left_stats.size(); ++i) {
+        if (key_ranges_disjoint(left_stats[i], right_stats[i])) {
+          logstream(LOG_INFO) << "Join keys do not overlap. Skipping join" << std::endl;
+          sframe empty_left = empty_like(sf_left);
+          sframe empty_right = empty_like(sf_right);
+          join_impl::hash_join_executor join_executor(empty_left,
+                                                      empty_right,
+                                                      left_join_positions,
+                                                      right_join_positions,
+                                                      in_join_type,
+                                                      1);
+          return join_executor.grace_hash_join();
+        }
+      }
+    }
+  }
+
+  // The buffer is limited to the working memory the governor grants for
+  // the duration of the join.
+  auto grant = memory_governor::get_instance().acquire(
+      memory_consumer::JOIN, max_buffer_size * CELL_SIZE_ESTIMATE);
+  max_buffer_size = std::max<size_t>(1, grant->bytes() / CELL_SIZE_ESTIMATE);
+
   // execute join (perhaps multiplex algorithm based on something?)
   join_impl::hash_join_executor join_executor(sf_left,
                                               sf_right,
@@ -61,4 +142,82 @@ sframe join(sframe& sf_left,
   return join_executor.grace_hash_join();
 }
 
+sframe join(const std::vector<sframe>& frames,
+            const std::vector<std::string>& key_columns,
+            size_t max_buffer_size) {
+  if (frames.empty()) log_and_throw("No SFrames to join");
+
+  // the output has the key columns, then the other columns of each frame
+  std::vector<std::string> output_columns(key_columns.begin(), key_columns.end());
+  std::set<std::string> seen_columns(key_columns.begin(), key_columns.end());
+  for (const auto& sf: frames) {
+    for (const auto& key: key_columns) {
+      if (!sf.contains_column(key)) {
+        log_and_throw("SFrame does not contain join column " + key);
+      }
+    }
+    for (const auto& name: sf.column_names()) {
+      if (std::find(key_columns.begin(), key_columns.end(), name) != key_columns.end()) {
+        continue;
+      }
+      if (seen_columns.count(name)) {
+        log_and_throw("Column " + name + " is in more than one of the SFrames joined");
+      }
+      seen_columns.insert(name);
+      output_columns.push_back(name);
+    }
+  }
+  std::map<std::string, std::string> join_columns;
+  for (const auto& key: key_columns) join_columns[key] = key;
+
+  struct join_input {
+    sframe frame;
+    size_t num_keys;
+  };
+  std::vector<join_input> inputs;
+  for (const auto& sf: frames) {
+    // without known statistics, assume every key is distinct
+    size_t num_keys = sf.num_rows();
+    if (SFRAME_COST_BASED_OPTIMIZATION) {
+      std::vector<size_t> positions;
+      std::vector<column_statistics> key_stats;
+      for (const auto& key: key_columns) positions.push_back(sf.column_index(key));
+      if (find_key_statistics(sf, positions, key_stats)) {
+        num_keys = estimate_num_keys(key_stats, sf.num_rows());
+      }
+    }
+    inputs.push_back(join_input{sf, num_keys});
+  }
+
+  // Greedily join the two inputs with the smallest estimated output, until
+  // one is left. The keys of an output are the keys present in both inputs.
+  while (inputs.size() > 1) {
+    size_t best_left = 0, best_right = 1;
+    size_t best_rows = size_t(-1);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      for (size_t j = i + 1; j < inputs.size(); ++j) {
+        size_t rows = estimate_join_rows(inputs[i].frame.num_rows(), inputs[i].num_keys,
+                                         inputs[j].frame.num_rows(), inputs[j].num_keys);
+        if (rows < best_rows) {
+          best_rows = rows;
+          best_left = i;
+          best_right = j;
+        }
+      }
+    }
+    logstream(LOG_INFO) << "Joining inputs " << best_left << " and " << best_right
+                        << ", estimated output " << best_rows << " rows" << std::endl;
+    join_input joined;
+    joined.frame = join(inputs[best_left].frame, inputs[best_right].frame,
+                        "inner", join_columns, max_buffer_size);
+    joined.num_keys = std::min(std::min(inputs[best_left].num_keys,
+                                        inputs[best_right].num_keys),
+                               joined.frame.num_rows());
+    inputs.erase(inputs.begin() + best_right);
+    inputs.erase(inputs.begin() + best_left);
+    inputs.push_back(std::move(joined));
+  }
+  return inputs[0].frame.select_columns(output_columns);
+}
+
 } // end of graphlab
@@ -21,4 +21,21 @@ sframe join(sframe& sf_left,
             const std::map<std::string,std::string> join_columns,
             size_t max_buffer_size = SFRAME_JOIN_BUFFER_NUM_CELLS);
 
+/**
+ * Inner joins several sframes on the key columns they all have.
+ *
+ * The sframes are joined two at a time, always joining the two inputs (or
+ * intermediate results) whose join has the smallest estimated number of
+ * rows, estimated from the statistics of the key columns which are already
+ * known (saved with the columns, or cached by an earlier scan). The key
+ * columns are never scanned only to order the joins. The columns
+ * other than the keys must have distinct names in all the sframes.
+ *
+ * The output has the key columns, followed by the other columns of each
+ * sframe in order.
+ */
+sframe join(const std::vector<sframe>& frames,
+            const std::vector<std::string>& key_columns,
+            size_t max_buffer_size = SFRAME_JOIN_BUFFER_NUM_CELLS);
+
 } // end of graphlab
@@ -9,6 +9,7 @@
 #include <cppipc/server/cancel_ops.hpp>
 #include <util/cityhash_gl.hpp>
 #include <sframe/sframe_constants.hpp>
+#include <fileio/memory_governor.hpp>
 
 namespace graphlab {
 namespace join_impl {
@@ -222,42 +223,34 @@ void hash_join_executor::init_result_frame(sframe &result_frame) {
   }
 }
 
-std::vector<flexible_type> hash_join_executor::unpack_row(
-    std::string val, size_t num_cols) {
-  iarchive iarc(val.c_str(), val.length());
-  std::vector<flexible_type> row(num_cols);
-  for(auto row_it = row.begin(); row_it != row.end(); ++row_it) {
-    iarc >> *row_it;
-  }
-
-  return row;
-}
-
 sframe hash_join_executor::grace_hash_join() {
   sframe result_frame;
 
-  std::shared_ptr<sframe> grace_left;
-  std::shared_ptr<sframe> grace_right;
+  spill_session session(memory_consumer::JOIN, "join");
+  // the partitions stay in memory while they fit in the join's buffer
+  session.set_memory_budget(_max_buffer_size * CELL_SIZE_ESTIMATE);
+  std::unique_ptr<spill_partitions> grace_left;
+  std::unique_ptr<spill_partitions> grace_right;
   timer full_ti;
   timer ti;
-  std::tie(grace_left, grace_right) = this->grace_partition_frames();
+  std::tie(grace_left, grace_right) = this->grace_partition_frames(session);
   logstream(LOG_INFO) << "Partitioned frames in: " << ti.current_time() << std::endl;
   this->init_result_frame(result_frame);
-  ASSERT_EQ(grace_left->size(), _left_frame.size());
-  ASSERT_EQ(grace_right->size(), _right_frame.size());
 
   size_t num_segments;
   std::vector<size_t> right_segment_lengths;
   if(_frames_partitioned) {
-    num_segments = grace_left->num_segments();
+    ASSERT_EQ(grace_left->size(), _left_frame.size());
+    ASSERT_EQ(grace_right->size(), _right_frame.size());
+    num_segments = grace_left->num_partitions();
     // After partitioning this needs to be true
-    ASSERT_EQ(num_segments, grace_right->num_segments());
+    ASSERT_EQ(num_segments, grace_right->num_partitions());
     for(size_t i = 0; i < num_segments; ++i) {
-      right_segment_lengths.push_back(grace_right->segment_length(i));
+      right_segment_lengths.push_back(grace_right->partition_length(i));
     }
   } else { 
     num_segments = 1;
-    right_segment_lengths.push_back(grace_right->num_rows());
+    right_segment_lengths.push_back(_right_frame.num_rows());
   }
 
   // Instantiate all output iterators
@@ -300,14 +293,23 @@ sframe hash_join_executor::grace_hash_join() {
   ASSERT_EQ(logical_right_segment_sizes.size(),
             num_segments*result_frame.num_segments());
 
-  // Readers for the left and right SArray used in the join
+  // The first row of each logical segment within its partition
+  std::vector<size_t> logical_right_segment_starts(logical_right_segment_sizes.size(), 0);
+  for(size_t i = 0; i < logical_right_segment_sizes.size(); ++i) {
+    if(i % result_frame.num_segments() != 0) {
+      logical_right_segment_starts[i] =
+          logical_right_segment_starts[i - 1] + logical_right_segment_sizes[i - 1];
+    }
+  }
+
+  // Readers for the left and right SArray used in the join, if they are not
+  // partitioned. The partitions are read from the spill.
   std::unique_ptr<sframe::reader_type> l_rdr;
-  if(_frames_partitioned) {
-    l_rdr = grace_left->get_reader();
-  } else {
-    l_rdr = grace_left->get_reader(num_segments);
+  std::unique_ptr<sframe::reader_type> r_rdr;
+  if(!_frames_partitioned) {
+    l_rdr = _left_frame.get_reader(num_segments);
+    r_rdr = _right_frame.get_reader(logical_right_segment_sizes);
   }
-  auto r_rdr = grace_right->get_reader(logical_right_segment_sizes);
 
   // Iterate over each segment of the left frame and add to a hash table.
   // These segments can not be read in parallel because they are
@@ -316,15 +318,13 @@ sframe hash_join_executor::grace_hash_join() {
   for(size_t i = 0; i < num_segments; ++i) {
     // Load the entire left partition into a hash table
     join_hash_table cur_ht(_left_join_positions);
-    for(auto iter = l_rdr->begin(i); iter != l_rdr->end(i); ++iter) {
-      // Must unpack the row data from the serialized string it is stored as
-      std::vector<flexible_type> row;
-      if(_frames_partitioned) {
-        row = unpack_row(std::string(iter->at(0)), _left_frame.num_columns());
-      } else {
-        row = *iter;
+    if(_frames_partitioned) {
+      auto reader = grace_left->get_reader(i);
+      while(reader.has_next()) cur_ht.add_row(reader.next());
+    } else {
+      for(auto iter = l_rdr->begin(i); iter != l_rdr->end(i); ++iter) {
+        cur_ht.add_row(*iter);
       }
-      cur_ht.add_row(row);
     }
 
     parallel_for(0, result_frame.num_segments(),
@@ -332,19 +332,7 @@ sframe hash_join_executor::grace_hash_join() {
           size_t cur_logical_segment = i*result_frame.num_segments()+seg_num;
           auto writer = result_output_iterators[seg_num];
 
-          // Iterate through the logical segment of the current segment
-          for(auto iter = r_rdr->begin(cur_logical_segment);
-              iter != r_rdr->end(cur_logical_segment);
-              ++iter) {
-
-            // Must unpack the row data from the serialized string it is stored as
-            std::vector<flexible_type> row;
-            if(_frames_partitioned) {
-              row = unpack_row(std::string(iter->at(0)), _right_frame.num_columns());
-            } else {
-              row = *iter;
-            }
-
+          auto probe = [&](const std::vector<flexible_type>& row) {
             // Merge any matching rows to the corresponding left row and write
             auto query_result = cur_ht.get_matching_rows(row, _right_join_positions);
 
@@ -356,6 +344,20 @@ sframe hash_join_executor::grace_hash_join() {
               // Match found! Add to the result set
               merge_rows_for_output(result_frame, writer, query_result.rows, {row});
             }
+          };
+
+          // Iterate through the logical segment of the current segment
+          if(_frames_partitioned) {
+            size_t row_start = logical_right_segment_starts[cur_logical_segment];
+            auto reader = grace_right->get_reader(
+                i, row_start, row_start + logical_right_segment_sizes[cur_logical_segment]);
+            while(reader.has_next()) probe(reader.next());
+          } else {
+            for(auto iter = r_rdr->begin(cur_logical_segment);
+                iter != r_rdr->end(cur_logical_segment);
+                ++iter) {
+              probe(*iter);
+            }
           }
         });
 
@@ -529,7 +531,8 @@ size_t hash_join_executor::choose_number_of_grace_partitions(const sframe &sf) {
 }
 
 
-std::pair<std::shared_ptr<sframe>,std::shared_ptr<sframe>> hash_join_executor::grace_partition_frames() {
+std::pair<std::unique_ptr<spill_partitions>,std::unique_ptr<spill_partitions>>
+hash_join_executor::grace_partition_frames(spill_session& session) {
   // Pick # of partitions
   // TODO: Add estimated disk and memory size to SFrames.
   // This way we can check when to do GRACE recursively
@@ -540,70 +543,58 @@ std::pair<std::shared_ptr<sframe>,std::shared_ptr<sframe>> hash_join_executor::g
   logstream(LOG_INFO) << "Chose " << num_partitions <<
     " partitions for GRACE hash join\n";
 
+  // We don't need to partition if only 1 is needed
+  if(num_partitions == 1) {
+    return {nullptr, nullptr};
+  }
+
   // Hash join columns into separate partitions
-  // (each partition is a segment of an SFrame)
-  auto parted_left_frame = grace_partition_frame(_left_frame, _left_join_positions, num_partitions);
-  auto parted_right_frame = grace_partition_frame(_right_frame, _right_join_positions, num_partitions);
+  auto parted_left_frame = grace_partition_frame(session, _left_frame,
+                                                 _left_join_positions, num_partitions);
+  auto parted_right_frame = grace_partition_frame(session, _right_frame,
+                                                  _right_join_positions, num_partitions);
+  _frames_partitioned = true;
 
-  return std::make_pair(parted_left_frame, parted_right_frame);
+  return std::make_pair(std::move(parted_left_frame), std::move(parted_right_frame));
 }
 
-std::shared_ptr<sframe> hash_join_executor::grace_partition_frame(
+std::unique_ptr<spill_partitions> hash_join_executor::grace_partition_frame(
+    spill_session& session,
     const sframe &sf,
     const std::vector<size_t> &join_col_nums,
     size_t num_partitions) {
-  //TODO: for now
   log_func_entry();
-  // We don't need to partition if only 1 is needed
-  if(num_partitions == 1) {
-    return std::make_shared<sframe>(sf);
-  } else if(num_partitions < 1) {
+  if(num_partitions < 1) {
     log_and_throw("Cannot make < 1 partitions!");
   }
 
-  // Open the partitioned sframe
-  auto parted_array = std::make_shared<sframe>();
-  parted_array->open_for_write({"data"},{flex_type_enum::STRING},"",num_partitions);
+  // The partitions keep the column types of the frame
+  std::unique_ptr<spill_partitions> parts(
+      new spill_partitions(session, sf.column_types(), num_partitions));
 
-  // Get all iterators
-  // Create a mutex for each iterator
-  std::vector<sframe::iterator> outiter_vector(num_partitions);
+  // Create a mutex for each partition
   std::vector<mutex> outiter_mutexes(num_partitions);
-  for(size_t i = 0; i < num_partitions; ++i) {
-    outiter_vector[i] = parted_array->get_output_iterator(i);
-  }
+  size_t row_bytes = sf.num_columns() * CELL_SIZE_ESTIMATE;
 
   // Iterate over each row of the given SFrame, hash on the join columns,
-  // and write that row to the appropriate segment of the partitioned sframe
+  // and write that row to the appropriate partition
   auto rdr = sf.get_reader(thread::cpu_count());
   parallel_for(0, rdr->num_segments(), [&](size_t seg_num) {
-    oarchive oarc;
     for(auto j = rdr->begin(seg_num); j != rdr->end(seg_num); ++j) {
       // Hash the given columns
       size_t hash_val = compute_hash_from_row(*j, join_col_nums);
       size_t which_partition = hash_val % num_partitions;
 
-      // Serialize the row
-      for(auto &k : *j) {
-        oarc << k;
-      }
-      std::string s = std::string(oarc.buf, oarc.off);
-      flexible_type f(std::move(s));
       outiter_mutexes[which_partition].lock();
-      *(outiter_vector[which_partition]) = std::vector<flexible_type>{std::move(f)};
-      ++outiter_vector[which_partition];
+      parts->write(which_partition, *j, row_bytes);
       outiter_mutexes[which_partition].unlock();
-      oarc.off = 0;
     }
-    free(oarc.buf);
   });
 
   // We're done writing. Close all output iterators.
-  parted_array->close();
-  
-  _frames_partitioned = true;
+  parts->close();
 
-  return parted_array;
+  return parts;
 }
 
 size_t compute_hash_from_row(const std::vector<flexible_type> &row,
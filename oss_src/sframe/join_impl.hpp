@@ -10,6 +10,7 @@
 #include <unordered_map>
 
 #include <sframe/sframe.hpp>
+#include <sframe/spill_partitions.hpp>
 
 //TODO: What happens if a join key (or part of one) is NULL?
 enum join_type_t {INNER_JOIN = 0, LEFT_JOIN, RIGHT_JOIN, FULL_JOIN};
@@ -126,16 +127,22 @@ class hash_join_executor {
 
   /**
    * Partition the left and right frames for the GRACE hash join algorithm and
-   * write these partitions out to disk.
+   * spill these partitions to disk. Returns null partitions if the frames
+   * do not need to be partitioned.
    */
-  std::pair<std::shared_ptr<sframe>,std::shared_ptr<sframe>> grace_partition_frames();
+  std::pair<std::unique_ptr<spill_partitions>,std::unique_ptr<spill_partitions>>
+      grace_partition_frames(spill_session& session);
 
   /**
-   * Partition one SFrame for the GRACE hash join algorithm.
+   * Partition one SFrame for the GRACE hash join algorithm. The rows keep
+   * the column types of the frame.
    *
    * Used by grace_partition_frames().
    */
-  std::shared_ptr<sframe> grace_partition_frame(const sframe &sf, const std::vector<size_t> &join_col_nums, size_t num_partitions);
+  std::unique_ptr<spill_partitions> grace_partition_frame(spill_session& session,
+                                                          const sframe &sf,
+                                                          const std::vector<size_t> &join_col_nums,
+                                                          size_t num_partitions);
 
   /**
    * Return the number of cells (rows * cols) of an sframe.
@@ -168,8 +175,6 @@ class hash_join_executor {
                              sframe::iterator result_iter,
                              const std::vector<std::vector<flexible_type>> &left_rows,
                              const std::vector<std::vector<flexible_type>> &right_rows);
-
-  std::vector<flexible_type> unpack_row(std::string val, size_t num_cols);
 };
 
 } // end of join_impl
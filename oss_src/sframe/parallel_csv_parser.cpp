@@ -969,24 +969,11 @@ void parse_csv_to_sframe(
   }
 }
 
-std::map<std::string, std::shared_ptr<sarray<flexible_type>>> parse_csvs_to_sframe(
-    const std::string& url,
-    csv_line_tokenizer& tokenizer,
-    csv_file_handling_options options,
-    sframe& frame,
-    std::string frame_sidx_file) {
-  // unpack the options
-  auto use_header = options.use_header;
-  auto continue_on_failure = options.continue_on_failure;
-  auto store_errors = options.store_errors;
-  auto column_type_hints = options.column_type_hints;
-  auto output_columns = options.output_columns;
-  auto row_limit = options.row_limit;
-  auto skip_rows = options.skip_rows;
-  
-  if (store_errors) continue_on_failure = true;
-  // otherwise, check that url is valid directory, and get its listing if no 
-  // pattern present
+/**
+ * Lists the regular files matching url (a file, a directory or a glob).
+ * Throws if there are none.
+ */
+static std::vector<std::string> get_csv_files(const std::string& url) {
   std::vector<std::string> files;
   std::vector<std::pair<std::string, file_status>> file_and_status = fileio::get_glob_files(url);
   
@@ -1000,22 +987,22 @@ std::map<std::string, std::shared_ptr<sarray<flexible_type>>> parse_csvs_to_sfra
     }
   }
 
-  file_and_status.clear(); // don't need these anymore
-  
   // ensure that we actually found some valid files
   if (files.empty()) {
     log_and_throw(std::string("No files corresponding to the specified path (") + 
                   sanitize_url(url) + std::string(")."));
   }
-  // get CSV info from first file
-  csv_info info;
-  read_csv_header(info, files[0], tokenizer, use_header, skip_rows);
-  logstream(LOG_INFO) << "CSV num. columns: " << info.ncols << std::endl;
-
-  if (info.ncols <= 0)
-    log_and_throw(std::string("0 columns found"));
+  return files;
+}
 
-  // check output_columns
+/**
+ * Restricts info to output_columns, which may name columns, or give their
+ * 1 based position as "X<n>". Returns the mapping from input columns to
+ * output columns, which is -1 where the input column is dropped, or an
+ * empty vector if all columns are output.
+ */
+static std::vector<size_t> select_output_columns(csv_info& info,
+                                                 const std::vector<std::string>& output_columns) {
   std::vector<size_t> output_column_order;
   if (!output_columns.empty()) {
     /*
@@ -1037,7 +1024,7 @@ std::map<std::string, std::shared_ptr<sarray<flexible_type>>> parse_csvs_to_sfra
       // Cannot find this column in the talble?
       // is output_columns a positional type? i.e. "X" something
       if (iter == info.column_names.end() && 
-          outcol.length() > 1 && outcol[i] == 'X') {
+          outcol.length() > 1 && outcol[0] == 'X') {
         size_t colnumber = stoull(outcol.substr(1));
         // column number is 1 based
         if (colnumber == 0 || colnumber > info.column_names.size()) {
@@ -1056,6 +1043,53 @@ std::map<std::string, std::shared_ptr<sarray<flexible_type>>> parse_csvs_to_sfra
     info.column_names = output_columns;
     info.ncols = output_columns.size();
   }
+  return output_column_order;
+}
+
+std::pair<std::vector<std::string>, std::vector<flex_type_enum>> read_csv_schema(
+    const std::string& url,
+    csv_line_tokenizer& tokenizer,
+    const csv_file_handling_options& options) {
+  std::vector<std::string> files = get_csv_files(url);
+  csv_info info;
+  read_csv_header(info, files[0], tokenizer, options.use_header, options.skip_rows);
+  if (info.ncols <= 0)
+    log_and_throw(std::string("0 columns found"));
+  select_output_columns(info, options.output_columns);
+  get_column_types(info, options.column_type_hints);
+  return {info.column_names, info.column_types};
+}
+
+std::map<std::string, std::shared_ptr<sarray<flexible_type>>> parse_csvs_to_sframe(
+    const std::string& url,
+    csv_line_tokenizer& tokenizer,
+    csv_file_handling_options options,
+    sframe& frame,
+    std::string frame_sidx_file) {
+  // unpack the options
+  auto use_header = options.use_header;
+  auto continue_on_failure = options.continue_on_failure;
+  auto store_errors = options.store_errors;
+  auto column_type_hints = options.column_type_hints;
+  auto output_columns = options.output_columns;
+  auto row_limit = options.row_limit;
+  auto skip_rows = options.skip_rows;
+  
+  if (store_errors) continue_on_failure = true;
+  // otherwise, check that url is valid directory, and get its listing if no 
+  // pattern present
+  std::vector<std::string> files = get_csv_files(url);
+
+  // get CSV info from first file
+  csv_info info;
+  read_csv_header(info, files[0], tokenizer, use_header, skip_rows);
+  logstream(LOG_INFO) << "CSV num. columns: " << info.ncols << std::endl;
+
+  if (info.ncols <= 0)
+    log_and_throw(std::string("0 columns found"));
+
+  // check output_columns
+  std::vector<size_t> output_column_order = select_output_columns(info, output_columns);
   // fill in the type information
   get_column_types(info, column_type_hints);
 
@@ -51,6 +51,17 @@ std::map<std::string, std::shared_ptr<sarray<flexible_type>>> parse_csvs_to_sfra
     sframe& frame,
     std::string frame_sidx_file = "");
 
+/**
+ * Returns the column names and types parse_csvs_to_sframe would produce
+ * with the same arguments, reading only the header of the first file.
+ * The output_columns and column_type_hints options are applied; the row
+ * related options are ignored.
+ */
+std::pair<std::vector<std::string>, std::vector<flex_type_enum>> read_csv_schema(
+    const std::string& url,
+    csv_line_tokenizer& tokenizer,
+    const csv_file_handling_options& options);
+
 }
 
 #endif // GRAPHLAB_UNITY_LIB_PARALLEL_CSV_PARSER_HPP
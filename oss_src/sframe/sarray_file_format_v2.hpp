@@ -10,6 +10,7 @@
 #include <string>
 #include <memory>
 #include <typeinfo>
+#include <type_traits>
 #include <map>
 #include <parallel/mutex.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -25,6 +26,8 @@
 #include <sframe/sarray_v2_block_manager.hpp>
 #include <sframe/sarray_v2_block_writer.hpp>
 #include <sframe/sarray_v2_encoded_block.hpp>
+#include <sframe/sarray_v2_decoded_block_cache.hpp>
+#include <sframe/column_statistics.hpp>
 #include <cppipc/server/cancel_ops.hpp>
 namespace graphlab {
 
@@ -85,6 +88,10 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
     m_cache.resize(m_block_list.size());
     m_used_cache_entries.resize(m_block_list.size());
     m_used_cache_entries.clear();
+    m_read_ahead_issued.resize(m_block_list.size());
+    m_read_ahead_issued.clear();
+    m_sequential_blocks.resize(m_block_list.size());
+    m_sequential_blocks.clear();
     // it is convenient for m_start_row to have one more entry which is 
     // the total # elements in the file
     m_start_row.push_back(m_num_rows);
@@ -124,6 +131,13 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
     return m_index_info.segment_sizes[segmentid];
   }
 
+  /**
+   * Returns the number of blocks currently held in the cache of this reader.
+   */
+  size_t num_cached_blocks() const {
+    return m_cache_size.value;
+  }
+
   /**
    * Gets the contents of the index file information read from the index file
    */
@@ -215,6 +229,16 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
    *  - When an eviction happens, we pick a random block number and search
    *  for the next block number which contains a cache entry, and try to evict
    *  that.
+   *
+   * For flexible_type arrays, when the process wide
+   * v2_block_impl::decoded_block_cache is enabled, blocks are looked up
+   * there first. A block read from file by a full sequential read (a read
+   * covering the whole block, or continuing from the end of the previous
+   * block) is decoded entirely and published to it. Other reads keep the
+   * block encoded, so that a small random read only decodes what it
+   * needs. Entries from the process wide cache hold a decoded buffer
+   * shared with it (is_shared), which must not be modified or returned to
+   * the buffer pool.
    */
   struct cache_entry {
     cache_entry() = default;
@@ -223,6 +247,7 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
     cache_entry(cache_entry&& other) {
       buffer_start_row = std::move(other.buffer_start_row);
       is_encoded = std::move(other.is_encoded);
+      is_shared = std::move(other.is_shared);
       buffer = std::move(other.buffer);
       encoded_buffer = std::move(other.encoded_buffer);
       encoded_buffer_reader = std::move(other.encoded_buffer_reader);
@@ -233,6 +258,7 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
     cache_entry& operator=(cache_entry&& other) {
       buffer_start_row = std::move(other.buffer_start_row);
       is_encoded = std::move(other.is_encoded);
+      is_shared = std::move(other.is_shared);
       buffer = std::move(other.buffer);
       encoded_buffer = std::move(other.encoded_buffer);
       encoded_buffer_reader = std::move(other.encoded_buffer_reader);
@@ -242,6 +268,8 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
     size_t buffer_start_row = 0;
     // whether this cache entry is held encoded or decoded
     bool is_encoded = false;
+    // whether the decoded buffer belongs to the process wide cache
+    bool is_shared = false;
     bool has_data = false;
     // if it is held decoded
     std::shared_ptr<std::vector<T> > buffer;
@@ -257,6 +285,16 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
   dense_bitset m_used_cache_entries;
   /// The number of cached blocks. If this gets big we need to evict something
   atomic<size_t> m_cache_size;
+  /**
+   * The blocks for which a read-ahead has been issued to the block manager
+   * and which have not been fetched since.
+   */
+  dense_bitset m_read_ahead_issued;
+  /**
+   * The blocks whose previous block was exhausted by a sequential read:
+   * a read starting at one of these continues a sequential scan.
+   */
+  dense_bitset m_sequential_blocks;
   /**
    * There is one cache object for each block
    */
@@ -275,6 +313,26 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
 
   void ensure_cache_decoded(cache_entry& cache, size_t block_number);
 
+  /**
+   * Fills the cache entry from the process wide decoded block cache.
+   * Returns false if the block is not cached there.
+   */
+  bool fetch_cache_from_shared_cache(size_t block_number, cache_entry& ret);
+
+  /**
+   * Updates the bitfield and cache_size counters after a cache entry is
+   * filled, and evicts something if the cache is too large.
+   */
+  void on_cache_filled(size_t block_number);
+
+  /**
+   * Asks the block manager to prefetch the SFRAME_READ_AHEAD_BLOCKS blocks
+   * following block_number, skipping those already requested or held in
+   * the process wide decoded block cache. Called when a block is fetched by
+   * a sequential read.
+   */
+  void issue_read_ahead(size_t block_number);
+
   /**
    * Releases a cache entry.
    * Releases the buffer back to the pool and update the bitfield and 
@@ -284,8 +342,11 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
     // if there is something to release
     if (m_cache[block_number].has_data) {
 //       std::cerr << "Releasing cache : " << block_number << std::endl;
-      m_buffer_pool.release_buffer(std::move(m_cache[block_number].buffer));
+      if (!m_cache[block_number].is_shared) {
+        m_buffer_pool.release_buffer(std::move(m_cache[block_number].buffer));
+      }
       m_cache[block_number].buffer.reset();
+      m_cache[block_number].is_shared = false;
       m_cache[block_number].encoded_buffer.release();
       m_cache[block_number].encoded_buffer_reader.release();
       m_cache[block_number].has_data = false;
@@ -317,7 +378,14 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
     }
   }
 
-  void fetch_cache_from_file(size_t block_number, cache_entry& ret);
+  /**
+   * Fills the cache entry from file. If publish is true and T is
+   * flexible_type, the block is decoded entirely and published to the
+   * process wide decoded block cache (if enabled); otherwise flexible_type
+   * blocks are held encoded.
+   */
+  void fetch_cache_from_file(size_t block_number, cache_entry& ret,
+                             bool publish = false);
 
   size_t block_offset_containing_row(size_t row) {
     auto pos = std::lower_bound(m_start_row.begin(), m_start_row.end(), row);
@@ -340,18 +408,77 @@ class sarray_format_reader_v2: public sarray_format_reader<T> {
 template <typename T>
 buffer_pool<std::vector<T> > sarray_format_reader_v2<T>::m_buffer_pool;
 
+template <typename T>
+inline void sarray_format_reader_v2<T>::on_cache_filled(size_t block_number) {
+  if (m_used_cache_entries.get(block_number) == false) m_cache_size.inc();
+  m_used_cache_entries.set_bit(block_number);
+  m_read_ahead_issued.clear_bit(block_number);
+  // evict something random
+  // we will only loop at most this number of times
+  int num_to_evict = (int)(m_cache_size.value) - 
+      SFRAME_MAX_BLOCKS_IN_CACHE;
+  while(num_to_evict > 0 && 
+        m_cache_size.value > SFRAME_MAX_BLOCKS_IN_CACHE) {
+    try_evict_something_from_cache();
+    --num_to_evict;
+  }
+}
+
+template <typename T>
+inline void sarray_format_reader_v2<T>::issue_read_ahead(size_t block_number) {
+  size_t end = std::min(block_number + 1 + SFRAME_READ_AHEAD_BLOCKS, 
+                        m_block_list.size());
+  std::vector<block_address> addrs;
+  for (size_t i = block_number + 1; i < end; ++i) {
+    if (m_read_ahead_issued.set_bit(i)) continue;
+    if (std::is_same<T, flexible_type>::value &&
+        v2_block_impl::decoded_block_cache::enabled() &&
+        v2_block_impl::decoded_block_cache::get_instance().contains(m_block_list[i])) {
+      continue;
+    }
+    addrs.push_back(m_block_list[i]);
+  }
+  if (!addrs.empty()) m_manager.prefetch_blocks(addrs);
+}
+
+template <>
+inline bool sarray_format_reader_v2<flexible_type>::
+fetch_cache_from_shared_cache(size_t block_number, cache_entry& ret) {
+  if (!v2_block_impl::decoded_block_cache::enabled()) return false;
+  auto block = v2_block_impl::decoded_block_cache::get_instance().get(
+      m_block_list[block_number]);
+  if (block == nullptr) return false;
+  if (ret.buffer && !ret.is_shared) {
+    m_buffer_pool.release_buffer(std::move(ret.buffer));
+  }
+  ret.buffer = block;
+  ret.is_shared = true;
+  ret.buffer_start_row = m_start_row[block_number];
+  ret.is_encoded = false;
+  ret.has_data = true;
+  on_cache_filled(block_number);
+  return true;
+}
+
+template <typename T>
+inline bool sarray_format_reader_v2<T>::
+fetch_cache_from_shared_cache(size_t block_number, cache_entry& ret) {
+  return false;
+}
+
 // specialization for fetch_cache_from_file when T is a flexible_type
 // since this permits an encoded representation
 template <>
 inline void 
 sarray_format_reader_v2<flexible_type>::
-fetch_cache_from_file(size_t block_number, cache_entry& ret) {
+fetch_cache_from_file(size_t block_number, cache_entry& ret, bool publish) {
 //   std::cerr << "Fetching from file: " << block_number << std::endl;
   // don't use the buffer. hold as encoded always when reading from a 
   // flexible_type file
   if (ret.buffer) {
-    m_buffer_pool.release_buffer(std::move(ret.buffer));
+    if (!ret.is_shared) m_buffer_pool.release_buffer(std::move(ret.buffer));
     ret.buffer.reset();
+    ret.is_shared = false;
   }
   block_address block_addr = m_block_list[block_number];
   v2_block_impl::block_info* info; 
@@ -360,27 +487,30 @@ fetch_cache_from_file(size_t block_number, cache_entry& ret) {
     log_and_throw("Unexpected block read failure. Bad file?");
   }
   ret.buffer_start_row = m_start_row[block_number];
-  ret.encoded_buffer.init(*info, buffer);
-  ret.encoded_buffer_reader = ret.encoded_buffer.get_range();
-  ret.is_encoded = true;
-  ret.has_data = true;
-  if (m_used_cache_entries.get(block_number) == false) m_cache_size.inc();
-  m_used_cache_entries.set_bit(block_number);
-  // evict something random
-  // we will only loop at most this number of times
-  int num_to_evict = (int)(m_cache_size.value) - 
-      SFRAME_MAX_BLOCKS_IN_CACHE;
-  while(num_to_evict > 0 && 
-        m_cache_size.value > SFRAME_MAX_BLOCKS_IN_CACHE) {
-    try_evict_something_from_cache();
-    --num_to_evict;
+  if (publish && v2_block_impl::decoded_block_cache::enabled()) {
+    // decode the whole block and publish it, so that other readers
+    // of this block do not have to read and decode it again.
+    auto decoded = std::make_shared<std::vector<flexible_type>>();
+    v2_block_impl::typed_decode(*info, buffer->data(), buffer->size(), *decoded);
+    v2_block_impl::decoded_block_cache::get_instance().insert(
+        block_addr, decoded, 
+        v2_block_impl::decoded_block_cache::estimate_block_size(*info));
+    ret.buffer = decoded;
+    ret.is_shared = true;
+    ret.is_encoded = false;
+  } else {
+    ret.encoded_buffer.init(*info, buffer);
+    ret.encoded_buffer_reader = ret.encoded_buffer.get_range();
+    ret.is_encoded = true;
   }
+  ret.has_data = true;
+  on_cache_filled(block_number);
 }
 
 template <typename T>
 inline void 
 sarray_format_reader_v2<T>::
-fetch_cache_from_file(size_t block_number, cache_entry& ret) {
+fetch_cache_from_file(size_t block_number, cache_entry& ret, bool publish) {
 //   std::cerr << "Fetching from file: " << block_number << std::endl;
   if (!ret.buffer) ret.buffer = m_buffer_pool.get_new_buffer();
   block_address block_addr = m_block_list[block_number];
@@ -390,17 +520,7 @@ fetch_cache_from_file(size_t block_number, cache_entry& ret) {
   ret.buffer_start_row = m_start_row[block_number];
   ret.is_encoded = false;
   ret.has_data = true;
-  if (m_used_cache_entries.get(block_number) == false) m_cache_size.inc();
-  m_used_cache_entries.set_bit(block_number);
-  // evict something random
-  // we will only loop at most this number of times
-  int num_to_evict = (int)(m_cache_size.value) - 
-      SFRAME_MAX_BLOCKS_IN_CACHE;
-  while(num_to_evict > 0 && 
-        m_cache_size.value > SFRAME_MAX_BLOCKS_IN_CACHE) {
-    try_evict_something_from_cache();
-    --num_to_evict;
-  }
+  on_cache_filled(block_number);
 }
 
 
@@ -448,8 +568,19 @@ fetch_rows_from_cache(size_t fetch_start,
     auto& cache = m_cache[i];
     std::unique_lock<graphlab::simple_spinlock> cache_lock_guard(cache.lock);
     if (!cache.has_data) {
-      fetch_cache_from_file(i, cache);
+      bool from_block_start = first_row_to_fetch_in_this_block == m_start_row[i];
+      if (from_block_start) issue_read_ahead(i);
+      // a full sequential read of the block: the read covers it, or it
+      // continues from the end of the previous block.
+      bool sequential = from_block_start &&
+          (last_row_to_fetch_in_this_block == m_start_row[i + 1] ||
+           i > start_offset ||
+           m_sequential_blocks.get(i));
+      if (!fetch_cache_from_shared_cache(i, cache)) {
+        fetch_cache_from_file(i, cache, sequential);
+      }
     } 
+    m_sequential_blocks.clear_bit(i);
     if (cache.buffer_start_row < first_row_to_fetch_in_this_block && cache.is_encoded) {
       // fast forward
       size_t diff = first_row_to_fetch_in_this_block - cache.buffer_start_row;
@@ -466,16 +597,19 @@ fetch_rows_from_cache(size_t fetch_start,
         output_idx += num_elem;
         cache.buffer_start_row = last_row_to_fetch_in_this_block;
       } else {
+        // the buffer may be shared, so we copy
         size_t input_offset = m_start_row[i];
         for (size_t j = first_row_to_fetch_in_this_block; 
              j < last_row_to_fetch_in_this_block; 
              ++j) {
           out_obj[output_idx++] = (*cache.buffer)[j - input_offset];
         }
+        cache.buffer_start_row = last_row_to_fetch_in_this_block;
       }
       if (last_row_to_fetch_in_this_block == m_start_row[i + 1]) {
         // we have exhausted this cache
         release_cache(i); 
+        if (i + 1 < m_block_list.size()) m_sequential_blocks.set_bit(i + 1);
       }
     } else {
       // non sequential read
@@ -487,6 +621,11 @@ fetch_rows_from_cache(size_t fetch_start,
            ++j) {
         out_obj[output_idx++] = (*cache.buffer)[j - input_offset];
       }
+      // the last row of the block has been served. Drop the block rather 
+      // than pinning it (possibly a shared decoded block) in this reader.
+      if (last_row_to_fetch_in_this_block == m_start_row[i + 1]) {
+        release_cache(i); 
+      }
     }
   }
 }
@@ -509,6 +648,7 @@ fetch_rows_from_cache(size_t fetch_start,
     if (!cache.buffer ||
         cache.buffer_start_row > first_row_to_fetch_in_this_block) {
       // we need to reload the cache
+      if (first_row_to_fetch_in_this_block == m_start_row[i]) issue_read_ahead(i);
       fetch_cache_from_file(i, cache);
     } 
     if (cache.buffer_start_row == first_row_to_fetch_in_this_block) {
@@ -559,6 +699,11 @@ read_rows(size_t row_start,
 
 /**
  * The array group writer which emits array v2 file formats.
+ *
+ * For flexible_type columns, if SFRAME_COST_BASED_OPTIMIZATION is set, the
+ * statistics of each column (see column_statistics.hpp) are gathered from
+ * the blocks as they are flushed, and stored in the column metadata on
+ * \ref close.
  */
 template <typename T>
 class sarray_group_format_writer_v2: public sarray_group_format_writer<T> {
@@ -577,8 +722,19 @@ class sarray_group_format_writer_v2: public sarray_group_format_writer<T> {
     m_writer.init(index_file, segments_to_create, columns_to_create);
     m_nsegments = segments_to_create;
     m_column_buffers.resize(columns_to_create);
+    // very wide frames would need too many distinct value sketches
+    m_collect_statistics = std::is_same<T, flexible_type>::value &&
+        SFRAME_COST_BASED_OPTIMIZATION &&
+        columns_to_create * segments_to_create <= MAX_STATISTICS_SEGMENTS;
     for (size_t i = 0; i < columns_to_create; ++i) {
       m_column_buffers[i].segment_data.resize(segments_to_create);
+      m_column_buffers[i].segment_stats.clear();
+      if (m_collect_statistics) {
+        for (size_t j = 0; j < segments_to_create; ++j) {
+          m_column_buffers[i].segment_stats.push_back(
+              segment_statistics(STATISTICS_HLL_BITS));
+        }
+      }
     }
     for (size_t i = 0; i < m_nsegments; ++i) {
       open_segment(i);
@@ -593,6 +749,16 @@ class sarray_group_format_writer_v2: public sarray_group_format_writer<T> {
     return m_writer.get_index_info();
   }
 
+  /**
+   * Sets the compression codec of a column. 
+   * See v2_block_impl::block_writer::set_column_compression()
+   */
+  void set_column_compression(size_t columnid,
+                              v2_block_impl::column_compression_options options) {
+    DASSERT_LT(columnid, m_column_buffers.size());
+    m_writer.set_column_compression(columnid, options);
+  }
+
   /**
    * Writes a row to the array group
    */
@@ -665,6 +831,14 @@ class sarray_group_format_writer_v2: public sarray_group_format_writer<T> {
       }
       m_writer.close_segment(i);
     }
+    if (m_collect_statistics) {
+      for (size_t j = 0;j < m_column_buffers.size(); ++j) {
+        auto& segment_stats = m_column_buffers[j].segment_stats;
+        m_writer.get_index_info().columns[j].metadata[COLUMN_STATISTICS_METADATA_KEY] =
+            combine_segment_statistics(segment_stats).to_string();
+        segment_stats.clear();
+      }
+    }
     /*
      * for (size_t i = 0;i < m_column_buffers.size(); ++i) {
      *   logstream(LOG_INFO) << "Writing column " << i 
@@ -708,8 +882,14 @@ class sarray_group_format_writer_v2: public sarray_group_format_writer<T> {
   }
 
  private:
+  /// The precision of the distinct value estimates of the column statistics
+  static constexpr size_t STATISTICS_HLL_BITS = 10;
+  /// The maximum number of column segments to gather statistics for
+  static constexpr size_t MAX_STATISTICS_SEGMENTS = 16384;
   /// whether the array is open
   bool m_array_open = false;
+  /// whether the column statistics are gathered
+  bool m_collect_statistics = false;
   /// The number of segments
   size_t m_nsegments;
   /// The writer
@@ -723,6 +903,8 @@ class sarray_group_format_writer_v2: public sarray_group_format_writer<T> {
     size_t elements_before_flush = SARRAY_WRITER_INITAL_ELEMENTS_PER_BLOCK;
     size_t total_bytes_written = 0;
     size_t total_elements_written = 0;
+    // The statistics of the values written to each segment, if collected
+    std::vector<segment_statistics> segment_stats;
   };
   
   std::vector<column_buffer> m_column_buffers;
@@ -763,6 +945,10 @@ inline void sarray_group_format_writer_v2<flexible_type>::flush_block(size_t col
   // if there is no data to write, skip
   auto& colbuf = m_column_buffers[columnid];
   if (colbuf.segment_data[segmentid].empty()) return;
+  if (m_collect_statistics) {
+    auto& stats = colbuf.segment_stats[segmentid];
+    for (const auto& val: colbuf.segment_data[segmentid]) stats.add(val);
+  }
   size_t write_size = colbuf.segment_data[segmentid].size();
   size_t ret = m_writer.write_typed_block(segmentid,
                                           columnid,
@@ -10,6 +10,7 @@
 #include <sframe/sarray.hpp>
 #include <sframe/sarray_v2_block_manager.hpp>
 #include <sframe/sframe_saving_impl.hpp>
+#include <sframe/column_statistics.hpp>
 namespace graphlab {
 
 template <typename T>
@@ -56,6 +57,8 @@ void sarray_save_blockwise(const sarray<T>& cur_column,
 
 
     writer.get_index_info().columns[0].metadata = col.column_index.metadata;
+    add_known_column_statistics(col.column_index,
+                                writer.get_index_info().columns[0].metadata);
 
     while(!col.eof) {
       // read a block
@@ -10,8 +10,10 @@ extern "C" {
 }
 #include <algorithm>
 #include <parallel/mutex.hpp>
+#include <parallel/thread_pool.hpp>
 #include <boost/algorithm/string.hpp>
 #include <sframe/sarray_v2_block_manager.hpp>
+#include <sframe/sarray_v2_decoded_block_cache.hpp>
 #include <sframe/sarray_index_file.hpp>
 #include <sframe/sframe_constants.hpp>
 #include <sframe/unfair_lock.hpp>
@@ -25,6 +27,23 @@ static unfair_lock* get_io_locks() {
   return iolocks;
 }
 
+/**
+ * The pool of threads servicing prefetch requests. These are kept apart
+ * from the main thread pool since they spend their time blocked on IO.
+ */
+static thread_pool& get_prefetch_thread_pool() {
+  static mutex lock;
+  static bool inited = false;
+  // Intentional leak. Avoids joining the IO threads during static destruction.
+  static thread_pool* pool;
+  if (inited) return *pool;
+  std::lock_guard<mutex> guard(lock);
+  if (inited) return *pool;
+  pool = new thread_pool(SFRAME_PREFETCH_IO_THREADS);
+  inited = true;
+  return *pool;
+}
+
 block_manager& block_manager::get_instance() {
   static block_manager manager;
   return manager;
@@ -95,6 +114,8 @@ void block_manager::close_column(column_address addr) {
   } 
   if (segment_destroyed) {
     m_segments.erase(segment_id); 
+    drop_prefetched_blocks(segment_id);
+    decoded_block_cache::get_instance().evict_segment(segment_id);
   }
 }
 
@@ -128,6 +149,87 @@ block_manager::read_block(block_address addr, block_info** ret_info) {
 
   if(ret_info) (*ret_info) = &info;
 
+  auto ret = take_prefetched_block(addr);
+  if (ret) return ret;
+  return read_block_from_segment(seg, info);
+}
+
+std::shared_ptr<std::vector<char> > 
+block_manager::read_raw_block(block_address addr, block_info** ret_info) {
+  size_t segment_id, column_id, block_id;
+  std::tie(segment_id, column_id, block_id) = addr;
+  std::shared_ptr<segment> seg = get_segment(segment_id);
+  block_info& info = seg->blocks[column_id][block_id];
+  if(ret_info) (*ret_info) = &info;
+  return read_raw_block_from_segment(seg, info);
+}
+
+void block_manager::prefetch_blocks(const std::vector<block_address>& addrs) {
+  for (const auto& addr: addrs) {
+    size_t segment_id, column_id, block_id;
+    std::tie(segment_id, column_id, block_id) = addr;
+    std::shared_ptr<segment> seg = get_segment(segment_id);
+    block_info& info = seg->blocks[column_id][block_id];
+
+    std::shared_ptr<prefetch_entry> entry;
+    {
+      std::lock_guard<graphlab::mutex> guard(m_prefetch_lock);
+      if (m_prefetched.count(addr)) continue;
+      if (m_prefetched.size() >= SFRAME_PREFETCH_MAX_PENDING_BLOCKS &&
+          !evict_prefetched_block()) {
+        // everything pending is still in flight. The IO threads are
+        // saturated; no point queueing more.
+        return;
+      }
+      entry = std::make_shared<prefetch_entry>();
+      entry->sequence_number = m_prefetch_counter++;
+      m_prefetched[addr] = entry;
+    }
+
+    get_prefetch_thread_pool().launch([this, seg, entry, &info]() mutable {
+      std::shared_ptr<std::vector<char> > data;
+      try {
+        // the segment was closed before we got to it
+        if (seg->reference_count.value > 0) {
+          data = read_block_from_segment(seg, info);
+        }
+      } catch (...) {
+        // leave the data empty. read_block() will retry synchronously and
+        // report the error.
+        data.reset();
+      }
+      std::lock_guard<graphlab::mutex> guard(m_prefetch_lock);
+      entry->data = data;
+      entry->ready = true;
+      m_prefetch_cond.broadcast();
+    });
+  }
+}
+
+bool block_manager::read_typed_block(block_address addr, 
+                                     std::vector<flexible_type>& ret,
+                                     block_info** ret_info) {
+  block_info* info;
+  std::shared_ptr<std::vector<char> > read_buffer = read_block(addr, &info);
+  if (ret_info) (*ret_info) = info;
+  if (!read_buffer) return false;
+  // check that the block flags match
+  bool success = typed_decode(*info, read_buffer->data(), read_buffer->size(), ret);
+  m_buffer_pool.release_buffer(std::move(read_buffer));
+  // check its the correct number of elements read
+  return success;
+}
+
+
+
+/**************************************************************************/
+/*                                                                        */
+/*                           Private Functions                            */
+/*                                                                        */
+/**************************************************************************/
+std::shared_ptr<std::vector<char> > 
+block_manager::read_raw_block_from_segment(std::shared_ptr<segment>& seg, 
+                                           block_info& info) {
   // get the return buffer
   // resize ret to the block length on disk
   std::shared_ptr<std::vector<char> > ret = m_buffer_pool.get_new_buffer();
@@ -146,10 +248,15 @@ block_manager::read_block(block_address addr, block_info** ret_info) {
   if (fin->fail()) {
     m_buffer_pool.release_buffer(std::move(ret));
     ret.reset();
-    return ret;
   }
-  guard.unlock();
+  return ret;
+}
 
+std::shared_ptr<std::vector<char> > 
+block_manager::read_block_from_segment(std::shared_ptr<segment>& seg, 
+                                       block_info& info) {
+  std::shared_ptr<std::vector<char> > ret = read_raw_block_from_segment(seg, info);
+  if (!ret) return ret;
 
   if (info.flags & LZ4_COMPRESSION) {
     /*
@@ -168,29 +275,51 @@ block_manager::read_block(block_address addr, block_info** ret_info) {
   return ret;
 }
 
-
-
-bool block_manager::read_typed_block(block_address addr, 
-                                     std::vector<flexible_type>& ret,
-                                     block_info** ret_info) {
-  block_info* info;
-  std::shared_ptr<std::vector<char> > read_buffer = read_block(addr, &info);
-  if (ret_info) (*ret_info) = info;
-  if (!read_buffer) return false;
-  // check that the block flags match
-  bool success = typed_decode(*info, read_buffer->data(), read_buffer->size(), ret);
-  m_buffer_pool.release_buffer(std::move(read_buffer));
-  // check its the correct number of elements read
-  return success;
+std::shared_ptr<std::vector<char> > 
+block_manager::take_prefetched_block(block_address addr) {
+  std::unique_lock<graphlab::mutex> guard(m_prefetch_lock);
+  auto iter = m_prefetched.find(addr);
+  if (iter == m_prefetched.end()) return nullptr;
+  std::shared_ptr<prefetch_entry> entry = iter->second;
+  while (!entry->ready) m_prefetch_cond.wait(guard);
+  // the entry may have been evicted (and its buffer released) 
+  // while we were waiting.
+  iter = m_prefetched.find(addr);
+  if (iter == m_prefetched.end() || iter->second != entry) return nullptr;
+  m_prefetched.erase(iter);
+  return entry->data;
 }
 
+bool block_manager::evict_prefetched_block() {
+  auto oldest = m_prefetched.end();
+  for (auto iter = m_prefetched.begin(); iter != m_prefetched.end(); ++iter) {
+    if (iter->second->ready && 
+        (oldest == m_prefetched.end() || 
+         iter->second->sequence_number < oldest->second->sequence_number)) {
+      oldest = iter;
+    }
+  }
+  if (oldest == m_prefetched.end()) return false;
+  m_buffer_pool.release_buffer(std::move(oldest->second->data));
+  m_prefetched.erase(oldest);
+  return true;
+}
 
+void block_manager::drop_prefetched_blocks(size_t segment_id) {
+  std::lock_guard<graphlab::mutex> guard(m_prefetch_lock);
+  auto iter = m_prefetched.lower_bound(block_address{segment_id, 0, 0});
+  while (iter != m_prefetched.end() && std::get<0>(iter->first) == segment_id) {
+    // blocks still in flight are left in place and will be 
+    // dropped by eviction once they complete.
+    if (iter->second->ready) {
+      m_buffer_pool.release_buffer(std::move(iter->second->data));
+      iter = m_prefetched.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
 
-/**************************************************************************/
-/*                                                                        */
-/*                           Private Functions                            */
-/*                                                                        */
-/**************************************************************************/
 std::shared_ptr<general_ifstream> block_manager::get_new_file_handle(std::string s) {
   std::lock_guard<graphlab::mutex> guard(m_file_handles_lock);
   while(m_file_handle_pool.size() >= SFRAME_FILE_HANDLE_POOL_SIZE) {
@@ -11,6 +11,7 @@
 #include <vector>
 #include <fstream>
 #include <tuple>
+#include <map>
 #include <parallel/pthread_tools.hpp>
 #include <parallel/atomic.hpp>
 #include <fileio/general_fstream.hpp>
@@ -142,6 +143,18 @@ namespace v2_block_impl {
  * {segment_file_id, column_id, block_id}. The first 2 fields can be copied
  * from the column_address, the block_id is a sequential counter from 0 to
  * \ref num_blocks_in_column() - 1.
+ *
+ * Read Ahead
+ * ----------
+ * \ref read_block() is synchronous. To overlap IO with decoding, readers may
+ * call \ref prefetch_blocks() with the addresses of blocks they expect to
+ * read next. The blocks are then read (and decompressed) by a small pool of
+ * IO threads, and held until the next \ref read_block() of the same address
+ * picks them up (waiting for the read to complete if it is still in flight).
+ * At most SFRAME_PREFETCH_MAX_PENDING_BLOCKS blocks are held; the oldest
+ * completed ones are dropped when this is exceeded.
+ * sarray_format_reader_v2 drives this automatically for sequential reads,
+ * with a window of SFRAME_READ_AHEAD_BLOCKS blocks.
  * 
  */
 class block_manager {
@@ -195,6 +208,30 @@ class block_manager {
   std::shared_ptr<std::vector<char> >
     read_block(block_address addr, block_info** ret_info = NULL);
 
+  /**
+   * Reads a block exactly as stored on disk, without decompressing it.
+   * The block info describes how the bytes are to be interpreted.
+   * Used to copy blocks from one segment to another.
+   *
+   *  Return an empty pointer on failure.
+   *
+   *  Safe for concurrent operation.
+   */
+  std::shared_ptr<std::vector<char> >
+    read_raw_block(block_address addr, block_info** ret_info = NULL);
+
+
+  /**
+   * Asynchronously reads the blocks at the given addresses, so that a later
+   * \ref read_block() of any of them does not have to wait for the disk.
+   * Blocks already prefetched or in flight are ignored, and requests
+   * beyond SFRAME_PREFETCH_MAX_PENDING_BLOCKS are dropped.
+   *
+   * The columns containing the blocks must be open.
+   *
+   * Safe for concurrent operation.
+   */
+  void prefetch_blocks(const std::vector<block_address>& addrs);
 
   /** 
    * Reads a block given a block address ((array_group ID, segment ID, block
@@ -291,6 +328,21 @@ class block_manager {
   /// Pool of buffers used for decompression, returns, etc.
   buffer_pool<std::vector<char> > m_buffer_pool;
 
+  /**
+   * A block requested by prefetch_blocks(). data is filled by an IO thread
+   * and is left empty if the read failed.
+   */
+  struct prefetch_entry {
+    bool ready = false;
+    size_t sequence_number = 0;
+    std::shared_ptr<std::vector<char> > data;
+  };
+
+  mutable graphlab::mutex m_prefetch_lock;
+  graphlab::conditional m_prefetch_cond;
+  size_t m_prefetch_counter = 0;
+  std::map<block_address, std::shared_ptr<prefetch_entry> > m_prefetched;
+
 /**************************************************************************/
 /*                                                                        */
 /*                           Private Functions                            */
@@ -318,6 +370,36 @@ class block_manager {
   bool read_block_from_stream(general_ifstream& fin, std::vector<char>& ret,
                               block_info& info);
 
+  /**
+   * Reads and decompresses a block of a segment.
+   * Returns an empty pointer on failure.
+   */
+  std::shared_ptr<std::vector<char> > 
+      read_block_from_segment(std::shared_ptr<segment>& seg, block_info& info);
+
+  /**
+   * Reads the bytes of a block of a segment, as stored on disk.
+   * Returns an empty pointer on failure.
+   */
+  std::shared_ptr<std::vector<char> > 
+      read_raw_block_from_segment(std::shared_ptr<segment>& seg, block_info& info);
+
+  /**
+   * Takes the prefetched block at the address, waiting for it if the read
+   * is still in flight. Returns an empty pointer if the block was not
+   * prefetched, or if the prefetch failed.
+   */
+  std::shared_ptr<std::vector<char> > take_prefetched_block(block_address addr);
+
+  /**
+   * Drops the oldest completed prefetched block.
+   * Returns false if there is none. m_prefetch_lock must be held.
+   */
+  bool evict_prefetched_block();
+
+  /// Drops all completed prefetched blocks of a segment.
+  void drop_prefetched_blocks(size_t segment_id);
+
   std::shared_ptr<segment> get_segment(size_t segmentid);
 
   void init_segment(std::shared_ptr<segment>& seg);
@@ -9,6 +9,7 @@
 #define GRAPHLAB_SFRAME_SARRAY_V2_BLOCK_TYPES_HPP
 #include <stdint.h>
 #include <tuple>
+#include <string>
 #include <serialization/serializable_pod.hpp>
 namespace graphlab {
 namespace v2_block_impl {
@@ -18,9 +19,40 @@ enum BLOCK_FLAGS {
   LZ4_COMPRESSION = 1,
   IS_FLEXIBLE_TYPE = 2,
   MULTIPLE_TYPE_BLOCK = 4,
-  BLOCK_ENCODING_EXTENSION = 8  // used to flag secondary compression schemes
+  BLOCK_ENCODING_EXTENSION = 8,  // used to flag secondary compression schemes
+  LZ4HC_COMPRESSION = 16 // always set together with LZ4_COMPRESSION
 };
 
+/**
+ * The compression codec used for the blocks of a column.
+ *
+ * LZ4HC produces regular LZ4 blocks at a higher compression ratio and a much
+ * higher compression cost; decompression is identical and just as fast.
+ * LZ4HC blocks are flagged with both LZ4_COMPRESSION and LZ4HC_COMPRESSION,
+ * so that any reader of the format can read a mix of codecs.
+ */
+enum class compression_codec: char {
+  NONE = 0,    ///< Never compress
+  LZ4 = 1,     ///< LZ4, kept only if it helps (the default)
+  LZ4HC = 2,   ///< LZ4 high compression, at a selectable level
+  AUTO = 3     ///< Sample the first blocks, then pick NONE or LZ4
+};
+
+/**
+ * Per column compression options of the block writer.
+ */
+struct column_compression_options {
+  compression_codec codec = compression_codec::LZ4;
+  /// The LZ4HC compression level (1 - 16). Ignored by other codecs.
+  int level = 9;
+};
+
+/**
+ * Parses a codec specification of the form "none", "lz4", "auto",
+ * "lz4hc" or "lz4hc:<level>". Throws on an invalid specification.
+ */
+column_compression_options parse_compression_options(const std::string& spec);
+
 namespace DOUBLE_RESERVED_FLAGS {
 enum FLAGS {
   LEGACY_ENCODING = 0,
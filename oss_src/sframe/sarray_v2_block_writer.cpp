@@ -7,7 +7,9 @@
  */
 extern "C" {
 #include <lz4/lz4.h>
+#include <lz4/lz4hc.h>
 }
+#include <boost/algorithm/string.hpp>
 #include <sframe/sarray_v2_block_writer.hpp>
 #include <sframe/sarray_index_file.hpp>
 #include <sframe/sframe_constants.hpp>
@@ -16,6 +18,37 @@ extern "C" {
 namespace graphlab {
 namespace v2_block_impl {
 
+column_compression_options parse_compression_options(const std::string& spec) {
+  column_compression_options ret;
+  std::string codec = boost::algorithm::to_lower_copy(spec);
+  size_t colon = codec.find(':');
+  std::string level;
+  if (colon != std::string::npos) {
+    level = codec.substr(colon + 1);
+    codec = codec.substr(0, colon);
+  }
+  if (codec == "none") ret.codec = compression_codec::NONE;
+  else if (codec == "lz4") ret.codec = compression_codec::LZ4;
+  else if (codec == "lz4hc") ret.codec = compression_codec::LZ4HC;
+  else if (codec == "auto") ret.codec = compression_codec::AUTO;
+  else log_and_throw("Unknown compression codec: " + spec);
+
+  if (!level.empty()) {
+    if (ret.codec != compression_codec::LZ4HC) {
+      log_and_throw("Compression level is only supported by lz4hc: " + spec);
+    }
+    try {
+      ret.level = std::stoi(level);
+    } catch (...) {
+      log_and_throw("Invalid compression level: " + spec);
+    }
+    if (ret.level < 1 || ret.level > 16) {
+      log_and_throw("Compression level must be between 1 and 16: " + spec);
+    }
+  }
+  return ret;
+}
+
 void block_writer::init(std::string group_index_file, 
                         size_t num_segments, 
                         size_t num_columns) {
@@ -35,6 +68,12 @@ void block_writer::init(std::string group_index_file,
   m_index_info.segment_files.resize(num_segments);
   m_index_info.columns.resize(num_columns);
 
+  column_compression_options default_compression = 
+      parse_compression_options(SFRAME_DEFAULT_COMPRESSION_CODEC);
+  m_column_compression.clear();
+  m_column_compression.resize(num_columns);
+  for (auto& c: m_column_compression) c.options = default_compression;
+
   // fill in the per column information of m_index_info. 
   for (size_t col = 0;col < m_index_info.columns.size(); ++col) {
     m_index_info.columns[col].index_file = 
@@ -71,6 +110,47 @@ void block_writer::open_segment(size_t segmentid, std::string filename) {
 }
 
 
+void block_writer::set_column_compression(size_t column_id,
+                                          column_compression_options options) {
+  ASSERT_LT(column_id, m_column_compression.size());
+  auto& state = m_column_compression[column_id];
+  std::lock_guard<simple_spinlock> guard(state.lock);
+  state.options = options;
+  state.sampled_blocks = 0;
+  state.sampled_bytes = 0;
+  state.sampled_compressed_bytes = 0;
+}
+
+column_compression_options block_writer::get_column_compression(size_t column_id) {
+  ASSERT_LT(column_id, m_column_compression.size());
+  auto& state = m_column_compression[column_id];
+  std::lock_guard<simple_spinlock> guard(state.lock);
+  return state.options;
+}
+
+void block_writer::record_compression_sample(size_t column_id, 
+                                             size_t block_size,
+                                             size_t compressed_size) {
+  auto& state = m_column_compression[column_id];
+  std::lock_guard<simple_spinlock> guard(state.lock);
+  // another block may have already made the decision
+  if (state.options.codec != compression_codec::AUTO) return;
+  ++state.sampled_blocks;
+  state.sampled_bytes += block_size;
+  state.sampled_compressed_bytes += compressed_size;
+  if (state.sampled_blocks >= SFRAME_COMPRESSION_AUTO_SAMPLE_BLOCKS) {
+    bool compressible = state.sampled_compressed_bytes < 
+        COMPRESSION_DISABLE_THRESHOLD * state.sampled_bytes;
+    state.options.codec = compressible ? compression_codec::LZ4 : 
+                                         compression_codec::NONE;
+    logstream(LOG_DEBUG) << "Column " << column_id << " compresses "
+                         << state.sampled_bytes << " bytes to " 
+                         << state.sampled_compressed_bytes << " bytes. "
+                         << (compressible ? "Using LZ4" : "Disabling compression")
+                         << std::endl;
+  }
+}
+
 static char padding_bytes[4096] = {0};
 
 size_t block_writer::write_block(size_t segment_id,
@@ -80,49 +160,84 @@ size_t block_writer::write_block(size_t segment_id,
   DASSERT_LT(segment_id, m_index_info.nsegments);
   DASSERT_LT(column_id, m_index_info.columns.size());
   DASSERT_TRUE(m_output_files[segment_id] != NULL);
+  column_compression_options options = get_column_compression(column_id);
+  // AUTO columns are compressed with LZ4 while sampling
+  compression_codec codec = options.codec == compression_codec::AUTO ? 
+      compression_codec::LZ4 : options.codec;
+
   // try to compress the data
-  size_t compress_bound = LZ4_compressBound(block.block_size);
-  auto compression_buffer = m_buffer_pool.get_new_buffer();
-  compression_buffer->resize(compress_bound);
-  char* cbuffer = compression_buffer->data();
-  size_t clen = compress_bound;
-  clen = LZ4_compress(data, cbuffer, block.block_size);
+  std::shared_ptr<std::vector<char> > compression_buffer;
+  char* cbuffer = NULL;
+  size_t clen = block.block_size;
+  if (codec != compression_codec::NONE) {
+    size_t compress_bound = LZ4_compressBound(block.block_size);
+    compression_buffer = m_buffer_pool.get_new_buffer();
+    compression_buffer->resize(compress_bound);
+    cbuffer = compression_buffer->data();
+    if (codec == compression_codec::LZ4HC) {
+      clen = LZ4_compressHC2(data, cbuffer, block.block_size, options.level);
+    } else {
+      clen = LZ4_compress(data, cbuffer, block.block_size);
+    }
+  }
+  if (options.codec == compression_codec::AUTO) {
+    record_compression_sample(column_id, block.block_size, clen);
+  }
 
   char* buffer_to_write = NULL;
   size_t buffer_to_write_len = 0;
-  if (clen < COMPRESSION_DISABLE_THRESHOLD * block.block_size) {
+  if (codec != compression_codec::NONE && clen > 0 &&
+      clen < COMPRESSION_DISABLE_THRESHOLD * block.block_size) {
     // compression has a benefit!
     block.flags |= LZ4_COMPRESSION;
+    if (codec == compression_codec::LZ4HC) block.flags |= LZ4HC_COMPRESSION;
     block.length = clen;
     buffer_to_write = cbuffer;
     buffer_to_write_len = clen;
   } else {
     // compression has no benefit! do not compress!
     // unset LZ4
-    block.flags &= (~(size_t)LZ4_COMPRESSION);
+    block.flags &= (~(size_t)(LZ4_COMPRESSION | LZ4HC_COMPRESSION));
     block.length = block.block_size;
     buffer_to_write = data;
     buffer_to_write_len = block.block_size;
   }
 
-  size_t padding = ((buffer_to_write_len + 4095) / 4096) * 4096 - buffer_to_write_len;
+  append_block(segment_id, column_id, buffer_to_write, block);
+  m_buffer_pool.release_buffer(std::move(compression_buffer));
+  return buffer_to_write_len;
+}
+
+size_t block_writer::write_raw_block(size_t segment_id,
+                                     size_t column_id, 
+                                     const char* data,
+                                     block_info block) {
+  DASSERT_LT(segment_id, m_index_info.nsegments);
+  DASSERT_LT(column_id, m_index_info.columns.size());
+  DASSERT_TRUE(m_output_files[segment_id] != NULL);
+  append_block(segment_id, column_id, data, block);
+  return block.length;
+}
+
+void block_writer::append_block(size_t segment_id,
+                                size_t column_id,
+                                const char* data,
+                                block_info& block) {
+  size_t padding = ((block.length + 4095) / 4096) * 4096 - block.length;
   ASSERT_LT(padding, 4096);
   // write!
   m_output_file_locks[segment_id].lock();
   block.offset = m_output_bytes_written[segment_id];
-  m_output_bytes_written[segment_id] += buffer_to_write_len + padding;
+  m_output_bytes_written[segment_id] += block.length + padding;
   m_index_info.columns[column_id].segment_sizes[segment_id] += block.num_elem;
-  m_output_files[segment_id]->write(buffer_to_write, buffer_to_write_len);
+  m_output_files[segment_id]->write(data, block.length);
   m_output_files[segment_id]->write(padding_bytes, padding);
   m_blocks[segment_id][column_id].push_back(block);
   m_output_file_locks[segment_id].unlock();
 
-  m_buffer_pool.release_buffer(std::move(compression_buffer));
-
   if (!m_output_files[segment_id]->good()) {
     log_and_throw_io_failure("Fail to write. Disk may be full.");
   }
-  return buffer_to_write_len;
 }
 
 size_t block_writer::write_typed_block(size_t segment_id,
@@ -45,6 +45,11 @@ namespace v2_block_impl {
  * // output the array group index file
  * writer.write_index_file()
  * \endcode
+ *
+ * Each column is compressed with the codec given by
+ * SFRAME_DEFAULT_COMPRESSION_CODEC, unless changed with
+ * \ref set_column_compression(). Compressed blocks are only kept if they are
+ * smaller than COMPRESSION_DISABLE_THRESHOLD of the uncompressed block.
  */
 class block_writer {
  public:
@@ -57,6 +62,19 @@ class block_writer {
             size_t num_segments, 
             size_t num_columns);
 
+  /**
+   * Sets the compression codec of a column. Only affects blocks written
+   * after the call. 
+   */
+  void set_column_compression(size_t column_id, 
+                              column_compression_options options);
+
+  /**
+   * Returns the compression codec of a column. Once an AUTO column has
+   * sampled enough blocks, this returns the codec it settled on.
+   */
+  column_compression_options get_column_compression(size_t column_id);
+
   /**
    * Opens a segment, using a given file name.
    */
@@ -79,6 +97,18 @@ class block_writer {
                    char* data,
                    block_info block);
 
+  /**
+   * Writes a block exactly as given, without trying to compress it.
+   * data must point to block.length bytes, interpreted as described by the
+   * block's flags (i.e. it may already be compressed). 
+   * Used to copy blocks read with block_manager::read_raw_block().
+   * Returns the actual number of bytes written.
+   */
+  size_t write_raw_block(size_t segment_id,
+                         size_t column_id,
+                         const char* data,
+                         block_info block);
+
   /**
    * Writes a block of data into a segment.
    *
@@ -152,8 +182,35 @@ class block_writer {
   /// For each segment, for each column the number of rows written so far
   std::vector<std::vector<size_t> > m_column_row_counter;
 
+  /**
+   * The compression options of a column, and while the codec is AUTO, 
+   * the LZ4 compression results of the blocks sampled so far.
+   */
+  struct column_compression_state {
+    simple_spinlock lock;
+    column_compression_options options;
+    size_t sampled_blocks = 0;
+    size_t sampled_bytes = 0;
+    size_t sampled_compressed_bytes = 0;
+  };
+  std::vector<column_compression_state> m_column_compression;
+
+  /**
+   * Records the compressed size of a block of an AUTO column, picking the
+   * codec once enough blocks have been sampled.
+   */
+  void record_compression_sample(size_t column_id, 
+                                 size_t block_size,
+                                 size_t compressed_size);
+
   /// Writes the file footer
   void emit_footer(size_t segment_id);
+
+  /// Appends the bytes of a block, and its info, to a segment.
+  void append_block(size_t segment_id,
+                    size_t column_id,
+                    const char* data,
+                    block_info& block);
 };
 
 } // namespace v2_block_impl
@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <sframe/sarray_v2_decoded_block_cache.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <fileio/memory_governor.hpp>
+#include <util/cityhash_gl.hpp>
+
+namespace graphlab {
+namespace v2_block_impl {
+
+constexpr size_t decoded_block_cache::NUM_SHARDS;
+
+decoded_block_cache& decoded_block_cache::get_instance() {
+  static decoded_block_cache cache;
+  return cache;
+}
+
+bool decoded_block_cache::enabled() {
+  return SFRAME_DECODED_BLOCK_CACHE_CAPACITY > 0;
+}
+
+size_t decoded_block_cache::address_hash::operator()(const block_address& addr) const {
+  return hash64(std::get<0>(addr), std::get<1>(addr), std::get<2>(addr));
+}
+
+decoded_block_cache::shard& decoded_block_cache::get_shard(const block_address& addr) {
+  return m_shards[address_hash()(addr) % NUM_SHARDS];
+}
+
+size_t decoded_block_cache::capacity() {
+  return memory_governor::get_instance().cache_capacity(
+      memory_consumer::DECODED_BLOCK_CACHE, SFRAME_DECODED_BLOCK_CACHE_CAPACITY);
+}
+
+size_t decoded_block_cache::estimate_block_size(const block_info& info) {
+  // the flexible_type array itself, plus the decoded payload, which is
+  // approximated by the size of the uncompressed block.
+  return info.num_elem * sizeof(flexible_type) + info.block_size;
+}
+
+decoded_block_cache::block_ptr decoded_block_cache::get(const block_address& addr) {
+  shard& s = get_shard(addr);
+  std::lock_guard<mutex> guard(s.lock);
+  auto iter = s.index.find(addr);
+  if (iter == s.index.end()) {
+    m_misses.inc();
+    return nullptr;
+  }
+  m_hits.inc();
+  cache_entry& entry = s.entries[iter->second];
+  entry.referenced = true;
+  return entry.block;
+}
+
+bool decoded_block_cache::contains(const block_address& addr) {
+  shard& s = get_shard(addr);
+  std::lock_guard<mutex> guard(s.lock);
+  return s.index.count(addr) > 0;
+}
+
+void decoded_block_cache::insert(const block_address& addr,
+                                 const block_ptr& block,
+                                 size_t size_bytes) {
+  size_t budget = capacity();
+  if (block == nullptr || size_bytes > budget) return;
+
+  shard& s = get_shard(addr);
+  {
+    std::lock_guard<mutex> guard(s.lock);
+    if (s.index.count(addr)) return;
+    // make room in the shard of the block first
+    evict_to_budget(s, budget - size_bytes);
+
+    cache_entry entry;
+    entry.address = addr;
+    entry.block = block;
+    entry.size_bytes = size_bytes;
+    s.index[addr] = s.entries.size();
+    s.entries.push_back(std::move(entry));
+    s.bytes += size_bytes;
+    m_bytes.inc(size_bytes);
+    m_insertions.inc();
+  }
+  // then in the other shards, one at a time, if it was not enough.
+  size_t shard_id = &s - m_shards;
+  for (size_t i = 1; i < NUM_SHARDS && m_bytes.value > budget; ++i) {
+    shard& other = m_shards[(shard_id + i) % NUM_SHARDS];
+    std::lock_guard<mutex> guard(other.lock);
+    evict_to_budget(other, budget);
+  }
+}
+
+void decoded_block_cache::remove_entry(shard& s, size_t i) {
+  s.bytes -= s.entries[i].size_bytes;
+  m_bytes.dec(s.entries[i].size_bytes);
+  s.index.erase(s.entries[i].address);
+  if (i + 1 != s.entries.size()) {
+    // move the last entry into the hole
+    s.entries[i] = std::move(s.entries.back());
+    s.index[s.entries[i].address] = i;
+  }
+  s.entries.pop_back();
+  if (s.hand >= s.entries.size()) s.hand = 0;
+}
+
+void decoded_block_cache::evict_to_budget(shard& s, size_t budget) {
+  while (m_bytes.value > budget && !s.entries.empty()) {
+    cache_entry& entry = s.entries[s.hand];
+    if (entry.referenced) {
+      // second chance
+      entry.referenced = false;
+      s.hand = (s.hand + 1) % s.entries.size();
+    } else {
+      remove_entry(s, s.hand);
+      m_evictions.inc();
+    }
+  }
+}
+
+void decoded_block_cache::evict_segment(size_t segment_id) {
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    shard& s = m_shards[i];
+    std::lock_guard<mutex> guard(s.lock);
+    size_t j = 0;
+    while (j < s.entries.size()) {
+      if (std::get<0>(s.entries[j].address) == segment_id) remove_entry(s, j);
+      else ++j;
+    }
+  }
+}
+
+void decoded_block_cache::clear() {
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    shard& s = m_shards[i];
+    std::lock_guard<mutex> guard(s.lock);
+    s.index.clear();
+    s.entries.clear();
+    s.hand = 0;
+    m_bytes.dec(s.bytes);
+    s.bytes = 0;
+  }
+}
+
+decoded_block_cache::cache_stats decoded_block_cache::get_stats() const {
+  cache_stats ret;
+  ret.hits = m_hits.value;
+  ret.misses = m_misses.value;
+  ret.insertions = m_insertions.value;
+  ret.evictions = m_evictions.value;
+  ret.capacity = capacity();
+  for (size_t i = 0; i < NUM_SHARDS; ++i) {
+    const shard& s = m_shards[i];
+    std::lock_guard<mutex> guard(s.lock);
+    ret.num_blocks += s.entries.size();
+    ret.bytes += s.bytes;
+  }
+  return ret;
+}
+
+} // v2_block_impl
+} // graphlab
@@ -0,0 +1,169 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_SARRAY_V2_DECODED_BLOCK_CACHE_HPP
+#define GRAPHLAB_SFRAME_SARRAY_V2_DECODED_BLOCK_CACHE_HPP
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <parallel/mutex.hpp>
+#include <parallel/atomic.hpp>
+#include <flexible_type/flexible_type.hpp>
+#include <sframe/sarray_v2_block_types.hpp>
+
+namespace graphlab {
+namespace v2_block_impl {
+
+/**
+ * \internal
+ * \ingroup sframe_physical
+ * \addtogroup sframe_internal SFrame Internal
+ * \{
+ */
+
+/**
+ * A process wide cache of decoded flexible_type blocks, shared by all
+ * sarray_format_reader_v2 instances.
+ *
+ * Each reader keeps a small private cache of the blocks it is currently
+ * reading (see sarray_format_reader_v2), which is lost as soon as the reader
+ * moves past the block. Two queries over the same column (or two columns
+ * of a self join) therefore read and decode every block twice. This cache
+ * keeps recently decoded blocks around across readers, so that repeated
+ * scans of hot columns skip both the IO and the decoding.
+ *
+ * Blocks are keyed by \ref block_address. Segment ids are never reused by
+ * the block_manager, so an address always refers to the same immutable
+ * data; the block manager drops the blocks of a segment when the segment
+ * is closed.
+ *
+ * The cache is split into shards (by address hash), each with its own lock.
+ * The byte budget SFRAME_DECODED_BLOCK_CACHE_CAPACITY is shared by all
+ * shards, so that any block up to the whole budget can be cached: an
+ * insertion evicts from the shard of the block first, then from the other
+ * shards. Within a shard, eviction uses the CLOCK algorithm: every hit
+ * sets a reference bit, and the clock hand evicts the first block without
+ * one.
+ *
+ * Blocks are handed out as shared pointers, so evicting a block never
+ * invalidates a reader which is using it. Cached blocks must never be
+ * modified.
+ */
+class decoded_block_cache {
+ public:
+  typedef std::shared_ptr<std::vector<flexible_type> > block_ptr;
+
+  /// Hit / miss counters and current contents of the cache.
+  struct cache_stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t insertions = 0;
+    size_t evictions = 0;
+    size_t num_blocks = 0;
+    size_t bytes = 0;
+    size_t capacity = 0;
+  };
+
+  static decoded_block_cache& get_instance();
+
+  /// Returns true if the cache has a non zero budget.
+  static bool enabled();
+
+  /**
+   * The byte budget of the cache right now: SFRAME_DECODED_BLOCK_CACHE_CAPACITY,
+   * or less while the memory governor needs the memory for working memory.
+   */
+  static size_t capacity();
+
+  /**
+   * Returns the cached decoded block at the address, or nullptr if it
+   * is not cached.
+   */
+  block_ptr get(const block_address& addr);
+
+  /**
+   * Returns true if the block at the address is cached. Does not count
+   * as a hit or a miss.
+   */
+  bool contains(const block_address& addr);
+
+  /**
+   * Inserts a decoded block. size_bytes is the estimated memory usage of
+   * the block, used against the byte budget. Blocks larger than the whole
+   * budget are not cached. If the block is already cached, this is a no-op.
+   */
+  void insert(const block_address& addr, const block_ptr& block, size_t size_bytes);
+
+  /**
+   * Drops all blocks of a segment.
+   */
+  void evict_segment(size_t segment_id);
+
+  /**
+   * Drops all blocks.
+   */
+  void clear();
+
+  cache_stats get_stats() const;
+
+  /**
+   * Estimated memory usage of a decoded block, from its block info.
+   */
+  static size_t estimate_block_size(const block_info& info);
+
+ private:
+  decoded_block_cache() = default;
+  decoded_block_cache(const decoded_block_cache&) = delete;
+  decoded_block_cache& operator=(const decoded_block_cache&) = delete;
+
+  static constexpr size_t NUM_SHARDS = 16;
+
+  struct address_hash {
+    size_t operator()(const block_address& addr) const;
+  };
+
+  struct cache_entry {
+    block_address address;
+    block_ptr block;
+    size_t size_bytes = 0;
+    bool referenced = false;
+  };
+
+  struct shard {
+    mutable mutex lock;
+    /// address -> index into entries
+    std::unordered_map<block_address, size_t, address_hash> index;
+    /// the clock
+    std::vector<cache_entry> entries;
+    size_t hand = 0;
+    size_t bytes = 0;
+  };
+
+  shard& get_shard(const block_address& addr);
+
+  /// removes entries[i] from the shard. Lock must be held.
+  void remove_entry(shard& s, size_t i);
+
+  /**
+   * Evicts from the shard until the whole cache fits in the budget, or the
+   * shard is empty. Lock must be held.
+   */
+  void evict_to_budget(shard& s, size_t budget);
+
+  shard m_shards[NUM_SHARDS];
+  atomic<size_t> m_hits;
+  atomic<size_t> m_misses;
+  atomic<size_t> m_insertions;
+  atomic<size_t> m_evictions;
+  /// bytes held by all shards
+  atomic<size_t> m_bytes;
+};
+
+/// \}
+} // v2_block_impl
+} // graphlab
+#endif
@@ -505,6 +505,13 @@ void typed_encode(const std::vector<flexible_type>& data,
   block.block_size = oarc.off;
 }
 
+/// Bytes decoded by typed_decode on each thread
+static __thread size_t decoded_bytes_on_thread = 0;
+
+size_t thread_decoded_bytes() {
+  return decoded_bytes_on_thread;
+}
+
 /**
  * Decodes a collection of flexible_type values. The array must be of 
  * contiguous type, but permitting undefined values.
@@ -522,6 +529,7 @@ bool typed_decode(const block_info& info,
                          << std::endl;
     return false;
   }
+  decoded_bytes_on_thread += len;
   graphlab::iarchive iarc(start, len);
 
   size_t dsize = info.num_elem;
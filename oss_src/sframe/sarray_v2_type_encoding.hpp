@@ -43,6 +43,12 @@ bool typed_decode(const block_info& info,
                   char* start, size_t len,
                   std::vector<flexible_type>& ret);
 
+/**
+ * Returns the number of bytes decoded by typed_decode on the calling
+ * thread so far.
+ */
+size_t thread_decoded_bytes();
+
 /**
  * Decodes a type block. Reads from block_info and a buffer.
  * Returns false on failure. 
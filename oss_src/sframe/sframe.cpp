@@ -228,11 +228,20 @@ void sframe::create_arrays_for_writing(const std::vector<std::string>& column_na
                                        const std::vector<flex_type_enum>& column_types,
                                        size_t nsegments,
                                        const std::string& frame_sidx_file,
-                                       bool fail_on_column_names) {
+                                       bool fail_on_column_names,
+                                       const std::vector<std::string>& column_codecs) {
   Dlog_func_entry();
   logstream(LOG_DEBUG) << "Opening Frame for writing to " << frame_sidx_file
                       << " with " << nsegments << " segments and "
                       << column_names.size() << " columns" << std::endl;
+  // parse the codecs first, so that an invalid one throws before any file
+  // is opened
+  std::vector<v2_block_impl::column_compression_options> compression;
+  for (const auto& codec: column_codecs) {
+    compression.push_back(codec.empty() ? 
+                          v2_block_impl::column_compression_options() :
+                          v2_block_impl::parse_compression_options(codec));
+  }
   reset();
   writing = true;
 
@@ -281,7 +290,8 @@ void sframe::create_arrays_for_writing(const std::vector<std::string>& column_na
   std::string prefix =
       index_file.substr(0, index_file.length() - suffix.length());
 
-  group_writer.reset(new sarray_group_format_writer_v2<flexible_type>);
+  auto v2_writer = std::make_shared<sarray_group_format_writer_v2<flexible_type>>();
+  group_writer = v2_writer;
   if (uses_temp_files) {
     std::string group_sidx =
         fileio::fixed_size_cache_manager::get_instance().get_temp_cache_id(".sidx");
@@ -294,6 +304,11 @@ void sframe::create_arrays_for_writing(const std::vector<std::string>& column_na
   for (size_t i = 0; i < index_info.ncolumns; ++i) {
     group_writer->get_index_info().columns[i].metadata["__type__"] =
         std::to_string(static_cast<int>(column_types[i]));
+    if (i < column_codecs.size() && !column_codecs[i].empty()) {
+      v2_writer->set_column_compression(i, compression[i]);
+      group_writer->get_index_info().columns[i].metadata["__compression__"] = 
+          column_codecs[i];
+    }
   }
 }
 
@@ -700,7 +715,8 @@ void sframe::write(size_t segmentid, const sframe_rows& t) {
   group_writer->write_segment(segmentid, t);
 }
 
-void sframe::save(std::string index_file) const {
+void sframe::save(std::string index_file, 
+                  const std::vector<std::string>& column_codecs) const {
   ASSERT_TRUE(inited);
   ASSERT_FALSE(writing);
   std::string expected_ext(".frame_idx");
@@ -708,7 +724,7 @@ void sframe::save(std::string index_file) const {
     log_and_throw("Index file must end with " + expected_ext);
   }
 
-  sframe_save(*this, index_file);
+  sframe_save(*this, index_file, column_codecs);
 }
 
 void sframe::debug_print() {
@@ -256,21 +256,34 @@ class sframe : public swriter_base<sframe_output_iterator> {
    *                             names are unique.  If false, will
    *                             automatically adjust column names so they are
    *                             unique.
+   * \param column_codecs The compression codec of each column, in the form
+   *                      accepted by v2_block_impl::parse_compression_options
+   *                      ("none", "lz4", "lz4hc[:level]" or "auto"). Columns
+   *                      beyond the end of the vector, or with an empty
+   *                      codec, use SFRAME_DEFAULT_COMPRESSION_CODEC. The
+   *                      codec is recorded in the column metadata under
+   *                      "__compression__", so saved copies of the column
+   *                      keep it. Throws on an invalid codec.
    */
   inline void open_for_write(const std::vector<std::string>& column_names,
                              const std::vector<flex_type_enum>& column_types,
                              const std::string& frame_sidx_file = "",
                              size_t nsegments = SFRAME_DEFAULT_NUM_SEGMENTS,
-                             bool fail_on_column_names=true) {
+                             bool fail_on_column_names=true,
+                             const std::vector<std::string>& column_codecs = {}) {
     Dlog_func_entry();
     ASSERT_MSG(!inited, "Attempting to init an SFrame "
         "which has already been inited.");
     if (column_names.size() != column_types.size()) {
       log_and_throw(std::string("Names and Types array length mismatch"));
     }
+    if (column_codecs.size() > column_types.size()) {
+      log_and_throw(std::string("More column codecs than columns"));
+    }
     inited = true;
     create_arrays_for_writing(column_names, column_types, 
-                              nsegments, frame_sidx_file, fail_on_column_names);
+                              nsegments, frame_sidx_file, fail_on_column_names,
+                              column_codecs);
   }
 
 /**************************************************************************/
@@ -647,8 +660,13 @@ class sframe : public swriter_base<sframe_output_iterator> {
   /**
    * Saves a copy of the current sframe into a different location.
    * Does not modify the current sframe.
+   *
+   * column_codecs optionally sets the compression codec of each column of
+   * the copy, as in \ref open_for_write. Columns without one keep the codec
+   * recorded in their metadata, or else use SFRAME_DEFAULT_COMPRESSION_CODEC.
    */
-  void save(std::string index_file) const;
+  void save(std::string index_file, 
+            const std::vector<std::string>& column_codecs = {}) const;
 
   /**
    * SFrame serializer. oarc must be associated with a directory.
@@ -721,7 +739,8 @@ class sframe : public swriter_base<sframe_output_iterator> {
                                  const std::vector<flex_type_enum>& column_types,
                                  size_t nsegments,
                                  const std::string& frame_sidx_file,
-                                 bool fail_on_column_names);
+                                 bool fail_on_column_names,
+                                 const std::vector<std::string>& column_codecs);
 
   void keep_array_file_ref();
   /**
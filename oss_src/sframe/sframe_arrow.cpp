@@ -0,0 +1,943 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <memory>
+#include <limits>
+#include <unordered_map>
+#include <logger/logger.hpp>
+#include <fileio/general_fstream.hpp>
+#include <parallel/lambda_omp.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sarray.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <sframe/sframe_arrow.hpp>
+
+namespace graphlab {
+
+namespace {
+
+/**************************************************************************/
+/*                                                                        */
+/*                                Export                                  */
+/*                                                                        */
+/**************************************************************************/
+
+/**
+ * A buffer backed by 64 bit words, so that it satisfies the 8 byte
+ * alignment Arrow requires.
+ */
+struct aligned_buffer {
+  std::vector<uint64_t> words;
+  void resize(size_t bytes) { words.resize((bytes + 7) / 8, 0); }
+  char* data() { return reinterpret_cast<char*>(words.data()); }
+  template <typename T>
+  T* as() { return reinterpret_cast<T*>(words.data()); }
+};
+
+/// The private data of an exported ArrowArray
+struct exported_array {
+  std::vector<aligned_buffer> buffers;
+  std::vector<const void*> buffer_pointers;
+  /// the contents of the file the buffers point into, when read from a file
+  std::shared_ptr<std::vector<uint64_t> > file_data;
+  std::vector<ArrowArray*> children;
+  ArrowArray* dictionary = nullptr;
+};
+
+/// The private data of an exported ArrowSchema
+struct exported_schema {
+  std::string format;
+  std::string name;
+  std::vector<ArrowSchema*> children;
+  ArrowSchema* dictionary = nullptr;
+};
+
+void release_exported_array(ArrowArray* array) {
+  auto data = reinterpret_cast<exported_array*>(array->private_data);
+  for (ArrowArray* child: data->children) {
+    if (child->release) child->release(child);
+    delete child;
+  }
+  if (data->dictionary) {
+    if (data->dictionary->release) data->dictionary->release(data->dictionary);
+    delete data->dictionary;
+  }
+  delete data;
+  array->release = nullptr;
+}
+
+void release_exported_schema(ArrowSchema* schema) {
+  auto data = reinterpret_cast<exported_schema*>(schema->private_data);
+  for (ArrowSchema* child: data->children) {
+    if (child->release) child->release(child);
+    delete child;
+  }
+  if (data->dictionary) {
+    if (data->dictionary->release) data->dictionary->release(data->dictionary);
+    delete data->dictionary;
+  }
+  delete data;
+  schema->release = nullptr;
+}
+
+/**
+ * Fills in an ArrowArray from its private data. The buffers (or the
+ * buffer pointers, for buffers not owned by it), children and dictionary
+ * must be filled in already.
+ */
+void finish_array(ArrowArray* out, exported_array* data,
+                  int64_t length, int64_t null_count) {
+  for (auto& buffer: data->buffers) {
+    data->buffer_pointers.push_back(buffer.words.empty() ? nullptr : buffer.data());
+  }
+  out->length = length;
+  out->null_count = null_count;
+  out->offset = 0;
+  out->n_buffers = data->buffer_pointers.size();
+  out->n_children = data->children.size();
+  out->buffers = data->buffer_pointers.data();
+  out->children = data->children.empty() ? nullptr : data->children.data();
+  out->dictionary = data->dictionary;
+  out->release = release_exported_array;
+  out->private_data = data;
+}
+
+void finish_schema(ArrowSchema* out, exported_schema* data) {
+  out->format = data->format.c_str();
+  out->name = data->name.c_str();
+  out->metadata = nullptr;
+  out->flags = ARROW_FLAG_NULLABLE;
+  out->n_children = data->children.size();
+  out->children = data->children.empty() ? nullptr : data->children.data();
+  out->dictionary = data->dictionary;
+  out->release = release_exported_schema;
+  out->private_data = data;
+}
+
+/**
+ * Converts a column to Arrow, block by block: the values are appended a
+ * block of rows at a time, as they are read, straight into the Arrow
+ * buffers, so the column is never held as flexible_types.
+ */
+class column_exporter {
+ public:
+  /// Throws if the type cannot be exported.
+  column_exporter(const std::string& name,
+                  flex_type_enum type,
+                  bool dictionary_encode_strings)
+      : m_name(name), m_type(type),
+        m_dictionary_encode(dictionary_encode_strings) {
+    switch(type) {
+     case flex_type_enum::INTEGER:
+     case flex_type_enum::FLOAT:
+     case flex_type_enum::DATETIME:
+     case flex_type_enum::UNDEFINED:
+       break;
+     case flex_type_enum::STRING:
+       m_offsets.push_back(0);
+       break;
+     case flex_type_enum::VECTOR:
+       m_offsets.push_back(0);
+       m_child.reset(new column_exporter("item", flex_type_enum::FLOAT, false));
+       break;
+     default:
+       log_and_throw(std::string("Cannot export column ") + name + " of type " +
+                     flex_type_enum_to_name(type) + " to Arrow");
+    }
+  }
+
+  /// Appends a block of values
+  void append(const std::vector<flexible_type>& values) {
+    size_t n = values.size();
+    m_validity.resize((m_length + n + 7) / 8);
+    uint8_t* bits = m_validity.as<uint8_t>();
+    for (size_t i = 0; i < n; ++i) {
+      if (values[i].get_type() == flex_type_enum::UNDEFINED) {
+        ++m_null_count;
+      } else {
+        bits[(m_length + i) / 8] |= (uint8_t)(1 << ((m_length + i) % 8));
+      }
+    }
+
+    switch(m_type) {
+     case flex_type_enum::INTEGER: {
+       int64_t* out = grow<int64_t>(m_values, n);
+       for (size_t i = 0; i < n; ++i) {
+         if (values[i].get_type() == flex_type_enum::INTEGER) out[i] = values[i].get<flex_int>();
+       }
+       break;
+     }
+     case flex_type_enum::FLOAT: {
+       double* out = grow<double>(m_values, n);
+       for (size_t i = 0; i < n; ++i) {
+         if (values[i].get_type() == flex_type_enum::FLOAT) out[i] = values[i].get<flex_float>();
+       }
+       break;
+     }
+     case flex_type_enum::DATETIME: {
+       int64_t* out = grow<int64_t>(m_values, n);
+       for (size_t i = 0; i < n; ++i) {
+         if (values[i].get_type() == flex_type_enum::DATETIME) {
+           const auto& dt = values[i].get<flex_date_time>();
+           out[i] = dt.posix_timestamp() * 1000000 + dt.microsecond();
+         }
+       }
+       break;
+     }
+     case flex_type_enum::STRING: {
+       if (m_dictionary_encode) {
+         append_dictionary_strings(values);
+       } else {
+         append_strings(values);
+       }
+       break;
+     }
+     case flex_type_enum::VECTOR: {
+       std::vector<flexible_type> child_values;
+       for (size_t i = 0; i < n; ++i) {
+         if (values[i].get_type() == flex_type_enum::VECTOR) {
+           for (double d: values[i].get<flex_vec>()) child_values.push_back(d);
+         }
+         int64_t offset = m_child->length() + child_values.size();
+         if (offset > std::numeric_limits<int32_t>::max()) {
+           log_and_throw(std::string("Vector column ") + m_name + " is too large to export");
+         }
+         m_offsets.push_back(offset);
+       }
+       m_child->append(child_values);
+       break;
+     }
+     default:
+       break;
+    }
+    m_length += n;
+  }
+
+  size_t length() const { return m_length; }
+
+  /**
+   * Moves the buffers into out_schema and out_array. The exporter cannot
+   * be used afterwards.
+   */
+  void finish(ArrowSchema* out_schema, ArrowArray* out_array) {
+    std::unique_ptr<exported_schema> schema(new exported_schema);
+    std::unique_ptr<exported_array> data(new exported_array);
+    schema->name = m_name;
+    int64_t null_count = m_null_count;
+    // the validity bitmap is left empty (a null buffer) if there are no
+    // missing values.
+    data->buffers.emplace_back();
+    if (null_count > 0) data->buffers[0] = std::move(m_validity);
+
+    switch(m_type) {
+     case flex_type_enum::INTEGER:
+       schema->format = "l";
+       data->buffers.push_back(std::move(m_values));
+       break;
+     case flex_type_enum::FLOAT:
+       schema->format = "g";
+       data->buffers.push_back(std::move(m_values));
+       break;
+     case flex_type_enum::DATETIME:
+       schema->format = "tsu:";
+       data->buffers.push_back(std::move(m_values));
+       break;
+     case flex_type_enum::STRING: {
+       if (m_dictionary_encode) {
+         // int32 indices into a dictionary of the distinct strings, in
+         // order of first appearance
+         schema->format = "i";
+         data->buffers.push_back(std::move(m_values));
+         column_exporter dictionary("", flex_type_enum::STRING, false);
+         dictionary.append(m_dictionary);
+         schema->dictionary = new ArrowSchema;
+         schema->dictionary->release = nullptr;
+         data->dictionary = new ArrowArray;
+         data->dictionary->release = nullptr;
+         dictionary.finish(schema->dictionary, data->dictionary);
+       } else {
+         // large utf8 if the offsets do not fit in 32 bits
+         bool large = m_offsets.back() > std::numeric_limits<int32_t>::max();
+         schema->format = large ? "U" : "u";
+         data->buffers.push_back(offsets_buffer(large));
+         data->buffers.push_back(std::move(m_bytes));
+       }
+       break;
+     }
+     case flex_type_enum::VECTOR: {
+       schema->format = "+l";
+       data->buffers.push_back(offsets_buffer(false));
+       auto child_schema = new ArrowSchema;
+       auto child_array = new ArrowArray;
+       child_schema->release = nullptr;
+       child_array->release = nullptr;
+       schema->children.push_back(child_schema);
+       data->children.push_back(child_array);
+       m_child->finish(child_schema, child_array);
+       break;
+     }
+     case flex_type_enum::UNDEFINED:
+       // the null type has no buffers at all
+       schema->format = "n";
+       data->buffers.clear();
+       null_count = m_length;
+       break;
+     default:
+       break;
+    }
+    finish_schema(out_schema, schema.release());
+    finish_array(out_array, data.release(), m_length, null_count);
+  }
+
+ private:
+  /**
+   * Grows a buffer of fixed width values by num_elem zeroed values, and
+   * returns a pointer to the first new value.
+   */
+  template <typename T>
+  T* grow(aligned_buffer& buffer, size_t num_elem) {
+    buffer.resize((m_length + num_elem) * sizeof(T));
+    return buffer.as<T>() + m_length;
+  }
+
+  void append_strings(const std::vector<flexible_type>& values) {
+    for (const auto& v: values) {
+      int64_t pos = m_offsets.back();
+      if (v.get_type() == flex_type_enum::STRING) {
+        const flex_string& s = v.get<flex_string>();
+        m_bytes.resize(pos + s.size());
+        std::memcpy(m_bytes.data() + pos, s.data(), s.size());
+        pos += s.size();
+      }
+      m_offsets.push_back(pos);
+    }
+  }
+
+  void append_dictionary_strings(const std::vector<flexible_type>& values) {
+    int32_t* out = grow<int32_t>(m_values, values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (values[i].get_type() != flex_type_enum::STRING) continue;
+      const flex_string& s = values[i].get<flex_string>();
+      auto iter = m_index_of.find(s);
+      if (iter == m_index_of.end()) {
+        if (m_dictionary.size() == (size_t)std::numeric_limits<int32_t>::max()) {
+          log_and_throw("Too many distinct strings to dictionary encode");
+        }
+        iter = m_index_of.insert({s, (int32_t)m_dictionary.size()}).first;
+        m_dictionary.push_back(s);
+      }
+      out[i] = iter->second;
+    }
+  }
+
+  /// The offsets as an Arrow buffer of int64 (if large) or int32
+  aligned_buffer offsets_buffer(bool large) {
+    aligned_buffer ret;
+    ret.resize(m_offsets.size() * (large ? 8 : 4));
+    for (size_t i = 0; i < m_offsets.size(); ++i) {
+      if (large) ret.as<int64_t>()[i] = m_offsets[i];
+      else ret.as<int32_t>()[i] = m_offsets[i];
+    }
+    std::vector<int64_t>().swap(m_offsets);
+    return ret;
+  }
+
+  std::string m_name;
+  flex_type_enum m_type;
+  bool m_dictionary_encode;
+  size_t m_length = 0;
+  int64_t m_null_count = 0;
+  aligned_buffer m_validity;
+  /// fixed width values, or dictionary indices
+  aligned_buffer m_values;
+  /// string or list offsets
+  std::vector<int64_t> m_offsets;
+  /// string bytes
+  aligned_buffer m_bytes;
+  /// the distinct strings when dictionary encoding
+  std::unordered_map<flex_string, int32_t> m_index_of;
+  std::vector<flexible_type> m_dictionary;
+  /// the values of a vector column
+  std::unique_ptr<column_exporter> m_child;
+};
+
+/**************************************************************************/
+/*                                                                        */
+/*                                Import                                  */
+/*                                                                        */
+/**************************************************************************/
+
+/**
+ * Reads the values of an imported Arrow array as flexible_types.
+ * Decoders are immutable once constructed, and can be used from many
+ * threads.
+ */
+class column_decoder {
+ public:
+  column_decoder(const ArrowSchema* schema, const ArrowArray* array)
+      : m_array(array) {
+    if (schema->dictionary != nullptr) {
+      // the array holds the indices, and the dictionary the values
+      if (array->dictionary == nullptr) {
+        log_and_throw(std::string("Dictionary array missing for ") + schema->name);
+      }
+      m_kind = parse_integer_format(schema->format);
+      column_decoder values(schema->dictionary, array->dictionary);
+      m_type = values.type();
+      m_dictionary.resize(array->dictionary->length);
+      for (int64_t i = 0; i < array->dictionary->length; ++i) {
+        m_dictionary[i] = values.get(i);
+      }
+      m_is_dictionary = true;
+      return;
+    }
+
+    std::string format = schema->format;
+    if (format == "n") {
+      m_kind = kind::NULL_VALUE; m_type = flex_type_enum::UNDEFINED;
+    } else if (format == "b") {
+      m_kind = kind::BOOL; m_type = flex_type_enum::INTEGER;
+    } else if (format == "f") {
+      m_kind = kind::FLOAT32; m_type = flex_type_enum::FLOAT;
+    } else if (format == "g") {
+      m_kind = kind::FLOAT64; m_type = flex_type_enum::FLOAT;
+    } else if (format == "u" || format == "z") {
+      m_kind = kind::STRING32; m_type = flex_type_enum::STRING;
+    } else if (format == "U" || format == "Z") {
+      m_kind = kind::STRING64; m_type = flex_type_enum::STRING;
+    } else if (format == "tdD") {
+      m_kind = kind::DATE32; m_type = flex_type_enum::DATETIME;
+    } else if (format.length() >= 4 && format.substr(0, 2) == "ts" && format[3] == ':') {
+      m_kind = kind::TIMESTAMP; m_type = flex_type_enum::DATETIME;
+      switch(format[2]) {
+       case 's': m_units_per_second = 1; break;
+       case 'm': m_units_per_second = 1000; break;
+       case 'u': m_units_per_second = 1000000; break;
+       case 'n': m_units_per_second = 1000000000; break;
+       default: log_and_throw(std::string("Unsupported Arrow timestamp format ") + format);
+      }
+      // values are always UTC. A time zone only changes how they are shown.
+      m_time_zone = format.length() > 4 ? 0 : flex_date_time::EMPTY_TIMEZONE;
+    } else if (format == "+l" || format == "+L") {
+      m_kind = format == "+l" ? kind::LIST32 : kind::LIST64;
+      if (schema->n_children != 1 || array->n_children != 1) {
+        log_and_throw(std::string("Malformed Arrow list column ") + schema->name);
+      }
+      m_child.reset(new column_decoder(schema->children[0], array->children[0]));
+      bool numeric = m_child->type() == flex_type_enum::INTEGER ||
+                     m_child->type() == flex_type_enum::FLOAT;
+      m_type = numeric ? flex_type_enum::VECTOR : flex_type_enum::LIST;
+    } else {
+      m_kind = parse_integer_format(format);
+      m_type = flex_type_enum::INTEGER;
+    }
+  }
+
+  flex_type_enum type() const { return m_type; }
+
+  /// Returns the value at logical index i of the array
+  flexible_type get(int64_t i) const {
+    int64_t p = m_array->offset + i;
+    if (m_kind == kind::NULL_VALUE || !is_valid(p)) return FLEX_UNDEFINED;
+    if (m_is_dictionary) {
+      int64_t index = get_integer(p);
+      if (index < 0 || (size_t)index >= m_dictionary.size()) {
+        log_and_throw("Arrow dictionary index out of range");
+      }
+      return m_dictionary[index];
+    }
+    switch(m_kind) {
+     case kind::BOOL:
+       return flex_int((buffer<uint8_t>(1)[p / 8] >> (p % 8)) & 1);
+     case kind::FLOAT32:
+       return flex_float(buffer<float>(1)[p]);
+     case kind::FLOAT64:
+       return flex_float(buffer<double>(1)[p]);
+     case kind::STRING32: {
+       const int32_t* offsets = buffer<int32_t>(1);
+       return flex_string(buffer<char>(2) + offsets[p], offsets[p + 1] - offsets[p]);
+     }
+     case kind::STRING64: {
+       const int64_t* offsets = buffer<int64_t>(1);
+       return flex_string(buffer<char>(2) + offsets[p], offsets[p + 1] - offsets[p]);
+     }
+     case kind::DATE32:
+       return flex_date_time((int64_t)buffer<int32_t>(1)[p] * 86400);
+     case kind::TIMESTAMP: {
+       int64_t v = buffer<int64_t>(1)[p];
+       int64_t seconds = v / m_units_per_second;
+       int64_t remainder = v % m_units_per_second;
+       if (remainder < 0) { remainder += m_units_per_second; --seconds; }
+       int32_t microseconds = remainder * 1000000 / m_units_per_second;
+       return flex_date_time(seconds, m_time_zone, microseconds);
+     }
+     case kind::LIST32:
+     case kind::LIST64: {
+       int64_t begin, end;
+       if (m_kind == kind::LIST32) {
+         begin = buffer<int32_t>(1)[p]; end = buffer<int32_t>(1)[p + 1];
+       } else {
+         begin = buffer<int64_t>(1)[p]; end = buffer<int64_t>(1)[p + 1];
+       }
+       if (m_type == flex_type_enum::VECTOR) {
+         flex_vec ret;
+         ret.reserve(end - begin);
+         for (int64_t j = begin; j < end; ++j) {
+           flexible_type v = m_child->get(j);
+           ret.push_back(v.get_type() == flex_type_enum::UNDEFINED ? NAN : (flex_float)v);
+         }
+         return ret;
+       } else {
+         flex_list ret;
+         ret.reserve(end - begin);
+         for (int64_t j = begin; j < end; ++j) ret.push_back(m_child->get(j));
+         return ret;
+       }
+     }
+     default:
+       return flex_int(get_integer(p));
+    }
+  }
+
+ private:
+  enum class kind {
+    NULL_VALUE, BOOL, INT8, UINT8, INT16, UINT16, INT32, UINT32, INT64, UINT64,
+    FLOAT32, FLOAT64, STRING32, STRING64, DATE32, TIMESTAMP, LIST32, LIST64
+  };
+
+  static kind parse_integer_format(const std::string& format) {
+    if (format == "c") return kind::INT8;
+    if (format == "C") return kind::UINT8;
+    if (format == "s") return kind::INT16;
+    if (format == "S") return kind::UINT16;
+    if (format == "i") return kind::INT32;
+    if (format == "I") return kind::UINT32;
+    if (format == "l") return kind::INT64;
+    if (format == "L") return kind::UINT64;
+    log_and_throw(std::string("Unsupported Arrow format ") + format);
+    return kind::INT64;
+  }
+
+  template <typename T>
+  const T* buffer(size_t i) const {
+    return reinterpret_cast<const T*>(m_array->buffers[i]);
+  }
+
+  bool is_valid(int64_t p) const {
+    if (m_array->null_count == 0 || m_array->buffers[0] == nullptr) return true;
+    return (buffer<uint8_t>(0)[p / 8] >> (p % 8)) & 1;
+  }
+
+  int64_t get_integer(int64_t p) const {
+    switch(m_kind) {
+     case kind::INT8: return buffer<int8_t>(1)[p];
+     case kind::UINT8: return buffer<uint8_t>(1)[p];
+     case kind::INT16: return buffer<int16_t>(1)[p];
+     case kind::UINT16: return buffer<uint16_t>(1)[p];
+     case kind::INT32: return buffer<int32_t>(1)[p];
+     case kind::UINT32: return buffer<uint32_t>(1)[p];
+     case kind::INT64: return buffer<int64_t>(1)[p];
+     case kind::UINT64: return (int64_t)buffer<uint64_t>(1)[p];
+     default: return 0;
+    }
+  }
+
+  const ArrowArray* m_array;
+  kind m_kind = kind::NULL_VALUE;
+  flex_type_enum m_type = flex_type_enum::UNDEFINED;
+  int64_t m_units_per_second = 1;
+  int32_t m_time_zone = flex_date_time::EMPTY_TIMEZONE;
+  bool m_is_dictionary = false;
+  std::vector<flexible_type> m_dictionary;
+  std::unique_ptr<column_decoder> m_child;
+};
+
+/**
+ * Calls the release callbacks of the imported structures when it goes out
+ * of scope.
+ */
+struct import_release_guard {
+  ArrowSchema* schema;
+  const std::vector<ArrowArray*>& batches;
+  ~import_release_guard() {
+    for (ArrowArray* batch: batches) {
+      if (batch && batch->release) batch->release(batch);
+    }
+    if (schema && schema->release) schema->release(schema);
+  }
+};
+
+/**************************************************************************/
+/*                                                                        */
+/*                             File transfer                              */
+/*                                                                        */
+/**************************************************************************/
+
+/// Buffers are aligned to this many bytes in the file
+constexpr size_t FILE_BUFFER_ALIGNMENT = 64;
+
+/**
+ * The sizes in bytes of the buffers of an array, from its format and its
+ * length (including the offset). Throws for formats which cannot be
+ * written.
+ */
+std::vector<size_t> arrow_buffer_sizes(const ArrowSchema* schema,
+                                       const ArrowArray* array) {
+  std::string format = schema->format;
+  size_t n = array->length + array->offset;
+  size_t validity = (n + 7) / 8;
+  auto fixed = [&](size_t width) { return std::vector<size_t>{validity, n * width}; };
+  if (format == "n") return {};
+  if (format == "b") return {validity, (n + 7) / 8};
+  if (format == "c" || format == "C") return fixed(1);
+  if (format == "s" || format == "S" || format == "e") return fixed(2);
+  if (format == "i" || format == "I" || format == "f" || format == "tdD") return fixed(4);
+  if (format == "l" || format == "L" || format == "g" || 
+      format == "tdm" || format.compare(0, 2, "ts") == 0) {
+    return fixed(8);
+  }
+  if (format == "u" || format == "z" || format == "U" || format == "Z") {
+    bool large = (format == "U" || format == "Z");
+    size_t num_bytes = 0;
+    if (array->n_buffers == 3 && array->buffers[1] != nullptr) {
+      num_bytes = large ? 
+          reinterpret_cast<const int64_t*>(array->buffers[1])[n] :
+          reinterpret_cast<const int32_t*>(array->buffers[1])[n];
+    }
+    return {validity, (n + 1) * (large ? 8 : 4), num_bytes};
+  }
+  if (format == "+l") return {validity, (n + 1) * 4};
+  if (format == "+L") return {validity, (n + 1) * 8};
+  if (format == "+s") return {validity};
+  log_and_throw(std::string("Cannot transfer Arrow format ") + format);
+}
+
+/**
+ * Appends the buffers of an array, and of its children and dictionary, to
+ * a file at position pos. Returns the layout of the array.
+ */
+flexible_type write_arrow_buffers(const ArrowSchema* schema,
+                                  const ArrowArray* array,
+                                  std::ostream& out,
+                                  size_t& pos) {
+  static const char padding[FILE_BUFFER_ALIGNMENT] = {0};
+  auto sizes = arrow_buffer_sizes(schema, array);
+  if ((size_t)array->n_buffers != sizes.size() || 
+      array->n_children != schema->n_children ||
+      (array->dictionary == nullptr) != (schema->dictionary == nullptr)) {
+    log_and_throw(std::string("Malformed Arrow array ") + 
+                  (schema->name ? schema->name : ""));
+  }
+  flex_list buffers;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    const char* data = reinterpret_cast<const char*>(array->buffers[i]);
+    if (data == nullptr) {
+      buffers.push_back(FLEX_UNDEFINED);
+      continue;
+    }
+    buffers.push_back(flex_list{flex_int(pos), flex_int(sizes[i])});
+    size_t pad = (FILE_BUFFER_ALIGNMENT - sizes[i] % FILE_BUFFER_ALIGNMENT) % 
+                 FILE_BUFFER_ALIGNMENT;
+    out.write(data, sizes[i]);
+    out.write(padding, pad);
+    pos += sizes[i] + pad;
+  }
+  flex_list children;
+  for (int64_t i = 0; i < array->n_children; ++i) {
+    children.push_back(write_arrow_buffers(schema->children[i], array->children[i], out, pos));
+  }
+  flexible_type dictionary = FLEX_UNDEFINED;
+  if (schema->dictionary) {
+    dictionary = write_arrow_buffers(schema->dictionary, array->dictionary, out, pos);
+  }
+  return flex_dict{{"format", flex_string(schema->format)},
+                   {"name", flex_string(schema->name ? schema->name : "")},
+                   {"length", flex_int(array->length)},
+                   {"null_count", flex_int(array->null_count)},
+                   {"offset", flex_int(array->offset)},
+                   {"buffers", buffers},
+                   {"children", children},
+                   {"dictionary", dictionary}};
+}
+
+/// Returns a field of a layout. Throws if it is missing.
+const flexible_type& layout_field(const flexible_type& layout, const std::string& key) {
+  if (layout.get_type() == flex_type_enum::DICT) {
+    for (const auto& kv: layout.get<flex_dict>()) {
+      if (kv.first.get_type() == flex_type_enum::STRING && 
+          kv.first.get<flex_string>() == key) {
+        return kv.second;
+      }
+    }
+  }
+  log_and_throw(std::string("Arrow layout is missing ") + key);
+}
+
+/**
+ * A list field of a layout. Lists of numbers may have been converted to
+ * vectors on their way through Python.
+ */
+flex_list layout_list(const flexible_type& value) {
+  switch(value.get_type()) {
+   case flex_type_enum::LIST:
+     return value.get<flex_list>();
+   case flex_type_enum::VECTOR: {
+     const flex_vec& vec = value.get<flex_vec>();
+     return flex_list(vec.begin(), vec.end());
+   }
+   case flex_type_enum::UNDEFINED:
+     return flex_list();
+   default:
+     log_and_throw("Malformed Arrow layout");
+  }
+}
+
+/**
+ * Fills in out_schema and out_array from a layout, with buffers pointing
+ * into the file contents. out_schema and out_array own what they hold as
+ * soon as they are filled in, even if a child then fails.
+ */
+void read_arrow_buffers(const flexible_type& layout,
+                        const std::shared_ptr<std::vector<uint64_t> >& file_data,
+                        size_t file_size,
+                        ArrowSchema* out_schema,
+                        ArrowArray* out_array) {
+  std::unique_ptr<exported_schema> schema(new exported_schema);
+  std::unique_ptr<exported_array> data(new exported_array);
+  schema->format = layout_field(layout, "format").to<flex_string>();
+  schema->name = layout_field(layout, "name").to<flex_string>();
+  data->file_data = file_data;
+  for (const auto& buffer: layout_list(layout_field(layout, "buffers"))) {
+    if (buffer.get_type() == flex_type_enum::UNDEFINED) {
+      data->buffer_pointers.push_back(nullptr);
+      continue;
+    }
+    flex_list range = layout_list(buffer);
+    if (range.size() != 2) log_and_throw("Malformed Arrow layout");
+    size_t offset = range[0].to<flex_int>();
+    size_t size = range[1].to<flex_int>();
+    if (offset % sizeof(uint64_t) != 0 || offset + size > file_size) {
+      log_and_throw("Arrow buffer out of the bounds of the file");
+    }
+    data->buffer_pointers.push_back(
+        reinterpret_cast<const char*>(file_data->data()) + offset);
+  }
+  flex_list children = layout_list(layout_field(layout, "children"));
+  for (size_t i = 0; i < children.size(); ++i) {
+    schema->children.push_back(new ArrowSchema);
+    schema->children.back()->release = nullptr;
+    data->children.push_back(new ArrowArray);
+    data->children.back()->release = nullptr;
+  }
+  const flexible_type& dictionary = layout_field(layout, "dictionary");
+  if (dictionary.get_type() != flex_type_enum::UNDEFINED) {
+    schema->dictionary = new ArrowSchema;
+    schema->dictionary->release = nullptr;
+    data->dictionary = new ArrowArray;
+    data->dictionary->release = nullptr;
+  }
+  int64_t length = layout_field(layout, "length").to<flex_int>();
+  int64_t null_count = layout_field(layout, "null_count").to<flex_int>();
+  int64_t offset = layout_field(layout, "offset").to<flex_int>();
+  finish_schema(out_schema, schema.release());
+  finish_array(out_array, data.release(), length, null_count);
+  out_array->offset = offset;
+
+  for (size_t i = 0; i < children.size(); ++i) {
+    read_arrow_buffers(children[i], file_data, file_size,
+                       out_schema->children[i], out_array->children[i]);
+  }
+  if (out_schema->dictionary) {
+    read_arrow_buffers(dictionary, file_data, file_size,
+                       out_schema->dictionary, out_array->dictionary);
+  }
+}
+
+} // anonymous namespace
+
+
+void export_sframe_to_arrow(const sframe& sf,
+                            struct ArrowSchema* out_schema,
+                            struct ArrowArray* out_array,
+                            const arrow_export_options& options) {
+  std::vector<size_t> column_indices;
+  if (options.columns.empty()) {
+    for (size_t i = 0; i < sf.num_columns(); ++i) column_indices.push_back(i);
+  } else {
+    for (const auto& name: options.columns) column_indices.push_back(sf.column_index(name));
+  }
+  size_t end_row = std::min(options.end_row, sf.num_rows());
+  size_t begin_row = std::min(options.begin_row, end_row);
+  size_t num_rows = end_row - begin_row;
+  size_t num_columns = column_indices.size();
+
+  std::unique_ptr<exported_schema> schema(new exported_schema);
+  std::unique_ptr<exported_array> data(new exported_array);
+  schema->format = "+s";
+  schema->name = "";
+  data->buffers.emplace_back();
+  for (size_t i = 0; i < num_columns; ++i) {
+    schema->children.push_back(new ArrowSchema);
+    schema->children.back()->release = nullptr;
+    data->children.push_back(new ArrowArray);
+    data->children.back()->release = nullptr;
+  }
+  // install the release callbacks first, so that everything is freed
+  // if a column fails to export.
+  finish_schema(out_schema, schema.release());
+  finish_array(out_array, data.release(), num_rows, 0);
+
+  try {
+    parallel_for(0, num_columns, [&](size_t i) {
+      size_t column = column_indices[i];
+      column_exporter exporter(sf.column_name(column), sf.column_type(column),
+                               options.dictionary_encode_strings);
+      auto reader = sf.select_column(column)->get_reader();
+      std::vector<flexible_type> buffer;
+      for (size_t start = begin_row; start < end_row; start += SARRAY_FROM_FILE_BATCH_SIZE) {
+        reader->read_rows(start, std::min(start + SARRAY_FROM_FILE_BATCH_SIZE, end_row), buffer);
+        exporter.append(buffer);
+      }
+      exporter.finish(out_schema->children[i], out_array->children[i]);
+    });
+  } catch (...) {
+    out_array->release(out_array);
+    out_schema->release(out_schema);
+    throw;
+  }
+  logstream(LOG_INFO) << "Exported " << num_rows << " rows and " << num_columns
+                      << " columns to Arrow" << std::endl;
+}
+
+
+sframe import_sframe_from_arrow(struct ArrowSchema* schema,
+                                const std::vector<struct ArrowArray*>& batches,
+                                const std::vector<std::string>& columns) {
+  import_release_guard guard{schema, batches};
+  if (schema == nullptr || std::string(schema->format) != "+s") {
+    log_and_throw("Arrow schema must be a struct of columns");
+  }
+
+  // the requested columns
+  std::vector<size_t> column_indices;
+  if (columns.empty()) {
+    for (int64_t i = 0; i < schema->n_children; ++i) column_indices.push_back(i);
+  } else {
+    for (const auto& name: columns) {
+      int64_t i = 0;
+      while (i < schema->n_children && name != schema->children[i]->name) ++i;
+      if (i == schema->n_children) {
+        log_and_throw(std::string("Column not found in Arrow schema: ") + name);
+      }
+      column_indices.push_back(i);
+    }
+  }
+  size_t num_columns = column_indices.size();
+
+  // decoders[i][b] reads column i of batch b
+  std::vector<std::vector<std::unique_ptr<column_decoder> > > decoders(num_columns);
+  std::vector<size_t> batch_begin{0};
+  for (const ArrowArray* batch: batches) {
+    if (batch == nullptr || batch->n_children != schema->n_children) {
+      log_and_throw("Arrow record batch does not match its schema");
+    }
+    batch_begin.push_back(batch_begin.back() + batch->length);
+  }
+  for (size_t i = 0; i < num_columns; ++i) {
+    size_t c = column_indices[i];
+    for (const ArrowArray* batch: batches) {
+      decoders[i].emplace_back(new column_decoder(schema->children[c], batch->children[c]));
+      if (decoders[i].back()->type() != decoders[i].front()->type()) {
+        log_and_throw(std::string("Column ") + schema->children[c]->name +
+                      " has different types in different batches");
+      }
+    }
+  }
+  size_t num_rows = batch_begin.back();
+
+  // each column is written in num_segments row ranges, all converted in
+  // parallel
+  size_t num_segments = std::max<size_t>(1, SFRAME_DEFAULT_NUM_SEGMENTS);
+  std::vector<std::shared_ptr<sarray<flexible_type> > > output(num_columns);
+  std::vector<std::string> names;
+  for (size_t i = 0; i < num_columns; ++i) {
+    output[i] = std::make_shared<sarray<flexible_type> >();
+    output[i]->open_for_write(num_segments);
+    output[i]->set_type(batches.empty() ? flex_type_enum::UNDEFINED : decoders[i][0]->type());
+    names.push_back(schema->children[column_indices[i]]->name);
+  }
+
+  parallel_for(0, num_columns * num_segments, [&](size_t task) {
+    size_t i = task / num_segments;
+    size_t segment = task % num_segments;
+    size_t begin = segment * num_rows / num_segments;
+    size_t end = (segment + 1) * num_rows / num_segments;
+    auto out = output[i]->get_output_iterator(segment);
+    // the batch holding row begin
+    size_t b = std::upper_bound(batch_begin.begin(), batch_begin.end(), begin)
+               - batch_begin.begin() - 1;
+    for (size_t row = begin; row < end; ++row) {
+      while (row >= batch_begin[b + 1]) ++b;
+      const ArrowArray* batch = batches[b];
+      *out = decoders[i][b]->get(batch->offset + (row - batch_begin[b]));
+      ++out;
+    }
+  });
+
+  for (auto& column: output) column->close();
+  logstream(LOG_INFO) << "Imported " << num_rows << " rows and " << num_columns
+                      << " columns from " << batches.size()
+                      << " Arrow record batches" << std::endl;
+  return sframe(output, names);
+}
+
+flexible_type write_arrow_to_file(struct ArrowSchema* schema,
+                                  struct ArrowArray* array,
+                                  const std::string& file) {
+  std::vector<ArrowArray*> batches{array};
+  import_release_guard guard{schema, batches};
+  general_ofstream fout(file);
+  size_t pos = 0;
+  flexible_type layout = write_arrow_buffers(schema, array, fout, pos);
+  if (!fout.good()) {
+    log_and_throw_io_failure("Fail to write. Disk may be full.");
+  }
+  fout.close();
+  return layout;
+}
+
+
+void read_arrow_from_file(const std::string& file,
+                          const flexible_type& layout,
+                          struct ArrowSchema* out_schema,
+                          struct ArrowArray* out_array) {
+  out_schema->release = nullptr;
+  out_array->release = nullptr;
+  general_ifstream fin(file);
+  size_t file_size = fin.file_size();
+  if (file_size == (size_t)(-1)) {
+    log_and_throw_io_failure(std::string("Unable to read ") + file);
+  }
+  // 64 bit words, so that the buffers are aligned
+  auto file_data = std::make_shared<std::vector<uint64_t> >((file_size + 7) / 8);
+  fin.read(reinterpret_cast<char*>(file_data->data()), file_size);
+  if (fin.fail()) {
+    log_and_throw_io_failure(std::string("Unable to read ") + file);
+  }
+  try {
+    read_arrow_buffers(layout, file_data, file_size, out_schema, out_array);
+  } catch (...) {
+    if (out_array->release) out_array->release(out_array);
+    if (out_schema->release) out_schema->release(out_schema);
+    throw;
+  }
+}
+
+} // namespace graphlab
@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_SFRAME_ARROW_HPP
+#define GRAPHLAB_SFRAME_SFRAME_ARROW_HPP
+#include <string>
+#include <vector>
+#include <flexible_type/flexible_type.hpp>
+#include <sframe/arrow_c_data_interface.hpp>
+
+namespace graphlab {
+class sframe;
+
+/**
+ * \ingroup sframe_physical
+ * \addtogroup sframe_main Main SFrame Objects
+ * \{
+ */
+
+/**
+ * Options for \ref export_sframe_to_arrow.
+ */
+struct arrow_export_options {
+  /// The columns to export. If empty, all columns are exported.
+  std::vector<std::string> columns;
+  /// The first row to export
+  size_t begin_row = 0;
+  /// One past the last row to export. Clipped to the length of the sframe.
+  size_t end_row = (size_t)(-1);
+  /// If true, string columns are exported dictionary encoded
+  bool dictionary_encode_strings = false;
+};
+
+/**
+ * Exports a range of rows of an sframe as an Arrow record batch, through
+ * the Arrow C data interface.
+ *
+ * The batch is a struct array (format "+s") with one child per column.
+ * Types are mapped as follows:
+ *  - integer: int64 ("l")
+ *  - float: float64 ("g")
+ *  - string: utf8 ("u"), large utf8 ("U") if the column holds 2GB or more,
+ *    or a dictionary with int32 indices if dictionary_encode_strings is set
+ *  - datetime: timestamp[us] ("tsu:"), UTC. Time zones are not exported.
+ *  - vector: list of float64 ("+l")
+ *  - undefined: null ("n")
+ * Missing values are exported as nulls. Other types throw.
+ *
+ * Columns are converted in parallel, each into its own contiguous Arrow
+ * buffers. Each column is read and appended to its buffers a block of rows
+ * at a time, so it is never held whole as flexible_types. The caller owns
+ * the structures and must call their release callbacks.
+ *
+ * From Python, with pyarrow:
+ * \code
+ * batch = pyarrow.RecordBatch._import_from_c(array_ptr, schema_ptr)
+ * pyarrow.parquet.write_table(pyarrow.Table.from_batches([batch]), "out.parquet")
+ * \endcode
+ */
+void export_sframe_to_arrow(const sframe& sf,
+                            struct ArrowSchema* out_schema,
+                            struct ArrowArray* out_array,
+                            const arrow_export_options& options = arrow_export_options());
+
+/**
+ * Imports a sequence of Arrow record batches sharing a schema into an sframe,
+ * through the Arrow C data interface.
+ *
+ * The schema must be a struct (format "+s"). Supported column types are all
+ * integer types and bool (as integer), float32 and float64 (as float),
+ * utf8 / large utf8 / binary (as string), timestamps of any unit and date32
+ * (as datetime), null, lists (as vector if the values are numeric, list
+ * otherwise) and dictionary encoded columns of any of these types. Nulls
+ * are imported as missing values.
+ *
+ * Only the requested columns are decoded. Columns and row ranges are
+ * converted in parallel, straight into the sarray writers, without building
+ * rows.
+ *
+ * The function takes ownership of the schema and of the batches, and calls
+ * their release callbacks, also on failure.
+ *
+ * \param schema The schema of the batches
+ * \param batches The record batches, e.g. the row groups of a Parquet file
+ * \param columns The columns to import. If empty, all columns are imported.
+ */
+sframe import_sframe_from_arrow(struct ArrowSchema* schema,
+                                const std::vector<struct ArrowArray*>& batches,
+                                const std::vector<std::string>& columns = {});
+
+/**
+ * Writes the buffers of an Arrow array (and of its children and
+ * dictionary) to a file, so that a process which does not share memory
+ * with this one, such as the Python client of the unity server, can
+ * rebuild it with \ref read_arrow_from_file.
+ *
+ * Buffers are written one after the other, each aligned to 64 bytes.
+ * Returns the layout of the array: a dictionary with the keys "format",
+ * "name", "length", "null_count", "offset", "buffers" (for each buffer
+ * [file offset, size], or None if it is null), "children" (their layouts)
+ * and "dictionary" (its layout, or None).
+ *
+ * The function takes ownership of the schema and of the array, and calls
+ * their release callbacks, also on failure.
+ */
+flexible_type write_arrow_to_file(struct ArrowSchema* schema,
+                                  struct ArrowArray* array,
+                                  const std::string& file);
+
+/**
+ * Reads an Arrow array written by \ref write_arrow_to_file, given its
+ * layout, into out_schema and out_array. The structures hold the contents
+ * of the file, and the caller must call their release callbacks.
+ */
+void read_arrow_from_file(const std::string& file,
+                          const flexible_type& layout,
+                          struct ArrowSchema* out_schema,
+                          struct ArrowArray* out_array);
+
+/// \}
+} // namespace graphlab
+#endif
@@ -7,6 +7,7 @@
  */
 #include <sframe/sframe_constants.hpp>
 #include <globals/globals.hpp>
+#include <sframe/sarray_v2_block_types.hpp>
 #include <limits>
 #include "export.hpp"
 namespace graphlab {
@@ -21,6 +22,8 @@ EXPORT const size_t SFRAME_WRITER_BUFFER_HARD_LIMIT = 1024 * 10;
 EXPORT size_t SFRAME_FILE_HANDLE_POOL_SIZE = 128;
 EXPORT const size_t SFRAME_BLOCK_MANAGER_BLOCK_BUFFER_COUNT = 128;
 EXPORT const float COMPRESSION_DISABLE_THRESHOLD = 0.9;
+EXPORT std::string SFRAME_DEFAULT_COMPRESSION_CODEC = "lz4";
+EXPORT const size_t SFRAME_COMPRESSION_AUTO_SAMPLE_BLOCKS = 4;
 EXPORT size_t SFRAME_DEFAULT_BLOCK_SIZE =  64 * 1024;
 EXPORT const size_t SARRAY_WRITER_MIN_ELEMENTS_PER_BLOCK = 8;
 EXPORT const size_t SARRAY_WRITER_INITAL_ELEMENTS_PER_BLOCK = 16;
@@ -28,12 +31,18 @@ EXPORT size_t SFRAME_WRITER_MAX_BUFFERED_CELLS = 32*1024*1024; // 64M elements
 EXPORT size_t SFRAME_WRITER_MAX_BUFFERED_CELLS_PER_BLOCK = 256*1024; // 1M elements.
 EXPORT // will be modified at startup to be 4x nCPUS
 EXPORT size_t SFRAME_MAX_BLOCKS_IN_CACHE = 32;
+EXPORT size_t SFRAME_DECODED_BLOCK_CACHE_CAPACITY = 256 * 1024 * 1024; // 256MB
+EXPORT size_t SFRAME_READ_AHEAD_BLOCKS = 4;
+EXPORT size_t SFRAME_PREFETCH_IO_THREADS = 4;
+EXPORT const size_t SFRAME_PREFETCH_MAX_PENDING_BLOCKS = 256;
 EXPORT size_t SFRAME_CSV_PARSER_READ_SIZE = 50 * 1024 * 1024; // 50MB
 EXPORT size_t SFRAME_GROUPBY_BUFFER_NUM_ROWS = 1024 * 1024;
 EXPORT size_t SFRAME_JOIN_BUFFER_NUM_CELLS = 50*1024*1024;
+EXPORT size_t SFRAME_SPILL_READ_BUFFER_SIZE = 4096;
 EXPORT size_t SFRAME_IO_READ_LOCK = false;
 EXPORT size_t SFRAME_SORT_PIVOT_ESTIMATION_SAMPLE_SIZE = 2000000;
 EXPORT size_t SFRAME_SORT_MAX_SEGMENTS = 128;
+EXPORT size_t SFRAME_COST_BASED_OPTIMIZATION = true;
 EXPORT const size_t SFRAME_IO_LOCK_FILE_SIZE_THRESHOLD = 4 * 1024 * 1024;
 EXPORT std::string LIBODBC_PREFIX("");
 EXPORT size_t ODBC_BUFFER_SIZE = size_t(3 * 1024 * 1024) * size_t(1024); // 3 GB (to allow for a blob or two)
@@ -43,6 +52,20 @@ REGISTER_GLOBAL(std::string,
                 LIBODBC_PREFIX,
                 true);
 
+static bool check_compression_codec(std::string val) {
+  try {
+    v2_block_impl::parse_compression_options(val);
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+REGISTER_GLOBAL_WITH_CHECKS(std::string,
+                            SFRAME_DEFAULT_COMPRESSION_CODEC,
+                            true,
+                            check_compression_codec);
+
 
 REGISTER_GLOBAL_WITH_CHECKS(int64_t, 
                             SFRAME_DEFAULT_NUM_SEGMENTS, 
@@ -67,6 +90,21 @@ REGISTER_GLOBAL_WITH_CHECKS(int64_t,
                             true, 
                             +[](int64_t val){ return val >= 1; });
 
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SFRAME_DECODED_BLOCK_CACHE_CAPACITY,
+                            true,
+                            +[](int64_t val){ return val >= 0; });
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SFRAME_READ_AHEAD_BLOCKS,
+                            true,
+                            +[](int64_t val){ return val >= 0; });
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SFRAME_PREFETCH_IO_THREADS,
+                            true,
+                            +[](int64_t val){ return val >= 1; });
+
 
 REGISTER_GLOBAL_WITH_CHECKS(int64_t, 
                             SFRAME_CSV_PARSER_READ_SIZE, 
@@ -86,6 +124,11 @@ REGISTER_GLOBAL_WITH_CHECKS(int64_t,
                             +[](int64_t val){ return val >= 1024; });
 
 
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SFRAME_SPILL_READ_BUFFER_SIZE,
+                            true,
+                            +[](int64_t val){ return val >= 1; });
+
 
 REGISTER_GLOBAL_WITH_CHECKS(int64_t, 
                             SFRAME_WRITER_MAX_BUFFERED_CELLS,
@@ -113,6 +156,11 @@ REGISTER_GLOBAL_WITH_CHECKS(int64_t,
                             true,
                             +[](int64_t val){ return val > 1; });
 
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SFRAME_COST_BASED_OPTIMIZATION,
+                            true,
+                            +[](int64_t val){ return val == 0 || val == 1; });
+
 REGISTER_GLOBAL_WITH_CHECKS(int64_t,
                             ODBC_BUFFER_SIZE,
                             true,
@@ -69,6 +69,19 @@ extern const size_t SFRAME_BLOCK_MANAGER_BLOCK_BUFFER_COUNT;
  */
 extern const float COMPRESSION_DISABLE_THRESHOLD;
 
+/**
+ * The compression codec used for the columns written by the v2 block writer,
+ * unless set per column. One of "none", "lz4", "lz4hc", "lz4hc:<level>"
+ * (level 1 - 16) or "auto". See v2_block_impl::compression_codec.
+ */
+extern std::string SFRAME_DEFAULT_COMPRESSION_CODEC;
+
+/**
+ * The number of blocks of each column an "auto" compressed column samples
+ * before settling on a codec.
+ */
+extern const size_t SFRAME_COMPRESSION_AUTO_SAMPLE_BLOCKS;
+
 
 /**
  * The default size of each block in the file. This is not strict. the
@@ -116,6 +129,30 @@ extern size_t SFRAME_WRITER_MAX_BUFFERED_CELLS;
  */
 extern size_t SFRAME_MAX_BLOCKS_IN_CACHE;
 
+/**
+ * The number of bytes of decoded blocks kept in the process wide block
+ * cache shared by all sarray readers. 0 disables the shared cache.
+ */
+extern size_t SFRAME_DECODED_BLOCK_CACHE_CAPACITY;
+
+/**
+ * The number of blocks ahead of the current block which a sequential
+ * sarray reader asks the block manager to prefetch. 0 disables read-ahead.
+ */
+extern size_t SFRAME_READ_AHEAD_BLOCKS;
+
+/**
+ * The number of IO threads used by the block manager to service prefetch
+ * requests. Read when the first prefetch is issued.
+ */
+extern size_t SFRAME_PREFETCH_IO_THREADS;
+
+/**
+ * The maximum number of prefetched blocks held by the block manager which
+ * have not yet been read.
+ */
+extern const size_t SFRAME_PREFETCH_MAX_PENDING_BLOCKS;
+
 /**
  * The amount to read from the file each time by the CSV parser. (this block
  * is then parsed in parallel by a collection of threads)
@@ -135,6 +172,12 @@ extern size_t SFRAME_GROUPBY_BUFFER_NUM_ROWS;
  */
 extern size_t SFRAME_JOIN_BUFFER_NUM_CELLS;
 
+/**
+ * The number of rows read at once, ahead of their use, from the runs the
+ * groupby, join and sort spill to temp storage.
+ */
+extern size_t SFRAME_SPILL_READ_BUFFER_SIZE;
+
 /**
  * Whether locks are used when reading from SFrames on local storage. Good
  * for spinning disks, bad for SSDs.
@@ -161,6 +204,14 @@ extern size_t SFRAME_SORT_PIVOT_ESTIMATION_SAMPLE_SIZE;
  */
 extern size_t SFRAME_SORT_MAX_SEGMENTS;
 
+/**
+ * If set, the statistics of flexible_type columns are gathered as they are
+ * written, and joins and groupbys use the known statistics of their key
+ * columns (see column_statistics.hpp) to choose how they execute. Set to 0
+ * to turn this off.
+ */
+extern size_t SFRAME_COST_BASED_OPTIMIZATION;
+
 /**
  * A variable the user can set to look for libodbc.so
  */
@@ -0,0 +1,238 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <cmath>
+#include <logger/logger.hpp>
+#include <fileio/general_fstream.hpp>
+#include <serialization/serialization_includes.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <sframe/sframe_key_index.hpp>
+
+namespace graphlab {
+
+namespace {
+
+const size_t KEY_INDEX_VERSION = 2;
+
+bool is_nan(const flexible_type& a) {
+  return a.get_type() == flex_type_enum::FLOAT && std::isnan(a.get<flex_float>());
+}
+
+/**
+ * Orders keys with missing values first and NaNs last, so that a float
+ * column is strictly weakly ordered. All other keys have the type of the
+ * indexed column.
+ */
+bool key_less(const flexible_type& a, const flexible_type& b) {
+  bool a_missing = a.get_type() == flex_type_enum::UNDEFINED;
+  bool b_missing = b.get_type() == flex_type_enum::UNDEFINED;
+  if (a_missing || b_missing) return a_missing && !b_missing;
+  bool a_nan = is_nan(a);
+  bool b_nan = is_nan(b);
+  if (a_nan || b_nan) return !a_nan && b_nan;
+  return a < b;
+}
+
+bool key_equal(const flexible_type& a, const flexible_type& b) {
+  return !key_less(a, b) && !key_less(b, a);
+}
+
+} // anonymous namespace
+
+
+sframe_key_index sframe_key_index::build(const sframe& sf,
+                                         const std::string& column_name) {
+  sframe_key_index ret;
+  ret.m_column_name = column_name;
+  ret.m_column_type = sf.column_type(sf.column_index(column_name));
+  ret.m_num_rows = sf.num_rows();
+  ret.m_column_index_file = sf.select_column(column_name)->get_index_file();
+  switch(ret.m_column_type) {
+   case flex_type_enum::INTEGER:
+   case flex_type_enum::FLOAT:
+   case flex_type_enum::STRING:
+   case flex_type_enum::DATETIME:
+     break;
+   default:
+     log_and_throw(std::string("Cannot index column ") + column_name +
+                   " of type " + flex_type_enum_to_name(ret.m_column_type));
+  }
+
+  std::vector<flexible_type> values;
+  values.reserve(ret.m_num_rows);
+  auto reader = sf.select_column(column_name)->get_reader();
+  std::vector<flexible_type> buffer;
+  for (size_t start = 0; start < ret.m_num_rows; start += SARRAY_FROM_FILE_BATCH_SIZE) {
+    reader->read_rows(start, start + SARRAY_FROM_FILE_BATCH_SIZE, buffer);
+    std::move(buffer.begin(), buffer.end(), std::back_inserter(values));
+  }
+  ASSERT_EQ(values.size(), ret.m_num_rows);
+
+  // row numbers ordered by key. The sort is stable, so the rows of each
+  // key remain in ascending order.
+  std::vector<size_t> order(values.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) {
+                     return key_less(values[a], values[b]);
+                   });
+
+  ret.m_rows = order;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || !key_equal(values[order[i - 1]], values[order[i]])) {
+      ret.m_keys.push_back(values[order[i]]);
+      ret.m_offsets.push_back(i);
+    }
+  }
+  ret.m_offsets.push_back(order.size());
+  logstream(LOG_INFO) << "Built key index on column " << column_name << ": "
+                      << ret.m_keys.size() << " distinct keys in "
+                      << ret.m_num_rows << " rows" << std::endl;
+  return ret;
+}
+
+
+sframe_key_index sframe_key_index::load(const std::string& index_file) {
+  general_ifstream fin(index_file);
+  if (fin.fail()) {
+    log_and_throw(std::string("Unable to open key index file at ") + index_file);
+  }
+  sframe_key_index ret;
+  iarchive iarc(fin);
+  ret.load(iarc);
+  if (fin.fail()) {
+    log_and_throw(std::string("Unable to read key index file ") + index_file);
+  }
+  return ret;
+}
+
+
+void sframe_key_index::save(const std::string& index_file) const {
+  general_ofstream fout(index_file);
+  if (fout.fail()) {
+    log_and_throw_io_failure(std::string("Unable to open ") + index_file + " for writing");
+  }
+  oarchive oarc(fout);
+  save(oarc);
+  if (!fout.good()) {
+    log_and_throw_io_failure("Fail to write. Disk may be full.");
+  }
+  fout.close();
+}
+
+
+void sframe_key_index::save(oarchive& oarc) const {
+  oarc << KEY_INDEX_VERSION << m_column_name << (int)m_column_type << m_num_rows
+       << m_column_index_file << m_keys << m_offsets << m_rows;
+}
+
+
+void sframe_key_index::load(iarchive& iarc) {
+  size_t version = 0;
+  int column_type = 0;
+  iarc >> version;
+  if (version != KEY_INDEX_VERSION) {
+    log_and_throw(std::string("Unsupported key index version ") + std::to_string(version));
+  }
+  iarc >> m_column_name >> column_type >> m_num_rows
+       >> m_column_index_file >> m_keys >> m_offsets >> m_rows;
+  m_column_type = (flex_type_enum)column_type;
+}
+
+
+size_t sframe_key_index::find_key(const flexible_type& key) const {
+  flexible_type k = key;
+  if (k.get_type() != flex_type_enum::UNDEFINED && k.get_type() != m_column_type) {
+    // integer and float keys are matched by numeric value
+    if (m_column_type == flex_type_enum::INTEGER &&
+        k.get_type() == flex_type_enum::FLOAT) {
+      flex_float value = k.get<flex_float>();
+      if (std::floor(value) != value) return (size_t)(-1);
+      k = flex_int(value);
+    } else if (m_column_type == flex_type_enum::FLOAT &&
+               k.get_type() == flex_type_enum::INTEGER) {
+      k = flex_float(k.get<flex_int>());
+    } else {
+      return (size_t)(-1);
+    }
+  }
+  auto iter = std::lower_bound(m_keys.begin(), m_keys.end(), k, key_less);
+  if (iter == m_keys.end() || !key_equal(*iter, k)) return (size_t)(-1);
+  return iter - m_keys.begin();
+}
+
+
+std::vector<size_t> sframe_key_index::find(const flexible_type& key) const {
+  size_t pos = find_key(key);
+  if (pos == (size_t)(-1)) return {};
+  return std::vector<size_t>(m_rows.begin() + m_offsets[pos],
+                             m_rows.begin() + m_offsets[pos + 1]);
+}
+
+
+std::vector<size_t> sframe_key_index::find(const std::vector<flexible_type>& keys) const {
+  std::vector<size_t> positions;
+  for (const auto& key: keys) {
+    size_t pos = find_key(key);
+    if (pos != (size_t)(-1)) positions.push_back(pos);
+  }
+  std::sort(positions.begin(), positions.end());
+  positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+  std::vector<size_t> ret;
+  for (size_t pos: positions) {
+    ret.insert(ret.end(),
+               m_rows.begin() + m_offsets[pos],
+               m_rows.begin() + m_offsets[pos + 1]);
+  }
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
+
+
+sframe sframe_key_index::lookup(const sframe& sf,
+                                const std::vector<flexible_type>& keys) const {
+  if (sf.num_rows() != m_num_rows || !sf.contains_column(m_column_name) ||
+      sf.select_column(m_column_name)->get_index_file() != m_column_index_file) {
+    log_and_throw(std::string("Key index on ") + m_column_name +
+                  " was built on a different SFrame");
+  }
+  return read_selected_rows(sf, find(keys));
+}
+
+
+sframe sframe_key_index::read_selected_rows(const sframe& sf,
+                                            const std::vector<size_t>& rows) {
+  sframe ret;
+  ret.open_for_write(sf.column_names(), sf.column_types(), "", 1);
+  auto out = ret.get_output_iterator(0);
+  if (!rows.empty()) {
+    auto reader = sf.get_reader();
+    std::vector<std::vector<flexible_type> > buffer;
+    size_t i = 0;
+    while (i < rows.size()) {
+      // extend the run while the rows are consecutive
+      size_t j = i + 1;
+      while (j < rows.size() && rows[j] == rows[j - 1] + 1 &&
+             j - i < DEFAULT_SARRAY_READER_BUFFER_SIZE) {
+        ++j;
+      }
+      reader->read_rows(rows[i], rows[j - 1] + 1, buffer);
+      for (auto& row: buffer) {
+        *out = std::move(row);
+        ++out;
+      }
+      i = j;
+    }
+  }
+  ret.close();
+  return ret;
+}
+
+} // namespace graphlab
@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_SFRAME_KEY_INDEX_HPP
+#define GRAPHLAB_SFRAME_SFRAME_KEY_INDEX_HPP
+#include <string>
+#include <vector>
+#include <flexible_type/flexible_type.hpp>
+
+namespace graphlab {
+class sframe;
+class oarchive;
+class iarchive;
+
+/**
+ * \ingroup sframe_physical
+ * \addtogroup sframe_main Main SFrame Objects
+ * \{
+ */
+
+/**
+ * A persisted point lookup index on a key column of an immutable sframe.
+ *
+ * Selecting the rows of a few keys with a logical filter scans and decodes
+ * the entire sframe. The index maps every distinct key of the column to
+ * the numbers of the rows holding it, so that the rows can be read
+ * directly: the matching rows are grouped into runs of consecutive row
+ * numbers, and only the blocks overlapping those runs are read and
+ * decoded.
+ *
+ * The index is stored as a sorted array of distinct keys, and for each
+ * key the sorted row numbers holding it (in compressed sparse row form).
+ * Lookups are binary searches.
+ *
+ * \code
+ * auto index = sframe_key_index::build(sf, "user_id");
+ * index.save("user_id.kidx");
+ * ...
+ * auto index = sframe_key_index::load("user_id.kidx");
+ * sframe rows = index.lookup(sf, {12345, 54321});
+ * \endcode
+ *
+ * The index records the index file of the column it was built on, and the
+ * number of rows of its sframe, and refuses to read from an sframe whose
+ * column is stored elsewhere or which has a different length. It must be
+ * rebuilt when the sframe is saved to another location.
+ *
+ * Keys are matched by value and type, except that integer and float keys
+ * are converted to the type of the column. Missing values are indexed and
+ * can be looked up with FLEX_UNDEFINED, and NaN keys match each other.
+ */
+class sframe_key_index {
+ public:
+  sframe_key_index() = default;
+
+  /**
+   * Builds an index on a column of an sframe.
+   * The column must be of integer, float, string or datetime type.
+   */
+  static sframe_key_index build(const sframe& sf, const std::string& column_name);
+
+  /// Loads an index saved with \ref save. Throws on failure.
+  static sframe_key_index load(const std::string& index_file);
+
+  /// Saves the index to a file. Throws on failure.
+  void save(const std::string& index_file) const;
+
+  /// The name of the indexed column
+  const std::string& column_name() const { return m_column_name; }
+
+  /// The number of rows of the indexed sframe
+  size_t num_rows() const { return m_num_rows; }
+
+  /// The index file of the indexed column
+  const std::string& column_index_file() const { return m_column_index_file; }
+
+  /// The number of distinct keys
+  size_t num_keys() const { return m_keys.size(); }
+
+  /**
+   * Returns the row numbers, in ascending order, of the rows whose key is
+   * equal to the given key.
+   */
+  std::vector<size_t> find(const flexible_type& key) const;
+
+  /**
+   * Returns the row numbers, in ascending order and without duplicates, of
+   * the rows whose key is equal to any of the given keys.
+   */
+  std::vector<size_t> find(const std::vector<flexible_type>& keys) const;
+
+  /**
+   * Reads the rows whose key is equal to any of the given keys from the
+   * indexed sframe, in their original order.
+   */
+  sframe lookup(const sframe& sf, const std::vector<flexible_type>& keys) const;
+
+  /**
+   * Reads the given rows (in ascending order, without duplicates) of an
+   * sframe. Consecutive rows are read with a single read, so only the
+   * blocks holding the rows are decoded.
+   */
+  static sframe read_selected_rows(const sframe& sf, const std::vector<size_t>& rows);
+
+  void save(oarchive& oarc) const;
+  void load(iarchive& iarc);
+
+ private:
+  /// Returns the position of the key in m_keys, or -1 if not present.
+  size_t find_key(const flexible_type& key) const;
+
+  std::string m_column_name;
+  flex_type_enum m_column_type = flex_type_enum::UNDEFINED;
+  size_t m_num_rows = 0;
+  std::string m_column_index_file;
+  /// Distinct keys in ascending order
+  std::vector<flexible_type> m_keys;
+  /// The rows of m_keys[i] are m_rows[m_offsets[i]] ... m_rows[m_offsets[i + 1] - 1]
+  std::vector<size_t> m_offsets;
+  std::vector<size_t> m_rows;
+};
+
+/// \}
+} // namespace graphlab
+#endif
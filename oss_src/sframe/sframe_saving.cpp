@@ -5,6 +5,8 @@
  * This software may be modified and distributed under the terms
  * of the BSD license. See the LICENSE file for details.
  */
+#include <sstream>
+#include <algorithm>
 #include <sframe/sframe.hpp>
 #include <sframe/sframe_index_file.hpp>
 #include <sframe/sarray_index_file.hpp>
@@ -12,12 +14,16 @@
 #include <sframe/sarray_v2_block_writer.hpp>
 #include <sframe/sarray_v2_block_types.hpp>
 #include <sframe/sframe_saving_impl.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <sframe/column_statistics.hpp>
+#include <parallel/lambda_omp.hpp>
 #include <fileio/fs_utils.hpp>
 #include <logger/assertions.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <boost/filesystem.hpp>
 namespace graphlab {
 using namespace sframe_saving_impl;
 /**
@@ -26,17 +32,38 @@ using namespace sframe_saving_impl;
  * the naive strategies when we run out of options.
  */
 
+/**
+ * Returns the codec a saved copy of column i should be written with: the one
+ * requested in column_codecs if any, else the one recorded in the column
+ * metadata. Returns an empty string for the default codec.
+ */
+static std::string target_column_codec(const index_file_information& column_index,
+                                       const std::vector<std::string>& column_codecs,
+                                       size_t i) {
+  if (i < column_codecs.size() && !column_codecs[i].empty()) {
+    return column_codecs[i];
+  }
+  auto iter = column_index.metadata.find("__compression__");
+  if (iter != column_index.metadata.end()) return iter->second;
+  return "";
+}
+
 /**
  * This is the most naive of all saving strategies.
  * 
  */
 void sframe_save_naive(const sframe& sf_source,
-                       std::string index_file) {
+                       std::string index_file,
+                       const std::vector<std::string>& column_codecs) {
   std::vector<std::string> my_names;
   std::vector<flex_type_enum> my_types;
+  std::vector<std::string> my_codecs;
   for(size_t i = 0; i < sf_source.num_columns(); ++i) {
     my_names.push_back(sf_source.column_name(i));
     my_types.push_back(sf_source.column_type(i));
+    my_codecs.push_back(
+        target_column_codec(sf_source.select_column(i)->get_index_info(),
+                            column_codecs, i));
   }
 
   // target sframe.
@@ -45,7 +72,8 @@ void sframe_save_naive(const sframe& sf_source,
   if (sf_source.num_segments() == 0) num_write_segments = 0;
 
   new_sf.open_for_write(my_names, my_types, 
-                        index_file, SFRAME_DEFAULT_NUM_SEGMENTS);
+                        index_file, SFRAME_DEFAULT_NUM_SEGMENTS, 
+                        true, my_codecs);
   if (sf_source.num_segments() == 0) {
     new_sf.close();
     return;
@@ -142,6 +170,8 @@ void sframe_save_blockwise(const sframe& sf_source,
       }
 
       writer.get_index_info().columns[i].metadata = col.column_index.metadata;
+      add_known_column_statistics(col.column_index,
+                                  writer.get_index_info().columns[i].metadata);
     }
     // we are going to reorder the blocks so that the column with the lowest
     // row number get written first. So this is to be a min-heap
@@ -203,8 +233,175 @@ void sframe_save_blockwise(const sframe& sf_source,
   }
 }
 
+/**
+ * Returns true if a block can be copied as stored on disk into a column 
+ * compressed with the given options, i.e. if recompressing it would produce
+ * the same kind of block.
+ */
+static bool can_copy_raw_block(const v2_block_impl::block_info& info,
+                               const v2_block_impl::column_compression_options& options) {
+  using v2_block_impl::compression_codec;
+  bool lz4 = info.flags & v2_block_impl::LZ4_COMPRESSION;
+  bool lz4hc = info.flags & v2_block_impl::LZ4HC_COMPRESSION;
+  switch(options.codec) {
+   case compression_codec::NONE:
+     return !lz4;
+   case compression_codec::LZ4:
+   case compression_codec::AUTO:
+     return lz4;
+   case compression_codec::LZ4HC:
+     return lz4hc;
+  }
+  return false;
+}
+
+void sframe_save_blockwise_parallel(const sframe& sf_source,
+                                    std::string index_file,
+                                    const std::vector<std::string>& column_codecs) {
+  // Unlike sframe_save_blockwise, which interleaves all columns into a 
+  // single segment in row order, columns and output segments are copied
+  // concurrently.
+  // Blocks cannot be split without decoding them, so each block goes to 
+  // the output segment containing its first row, were the rows split evenly
+  // across segments. All columns thus end up with nearly (to within a
+  // block) the same even segmentation. The blocks of a column going to one
+  // output segment must be written in order, so each (column, output
+  // segment) pair is copied by a single thread, and the pairs are copied
+  // concurrently.
+  auto& block_manager = v2_block_impl::block_manager::get_instance();
+  v2_block_impl::block_writer writer;
+
+  std::string base_name; 
+  size_t last_dot = index_file.find_last_of(".");
+  if (last_dot != std::string::npos) {
+    base_name = index_file.substr(0, last_dot);
+  } else {
+    base_name = index_file;
+  } 
+  auto index = base_name + ".sidx";
+  size_t num_columns = sf_source.num_columns();
+  if (column_codecs.size() > num_columns) {
+    log_and_throw("More column codecs than columns");
+  }
+  size_t num_rows = sf_source.num_rows();
+  size_t num_output_segments = std::max<size_t>(1, SFRAME_DEFAULT_NUM_SEGMENTS);
+  writer.init(index, num_output_segments, num_columns);
+  for (size_t i = 0;i < num_output_segments; ++i) {
+    std::stringstream strm;
+    strm << base_name << ".";
+    strm.fill('0'); strm.width(4);
+    strm << i;
+    writer.open_segment(i, strm.str());
+  }
+
+  std::vector<index_file_information> column_indices(num_columns);
+  for (size_t i = 0;i < num_columns; ++i) {
+    column_indices[i] = sf_source.select_column(i)->get_index_info();
+    writer.get_index_info().columns[i].metadata = column_indices[i].metadata;
+    add_known_column_statistics(column_indices[i],
+                                writer.get_index_info().columns[i].metadata);
+    std::string codec = target_column_codec(column_indices[i], column_codecs, i);
+    if (!codec.empty()) {
+      writer.set_column_compression(
+          i, v2_block_impl::parse_compression_options(codec));
+      writer.get_index_info().columns[i].metadata["__compression__"] = codec;
+    }
+  }
+
+  // the source blocks of each column, by output segment
+  std::vector<std::vector<v2_block_impl::column_address> > 
+      opened_columns(num_columns);
+  std::vector<std::vector<std::vector<v2_block_impl::block_address> > > 
+      blocks(num_columns, 
+             std::vector<std::vector<v2_block_impl::block_address> >(num_output_segments));
+  atomic<size_t> raw_blocks, recompressed_blocks;
+  try {
+    parallel_for(0, num_columns, [&](size_t i) {
+      size_t next_row = 0;
+      for (const auto& segment_file: column_indices[i].segment_files) {
+        auto column_address = block_manager.open_column(segment_file);
+        opened_columns[i].push_back(column_address);
+        size_t num_blocks = block_manager.num_blocks_in_column(column_address);
+        for (size_t j = 0; j < num_blocks; ++j) {
+          v2_block_impl::block_address block_address
+                          {std::get<0>(column_address),
+                           std::get<1>(column_address),
+                           j};
+          size_t output_segment = num_rows == 0 ? 0 : 
+              std::min(next_row * num_output_segments / num_rows, 
+                       num_output_segments - 1);
+          blocks[i][output_segment].push_back(block_address);
+          next_row += block_manager.get_block_info(block_address).num_elem;
+        }
+      }
+    });
+
+    // consecutive pairs go to the same output segment, so that each thread
+    // mostly writes to its own segments.
+    parallel_for(0, num_columns * num_output_segments, [&](size_t pair) {
+      size_t i = pair % num_columns;
+      size_t output_segment = pair / num_columns;
+      auto options = writer.get_column_compression(i);
+      for (const auto& block_address: blocks[i][output_segment]) {
+        v2_block_impl::block_info* infoptr = nullptr;
+        std::shared_ptr<std::vector<char> > data;
+        bool copy_raw = 
+            can_copy_raw_block(block_manager.get_block_info(block_address), options);
+        if (copy_raw) {
+          data = block_manager.read_raw_block(block_address, &infoptr);
+        } else {
+          data = block_manager.read_block(block_address, &infoptr);
+        }
+        if (!data) log_and_throw("Unexpected block read failure. Bad file?");
+        if (copy_raw) {
+          writer.write_raw_block(output_segment, i, data->data(), *infoptr);
+          raw_blocks.inc();
+        } else {
+          writer.write_block(output_segment, i, data->data(), *infoptr);
+          recompressed_blocks.inc();
+        }
+      }
+    });
+  } catch (...) {
+    for (const auto& columns: opened_columns) {
+      for (const auto& column_address: columns) {
+        try {
+          block_manager.close_column(column_address);
+        } catch (...) { }
+      }
+    }
+    throw;
+  }
+  for (const auto& columns: opened_columns) {
+    for (const auto& column_address: columns) {
+      block_manager.close_column(column_address);
+    }
+  }
+  logstream(LOG_INFO) << "Saved " << num_columns << " columns into " 
+                      << num_output_segments << " segments. " 
+                      << raw_blocks.value << " blocks copied, "
+                      << recompressed_blocks.value << " blocks recompressed"
+                      << std::endl;
+
+  // close writers.
+  for (size_t i = 0;i < num_output_segments; ++i) {
+    writer.close_segment(i);
+  }
+  writer.write_index_file();
+  auto output_index = writer.get_index_info();
+
+  // write the frame index, referencing the new columns
+  auto frame_index = sf_source.get_index_info();
+  frame_index.column_files.clear();
+  for (auto col : output_index.columns) {
+    frame_index.column_files.push_back(col.index_file);
+  }
+  write_sframe_index_file(index_file, frame_index);
+}
+
 void sframe_save(const sframe& sf_source,
-                 std::string index_file) {
+                 std::string index_file,
+                 const std::vector<std::string>& column_codecs) {
   // if there are any columns on sarray v1 format, we use the naive form
   bool has_legacy_sframe = false;
   for (size_t i = 0;i < sf_source.num_columns(); ++i) {
@@ -213,9 +410,9 @@ void sframe_save(const sframe& sf_source,
   }
 
   if (has_legacy_sframe) {
-    sframe_save_naive(sf_source, index_file); 
+    sframe_save_naive(sf_source, index_file, column_codecs); 
   } else {
-    sframe_save_blockwise(sf_source, index_file);
+    sframe_save_blockwise_parallel(sf_source, index_file, column_codecs);
   }
 }
 
@@ -399,4 +596,256 @@ void sframe_save_weak_reference(const sframe& sf_source,
   
 }
 
+/**
+ * Reads the array group holding the columns of a frame saved with
+ * sframe_save, i.e. where column i of the frame is column i of a single 
+ * v2 array group. Throws if the frame is not in that layout.
+ */
+static group_index_file_information 
+read_saved_frame_group(const sframe_index_file_information& frame_index) {
+  if (frame_index.ncolumns == 0) {
+    log_and_throw("Cannot update a saved SFrame with no columns");
+  }
+  std::string group_file = 
+      parse_v2_segment_filename(frame_index.column_files[0]).first;
+  for (size_t i = 0;i < frame_index.ncolumns; ++i) {
+    auto column = parse_v2_segment_filename(frame_index.column_files[i]);
+    if (column.first != group_file || column.second != i) {
+      log_and_throw(std::string("SFrame at ") + frame_index.file_name + 
+                    " does not store its columns in a single group. "
+                    "Save it with sframe_save before updating it in place.");
+    }
+  }
+  auto group = read_array_group_index_file(group_file);
+  if (group.version != 2 || group.columns.size() != frame_index.ncolumns) {
+    log_and_throw(std::string("SFrame at ") + frame_index.file_name + 
+                  " is not in the v2 format. "
+                  "Save it with sframe_save before updating it in place.");
+  }
+  return group;
+}
+
+/**
+ * Replaces a frame index file. On the local filesystem the new index is 
+ * written next to the old one and renamed over it, so that readers see 
+ * either the old or the new index, never a partial one.
+ */
+static void commit_sframe_index_file(std::string index_file,
+                                     const sframe_index_file_information& info) {
+  if (fileio::get_protocol(index_file) != "") {
+    write_sframe_index_file(index_file, info);
+    return;
+  }
+  auto suffix = boost::lexical_cast<std::string>(boost::uuids::random_generator()());
+  std::string temp_index_file = index_file + "." + suffix + ".tmp";
+  write_sframe_index_file(temp_index_file, info);
+  try {
+    boost::filesystem::rename(temp_index_file, index_file);
+  } catch (...) {
+    fileio::delete_path(temp_index_file);
+    log_and_throw_io_failure(std::string("Unable to replace index file ") + index_file);
+  }
+}
+
+/**
+ * Rebuilds the per column index information of a group after its 
+ * segment list has been changed.
+ */
+static void update_group_columns(group_index_file_information& group) {
+  for (size_t i = 0;i < group.columns.size(); ++i) {
+    auto& column = group.columns[i];
+    column.index_file = group.group_index_file + ":" + std::to_string(i);
+    column.nsegments = group.nsegments;
+    column.segment_files.clear();
+    for (const auto& segment_file: group.segment_files) {
+      column.segment_files.push_back(segment_file + ":" + std::to_string(i));
+    }
+    ASSERT_EQ(column.segment_sizes.size(), group.nsegments);
+  }
+}
+
+static std::string index_file_base_name(const std::string& index_file) {
+  size_t last_dot = index_file.find_last_of(".");
+  if (last_dot != std::string::npos) {
+    return index_file.substr(0, last_dot);
+  } else {
+    return index_file;
+  } 
+}
+
+void sframe_append_saved(const sframe& sf_source,
+                         std::string index_file) {
+  auto frame_index = read_sframe_index_file(index_file);
+  auto group = read_saved_frame_group(frame_index);
+  {
+    sframe existing(frame_index);
+    if (existing.column_names() != sf_source.column_names() ||
+        existing.column_types() != sf_source.column_types()) {
+      log_and_throw(std::string("Cannot append to the SFrame at ") + index_file + 
+                    ": column names and types do not match");
+    }
+  }
+  if (sf_source.num_rows() == 0) return;
+
+  // write the new rows as a frame of their own, next to the index file
+  std::string base_name = index_file_base_name(index_file);
+  auto suffix = boost::lexical_cast<std::string>(boost::uuids::random_generator()());
+  std::string append_index_file = base_name + "-append-" + suffix + ".frame_idx";
+  sframe_save(sf_source, append_index_file);
+  auto append_frame_index = read_sframe_index_file(append_index_file);
+  auto append_group = read_saved_frame_group(append_frame_index);
+
+  // and splice its non-empty segments onto the end of the existing group
+  size_t num_appended_segments = 0;
+  for (size_t j = 0;j < append_group.nsegments; ++j) {
+    bool empty = std::all_of(append_group.columns.begin(), 
+                             append_group.columns.end(),
+                             [&](const index_file_information& column) {
+                               return column.segment_sizes[j] == 0;
+                             });
+    if (empty) {
+      fileio::delete_path(append_group.segment_files[j]);
+      continue;
+    }
+    group.segment_files.push_back(append_group.segment_files[j]);
+    for (size_t i = 0;i < group.columns.size(); ++i) {
+      group.columns[i].segment_sizes.push_back(append_group.columns[i].segment_sizes[j]);
+    }
+    ++num_appended_segments;
+  }
+  group.nsegments = group.segment_files.size();
+  group.group_index_file = base_name + "-" + suffix + ".sidx";
+  update_group_columns(group);
+  write_array_group_index_file(group.group_index_file, group);
+
+  frame_index.nrows += sf_source.num_rows();
+  for (size_t i = 0;i < frame_index.ncolumns; ++i) {
+    frame_index.column_files[i] = group.group_index_file + ":" + std::to_string(i);
+  }
+  commit_sframe_index_file(index_file, frame_index);
+
+  // the temporary frame and group index files are no longer referenced.
+  fileio::delete_path(append_index_file);
+  fileio::delete_path(append_group.group_index_file);
+  logstream(LOG_INFO) << "Appended " << sf_source.num_rows() << " rows in " 
+                      << num_appended_segments << " segments to " 
+                      << index_file << std::endl;
+}
+
+size_t sframe_compact_saved(std::string index_file) {
+  auto frame_index = read_sframe_index_file(index_file);
+  auto group = read_saved_frame_group(frame_index);
+  size_t num_columns = group.columns.size();
+  size_t num_segments = group.nsegments;
+
+  // The columns of a saved frame are segmented the same way, to within a
+  // block, so segments are sized by their first column.
+  auto segment_rows = [&](size_t j) { return group.columns[0].segment_sizes[j]; };
+  size_t num_target_segments = std::max<size_t>(1, SFRAME_DEFAULT_NUM_SEGMENTS);
+  size_t target_rows = std::max<size_t>(
+      1, (frame_index.nrows + num_target_segments - 1) / num_target_segments);
+
+  // split the segments into runs [begin, end). Large segments are a run 
+  // by themselves, and adjacent small segments are grouped until they 
+  // reach the target size.
+  std::vector<std::pair<size_t, size_t> > runs;
+  std::vector<size_t> merged_runs;
+  for (size_t begin = 0; begin < num_segments; ) {
+    size_t end = begin + 1;
+    size_t rows = segment_rows(begin);
+    while (rows < target_rows && end < num_segments && 
+           segment_rows(end) < target_rows) {
+      rows += segment_rows(end);
+      ++end;
+    }
+    if (end - begin > 1) merged_runs.push_back(runs.size());
+    runs.push_back({begin, end});
+    begin = end;
+  }
+  if (merged_runs.empty()) return num_segments;
+
+  // write each merged run as a new segment, copying blocks as stored.
+  auto& block_manager = v2_block_impl::block_manager::get_instance();
+  v2_block_impl::block_writer writer;
+  std::string base_name = index_file_base_name(index_file);
+  auto suffix = boost::lexical_cast<std::string>(boost::uuids::random_generator()());
+  std::string group_index_file = base_name + "-" + suffix + ".sidx";
+  writer.init(group_index_file, merged_runs.size(), num_columns);
+  for (size_t k = 0;k < merged_runs.size(); ++k) {
+    std::stringstream strm;
+    strm << base_name << "-" << suffix << ".";
+    strm.fill('0'); strm.width(4);
+    strm << k;
+    writer.open_segment(k, strm.str());
+  }
+
+  parallel_for(0, merged_runs.size() * num_columns, [&](size_t task) {
+    size_t k = task / num_columns;
+    size_t column = task % num_columns;
+    const auto& run = runs[merged_runs[k]];
+    for (size_t j = run.first; j < run.second; ++j) {
+      auto column_address = 
+          block_manager.open_column(group.columns[column].segment_files[j]);
+      try {
+        size_t num_blocks = block_manager.num_blocks_in_column(column_address);
+        for (size_t b = 0; b < num_blocks; ++b) {
+          v2_block_impl::block_address block_address
+                          {std::get<0>(column_address),
+                           std::get<1>(column_address),
+                           b};
+          v2_block_impl::block_info* infoptr = nullptr;
+          auto data = block_manager.read_raw_block(block_address, &infoptr);
+          if (!data) log_and_throw("Unexpected block read failure. Bad file?");
+          writer.write_raw_block(k, column, data->data(), *infoptr);
+        }
+      } catch (...) {
+        try {
+          block_manager.close_column(column_address);
+        } catch (...) { }
+        throw;
+      }
+      block_manager.close_column(column_address);
+    }
+  });
+  for (size_t k = 0;k < merged_runs.size(); ++k) {
+    writer.close_segment(k);
+  }
+  const auto& written = writer.get_index_info();
+
+  // build the new group: untouched segments are referenced as they are.
+  group_index_file_information compacted = group;
+  compacted.group_index_file = group_index_file;
+  compacted.segment_files.clear();
+  for (auto& column: compacted.columns) column.segment_sizes.clear();
+  size_t k = 0;
+  for (size_t r = 0;r < runs.size(); ++r) {
+    if (k < merged_runs.size() && merged_runs[k] == r) {
+      compacted.segment_files.push_back(written.segment_files[k]);
+      for (size_t i = 0;i < num_columns; ++i) {
+        compacted.columns[i].segment_sizes.push_back(
+            written.columns[i].segment_sizes[k]);
+      }
+      ++k;
+    } else {
+      compacted.segment_files.push_back(group.segment_files[runs[r].first]);
+      for (size_t i = 0;i < num_columns; ++i) {
+        compacted.columns[i].segment_sizes.push_back(
+            group.columns[i].segment_sizes[runs[r].first]);
+      }
+    }
+  }
+  compacted.nsegments = compacted.segment_files.size();
+  update_group_columns(compacted);
+  write_array_group_index_file(group_index_file, compacted);
+
+  for (size_t i = 0;i < frame_index.ncolumns; ++i) {
+    frame_index.column_files[i] = group_index_file + ":" + std::to_string(i);
+  }
+  commit_sframe_index_file(index_file, frame_index);
+  logstream(LOG_INFO) << "Compacted " << index_file << " from " 
+                      << num_segments << " to " << compacted.nsegments 
+                      << " segments" << std::endl;
+  return compacted.nsegments;
+}
+
 }
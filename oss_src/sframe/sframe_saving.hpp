@@ -7,14 +7,21 @@
  */
 #ifndef GRAPHLAB_SFRAME_SAVING_HPP
 #define GRAPHLAB_SFRAME_SAVING_HPP
+#include <string>
+#include <vector>
 namespace graphlab {
 class sframe;
 /**
  * Saves an SFrame to another index file location using the most naive method:
- * decode rows, and write them
+ * decode rows, and write them.
+ *
+ * column_codecs optionally sets the compression codec of each saved column
+ * (see \ref sframe::open_for_write). A column without one keeps the codec
+ * recorded in its metadata.
  */
 void sframe_save_naive(const sframe& sf, 
-                       std::string index_file);
+                       std::string index_file,
+                       const std::vector<std::string>& column_codecs = {});
 
 /**
  * Saves an SFrame to another index file location using a more efficient method,
@@ -24,10 +31,26 @@ void sframe_save_blockwise(const sframe& sf,
                            std::string index_file);
 
 /**
- * Automatically determines the optimal strategy to save an sframe
+ * Saves an SFrame to another index file location block by block, copying
+ * many columns, and the blocks of each column going to different output
+ * segments, concurrently. Blocks are copied
+ * as stored on disk when their compression matches the target column's 
+ * codec, and decompressed and recompressed otherwise. The target codec of a
+ * column is taken from column_codecs, else from its metadata, else it is
+ * SFRAME_DEFAULT_COMPRESSION_CODEC.
+ * All columns must be in the v2 format.
+ */
+void sframe_save_blockwise_parallel(const sframe& sf, 
+                                    std::string index_file,
+                                    const std::vector<std::string>& column_codecs = {});
+
+/**
+ * Automatically determines the optimal strategy to save an sframe.
+ * See \ref sframe_save_blockwise_parallel for column_codecs.
  */
 void sframe_save(const sframe& sf, 
-                 std::string index_file);
+                 std::string index_file,
+                 const std::vector<std::string>& column_codecs = {});
 
 /**
  * Performs an "incomplete save" to a target index file location.
@@ -50,6 +73,43 @@ void sframe_save(const sframe& sf,
 void sframe_save_weak_reference(const sframe& sf,
                                 std::string index_file);
 
+/**
+ * Appends the rows of an SFrame to an SFrame previously saved (with 
+ * \ref sframe_save) at index_file, without rewriting the existing segments.
+ *
+ * The new rows are written into new segment files next to the index file,
+ * and a new array group index listing the existing segments followed by the
+ * new ones is written. The frame index file is replaced last, so until then
+ * readers continue to see the SFrame as it was. The previous array group
+ * index is left in place since weak references (see
+ * \ref sframe_save_weak_reference) may still point to it.
+ *
+ * The column names and types of sf must match the saved SFrame.
+ * Every append adds segments, so frequent small appends should be followed
+ * by an occasional \ref sframe_compact_saved.
+ *
+ * \param sf The rows to append
+ * \param index_file The frame index file of the saved SFrame
+ */
+void sframe_append_saved(const sframe& sf,
+                         std::string index_file);
+
+/**
+ * Merges runs of adjacent small segments of a saved SFrame into larger
+ * segments, leaving the other segments untouched. 
+ *
+ * A segment is small if it holds fewer than 1 / SFRAME_DEFAULT_NUM_SEGMENTS
+ * of the rows. Blocks are copied as stored on disk, without decoding.
+ * Like \ref sframe_append_saved, the frame index file is replaced last.
+ * The files of the merged segments are not deleted, since readers of the
+ * previous version of the SFrame may still be using them.
+ *
+ * Returns the number of segments after compaction.
+ *
+ * \param index_file The frame index file of the saved SFrame
+ */
+size_t sframe_compact_saved(std::string index_file);
+
 }; // naemspace graphlab
 
 #endif
@@ -0,0 +1,321 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <boost/filesystem.hpp>
+#include <logger/assertions.hpp>
+#include <parallel/atomic.hpp>
+#include <parallel/pthread_tools.hpp>
+#include <fileio/temp_files.hpp>
+#include <sframe/sarray_index_file.hpp>
+#include <sframe/spill_partitions.hpp>
+
+namespace graphlab {
+
+/**************************************************************************/
+/*                                                                        */
+/*                              spill_reader                              */
+/*                                                                        */
+/**************************************************************************/
+
+spill_reader::spill_reader(std::shared_ptr<sframe::reader_type> reader,
+                           size_t row_start, size_t row_end,
+                           size_t buffer_size)
+    : spill_reader(std::vector<range>{range{
+          reader, row_start,
+          std::max(row_start, std::min(row_end, reader->size()))}},
+        buffer_size) { }
+
+spill_reader::spill_reader(std::vector<range> ranges, size_t buffer_size)
+    : m_ranges(std::move(ranges)),
+      m_buffer_size(std::max<size_t>(buffer_size, 1)) {
+  for (const auto& r: m_ranges) m_size += r.end - r.begin;
+  prefetch();
+}
+
+/**
+ * The number of buffers being read in the background. A merge reads from
+ * many spill_readers at once: the buffers past cpu_count() are read when
+ * they are needed instead.
+ */
+static atomic<size_t> num_background_reads;
+
+void spill_reader::prefetch() {
+  while (m_range < m_ranges.size() &&
+         m_ranges[m_range].begin >= m_ranges[m_range].end) {
+    ++m_range;
+  }
+  if (m_range == m_ranges.size()) return;
+  // a buffer is read from a single range
+  auto& r = m_ranges[m_range];
+  size_t row_start = r.begin;
+  size_t row_end = std::min(r.end, r.begin + m_buffer_size);
+  auto reader = r.reader;
+  if (num_background_reads.inc() <= thread::cpu_count()) {
+    m_next_buffer = std::async(std::launch::async,
+                               [reader, row_start, row_end]() {
+                                 std::vector<std::vector<flexible_type>> rows;
+                                 try {
+                                   reader->read_rows(row_start, row_end, rows);
+                                 } catch (...) {
+                                   num_background_reads.dec();
+                                   throw;
+                                 }
+                                 num_background_reads.dec();
+                                 return rows;
+                               });
+  } else {
+    num_background_reads.dec();
+    m_next_buffer = std::async(std::launch::deferred,
+                               [reader, row_start, row_end]() {
+                                 std::vector<std::vector<flexible_type>> rows;
+                                 reader->read_rows(row_start, row_end, rows);
+                                 return rows;
+                               });
+  }
+  r.begin = row_end;
+}
+
+std::vector<flexible_type>& spill_reader::next() {
+  DASSERT_LT(m_iter, m_size);
+  if (m_buffer_pos == m_buffer.size()) {
+    m_buffer = m_next_buffer.get();
+    m_buffer_pos = 0;
+    prefetch();
+  }
+  DASSERT_LT(m_buffer_pos, m_buffer.size());
+  ++m_iter;
+  return m_buffer[m_buffer_pos++];
+}
+
+/**************************************************************************/
+/*                                                                        */
+/*                            spill_partitions                            */
+/*                                                                        */
+/**************************************************************************/
+
+/**
+ * The memory budget a partition takes from the session at once, so that
+ * the writers rarely contend on the session.
+ */
+static const size_t MEMORY_RESERVATION_SIZE = 64 * 1024;
+
+spill_partitions::spill_partitions(spill_session& session,
+                                   const std::vector<flex_type_enum>& column_types,
+                                   size_t num_partitions)
+    : m_session(session), m_column_types(column_types),
+      m_num_partitions(num_partitions), m_writers(num_partitions) {
+  ASSERT_GT(num_partitions, 0);
+  ASSERT_GT(column_types.size(), 0);
+  if (m_session.memory_budget() == 0) {
+    for (auto& w: m_writers) w.on_disk = true;
+    return;
+  }
+  // names are generated
+  std::vector<std::string> column_names(column_types.size());
+  m_memory_run.frame.open_for_write(column_names, column_types, "", num_partitions);
+  for (size_t i = 0; i < num_partitions; ++i) {
+    m_writers[i].memory_iter = m_memory_run.frame.get_output_iterator(i);
+  }
+}
+
+void spill_partitions::discard_run(run& r) {
+  r.reader.reset();
+  // the runs of a spill which failed are written no further
+  if (r.frame.is_opened_for_write()) {
+    try { r.frame.close(); } catch (...) { }
+  }
+  if (r.frame.is_opened_for_read()) r.frame.delete_files_on_destruction();
+  r.frame = sframe();
+}
+
+spill_partitions::~spill_partitions() {
+  discard_run(m_memory_run);
+  m_session.release_memory(m_memory_reserved.value);
+  for (auto& r: m_runs) {
+    discard_run(r);
+    spill_manager::get_instance().release_run(r.directory, r.bytes);
+  }
+}
+
+void spill_partitions::open_disk_runs() {
+  std::lock_guard<mutex> guard(m_disk_runs_lock);
+  if (!m_runs.empty()) return;
+  size_t num_runs = std::min(m_num_partitions,
+                             std::max<size_t>(num_temp_directories(), 1));
+  std::vector<std::string> column_names(m_column_types.size());
+  std::vector<run> runs;
+  try {
+    for (size_t i = 0; i < num_runs; ++i) {
+      run r;
+      r.directory = m_session.open_run();
+      runs.push_back(r);
+      // partitions i, i + num_runs, i + 2 * num_runs... go to the run i
+      size_t num_segments = (m_num_partitions - i + num_runs - 1) / num_runs;
+      std::string name = spill_manager::get_instance().get_run_name(r.directory);
+      runs.back().frame.open_for_write(column_names, m_column_types,
+                                       name + ".frame_idx", num_segments);
+    }
+  } catch (...) {
+    for (auto& opened: runs) {
+      discard_run(opened);
+      spill_manager::get_instance().release_run(opened.directory, 0);
+    }
+    throw;
+  }
+  m_runs = std::move(runs);
+}
+
+std::pair<size_t, size_t> spill_partitions::locate(size_t partition) const {
+  ASSERT_LT(partition, m_num_partitions);
+  return {partition % m_runs.size(), partition / m_runs.size()};
+}
+
+void spill_partitions::write(size_t partition,
+                             const std::vector<flexible_type>& row,
+                             size_t bytes) {
+  DASSERT_FALSE(m_closed);
+  DASSERT_LT(partition, m_num_partitions);
+  auto& w = m_writers[partition];
+  if (!w.on_disk && w.reserved < bytes) {
+    size_t reservation = std::max(bytes, MEMORY_RESERVATION_SIZE);
+    if (m_session.reserve_memory(reservation)) {
+      w.reserved += reservation;
+      m_memory_reserved.inc(reservation);
+    } else {
+      w.on_disk = true;
+    }
+  }
+  if (!w.on_disk) {
+    w.reserved -= bytes;
+    *w.memory_iter = row;
+    ++w.memory_iter;
+    return;
+  }
+  if (!w.disk_opened) {
+    open_disk_runs();
+    auto location = locate(partition);
+    w.disk_iter = m_runs[location.first].frame.get_output_iterator(location.second);
+    w.disk_opened = true;
+  }
+  *w.disk_iter = row;
+  ++w.disk_iter;
+}
+
+size_t spill_partitions::run_bytes(const sframe& frame) {
+  // all the columns are in the same segment files
+  std::set<std::string> files;
+  auto index_info = frame.select_column(0)->get_index_info();
+  for (const auto& file: index_info.segment_files) {
+    files.insert(parse_v2_segment_filename(file).first);
+  }
+  size_t ret = 0;
+  for (const auto& file: files) {
+    boost::system::error_code ec;
+    size_t size = boost::filesystem::file_size(file, ec);
+    if (!ec) ret += size;
+  }
+  return ret;
+}
+
+void spill_partitions::finish_run(run& r) {
+  r.frame.close();
+  r.frame.delete_files_on_destruction();
+  r.reader = r.frame.get_reader();
+  r.segment_offsets.resize(r.frame.num_segments() + 1, 0);
+  for (size_t i = 0; i < r.frame.num_segments(); ++i) {
+    r.segment_offsets[i + 1] = r.segment_offsets[i] + r.frame.segment_length(i);
+  }
+}
+
+void spill_partitions::close() {
+  ASSERT_FALSE(m_closed);
+  if (m_memory_run.frame.is_opened_for_write()) finish_run(m_memory_run);
+  // the budget taken and not used is returned
+  for (auto& w: m_writers) {
+    m_session.release_memory(w.reserved);
+    m_memory_reserved.dec(w.reserved);
+    w.reserved = 0;
+  }
+  for (auto& r: m_runs) {
+    finish_run(r);
+    r.bytes = run_bytes(r.frame);
+    m_session.close_run(r.directory, r.bytes);
+  }
+  m_closed = true;
+}
+
+std::vector<spill_reader::range>
+spill_partitions::partition_ranges(size_t partition) const {
+  ASSERT_TRUE(m_closed);
+  ASSERT_LT(partition, m_num_partitions);
+  std::vector<spill_reader::range> ret;
+  if (m_memory_run.reader) {
+    const auto& offsets = m_memory_run.segment_offsets;
+    ret.push_back({m_memory_run.reader, offsets[partition], offsets[partition + 1]});
+  }
+  if (!m_runs.empty()) {
+    auto location = locate(partition);
+    const auto& r = m_runs[location.first];
+    ret.push_back({r.reader,
+                   r.segment_offsets[location.second],
+                   r.segment_offsets[location.second + 1]});
+  }
+  return ret;
+}
+
+size_t spill_partitions::partition_length(size_t partition) const {
+  size_t ret = 0;
+  for (const auto& r: partition_ranges(partition)) ret += r.end - r.begin;
+  return ret;
+}
+
+size_t spill_partitions::size() const {
+  ASSERT_TRUE(m_closed);
+  size_t ret = 0;
+  if (m_memory_run.reader) ret += m_memory_run.segment_offsets.back();
+  for (const auto& r: m_runs) ret += r.segment_offsets.back();
+  return ret;
+}
+
+spill_reader spill_partitions::get_reader(size_t partition,
+                                          size_t row_start,
+                                          size_t row_end,
+                                          size_t buffer_size) const {
+  // clip the ranges to [row_start, row_end) of their concatenation
+  std::vector<spill_reader::range> ranges;
+  size_t offset = 0;
+  for (const auto& r: partition_ranges(partition)) {
+    size_t length = r.end - r.begin;
+    size_t begin = std::max(row_start, offset);
+    size_t end = std::min(row_end, offset + length);
+    if (begin < end) {
+      ranges.push_back({r.reader, r.begin + (begin - offset), r.begin + (end - offset)});
+    }
+    offset += length;
+  }
+  return spill_reader(std::move(ranges), buffer_size);
+}
+
+void spill_partitions::read_partition(size_t partition,
+                                      std::vector<std::vector<flexible_type>>& rows) const {
+  rows.clear();
+  std::vector<std::vector<flexible_type>> part;
+  for (const auto& r: partition_ranges(partition)) {
+    if (r.begin == r.end) continue;
+    r.reader->read_rows(r.begin, r.end, part);
+    if (rows.empty()) {
+      rows.swap(part);
+    } else {
+      std::move(part.begin(), part.end(), std::back_inserter(rows));
+    }
+  }
+}
+
+} // namespace graphlab
@@ -0,0 +1,206 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_SPILL_PARTITIONS_HPP
+#define GRAPHLAB_SFRAME_SPILL_PARTITIONS_HPP
+#include <future>
+#include <memory>
+#include <vector>
+#include <parallel/mutex.hpp>
+#include <parallel/atomic.hpp>
+#include <flexible_type/flexible_type.hpp>
+#include <fileio/spill_manager.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_constants.hpp>
+
+namespace graphlab {
+
+/**
+ * A buffered reader reading ranges of rows of sframes one after the other,
+ * which reads the next buffer of rows (SFRAME_SPILL_READ_BUFFER_SIZE by
+ * default) in the background while the current one is consumed.
+ *
+ * \code
+ * spill_reader reader = partitions.get_reader(i);
+ * while(reader.has_next()) {
+ *   std::vector<flexible_type>& row = reader.next();
+ *   ... the row may be moved from ...
+ * }
+ * \endcode
+ *
+ * The sframes read must outlive the spill_reader.
+ */
+class spill_reader {
+ public:
+  /// The rows [begin, end) of an sframe
+  struct range {
+    std::shared_ptr<sframe::reader_type> reader;
+    size_t begin;
+    size_t end;
+  };
+
+  spill_reader() = default;
+
+  spill_reader(std::shared_ptr<sframe::reader_type> reader,
+               size_t row_start, size_t row_end,
+               size_t buffer_size = SFRAME_SPILL_READ_BUFFER_SIZE);
+
+  /// Reads the ranges in order
+  spill_reader(std::vector<range> ranges,
+               size_t buffer_size = SFRAME_SPILL_READ_BUFFER_SIZE);
+
+  spill_reader(spill_reader&&) = default;
+  spill_reader& operator=(spill_reader&&) = default;
+
+  /// Return true if the reader has more rows
+  bool has_next() const { return m_iter < m_size; }
+
+  /// Returns the next row
+  std::vector<flexible_type>& next();
+
+  /// The number of rows of the ranges
+  size_t size() const { return m_size; }
+
+ private:
+  /// Starts reading the next buffer, if any row is left
+  void prefetch();
+
+  /// The rows not read yet: the ranges from m_range on
+  std::vector<range> m_ranges;
+  size_t m_range = 0;
+  std::vector<std::vector<flexible_type>> m_buffer;
+  std::future<std::vector<std::vector<flexible_type>>> m_next_buffer;
+  size_t m_buffer_pos = 0;
+  size_t m_buffer_size = 0;
+  size_t m_size = 0;
+  /// The number of rows returned
+  size_t m_iter = 0;
+};
+
+/**
+ * The rows a memory intensive operator (a groupby, a join or a sort)
+ * spills to temp storage, in num_partitions partitions.
+ *
+ * The rows are written with their column types: a spill is compressed by
+ * the typed block encoding of the sframe, as any sframe is, rather than
+ * serialized. The partitions are stored in runs, sframes holding the
+ * partitions as their segments.
+ *
+ * The rows are first written to a run in memory (cache://), as long as
+ * they fit in the memory budget of the spill_session. The rows which do
+ * not fit are written to runs written directly to the temp directories.
+ * There is one such run per temp directory (or per partition, if there are
+ * fewer partitions), each holding a stripe of the partitions, and the
+ * \ref spill_manager places each run on a different directory: the I/O of
+ * a spill is spread over all the temp disks. A partition is read as its
+ * rows in memory followed by its rows on disk, in the order written.
+ *
+ * Every run on disk is accounted to the spill_session on \ref close. The
+ * files are deleted, and the memory budget returned, when the object is
+ * destroyed.
+ *
+ * Like an sframe, a partition must be written to by one thread at a time.
+ */
+class spill_partitions {
+ public:
+  spill_partitions(spill_session& session,
+                   const std::vector<flex_type_enum>& column_types,
+                   size_t num_partitions);
+
+  ~spill_partitions();
+
+  spill_partitions(const spill_partitions&) = delete;
+  spill_partitions& operator=(const spill_partitions&) = delete;
+
+  size_t num_partitions() const { return m_num_partitions; }
+
+  size_t num_columns() const { return m_column_types.size(); }
+
+  const std::vector<flex_type_enum>& column_types() const { return m_column_types; }
+
+  /**
+   * Writes a row to a partition. bytes estimates the memory the row takes,
+   * charged to the memory budget of the session if the row is kept in
+   * memory.
+   */
+  void write(size_t partition, const std::vector<flexible_type>& row, size_t bytes);
+
+  /// Finishes writing all the partitions, which can then be read
+  void close();
+
+  /// The number of rows of a partition
+  size_t partition_length(size_t partition) const;
+
+  /// The number of rows of all the partitions
+  size_t size() const;
+
+  /**
+   * Returns a prefetching reader of the rows [row_start, row_end) of a
+   * partition, reading buffer_size rows at once. The reader must not
+   * outlive this object.
+   */
+  spill_reader get_reader(size_t partition,
+                          size_t row_start = 0,
+                          size_t row_end = (size_t)(-1),
+                          size_t buffer_size = SFRAME_SPILL_READ_BUFFER_SIZE) const;
+
+  /// Reads all the rows of a partition
+  void read_partition(size_t partition,
+                      std::vector<std::vector<flexible_type>>& rows) const;
+
+ private:
+  struct run {
+    size_t directory = 0;
+    size_t bytes = 0;
+    sframe frame;
+    std::shared_ptr<sframe::reader_type> reader;
+    /// The first row of each segment, and the number of rows
+    std::vector<size_t> segment_offsets;
+  };
+
+  struct partition_writer {
+    sframe::iterator memory_iter;
+    sframe::iterator disk_iter;
+    /// Set once a row did not fit in memory. The later rows go to disk.
+    bool on_disk = false;
+    bool disk_opened = false;
+    /// The memory budget taken and not used yet
+    size_t reserved = 0;
+  };
+
+  /// Opens the runs on disk, on the first row which does not fit in memory
+  void open_disk_runs();
+
+  /// Reads the segment offsets of a run written, and opens its reader
+  static void finish_run(run& r);
+
+  /// Closes and deletes a run, if it was opened
+  static void discard_run(run& r);
+
+  /// The run on disk of a partition, and its segment in the run
+  std::pair<size_t, size_t> locate(size_t partition) const;
+
+  /// The rows of a partition: in memory, then on disk
+  std::vector<spill_reader::range> partition_ranges(size_t partition) const;
+
+  /// Returns the total size of the files of a run
+  static size_t run_bytes(const sframe& frame);
+
+  spill_session& m_session;
+  std::vector<flex_type_enum> m_column_types;
+  size_t m_num_partitions;
+  std::vector<partition_writer> m_writers;
+  run m_memory_run;
+  /// The memory budget taken from the session
+  atomic<size_t> m_memory_reserved;
+  std::vector<run> m_runs;
+  mutex m_disk_runs_lock;
+  bool m_closed = false;
+};
+
+} // namespace graphlab
+#endif
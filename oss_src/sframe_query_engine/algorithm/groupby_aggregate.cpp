@@ -13,15 +13,55 @@
 #include <sframe_query_engine/planning/planner.hpp>
 #include <sframe_query_engine/operators/operator_properties.hpp>
 #include <sframe_query_engine/operators/project.hpp>
+#include <sframe_query_engine/operators/sframe_source.hpp>
+#include <sframe_query_engine/operators/sarray_source.hpp>
 #include <sframe_query_engine/algorithm/groupby_aggregate.hpp>
 #include <sframe/group_aggregate_value.hpp>
 #include <sframe/groupby_aggregate_impl.hpp>
 #include <sframe/sframe_config.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <sframe/column_statistics.hpp>
 #include <sframe/groupby_aggregate.hpp>
 
 namespace graphlab {
 namespace query_eval {
 
+/**
+ * Returns the stored sarray a column of the output of a plan reads, if the
+ * plan just selects columns of stored sarrays or sframes. Returns nullptr
+ * otherwise.
+ */
+static std::shared_ptr<sarray<flexible_type>> find_source_column(
+    const std::shared_ptr<planner_node>& node, size_t column) {
+  switch (node->operator_type) {
+    case planner_node_type::PROJECT_NODE: {
+      auto indices = node->operator_parameters.at("indices").get<flex_list>();
+      if (column >= indices.size()) return nullptr;
+      return find_source_column(node->inputs[0], indices[column].get<flex_int>());
+    }
+    case planner_node_type::SFRAME_SOURCE_NODE: {
+      auto sf = node->any_operator_parameters.at("sframe").as<sframe>();
+      if (node->operator_parameters.at("begin_index").get<flex_int>() != 0 ||
+          (size_t)node->operator_parameters.at("end_index").get<flex_int>() != sf.size()) {
+        return nullptr;
+      }
+      return sf.select_column(column);
+    }
+    case planner_node_type::SARRAY_SOURCE_NODE: {
+      auto sa = node->any_operator_parameters.at("sarray")
+          .as<std::shared_ptr<sarray<flexible_type>>>();
+      if (column != 0 ||
+          node->operator_parameters.at("begin_index").get<flex_int>() != 0 ||
+          (size_t)node->operator_parameters.at("end_index").get<flex_int>() != sa->size()) {
+        return nullptr;
+      }
+      return sa;
+    }
+    default:
+      return nullptr;
+  }
+}
+
 std::shared_ptr<sframe> 
     groupby_aggregate(
       const std::shared_ptr<planner_node>& source,
@@ -30,6 +70,8 @@ std::shared_ptr<sframe>
       const std::vector<std::string>& output_column_names,
       const std::vector<std::pair<std::vector<std::string>,
                                   std::shared_ptr<group_aggregate_value>>>& groups) {
+  // the spills of the group container are counted on the query
+  running_query_scope query_scope("groupby");
   // first, sanity checks
   // check that group keys exist
   if (output_column_names.size() != groups.size()) {
@@ -176,22 +218,67 @@ std::shared_ptr<sframe>
     column_types.push_back(output_type);
   }
 
+  // If the key is a column known to be stored sorted, the groups are
+  // contiguous in the input and can be aggregated in a single streaming
+  // pass, without hashing or spilling. Only statistics already known are
+  // used: the key column is not scanned just to find out.
+  bool sorted_input = false;
+  if (SFRAME_COST_BASED_OPTIMIZATION && keys.size() == 1) {
+    auto key_column = find_source_column(source, source_column_to_index.at(keys[0]));
+    column_statistics stats;
+    if (key_column != nullptr && find_column_statistics(key_column, stats)) {
+      logstream(LOG_INFO) << "Estimated number of groups: "
+                          << estimate_num_groups(stats) << std::endl;
+      sorted_input = stats.sorted;
+    }
+  }
+
   size_t nsegments = thread::cpu_count() * std::max<size_t>(1, log2(thread::cpu_count()));
+  if (sorted_input) nsegments = thread::cpu_count();
 
   output->open_for_write(column_names,
                          column_types,
                          "",
                          nsegments);
 
-
-  groupby_aggregate_impl::group_aggregate_container
-      container(SFRAME_GROUPBY_BUFFER_NUM_ROWS, nsegments);
-
   // ok the input sframe (frame_with_relevant_cols) contains all the values
   // we care about. However, the challenge here is to figure out how the keys
   // and values line up. By construction, all the key columns come first.
   // which is good. But group columns can be pretty much anywhere.
   size_t num_keys = keys.size();
+
+  if (sorted_input) {
+    logstream(LOG_INFO) << "Aggregating groups of sorted input" << std::endl;
+    timer ti;
+    groupby_aggregate_impl::sorted_group_aggregator aggregator(*output, num_keys);
+    for (const auto& group: groups) {
+      std::vector<size_t> column_numbers;
+      for(auto& col_name : group.first) {
+        column_numbers.push_back(relevant_column_to_index.at(col_name));
+      }
+      aggregator.define_group(column_numbers, group.second);
+    }
+    planner().materialize(frame_with_relevant_cols,
+                          [&](size_t segmentid,
+                              const std::shared_ptr<sframe_rows>& rows)->bool {
+                            if (rows == nullptr) return true;
+                            for (auto& row: *rows) {
+                              aggregator.add(row, segmentid);
+                            }
+                            return false;
+                          },
+                          nsegments);
+    aggregator.finalize();
+    logstream(LOG_INFO) << "Groups aggregated in " << ti.current_time() << std::endl;
+    output->close();
+    return output;
+  }
+
+  groupby_aggregate_impl::group_aggregate_container
+      container(SFRAME_GROUPBY_BUFFER_NUM_ROWS, nsegments,
+                std::vector<flex_type_enum>(column_types.begin(),
+                                            column_types.begin() + keys.size()));
+
   for (const auto& group: groups) {
     std::vector<size_t> column_numbers;
     for(auto& col_name : group.first) {
@@ -200,6 +287,7 @@ std::shared_ptr<sframe>
 
     container.define_group(column_numbers, group.second);
   }
+  container.acquire_memory_grant(relevant_column_to_index.size());
   // done. now we can begin parallel processing
 
   // shuffle the rows based on the value of the key column.
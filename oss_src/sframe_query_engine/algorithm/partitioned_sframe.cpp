@@ -0,0 +1,502 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#define BOOST_SPIRIT_THREADSAFE
+#include <map>
+#include <set>
+#include <cctype>
+#include <algorithm>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/ini_parser.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <boost/lexical_cast.hpp>
+#include <logger/logger.hpp>
+#include <fileio/fs_utils.hpp>
+#include <fileio/general_fstream.hpp>
+#include <ini/boost_property_tree_utils.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/planning/planner.hpp>
+#include <sframe_query_engine/operators/sframe_source.hpp>
+#include <sframe_query_engine/operators/constant.hpp>
+#include <sframe_query_engine/operators/union.hpp>
+#include <sframe_query_engine/operators/project.hpp>
+#include <sframe_query_engine/operators/append.hpp>
+#include <sframe_query_engine/algorithm/sort.hpp>
+#include <sframe_query_engine/algorithm/partitioned_sframe.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+namespace {
+
+const char* MANIFEST_FILE = "partitions.ini";
+const char* NULL_PARTITION = "__HIVE_DEFAULT_PARTITION__";
+const int MANIFEST_VERSION = 1;
+
+/**
+ * Percent encodes every character of a partition value which is not
+ * alphanumeric or one of "-_.", so that any value is a valid, unambiguous
+ * directory name.
+ */
+std::string escape_partition_value(const std::string& s) {
+  static const char* hex = "0123456789ABCDEF";
+  std::string ret;
+  for (unsigned char c: s) {
+    if (std::isalnum(c) || c == '-' || c == '_' || c == '.') {
+      ret.push_back(c);
+    } else {
+      ret.push_back('%');
+      ret.push_back(hex[c >> 4]);
+      ret.push_back(hex[c & 15]);
+    }
+  }
+  // "." and ".." are not usable as directory names
+  if (ret == "." || ret == "..") {
+    ret.replace(0, 1, "%2E");
+  }
+  return ret;
+}
+
+std::string unescape_partition_value(const std::string& s) {
+  std::string ret;
+  for (size_t i = 0; i < s.length(); ++i) {
+    if (s[i] == '%' && i + 2 < s.length()) {
+      ret.push_back((char)std::stoi(s.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    } else {
+      ret.push_back(s[i]);
+    }
+  }
+  return ret;
+}
+
+std::string partition_directory_component(const std::string& column,
+                                          const flexible_type& value) {
+  std::string ret = escape_partition_value(column) + "=";
+  if (value.get_type() == flex_type_enum::UNDEFINED) ret += NULL_PARTITION;
+  else ret += escape_partition_value(value.to<flex_string>());
+  return ret;
+}
+
+/**
+ * Parses the key values out of a partition path
+ * "col1=val1/col2=val2/...".
+ */
+std::vector<flexible_type> parse_partition_path(
+    const std::string& path,
+    const std::vector<std::string>& partition_columns,
+    const std::vector<flex_type_enum>& partition_types) {
+  std::vector<flexible_type> key;
+  size_t pos = 0;
+  for (size_t i = 0; i < partition_columns.size(); ++i) {
+    size_t end = path.find('/', pos);
+    if (end == std::string::npos) end = path.length();
+    std::string component = path.substr(pos, end - pos);
+    size_t eq = component.find('=');
+    if (eq == std::string::npos ||
+        unescape_partition_value(component.substr(0, eq)) != partition_columns[i]) {
+      log_and_throw(std::string("Malformed partition path ") + path);
+    }
+    std::string value = component.substr(eq + 1);
+    if (value == NULL_PARTITION) {
+      key.push_back(FLEX_UNDEFINED);
+    } else if (partition_types[i] == flex_type_enum::INTEGER) {
+      key.push_back(flex_int(std::stoll(value)));
+    } else {
+      key.push_back(flex_string(unescape_partition_value(value)));
+    }
+    pos = end + 1;
+  }
+  return key;
+}
+
+void check_partition_columns(const std::vector<std::string>& column_names,
+                             const std::vector<flex_type_enum>& column_types,
+                             const std::vector<std::string>& partition_columns) {
+  if (partition_columns.empty()) {
+    log_and_throw("At least one partition column is required");
+  }
+  if (partition_columns.size() >= column_names.size()) {
+    log_and_throw("At least one column must not be a partition column");
+  }
+  std::set<std::string> seen;
+  for (const auto& col: partition_columns) {
+    auto iter = std::find(column_names.begin(), column_names.end(), col);
+    if (iter == column_names.end()) {
+      log_and_throw(std::string("Partition column not found: ") + col);
+    }
+    if (!seen.insert(col).second) {
+      log_and_throw(std::string("Duplicate partition column: ") + col);
+    }
+    flex_type_enum type = column_types[iter - column_names.begin()];
+    if (type != flex_type_enum::INTEGER && type != flex_type_enum::STRING) {
+      log_and_throw(std::string("Partition column ") + col +
+                    " must be of integer or string type");
+    }
+  }
+}
+
+/**
+ * Combines nodes[begin, end) with a balanced tree of appends, so that the
+ * depth of the plan grows logarithmically in the number of frames.
+ */
+std::shared_ptr<planner_node> append_all(
+    const std::vector<std::shared_ptr<planner_node> >& nodes,
+    size_t begin, size_t end) {
+  DASSERT_LT(begin, end);
+  if (end - begin == 1) return nodes[begin];
+  size_t mid = begin + (end - begin) / 2;
+  return op_append::make_planner_node(append_all(nodes, begin, mid),
+                                      append_all(nodes, mid, end));
+}
+
+struct manifest {
+  std::vector<std::string> column_names;
+  std::vector<flex_type_enum> column_types;
+  std::vector<std::string> partition_columns;
+  std::vector<std::string> frame_files;
+};
+
+manifest read_manifest(const std::string& directory) {
+  std::string manifest_file = fileio::make_absolute_path(directory, MANIFEST_FILE);
+  general_ifstream fin(manifest_file);
+  if (fin.fail()) {
+    log_and_throw(std::string("Unable to open partition manifest at ") + manifest_file);
+  }
+  boost::property_tree::ptree data;
+  try {
+    boost::property_tree::ini_parser::read_ini(fin, data);
+  } catch(boost::property_tree::ini_parser_error e) {
+    log_and_throw(std::string("Unable to parse partition manifest ") + manifest_file);
+  }
+
+  manifest ret;
+  try {
+    int version = std::atoi(data.get<std::string>("partitioned_sframe.version").c_str());
+    if (version > MANIFEST_VERSION) {
+      log_and_throw(std::string("Unsupported partition manifest version in ") + manifest_file);
+    }
+    size_t ncolumns = std::atol(data.get<std::string>("partitioned_sframe.num_columns").c_str());
+    size_t npartition_columns =
+        std::atol(data.get<std::string>("partitioned_sframe.num_partition_columns").c_str());
+    size_t nfiles = std::atol(data.get<std::string>("partitioned_sframe.num_files").c_str());
+
+    ret.column_names =
+        ini::read_sequence_section<std::string>(data, "column_names", ncolumns);
+    auto types = ini::read_sequence_section<int>(data, "column_types", ncolumns);
+    for (int t: types) ret.column_types.push_back((flex_type_enum)t);
+    ret.partition_columns =
+        ini::read_sequence_section<std::string>(data, "partition_columns", npartition_columns);
+    ret.frame_files =
+        ini::read_sequence_section<std::string>(data, "frame_files", nfiles);
+  } catch(std::string e) {
+    log_and_throw(e);
+  } catch(...) {
+    log_and_throw(std::string("Unable to parse partition manifest ") + manifest_file);
+  }
+  return ret;
+}
+
+void write_manifest(const std::string& directory, const manifest& m) {
+  std::string manifest_file = fileio::make_absolute_path(directory, MANIFEST_FILE);
+  boost::property_tree::ptree data;
+  data.put("partitioned_sframe.version", MANIFEST_VERSION);
+  data.put("partitioned_sframe.num_columns", m.column_names.size());
+  data.put("partitioned_sframe.num_partition_columns", m.partition_columns.size());
+  data.put("partitioned_sframe.num_files", m.frame_files.size());
+  ini::write_sequence_section(data, "column_names", m.column_names);
+  std::vector<int> types;
+  for (auto t: m.column_types) types.push_back((int)t);
+  ini::write_sequence_section(data, "column_types", types);
+  ini::write_sequence_section(data, "partition_columns", m.partition_columns);
+  ini::write_sequence_section(data, "frame_files", m.frame_files);
+
+  general_ofstream fout(manifest_file);
+  boost::property_tree::ini_parser::write_ini(fout, data);
+  if (!fout.good()) {
+    log_and_throw_io_failure("Fail to write. Disk may be full.");
+  }
+  fout.close();
+}
+
+} // anonymous namespace
+
+
+bool partition_predicate::evaluate(const flexible_type& key) const {
+  bool key_missing = key.get_type() == flex_type_enum::UNDEFINED;
+  switch(op) {
+   case comparison::IN: {
+     if (value.get_type() != flex_type_enum::LIST) {
+       log_and_throw("The value of an IN partition predicate must be a list");
+     }
+     for (const auto& v: value.get<flex_list>()) {
+       bool v_missing = v.get_type() == flex_type_enum::UNDEFINED;
+       if (key_missing || v_missing) {
+         if (key_missing && v_missing) return true;
+       } else if (key == v) {
+         return true;
+       }
+     }
+     return false;
+   }
+   default:
+     break;
+  }
+
+  bool value_missing = value.get_type() == flex_type_enum::UNDEFINED;
+  if (key_missing || value_missing) {
+    // missing values are only equal to each other, and are not ordered
+    bool both = key_missing && value_missing;
+    if (op == comparison::EQ) return both;
+    if (op == comparison::NE) return !both;
+    return false;
+  }
+  switch(op) {
+   case comparison::EQ: return key == value;
+   case comparison::NE: return key != value;
+   case comparison::LT: return key < value;
+   case comparison::LE: return key <= value;
+   case comparison::GT: return key > value;
+   case comparison::GE: return key >= value;
+   default: return false;
+  }
+}
+
+
+partitioned_sframe::partitioned_sframe(const std::string& directory)
+    : m_directory(directory) {
+  manifest m = read_manifest(directory);
+  m_column_names = m.column_names;
+  m_column_types = m.column_types;
+  m_partition_columns = m.partition_columns;
+  check_partition_columns(m_column_names, m_column_types, m_partition_columns);
+
+  std::vector<flex_type_enum> partition_types;
+  for (const auto& col: m_partition_columns) {
+    size_t idx = std::find(m_column_names.begin(), m_column_names.end(), col)
+                 - m_column_names.begin();
+    partition_types.push_back(m_column_types[idx]);
+  }
+
+  // group the frame files by their partition directory
+  std::map<std::string, size_t> partition_index;
+  for (const auto& file: m.frame_files) {
+    size_t slash = file.rfind('/');
+    if (slash == std::string::npos) {
+      log_and_throw(std::string("Malformed partition frame file ") + file);
+    }
+    std::string path = file.substr(0, slash);
+    auto iter = partition_index.find(path);
+    if (iter == partition_index.end()) {
+      partition p;
+      p.path = path;
+      p.key = parse_partition_path(path, m_partition_columns, partition_types);
+      iter = partition_index.insert({path, m_partitions.size()}).first;
+      m_partitions.push_back(std::move(p));
+    }
+    m_partitions[iter->second].frame_files.push_back(file);
+  }
+}
+
+
+void partitioned_sframe::write(const sframe& sf,
+                               const std::string& directory,
+                               const std::vector<std::string>& partition_columns) {
+  auto column_names = sf.column_names();
+  auto column_types = sf.column_types();
+  check_partition_columns(column_names, column_types, partition_columns);
+
+  manifest m;
+  auto status = fileio::get_file_status(directory);
+  if (status == fileio::file_status::REGULAR_FILE) {
+    log_and_throw(std::string("Cannot write partitioned sframe: ") +
+                  directory + " is a file");
+  } else if (status == fileio::file_status::MISSING) {
+    if (!fileio::create_directory(directory)) {
+      log_and_throw(std::string("Unable to create directory ") + directory);
+    }
+  }
+  auto manifest_status = fileio::get_file_status(
+      fileio::make_absolute_path(directory, MANIFEST_FILE));
+  if (manifest_status == fileio::file_status::REGULAR_FILE) {
+    m = read_manifest(directory);
+    if (m.column_names != column_names || m.column_types != column_types) {
+      log_and_throw(std::string("Schema does not match the partitioned sframe at ")
+                    + directory);
+    }
+    if (m.partition_columns != partition_columns) {
+      log_and_throw(std::string("Partition columns do not match the "
+                                "partitioned sframe at ") + directory);
+    }
+  } else {
+    m.column_names = column_names;
+    m.column_types = column_types;
+    m.partition_columns = partition_columns;
+  }
+
+  std::vector<size_t> key_indices;
+  for (const auto& col: partition_columns) key_indices.push_back(sf.column_index(col));
+  std::vector<std::string> value_names;
+  std::vector<flex_type_enum> value_types;
+  std::vector<size_t> value_indices;
+  for (size_t i = 0; i < column_names.size(); ++i) {
+    if (std::find(key_indices.begin(), key_indices.end(), i) == key_indices.end()) {
+      value_names.push_back(column_names[i]);
+      value_types.push_back(column_types[i]);
+      value_indices.push_back(i);
+    }
+  }
+
+  if (sf.size() > 0) {
+    // sort by the partition keys so that each partition is one contiguous
+    // run of rows, which is then written out as a single frame.
+    auto sorted = sort(op_sframe_source::make_planner_node(sf),
+                       column_names, key_indices,
+                       std::vector<bool>(key_indices.size(), true));
+    auto reader = sorted->get_reader();
+    auto uuid_generator = boost::uuids::random_generator();
+
+    std::string current_path;
+    sframe current_frame;
+    sframe::iterator current_iter;
+    std::vector<std::vector<flexible_type> > rows;
+    std::vector<flexible_type> out_row(value_indices.size());
+    size_t num_frames = 0;
+
+    auto finish_frame = [&]() {
+      if (current_frame.is_opened_for_write()) {
+        current_frame.close();
+        current_frame = sframe();
+      }
+    };
+
+    for (size_t start = 0; start < sorted->size(); start += DEFAULT_SARRAY_READER_BUFFER_SIZE) {
+      reader->read_rows(start, start + DEFAULT_SARRAY_READER_BUFFER_SIZE, rows);
+      for (const auto& row: rows) {
+        std::string path;
+        for (size_t i = 0; i < key_indices.size(); ++i) {
+          if (i > 0) path += "/";
+          path += partition_directory_component(partition_columns[i], row[key_indices[i]]);
+        }
+        if (path != current_path || !current_frame.is_opened_for_write()) {
+          finish_frame();
+          current_path = path;
+          std::string partition_dir = fileio::make_absolute_path(directory, path);
+          if (!fileio::create_directory(partition_dir)) {
+            log_and_throw(std::string("Unable to create directory ") + partition_dir);
+          }
+          std::string file = path + "/part-" +
+              boost::lexical_cast<std::string>(uuid_generator()) + ".frame_idx";
+          current_frame.open_for_write(value_names, value_types,
+                                       fileio::make_absolute_path(directory, file), 1);
+          current_iter = current_frame.get_output_iterator(0);
+          m.frame_files.push_back(file);
+          ++num_frames;
+        }
+        for (size_t i = 0; i < value_indices.size(); ++i) {
+          out_row[i] = row[value_indices[i]];
+        }
+        *current_iter = out_row;
+        ++current_iter;
+      }
+    }
+    finish_frame();
+    logstream(LOG_INFO) << "Wrote " << sf.size() << " rows into "
+                        << num_frames << " partitions of " << directory << std::endl;
+  }
+
+  // the manifest is written last so that a failed write leaves the
+  // existing partitioned sframe unchanged.
+  write_manifest(directory, m);
+}
+
+
+std::vector<size_t> partitioned_sframe::select_partitions(
+    const partition_filter& filter) const {
+  std::vector<size_t> predicate_columns;
+  for (const auto& pred: filter) {
+    auto iter = std::find(m_partition_columns.begin(),
+                          m_partition_columns.end(), pred.column);
+    if (iter == m_partition_columns.end()) {
+      log_and_throw(std::string("Cannot filter on ") + pred.column +
+                    ": not a partition column");
+    }
+    predicate_columns.push_back(iter - m_partition_columns.begin());
+  }
+
+  std::vector<size_t> ret;
+  for (size_t i = 0; i < m_partitions.size(); ++i) {
+    bool selected = true;
+    for (size_t j = 0; j < filter.size() && selected; ++j) {
+      selected = filter[j].evaluate(m_partitions[i].key[predicate_columns[j]]);
+    }
+    if (selected) ret.push_back(i);
+  }
+  return ret;
+}
+
+
+std::shared_ptr<planner_node> partitioned_sframe::get_planner_node(
+    const partition_filter& filter) const {
+  auto selected = select_partitions(filter);
+  logstream(LOG_INFO) << "Partition pruning selected " << selected.size()
+                      << " of " << m_partitions.size() << " partitions" << std::endl;
+
+  // the frames hold the value columns in their original relative order,
+  // followed (after the union) by the partition columns. Work out where
+  // each original column lands.
+  std::vector<size_t> key_indices;
+  for (const auto& col: m_partition_columns) {
+    key_indices.push_back(std::find(m_column_names.begin(), m_column_names.end(), col)
+                          - m_column_names.begin());
+  }
+  size_t num_values = m_column_names.size() - key_indices.size();
+  std::vector<size_t> projection(m_column_names.size());
+  size_t next_value = 0;
+  for (size_t i = 0; i < m_column_names.size(); ++i) {
+    auto iter = std::find(key_indices.begin(), key_indices.end(), i);
+    if (iter == key_indices.end()) projection[i] = next_value++;
+    else projection[i] = num_values + (iter - key_indices.begin());
+  }
+
+  std::vector<std::shared_ptr<planner_node> > frames;
+  for (size_t p: selected) {
+    const partition& part = m_partitions[p];
+    for (const auto& file: part.frame_files) {
+      sframe frame(fileio::make_absolute_path(m_directory, file));
+      if (frame.size() == 0) continue;
+      std::vector<std::shared_ptr<planner_node> > columns{
+        op_sframe_source::make_planner_node(frame)};
+      for (size_t k = 0; k < key_indices.size(); ++k) {
+        columns.push_back(op_constant::make_planner_node(
+            part.key[k], m_column_types[key_indices[k]], frame.size()));
+      }
+      frames.push_back(op_project::make_planner_node(
+          op_union::make_planner_node(columns), projection));
+    }
+  }
+
+  if (frames.empty()) {
+    sframe empty;
+    empty.open_for_write(m_column_names, m_column_types, "", 1);
+    empty.close();
+    return op_sframe_source::make_planner_node(empty);
+  }
+  return append_all(frames, 0, frames.size());
+}
+
+
+sframe partitioned_sframe::to_sframe(const partition_filter& filter) const {
+  return planner().materialize(get_planner_node(filter));
+}
+
+} // end of query_eval
+} // end of graphlab
@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_QUERY_EVAL_PARTITIONED_SFRAME_HPP
+#define GRAPHLAB_QUERY_EVAL_PARTITIONED_SFRAME_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <flexible_type/flexible_type.hpp>
+
+namespace graphlab {
+
+class sframe;
+
+namespace query_eval {
+
+class planner_node;
+
+/**
+ * A comparison of a partition column against a value, used to prune the
+ * partitions of a \ref partitioned_sframe.
+ */
+struct partition_predicate {
+  enum class comparison {
+    EQ, NE, LT, LE, GT, GE,
+    IN  ///< value is a flex_list of accepted values
+  };
+
+  std::string column;
+  comparison op = comparison::EQ;
+  flexible_type value;
+
+  /// Returns true if the partition key value satisfies the predicate.
+  bool evaluate(const flexible_type& key) const;
+};
+
+/**
+ * A conjunction of predicates over partition columns. An empty filter
+ * selects all partitions.
+ */
+typedef std::vector<partition_predicate> partition_filter;
+
+/**
+ * An SFrame stored as a directory of partitions, one per distinct value of
+ * a set of key columns, laid out Hive-style:
+ *
+ * \verbatim
+ * directory/partitions.ini
+ * directory/date=2015-10-15/part-<uuid>.frame_idx (+ its array files)
+ * directory/date=2015-10-16/part-<uuid>.frame_idx
+ * directory/date=2015-10-16/part-<uuid>.frame_idx
+ * \endverbatim
+ *
+ * The partition column values are encoded in the directory names only; the
+ * frames in each partition directory hold the remaining columns. Key
+ * characters which are not alphanumeric or one of "-_." are percent
+ * encoded, and missing values are written as __HIVE_DEFAULT_PARTITION__.
+ * Partition columns must be of integer or string type.
+ *
+ * partitions.ini lists the schema, the partition columns and the frame
+ * files, so that loading does not require listing the directory tree.
+ * Each \ref write adds a new frame file to each partition it touches, so a
+ * partitioned sframe can be grown by appending a day of data at a time.
+ *
+ * Loading is lazy. \ref get_planner_node returns an APPEND of the selected
+ * partitions, each a UNION of its frames' sources and constant columns for
+ * the partition keys, so that partitions rejected by the filter are never
+ * opened.
+ *
+ * \code
+ * partitioned_sframe::write(events, "events/", {"date"});
+ * partitioned_sframe ps("events/");
+ * partition_predicate day;
+ * day.column = "date";
+ * day.value = "2015-10-15";
+ * sframe one_day = ps.to_sframe({day});
+ * \endcode
+ */
+class partitioned_sframe {
+ public:
+  /// A partition: the key values and the frames holding its rows.
+  struct partition {
+    /// The path of the partition directory relative to the root
+    std::string path;
+    /// key[i] is the value of partition_columns()[i]
+    std::vector<flexible_type> key;
+    /// The frame index files, relative to the root
+    std::vector<std::string> frame_files;
+  };
+
+  /**
+   * Opens a partitioned sframe directory. Throws if the directory does not
+   * contain a partitions.ini.
+   */
+  explicit partitioned_sframe(const std::string& directory);
+
+  /**
+   * Writes the rows of an sframe into a partitioned sframe directory,
+   * partitioned by the values of partition_columns.
+   *
+   * If the directory does not already hold a partitioned sframe, one is
+   * created. Otherwise the schema and the partition columns must match,
+   * and the rows are appended to the existing partitions (creating new
+   * partitions as needed).
+   */
+  static void write(const sframe& sf,
+                    const std::string& directory,
+                    const std::vector<std::string>& partition_columns);
+
+  /// The names of all columns, including the partition columns
+  const std::vector<std::string>& column_names() const { return m_column_names; }
+
+  /// The types of all columns, including the partition columns
+  const std::vector<flex_type_enum>& column_types() const { return m_column_types; }
+
+  /// The names of the partition columns
+  const std::vector<std::string>& partition_columns() const { return m_partition_columns; }
+
+  /// The number of partitions
+  size_t num_partitions() const { return m_partitions.size(); }
+
+  /// Returns a partition
+  const partition& get_partition(size_t i) const { return m_partitions[i]; }
+
+  /**
+   * Returns the indices of the partitions whose keys satisfy the filter.
+   * Throws if the filter references a column which is not a partition
+   * column.
+   */
+  std::vector<size_t> select_partitions(const partition_filter& filter) const;
+
+  /**
+   * Returns a lazy query plan over the rows of the partitions selected by
+   * the filter, with the columns in the order of \ref column_names.
+   */
+  std::shared_ptr<planner_node> get_planner_node(
+      const partition_filter& filter = partition_filter()) const;
+
+  /**
+   * Materializes the rows of the partitions selected by the filter.
+   */
+  sframe to_sframe(const partition_filter& filter = partition_filter()) const;
+
+ private:
+  std::string m_directory;
+  std::vector<std::string> m_column_names;
+  std::vector<flex_type_enum> m_column_types;
+  std::vector<std::string> m_partition_columns;
+  std::vector<partition> m_partitions;
+};
+
+} // end of query_eval
+} // end of graphlab
+
+#endif
@@ -0,0 +1,284 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <cmath>
+#include <parallel/mutex.hpp>
+#include <parallel/lambda_omp.hpp>
+#include <parallel/pthread_tools.hpp>
+#include <util/cityhash_gl.hpp>
+#include <timer/timer.hpp>
+#include <fileio/memory_governor.hpp>
+#include <fileio/spill_manager.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_config.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <sframe/spill_partitions.hpp>
+#include <sframe_query_engine/planning/planner.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/operators/all_operators.hpp>
+#include <sframe_query_engine/algorithm/sample.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+// the size heuristic of sort:
+// the memory overhead of each row, on top of CELL_SIZE_ESTIMATE per cell
+constexpr size_t ROW_SIZE_ESTIMATE = 32;
+
+std::vector<size_t> reservoir_sample_rows(size_t num_rows,
+                                          size_t num_samples,
+                                          flex_int random_seed) {
+  std::vector<size_t> reservoir(std::min(num_rows, num_samples));
+  for (size_t i = 0; i < reservoir.size(); ++i) reservoir[i] = i;
+  if (num_samples == 0 || num_samples >= num_rows) return reservoir;
+
+  uint64_t state = op_sample_mask::seed_hash(random_seed);
+  double k = num_samples;
+  double w = std::exp(std::log(op_sample_mask::next_uniform(state)) / k);
+  size_t row = num_samples - 1;
+  while (true) {
+    // the number of rows skipped before the next row entering the reservoir
+    double gap = std::floor(std::log(op_sample_mask::next_uniform(state)) /
+                            std::log1p(-w));
+    if (!(gap < (double)(num_rows - row - 1))) break;
+    row += 1 + (size_t)gap;
+    // it replaces a uniformly drawn row of the reservoir
+    size_t slot = (1 - op_sample_mask::next_uniform(state)) * k;
+    reservoir[std::min(slot, num_samples - 1)] = row;
+    w *= std::exp(std::log(op_sample_mask::next_uniform(state)) / k);
+  }
+  std::sort(reservoir.begin(), reservoir.end());
+  return reservoir;
+}
+
+/**
+ * Reads the given rows (in ascending order, without duplicates) of an
+ * sframe. The rows are cut into one range per thread, each read into its
+ * own segment, when there are enough of them to go around. Consecutive
+ * rows are read with a single read, so only the blocks holding the rows
+ * are decoded.
+ */
+static sframe read_selected_rows(const sframe& sf, const std::vector<size_t>& rows) {
+  size_t num_segments = std::max<size_t>(
+      1, std::min<size_t>(thread::cpu_count(),
+                          rows.size() / DEFAULT_SARRAY_READER_BUFFER_SIZE));
+  sframe ret;
+  ret.open_for_write(sf.column_names(), sf.column_types(), "", num_segments);
+  if (!rows.empty()) {
+    auto reader = sf.get_reader();
+    parallel_for(0, num_segments, [&](size_t segment_id) {
+      size_t i = rows.size() * segment_id / num_segments;
+      size_t end = rows.size() * (segment_id + 1) / num_segments;
+      auto out = ret.get_output_iterator(segment_id);
+      std::vector<std::vector<flexible_type> > buffer;
+      while (i < end) {
+        // extend the run while the rows are consecutive
+        size_t j = i + 1;
+        while (j < end && rows[j] == rows[j - 1] + 1 &&
+               j - i < DEFAULT_SARRAY_READER_BUFFER_SIZE) {
+          ++j;
+        }
+        reader->read_rows(rows[i], rows[j - 1] + 1, buffer);
+        for (auto& row: buffer) {
+          *out = std::move(row);
+          ++out;
+        }
+        i = j;
+      }
+    });
+  }
+  ret.close();
+  return ret;
+}
+
+/**
+ * Reads the given rows (sorted) of a source node, into a source node of
+ * the same kind. Returns nullptr if the node is not an sframe or sarray
+ * source.
+ */
+static std::shared_ptr<planner_node> read_source_rows(
+    std::shared_ptr<planner_node> source_node,
+    std::vector<size_t> rows) {
+  auto type = source_node->operator_type;
+  if (type != planner_node_type::SFRAME_SOURCE_NODE &&
+      type != planner_node_type::SARRAY_SOURCE_NODE) {
+    return nullptr;
+  }
+  size_t begin_index = source_node->operator_parameters.at("begin_index");
+  for (auto& row: rows) row += begin_index;
+  if (type == planner_node_type::SFRAME_SOURCE_NODE) {
+    auto source = source_node->any_operator_parameters.at("sframe").as<sframe>();
+    return op_sframe_source::make_planner_node(
+        read_selected_rows(source, rows));
+  }
+  auto source = source_node->any_operator_parameters.at("sarray")
+      .as<std::shared_ptr<sarray<flexible_type>>>();
+  sframe selected = read_selected_rows(sframe({source}), rows);
+  return op_sarray_source::make_planner_node(selected.select_column(0));
+}
+
+std::shared_ptr<planner_node> sample(
+    std::shared_ptr<planner_node> sframe_planner_node,
+    size_t num_rows,
+    double fraction,
+    flex_int random_seed) {
+  if (fraction > 0 && fraction < SPARSE_SAMPLE_FRACTION) {
+    auto ret = read_source_rows(
+        sframe_planner_node,
+        op_sample_mask::sampled_rows(num_rows, fraction, random_seed));
+    if (ret) return ret;
+  }
+  return op_logical_filter::make_planner_node(
+      sframe_planner_node,
+      op_sample_mask::make_planner_node(num_rows, fraction, random_seed));
+}
+
+std::shared_ptr<planner_node> sample_rows(
+    std::shared_ptr<planner_node> sframe_planner_node,
+    size_t num_rows,
+    size_t num_samples,
+    flex_int random_seed) {
+  std::shared_ptr<std::vector<size_t>> indices =
+      std::make_shared<std::vector<size_t>>(
+          reservoir_sample_rows(num_rows, num_samples, random_seed));
+  if (indices->size() < num_rows) {
+    auto ret = read_source_rows(sframe_planner_node, *indices);
+    if (ret) return ret;
+  }
+  return op_logical_filter::make_planner_node(
+      sframe_planner_node,
+      op_sample_mask::make_planner_node(
+          num_rows, std::shared_ptr<const std::vector<size_t>>(indices)));
+}
+
+/**
+ * Writes the rows to the segment of out, ordered by the keys of their
+ * positions. The position of rows[i] is position(i).
+ */
+template <typename PositionFunction>
+static void write_by_key(std::vector<std::vector<flexible_type>>& rows,
+                         PositionFunction position,
+                         uint64_t seed_hash,
+                         size_t num_columns,
+                         sframe& out,
+                         size_t segment_id) {
+  std::vector<std::pair<uint64_t, size_t>> keys(rows.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    keys[i] = {hash64(seed_hash, position(i)), i};
+  }
+  std::sort(keys.begin(), keys.end());
+  auto outiter = out.get_output_iterator(segment_id);
+  for (const auto& key: keys) {
+    auto& row = rows[key.second];
+    // drops the position column, if any
+    row.resize(num_columns);
+    *outiter = row;
+    ++outiter;
+  }
+}
+
+/**
+ * The partition of a key: the partitions are contiguous ranges of keys, so
+ * that the partitions sorted by key, in order, are the rows sorted by key.
+ */
+static size_t key_partition(uint64_t key, size_t num_partitions) {
+  return ((key >> 32) * num_partitions) >> 32;
+}
+
+std::shared_ptr<sframe> shuffle(
+    std::shared_ptr<planner_node> sframe_planner_node,
+    const std::vector<std::string>& column_names,
+    flex_int random_seed) {
+  log_func_entry();
+  // the spills of the scatter are counted on the query
+  running_query_scope query_scope("shuffle");
+
+  // the keys are hashed from the positions of the rows: the length must be
+  // known
+  int64_t length = infer_planner_node_length(sframe_planner_node);
+  if (length == -1) {
+    sframe materialized = planner().materialize(sframe_planner_node);
+    sframe_planner_node = op_sframe_source::make_planner_node(materialized);
+    length = materialized.size();
+  }
+  size_t num_rows = length;
+  auto column_types = infer_planner_node_type(sframe_planner_node);
+  size_t num_columns = column_types.size();
+  uint64_t seed_hash = op_sample_mask::seed_hash(random_seed);
+
+  size_t estimated_sframe_size = num_rows * num_columns * CELL_SIZE_ESTIMATE +
+                                 num_rows * ROW_SIZE_ESTIMATE;
+  auto memory = memory_governor::get_instance().acquire(
+      memory_consumer::SORT, sframe_config::SFRAME_SORT_BUFFER_SIZE);
+  size_t num_partitions = std::ceil((1.0 * estimated_sframe_size) /
+                                    std::max<size_t>(1, memory->bytes()));
+  // small enough for each thread to shuffle one at once
+  num_partitions = num_partitions * thread::cpu_count();
+  num_partitions = std::min<size_t>(num_partitions, SFRAME_SORT_MAX_SEGMENTS);
+
+  auto ret = std::make_shared<sframe>();
+  if (num_partitions <= thread::cpu_count()) {
+    logstream(LOG_INFO) << "Shuffling SFrame in memory" << std::endl;
+    auto sf = planner().materialize(sframe_planner_node);
+    std::vector<std::vector<flexible_type>> rows;
+    sf.get_reader()->read_rows(0, sf.size(), rows);
+    ret->open_for_write(column_names, column_types, "", 1);
+    write_by_key(rows, [](size_t i) { return i; }, seed_hash, num_columns, *ret, 0);
+    ret->close();
+    return ret;
+  }
+
+  // scatter the rows, with their positions as the last column
+  timer ti;
+  auto positioned_node = op_union::make_planner_node(
+      sframe_planner_node, op_range::make_planner_node(0, num_rows));
+  auto spill_types = column_types;
+  spill_types.push_back(flex_type_enum::INTEGER);
+  spill_session session(memory_consumer::SORT, "shuffle");
+  // the partitions stay in memory while they fit in the shuffle's grant
+  session.set_memory_budget(memory->bytes());
+  spill_partitions partitions(session, spill_types, num_partitions);
+  std::vector<mutex> outiter_mutexes(num_partitions);
+  size_t row_bytes = spill_types.size() * CELL_SIZE_ESTIMATE + ROW_SIZE_ESTIMATE;
+
+  planner().materialize(
+      positioned_node,
+      [&](size_t segment_id, const std::shared_ptr<sframe_rows>& data) {
+        std::vector<flexible_type> row;
+        for (const auto& item: *data) {
+          size_t position = item[num_columns].get<flex_int>();
+          size_t partition_id = key_partition(hash64(seed_hash, position),
+                                              num_partitions);
+          row.resize(item.size());
+          for (size_t i = 0; i < item.size(); ++i) row[i] = item[i];
+          std::lock_guard<mutex> guard(outiter_mutexes[partition_id]);
+          partitions.write(partition_id, row, row_bytes);
+        }
+        return false;
+      },
+      thread::cpu_count());
+  partitions.close();
+  logstream(LOG_INFO) << "Shuffle scatter step: " << ti.current_time() << std::endl;
+
+  // sort every partition by key
+  ti.start();
+  ret->open_for_write(column_names, column_types, "", num_partitions);
+  parallel_for(0, num_partitions, [&](size_t partition_id) {
+    std::vector<std::vector<flexible_type>> rows;
+    partitions.read_partition(partition_id, rows);
+    write_by_key(rows,
+                 [&](size_t i) { return (size_t)rows[i][num_columns].get<flex_int>(); },
+                 seed_hash, num_columns, *ret, partition_id);
+  });
+  ret->close();
+  logstream(LOG_INFO) << "Shuffle sort step: " << ti.current_time() << std::endl;
+  return ret;
+}
+
+} // namespace query_eval
+} // namespace graphlab
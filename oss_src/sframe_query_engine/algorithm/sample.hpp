@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_QUERY_EVAL_SAMPLE_HPP
+#define GRAPHLAB_QUERY_EVAL_SAMPLE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <flexible_type/flexible_type.hpp>
+
+namespace graphlab {
+
+class sframe;
+
+namespace query_eval {
+
+struct planner_node;
+
+/**
+ * Draws a uniform sample of num_samples of the rows [0, num_rows), without
+ * replacement, by reservoir sampling (Algorithm L of Li, 1994). The rows are
+ * returned sorted.
+ *
+ * The reservoir skips over the rows it does not sample by geometric jumps:
+ * drawing the sample costs O(num_samples * (1 + log(num_rows / num_samples))),
+ * and nothing is read. The sample only depends on the seed.
+ */
+std::vector<size_t> reservoir_sample_rows(size_t num_rows,
+                                          size_t num_samples,
+                                          flex_int random_seed);
+
+/**
+ * The fraction below which \ref sample reads the rows sampled from the
+ * source directly, rather than filtering all the rows by an op_sample_mask.
+ * Below it, most query blocks hold no row sampled: the query would go
+ * through all the blocks only to skip them, while the direct reads only
+ * visit the blocks holding a row sampled.
+ */
+constexpr double SPARSE_SAMPLE_FRACTION = 1.0 / 256;
+
+/**
+ * Returns the lazy sframe of a Bernoulli sample of the rows of
+ * sframe_planner_node, which has num_rows rows: each row is sampled with
+ * probability fraction, and the rows keep their order.
+ *
+ * If the sample is sparse (fraction < SPARSE_SAMPLE_FRACTION) and
+ * sframe_planner_node is an sframe or sarray source, the rows sampled are
+ * drawn up front and only they are read, eagerly. Otherwise the rows are
+ * filtered by an op_sample_mask. Both sample the same rows for a seed.
+ */
+std::shared_ptr<planner_node> sample(
+    std::shared_ptr<planner_node> sframe_planner_node,
+    size_t num_rows,
+    double fraction,
+    flex_int random_seed);
+
+/**
+ * Returns the lazy sframe of a uniform sample of num_samples of the rows of
+ * sframe_planner_node, which has num_rows rows (all the rows if it has
+ * fewer). The rows keep their order.
+ *
+ * The sample is drawn by \ref reservoir_sample_rows. As with \ref sample,
+ * only the rows sampled are read if sframe_planner_node is a source, and
+ * the rows are otherwise filtered by an op_sample_mask: the blocks without
+ * a row sampled are not read.
+ */
+std::shared_ptr<planner_node> sample_rows(
+    std::shared_ptr<planner_node> sframe_planner_node,
+    size_t num_rows,
+    size_t num_samples,
+    flex_int random_seed);
+
+/**
+ * Shuffles the rows of an sframe into a random permutation, which only
+ * depends on the seed.
+ *
+ * Every row is given a random key, hashed from the seed and the position
+ * of the row. The rows are scattered to spill partitions by the high bits
+ * of their keys, in parallel, and each partition is then sorted by key in
+ * memory, in parallel, into a segment of the result. As with \ref sort, the
+ * partitions are sized by the sort memory budget, and the shuffle is done
+ * in memory if it fits in it.
+ *
+ * \param sframe_planner_node The lazy sframe to be shuffled
+ * \param column_names The column names of the result
+ * \param random_seed The seed of the permutation
+ * \return The shuffled sframe
+ */
+std::shared_ptr<sframe> shuffle(
+    std::shared_ptr<planner_node> sframe_planner_node,
+    const std::vector<std::string>& column_names,
+    flex_int random_seed);
+
+} // end of query_eval
+} // end of graphlab
+
+#endif // GRAPHLAB_QUERY_EVAL_SAMPLE_HPP
@@ -13,6 +13,9 @@
 #include <sframe/sarray.hpp>
 #include <sframe/sframe.hpp>
 #include <sframe/sframe_config.hpp>
+#include <fileio/memory_governor.hpp>
+#include <fileio/spill_manager.hpp>
+#include <sframe/spill_partitions.hpp>
 #include <sketches/quantile_sketch.hpp>
 #include <sketches/streaming_quantile_sketch.hpp>
 #include <sframe_query_engine/planning/planner_node.hpp>
@@ -21,15 +24,15 @@
 #include <sframe_query_engine/operators/union.hpp>
 #include <sframe_query_engine/algorithm/sort_and_merge.hpp>
 #include <sframe_query_engine/algorithm/sort_comparator.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
 
 namespace graphlab {
 
 namespace query_eval {
 
 // heuristic
-// guestimate for the size of each cell
-// and the memory overhead of each row
-constexpr size_t CELL_SIZE_ESTIMATE = 64;
+// guestimate for the memory overhead of each row, on top of
+// CELL_SIZE_ESTIMATE per cell
 constexpr size_t ROW_SIZE_ESTIMATE = 32;
 
 /**
@@ -123,10 +126,10 @@ bool get_partition_keys(
  * Partition given sframe into multiple partitions according to given partition key.
  * This results to multiple partitions and partitions are relatively ordered.
  *
- * This function writes the resulting partitions into a sarray<string> type, where
- * each segment in the sarray is one partition that are relatively ordered.
+ * This function writes the resulting partitions into spill partitions, where
+ * each partition holds rows that are relatively ordered with the other
+ * partitions. The rows are written with their column types.
  *
- * We store a serialized version of original sframe sorting key columns and values
  * \param sframe_ptr The lazy sframe to be scatter partitioned
  * The key columns must be the lowest numbered columns.
  * \param num_sort_columns Columns [0, num_sort_columns - 1] are the key
@@ -136,20 +139,19 @@ bool get_partition_keys(
  * \param partition_keys The "spliting" point to partition the sframe
  * \param partition_sizes The estimated size of each sorted partition
  * \param partition_sorted Flag of weather each partition is sorted
+ * \param session The spill session the partitions are accounted to
  *
- * \return a pointer to a persisted sarray object, the sarray stores serialized
- *   values of partitioned sframe, with values between segments relatively ordered.
- *   Each row of the returned SArray is a pair<flex_list, string>
- *   where the first element of the pair is the key and the 2nd element of the
- *   pair is the serialized values.
+ * \return the partitions of the sframe, with values between partitions
+ *   relatively ordered.
 **/
-std::shared_ptr<sarray<std::pair<flex_list, std::string> >> scatter_partition(
+std::unique_ptr<spill_partitions> scatter_partition(
   const std::shared_ptr<planner_node> sframe_planner_node,
   size_t num_sort_columns,
   const std::vector<bool>& sort_orders,
   const std::vector<flexible_type>& partition_keys,
   std::vector<size_t>& partition_sizes,
-  std::vector<bool>& partition_sorted) {
+  std::vector<bool>& partition_sorted,
+  spill_session& session) {
 
   log_func_entry();
 
@@ -157,14 +159,11 @@ std::shared_ptr<sarray<std::pair<flex_list, std::string> >> scatter_partition(
   logstream(LOG_INFO) << "Scatter partition for sort, scatter to " +
         std::to_string(num_partitions_keys) + " partitions" << std::endl;
 
-  // Preparing resulting sarray for writing
-  auto parted_array = std::make_shared<sarray<std::pair<flex_list, std::string>>>();
-  parted_array->open_for_write(num_partitions_keys);
-
-  std::vector<sarray<std::pair<flex_list, std::string>>::iterator> outiter_vector(num_partitions_keys);
-  for(size_t i = 0; i < num_partitions_keys; ++i) {
-    outiter_vector[i] = parted_array->get_output_iterator(i);
-  }
+  // Preparing resulting partitions for writing
+  std::unique_ptr<spill_partitions> partitions(
+      new spill_partitions(session,
+                           infer_planner_node_type(sframe_planner_node),
+                           num_partitions_keys));
 
   // Create a mutex for each partition
   std::vector<mutex> outiter_mutexes(num_partitions_keys);
@@ -180,8 +179,8 @@ std::shared_ptr<sarray<std::pair<flex_list, std::string> >> scatter_partition(
 
   auto partial_sort_callback = [&](size_t segment_id,
                                    const std::shared_ptr<sframe_rows>& data) {
-    oarchive oarc;
     std::vector<flexible_type> sort_keys(num_sort_columns);
+    std::vector<flexible_type> row;
     for(auto& item: (*data)) {
       // extract sort key
       for(size_t i = 0; i < num_sort_columns; i++) {
@@ -211,32 +210,32 @@ std::shared_ptr<sarray<std::pair<flex_list, std::string> >> scatter_partition(
       }
       sorted_mutexes[partition_id].unlock();
 
-      // stream the key and value to output segment
-      for (size_t i = num_sort_columns; i < item.size(); ++i) oarc << item[i];
-      std::string arcout = std::string(oarc.buf, oarc.off);
+      // Calculate roughly how much memory each partition will take up when
+      // loaded to be sorted
+      // say that each row adds 32 bytes and each cell adds 64 bytes, plus
+      // the memory the values point to
+      size_t row_bytes = (item.size() * CELL_SIZE_ESTIMATE) + ROW_SIZE_ESTIMATE;
+      row.resize(item.size());
+      for (size_t i = 0; i < item.size(); ++i) {
+        row[i] = item[i];
+        row_bytes += estimate_value_bytes(row[i]);
+      }
 
       // write to coresponding output segment
       outiter_mutexes[partition_id].lock();
 
-      // Calculate roughly how much memory each partition will take up when
-      // loaded to be sorted
-      // say that each row adds 32 bytes and each cell adds 64 bytes
-      partition_size_in_bytes[partition_id] += 
-          oarc.off + (num_sort_columns * CELL_SIZE_ESTIMATE) + ROW_SIZE_ESTIMATE; 
+      partition_size_in_bytes[partition_id] += row_bytes;
       ++partition_size_in_rows[partition_id];
 
-      *(outiter_vector[partition_id]) = {sort_keys, std::move(arcout)};
-      ++outiter_vector[partition_id];
+      partitions->write(partition_id, row, row_bytes);
 
       outiter_mutexes[partition_id].unlock();
-      oarc.off = 0;
     }
-    free(oarc.buf);
     return false;
   };
 
   planner().materialize(sframe_planner_node, partial_sort_callback, num_threads);
-  parted_array->close();
+  partitions->close();
 
 
   for(size_t i = 0; i < num_partitions_keys; ++i) {
@@ -246,7 +245,7 @@ std::shared_ptr<sarray<std::pair<flex_list, std::string> >> scatter_partition(
 
   partition_sizes = partition_size_in_bytes;
 
-  return parted_array;
+  return partitions;
 }
 
 /**
@@ -284,6 +283,8 @@ std::shared_ptr<sframe> sort(
     const std::vector<size_t>& sort_column_indices,
     const std::vector<bool>& sort_orders) {
   log_func_entry();
+  // the spills of the scatter are counted on the query
+  running_query_scope query_scope("sort");
 
   auto column_types = infer_planner_node_type(sframe_planner_node);
 
@@ -332,7 +333,10 @@ std::shared_ptr<sframe> sort(
   // chunks. To account for strings, we estimate each cell is 64 bytes.
   // I'd love to estimate better.
   size_t estimated_sframe_size = num_rows * num_columns * CELL_SIZE_ESTIMATE+ num_rows * ROW_SIZE_ESTIMATE;
-  size_t num_partitions = std::ceil((1.0 * estimated_sframe_size) / sframe_config::SFRAME_SORT_BUFFER_SIZE);
+  auto memory = memory_governor::get_instance().acquire(
+      memory_consumer::SORT, sframe_config::SFRAME_SORT_BUFFER_SIZE);
+  size_t num_partitions = std::ceil((1.0 * estimated_sframe_size) /
+                                    std::max<size_t>(1, memory->bytes()));
 
   // Make partitions small enough for each thread to (theoretically) sort at once
   num_partitions = num_partitions * thread::cpu_count();
@@ -374,8 +378,8 @@ std::shared_ptr<sframe> sort(
 
   // scatter partition the sframe into multiple chunks, chunks are relatively
   // sorted, but each chunk is not sorted. The sorting of each chunk is delayed
-  // until it is consumed. Each chunk is stored as one segment for a sarray.
-  // The chunk stores a serailized version of key and value
+  // until it is consumed. Each chunk is stored as one spill partition,
+  // keys first, then values.
   std::vector<size_t> partition_sizes;
 
   // In the case where all sort keys in a given partition are the same, then
@@ -402,11 +406,15 @@ std::shared_ptr<sframe> sort(
     key_and_value_columns = key_columns;
   }
   ti.start();
-  auto partition_array = scatter_partition(
+  spill_session session(memory_consumer::SORT, "sort");
+  // the partitions stay in memory while they fit in the sort's grant
+  session.set_memory_budget(memory->bytes());
+  auto partitions = scatter_partition(
     key_and_value_columns, 
     sort_orders.size(),
     sort_orders,
-    partition_keys, partition_sizes, partition_sorted);
+    partition_keys, partition_sizes, partition_sorted,
+    session);
   logstream(LOG_INFO) << "Scatter step: " << ti.current_time() << std::endl;
 
   ti.start();
@@ -435,13 +443,14 @@ std::shared_ptr<sframe> sort(
   }
 
   auto ret = sort_and_merge(
-    partition_array,
+    *partitions,
     partition_sorted,
     partition_sizes,
     sort_orders,
     permute_ordering,
     column_names,
-    column_types);
+    column_types,
+    *memory);
   logstream(LOG_INFO) << "Sort and merge step: " << ti.current_time() << std::endl;
 
   return ret;
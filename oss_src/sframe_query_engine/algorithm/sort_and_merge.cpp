@@ -10,58 +10,14 @@
 #include<sframe/sarray.hpp>
 #include<sframe/sframe.hpp>
 #include<sframe/sframe_config.hpp>
+#include<sframe/spill_partitions.hpp>
 #include<parallel/mutex.hpp>
+#include<fileio/memory_governor.hpp>
 #include<sframe_query_engine/algorithm/sort_comparator.hpp>
 
 namespace graphlab {
 namespace query_eval {
 
-/**
- * Gets the first row of a segment
- */
-size_t segment_start(
-  std::unique_ptr<sarray_reader<std::pair<flex_list, std::string>>>& reader,
-  size_t segmentid) {
-  size_t ret = 0;
-  for (size_t i = 0; i < segmentid; ++i)  ret += reader->segment_length(i);
-  return ret;
-}
-
-void read_one_chunk(
-  std::unique_ptr<sarray_reader<std::pair<flex_list, std::string>>>& reader,
-  size_t segment_id,
-  size_t num_columns,
-  std::vector<std::pair<flex_list, std::string>>& rows) {
-
-  rows.resize(reader->segment_length(segment_id));
-  rows.shrink_to_fit();
-  size_t row_start = segment_start(reader, segment_id);
-  size_t row_end = segment_start(reader, segment_id + 1);
-  reader->read_rows(row_start, row_end, rows);
-}
-
-/*
- * When sorting, we organize the data as a pair of 
- * {sort_keys, string of serialized values}.
- * But when writing we need to convert it back to a vector<flexible_type>
- *
- * This function destructively modifies sort_row to turn it into a 
- * vector<flexible_type>.
- */
-void sort_row_to_output_row(std::pair<flex_list, std::string>& sort_row,
-                            std::vector<flexible_type>& output_row,
-                            size_t num_columns) {
-  output_row.resize(num_columns);
-  size_t i = sort_row.first.size();
-  // first the key columns
-  std::move(sort_row.first.begin(), sort_row.first.end(), output_row.begin());
-  // then the value columns
-  iarchive iarc(sort_row.second.c_str(), sort_row.second.length());
-  for(; i < num_columns; ++i) {
-    iarc >> output_row[i];
-  }
-}
-
 /**
  * Moves permuted_row[permute_order[i]] to output_row[i]
  * permuted_row and output_row must not be the same object.
@@ -78,33 +34,24 @@ void permute_row(std::vector<flexible_type>& permuted_row,
 }
 
 void write_one_chunk(
-  std::unique_ptr<sarray_reader<std::pair<flex_list, std::string>>>& reader,
+  spill_reader reader,
   const std::vector<size_t>& permute_order,
-  size_t segment_id,
-  size_t num_columns,
   sframe_output_iterator& output_iterator) {
-
-  flex_list permuted_row(num_columns);
-  flex_list output_row(num_columns);
-  for(auto iter = reader->begin(segment_id); iter != reader->end(segment_id); ++iter) {
-    auto row = std::move(*iter);
-    sort_row_to_output_row(row, permuted_row, num_columns);
-    permute_row(permuted_row, output_row, permute_order);
+  std::vector<flexible_type> output_row;
+  while(reader.has_next()) {
+    permute_row(reader.next(), output_row, permute_order);
     *output_iterator = output_row;
     output_iterator++;
   }
 }
 
 void write_one_chunk(
-    std::vector<std::pair<flex_list, std::string>>& rows,
+    std::vector<std::vector<flexible_type>>& rows,
     const std::vector<size_t>& permute_order,
-    sframe_output_iterator& output_iterator,
-    size_t num_columns) {
-  std::vector<flexible_type> permuted_row(num_columns);
-  std::vector<flexible_type> output_row(num_columns);
+    sframe_output_iterator& output_iterator) {
+  std::vector<flexible_type> output_row;
   for(auto& row : rows) {
-    sort_row_to_output_row(row, permuted_row, num_columns);
-    permute_row(permuted_row, output_row, permute_order);
+    permute_row(row, output_row, permute_order);
     *output_iterator = output_row;
     output_iterator++;
   }
@@ -126,16 +73,16 @@ void write_one_chunk(
  * buffer to sort...hopefully not allocating too much memory :/. 
  */
 std::shared_ptr<sframe> sort_and_merge(
-    const std::shared_ptr<sarray<std::pair<flex_list, std::string>>>& partition_array,
+    const spill_partitions& partitions,
     const std::vector<bool>& partition_sorted,
     const std::vector<size_t>& partition_sizes,
     const std::vector<bool>& sort_orders,
     const std::vector<size_t>& permute_order,
     const std::vector<std::string>& column_names,
-    const std::vector<flex_type_enum>& column_types) {
+    const std::vector<flex_type_enum>& column_types,
+    const memory_grant& memory) {
 
-  size_t num_segments = partition_array->num_segments();
-  auto reader = partition_array->get_reader();
+  size_t num_segments = partitions.num_partitions();
   atomic<size_t> next_segment_to_sort = 0;
   graphlab::mutex mem_used_mutex;
   graphlab::conditional mem_threshold_cv;
@@ -145,23 +92,25 @@ std::shared_ptr<sframe> sort_and_merge(
   // Prepare the output sframe
   sframe out_sframe;
   out_sframe.open_for_write(column_names, column_types, "", num_segments);
-  size_t num_columns = column_names.size();
-  less_than_full_function comparator(sort_orders);
+  // the key columns come first
+  std::vector<size_t> sort_columns(sort_orders.size());
+  for (size_t i = 0;i < sort_columns.size(); ++i) sort_columns[i] = i;
+  less_than_partial_function comparator(sort_columns, sort_orders);
 
   parallel_for(0, num_threads,
    [&](size_t thread_id) {
     // Each thread keep running until no more segment to sort
-    std::vector<std::pair<flex_list, std::string>> rows;
+    std::vector<std::vector<flexible_type>> rows;
     size_t segment_id = next_segment_to_sort++;
     while(segment_id < num_segments) {
       auto outiterator = out_sframe.get_output_iterator(segment_id);
       if (partition_sorted[segment_id]) {
         logstream(LOG_INFO) << "segment " << segment_id << " is already sorted, skip sorting " << std::endl;
-        write_one_chunk(reader, permute_order, segment_id, num_columns, outiterator);
+        write_one_chunk(partitions.get_reader(segment_id), permute_order, outiterator);
       } else {
         mem_used_mutex.lock();
-        while((mem_used+partition_sizes[segment_id]) > sframe_config::SFRAME_SORT_BUFFER_SIZE) {
-          if(((partition_sizes[segment_id] > sframe_config::SFRAME_SORT_BUFFER_SIZE) && (mem_used == 0)) ||
+        while((mem_used+partition_sizes[segment_id]) > memory.bytes()) {
+          if(((partition_sizes[segment_id] > memory.bytes()) && (mem_used == 0)) ||
             (partition_sizes[segment_id] == 0)) {
             break;
           }
@@ -170,12 +119,12 @@ std::shared_ptr<sframe> sort_and_merge(
         //logstream(LOG_INFO) << "sorting segment " << segment_id << " in thread " << thread_id << std::endl;
         mem_used += partition_sizes[segment_id];
         mem_used_mutex.unlock();
-        read_one_chunk(reader, segment_id, num_columns, rows);
+        partitions.read_partition(segment_id, rows);
 
         // sort one chunk
         std::sort(rows.begin(), rows.end(), comparator);
 
-        write_one_chunk(rows, permute_order ,outiterator, num_columns);
+        write_one_chunk(rows, permute_order ,outiterator);
         out_sframe.flush_write_to_segment(segment_id);
         logstream(LOG_INFO) << "Finished sorting segment " << segment_id << std::endl;
 
@@ -7,6 +7,8 @@
  */
 #ifndef GRAPHLAB_QUERY_EVAL_SORT_AND_MERGE_HPP
 #define GRAPHLAB_QUERY_EVAL_SORT_AND_MERGE_HPP
+#include <fileio/memory_governor.hpp>
+#include <sframe/spill_partitions.hpp>
 
 namespace graphlab {
 namespace query_eval {
@@ -16,15 +18,15 @@ namespace query_eval {
 /**
  * The merge stage of parallel sort.
  *
- * The input is a partially sorted(partitioned) sframe, represented by 
- * an sarray<string> with N segments. Each segment
- * is a partitioned key range, and segments are ordered by 
+ * The input is a partially sorted(partitioned) sframe, represented by
+ * N spill partitions, with the key columns first. Each partition
+ * is a partitioned key range, and partitions are ordered by
  * the key orders.
  *
  * Given the partially sorted sframe, this function will in parallel 
  * sort each partition, and concat the result into final sframe.
  *
- * \param partition_array the serialized input sframe, partially sorted
+ * \param partitions the input sframe, partially sorted
  * \param partition_sorted flag whether the partition is already sorted
  * \param partition_sizes the estimate size of each partition
  * \param sort_orders sort order of the keys
@@ -32,17 +34,20 @@ namespace query_eval {
  * will be stored in column i of the final SFrame
  * \param column_names column names of the final sframe
  * \param column_types column types of the final sframe
+ * \param memory the working memory of the sort. The partitions being sorted
+ * at the same time must fit in it.
  *
  * \return a sorted sframe.
  */
 std::shared_ptr<sframe> sort_and_merge(
-    const std::shared_ptr<sarray<std::pair<flex_list, std::string>>>& partition_array,
+    const spill_partitions& partitions,
     const std::vector<bool>& partition_sorted,
     const std::vector<size_t>& partition_sizes,
     const std::vector<bool>& sort_orders,
     const std::vector<size_t>& permute_order,
     const std::vector<std::string>& column_names,
-    const std::vector<flex_type_enum>& column_types);
+    const std::vector<flex_type_enum>& column_types,
+    const memory_grant& memory);
 
 } // enfd of query_eval
 } // end of graphlab
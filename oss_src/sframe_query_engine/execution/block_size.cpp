@@ -0,0 +1,227 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <globals/globals.hpp>
+#include <parallel/mutex.hpp>
+#include <util/cityhash_gl.hpp>
+#include <sframe/sarray.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_config.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/operators/operator_properties.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+// about the size of a per-core L2 cache
+size_t SFRAME_QUERY_BLOCK_BYTES = 256 * 1024;
+size_t SFRAME_QUERY_MAX_BLOCK_SIZE = 4096;
+
+REGISTER_GLOBAL(int64_t, SFRAME_QUERY_BLOCK_BYTES, true);
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SFRAME_QUERY_MAX_BLOCK_SIZE,
+                            true,
+                            +[](int64_t val){ return val >= (int64_t)SFRAME_QUERY_MIN_BLOCK_SIZE; });
+
+/// The number of rows measured to estimate the width of a column
+static const size_t COLUMN_SAMPLE_SIZE = 64;
+
+/// The maximum number of column estimates kept
+static const size_t COLUMN_ESTIMATE_CACHE_SIZE = 4096;
+
+/// The memory taken by a container besides its elements
+static const size_t CONTAINER_OVERHEAD = 32;
+
+size_t estimate_value_bytes(const flexible_type& value) {
+  size_t ret = sizeof(flexible_type);
+  switch (value.get_type()) {
+    case flex_type_enum::STRING:
+      ret += CONTAINER_OVERHEAD + value.get<flex_string>().size();
+      break;
+    case flex_type_enum::VECTOR:
+      ret += CONTAINER_OVERHEAD + sizeof(double) * value.get<flex_vec>().size();
+      break;
+    case flex_type_enum::LIST:
+      ret += CONTAINER_OVERHEAD;
+      for (const auto& v: value.get<flex_list>()) ret += estimate_value_bytes(v);
+      break;
+    case flex_type_enum::DICT:
+      ret += CONTAINER_OVERHEAD;
+      for (const auto& kv: value.get<flex_dict>()) {
+        ret += estimate_value_bytes(kv.first) + estimate_value_bytes(kv.second);
+      }
+      break;
+    case flex_type_enum::IMAGE:
+      ret += sizeof(flex_image) + value.get<flex_image>().m_image_data_size;
+      break;
+    default:
+      break;
+  }
+  return ret;
+}
+
+size_t estimate_type_bytes(flex_type_enum type) {
+  switch (type) {
+    case flex_type_enum::STRING:
+      return sizeof(flexible_type) + CONTAINER_OVERHEAD + 16;
+    case flex_type_enum::VECTOR:
+    case flex_type_enum::LIST:
+    case flex_type_enum::DICT:
+      return sizeof(flexible_type) + CONTAINER_OVERHEAD + 8 * sizeof(flexible_type);
+    case flex_type_enum::IMAGE:
+      return sizeof(flexible_type) + sizeof(flex_image) + 64 * 1024;
+    default:
+      return sizeof(flexible_type);
+  }
+}
+
+static mutex column_estimate_lock;
+
+static std::map<std::string, size_t>& column_estimate_cache() {
+  static auto* cache = new std::map<std::string, size_t>();
+  return *cache;
+}
+
+size_t estimate_column_bytes(const std::shared_ptr<sarray<flexible_type>>& column) {
+  size_t num_rows = column->size();
+  if (num_rows == 0) return estimate_type_bytes(column->get_type());
+  std::string key = column->get_index_info().index_file + "@" + std::to_string(num_rows);
+  {
+    std::lock_guard<mutex> guard(column_estimate_lock);
+    auto iter = column_estimate_cache().find(key);
+    if (iter != column_estimate_cache().end()) return iter->second;
+  }
+
+  std::vector<flexible_type> sample;
+  column->get_reader()->read_rows(0, std::min(num_rows, COLUMN_SAMPLE_SIZE), sample);
+  size_t total = 0;
+  for (const auto& v: sample) total += estimate_value_bytes(v);
+  size_t ret = sample.empty() ? estimate_type_bytes(column->get_type())
+                              : (total + sample.size() - 1) / sample.size();
+
+  std::lock_guard<mutex> guard(column_estimate_lock);
+  if (column_estimate_cache().size() >= COLUMN_ESTIMATE_CACHE_SIZE) {
+    column_estimate_cache().clear();
+  }
+  column_estimate_cache()[key] = ret;
+  return ret;
+}
+
+static mutex observed_bytes_lock;
+
+static std::map<uint64_t, size_t>& observed_bytes() {
+  static auto* observed = new std::map<uint64_t, size_t>();
+  return *observed;
+}
+
+void record_observed_value_bytes(uint64_t key, size_t bytes) {
+  std::lock_guard<mutex> guard(observed_bytes_lock);
+  if (observed_bytes().size() >= COLUMN_ESTIMATE_CACHE_SIZE) observed_bytes().clear();
+  observed_bytes()[key] = bytes;
+}
+
+bool find_observed_value_bytes(uint64_t key, size_t& bytes) {
+  std::lock_guard<mutex> guard(observed_bytes_lock);
+  auto iter = observed_bytes().find(key);
+  if (iter == observed_bytes().end()) return false;
+  bytes = iter->second;
+  return true;
+}
+
+std::vector<size_t> estimate_row_bytes(
+    const std::shared_ptr<planner_node>& pnode,
+    std::map<const planner_node*, std::vector<size_t>>& memo) {
+  auto iter = memo.find(pnode.get());
+  if (iter != memo.end()) return iter->second;
+
+  std::vector<std::vector<size_t>> inputs;
+  for (const auto& input: pnode->inputs) {
+    inputs.push_back(estimate_row_bytes(input, memo));
+  }
+
+  std::vector<size_t> ret;
+  switch (pnode->operator_type) {
+    case planner_node_type::SARRAY_SOURCE_NODE: {
+      auto source = pnode->any_operator_parameters.at("sarray")
+          .as<std::shared_ptr<sarray<flexible_type>>>();
+      ret.push_back(estimate_column_bytes(source));
+      break;
+    }
+    case planner_node_type::SFRAME_SOURCE_NODE: {
+      auto source = pnode->any_operator_parameters.at("sframe").as<sframe>();
+      for (size_t i = 0; i < source.num_columns(); ++i) {
+        ret.push_back(estimate_column_bytes(source.select_column(i)));
+      }
+      break;
+    }
+    case planner_node_type::PROJECT_NODE: {
+      const flex_list& indices = pnode->operator_parameters.at("indices").get<flex_list>();
+      for (const auto& i: indices) ret.push_back(inputs[0].at(i.get<flex_int>()));
+      break;
+    }
+    case planner_node_type::UNION_NODE:
+      for (const auto& input: inputs) ret.insert(ret.end(), input.begin(), input.end());
+      break;
+    case planner_node_type::GENERALIZED_UNION_PROJECT_NODE: {
+      const flex_dict& index_map = pnode->operator_parameters.at("index_map").get<flex_dict>();
+      for (const auto& m: index_map) {
+        size_t input = m.first.get<flex_int>();
+        size_t column = m.second.get<flex_int>();
+        // columns of the node which are not read from an input are constants
+        if (input < inputs.size() && column < inputs[input].size()) {
+          ret.push_back(inputs[input][column]);
+        } else {
+          ret.push_back(sizeof(flexible_type));
+        }
+      }
+      break;
+    }
+    case planner_node_type::LAMBDA_TRANSFORM_NODE: {
+      size_t bytes = 0;
+      uint64_t key = hash64(pnode->operator_parameters.at("lambda_str").get<flex_string>());
+      if (!find_observed_value_bytes(key, bytes)) {
+        bytes = estimate_type_bytes(infer_planner_node_type(pnode)[0]);
+      }
+      ret.push_back(bytes);
+      break;
+    }
+    case planner_node_type::LOGICAL_FILTER_NODE:
+    case planner_node_type::APPEND_NODE:
+      ret = inputs[0];
+      break;
+    default:
+      for (auto type: infer_planner_node_type(pnode)) {
+        ret.push_back(estimate_type_bytes(type));
+      }
+      break;
+  }
+  memo[pnode.get()] = ret;
+  return ret;
+}
+
+size_t choose_block_size(const std::shared_ptr<planner_node>& tip) {
+  if (SFRAME_QUERY_BLOCK_BYTES == 0) return sframe_config::SFRAME_READ_BATCH_SIZE;
+
+  // every node holds one block of its output
+  std::map<const planner_node*, std::vector<size_t>> memo;
+  estimate_row_bytes(tip, memo);
+  size_t bytes_per_row = 0;
+  for (const auto& node: memo) {
+    for (size_t bytes: node.second) bytes_per_row += bytes;
+  }
+  bytes_per_row = std::max<size_t>(bytes_per_row, 1);
+
+  size_t block_size = SFRAME_QUERY_BLOCK_BYTES / bytes_per_row;
+  block_size = std::min(block_size, SFRAME_QUERY_MAX_BLOCK_SIZE);
+  return std::max(block_size, SFRAME_QUERY_MIN_BLOCK_SIZE);
+}
+
+} // namespace query_eval
+} // namespace graphlab
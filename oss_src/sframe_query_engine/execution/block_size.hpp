@@ -0,0 +1,100 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_QUERY_ENGINE_EXECUTION_BLOCK_SIZE_HPP
+#define GRAPHLAB_SFRAME_QUERY_ENGINE_EXECUTION_BLOCK_SIZE_HPP
+#include <map>
+#include <memory>
+#include <vector>
+#include <flexible_type/flexible_type.hpp>
+
+namespace graphlab {
+template <typename T>
+class sarray;
+
+namespace query_eval {
+struct planner_node;
+
+/**
+ * The number of bytes the blocks of all the operators of a pipeline should
+ * take together, so that a block stays in cache from the operator producing
+ * it to the operators consuming it. 0 disables the adaptive block size: all
+ * pipelines then use blocks of sframe_config::SFRAME_READ_BATCH_SIZE rows.
+ */
+extern size_t SFRAME_QUERY_BLOCK_BYTES;
+
+/**
+ * The largest number of rows of a block, however narrow the rows are.
+ */
+extern size_t SFRAME_QUERY_MAX_BLOCK_SIZE;
+
+/**
+ * The smallest number of rows of a block, however wide the rows are.
+ */
+static const size_t SFRAME_QUERY_MIN_BLOCK_SIZE = 8;
+
+/**
+ * Returns an estimate of the memory taken by a value: the flexible_type
+ * and the memory it points to.
+ */
+size_t estimate_value_bytes(const flexible_type& value);
+
+/**
+ * Returns an estimate of the memory taken by a value of a type, when
+ * nothing else is known of it.
+ */
+size_t estimate_type_bytes(flex_type_enum type);
+
+/**
+ * Returns an estimate of the average memory taken by a value of a column,
+ * measured on a sample of its first rows. The estimates are kept for the
+ * lifetime of the process.
+ */
+size_t estimate_column_bytes(const std::shared_ptr<sarray<flexible_type>>& column);
+
+/**
+ * Records the average memory taken by the values an operator produced,
+ * measured while executing it, so that the later queries running the same
+ * computation (identified by key) size their blocks by it rather than by
+ * the type of the values.
+ */
+void record_observed_value_bytes(uint64_t key, size_t bytes);
+
+/**
+ * Returns in bytes the memory taken by the values of the computation
+ * identified by key, if recorded by \ref record_observed_value_bytes.
+ */
+bool find_observed_value_bytes(uint64_t key, size_t& bytes);
+
+/**
+ * Returns the estimated bytes per value of each output column of a node.
+ * The columns of the sources are measured; the columns passed through by
+ * an operator (project, union, filter, append) keep the estimate of their
+ * input, the lambda transforms use the width observed when they last ran,
+ * and the other columns are estimated by their type.
+ *
+ * The estimates of all the nodes visited are stored in memo.
+ */
+std::vector<size_t> estimate_row_bytes(
+    const std::shared_ptr<planner_node>& pnode,
+    std::map<const planner_node*, std::vector<size_t>>& memo);
+
+/**
+ * Returns the number of rows of the blocks exchanged by the operators of
+ * the pipeline ending at tip, so that a block of every operator takes about
+ * SFRAME_QUERY_BLOCK_BYTES together: pipelines of wide rows use short
+ * blocks which stay in cache, and pipelines of narrow rows long blocks
+ * which amortize the switches between the operators.
+ *
+ * All the operators of a pipeline must use the same block size (see \ref
+ * execution_node).
+ */
+size_t choose_block_size(const std::shared_ptr<planner_node>& tip);
+
+} // namespace query_eval
+} // namespace graphlab
+#endif
@@ -5,11 +5,14 @@
  * This software may be modified and distributed under the terms
  * of the BSD license. See the LICENSE file for details.
  */
+#include <algorithm>
 #include <sframe/sframe_rows.hpp>
 #include <sframe/sframe_config.hpp>
 #include <globals/globals.hpp>
 #include <sframe_query_engine/execution/query_context.hpp>
 #include <sframe_query_engine/execution/execution_node.hpp>
+#include <sframe_query_engine/execution/query_profile.hpp>
+#include <sframe/sarray_v2_type_encoding.hpp>
 #include <cppipc/cppipc.hpp>
 
 namespace graphlab {
@@ -22,6 +25,10 @@ int64_t COROUTINE_STACK_SIZE =
     64*1024 < stack_traits::minimum_size() ?
         stack_traits::minimum_size() : 64*1024;
 
+size_t SFRAME_QUERY_BLOCK_EXECUTION = true;
+
+REGISTER_GLOBAL(int64_t, SFRAME_QUERY_BLOCK_EXECUTION, true);
+
 REGISTER_GLOBAL_WITH_CHECKS(int64_t, COROUTINE_STACK_SIZE, false,
             +[](int64_t i){ 
               return stack_traits::minimum_size() <= i && 
@@ -51,6 +58,31 @@ void execution_node::init(const std::shared_ptr<query_operator>& op,
   reset();
 }
 
+execution_node::~execution_node() {
+  if (!m_profile) return;
+  auto& c = m_counters;
+  m_profile->num_instances.inc();
+  m_profile->rows_in.inc(c.rows_in);
+  m_profile->rows_out.inc(c.rows_out);
+  m_profile->batches_out.inc(c.batches_out);
+  m_profile->blocks_skipped.inc(c.blocks_skipped);
+  m_profile->wall_time_ns.inc(c.wall_ns - std::min(c.wall_ns, c.input_wall_ns));
+  m_profile->cpu_time_ns.inc(c.cpu_ns - std::min(c.cpu_ns, c.input_cpu_ns));
+  m_profile->bytes_decoded.inc(c.bytes_decoded - std::min(c.bytes_decoded,
+                                                          c.input_bytes_decoded));
+  if (c.first_call_ns > 0) {
+    m_profile->add_span({c.thread, c.first_call_ns, c.last_return_ns});
+  }
+}
+
+void execution_node::enable_profiling(const std::shared_ptr<operator_profile>& profile) {
+  m_profile = profile;
+}
+
+void execution_node::set_block_size(size_t block_size) {
+  m_block_size = block_size;
+}
+
 void execution_node::reset() {
   if (m_coroutines_started) {
     m_consumer_pos.assign(m_consumer_pos.size(), 0);
@@ -66,6 +98,15 @@ void execution_node::reset() {
 void execution_node::start_coroutines() {
   // restart the coroutine
   m_coroutines_started = true;
+  m_block_mode = SFRAME_QUERY_BLOCK_EXECUTION && m_operator->supports_block_execution();
+  if (m_block_mode) {
+    // no coroutine: the blocks are computed by execute_next_block()
+    m_block_done = false;
+    m_block_index = 0;
+    if (!m_block_buffer) m_block_buffer = std::make_shared<sframe_rows>();
+    m_block_inputs.resize(num_inputs());
+    return;
+  }
   auto coro_attributes = boost::coroutines::attributes(COROUTINE_STACK_SIZE);
 
   auto attributes = m_operator->attributes();
@@ -151,7 +192,7 @@ LABEL_GOTO_SINK_AGAIN:
                                 }
                                 return emit_state::NONE;
                               },
-                              sframe_config::SFRAME_READ_BATCH_SIZE,
+                              m_block_size,
                               initial_operator_state);
         try {
           m_operator->execute(context);
@@ -177,11 +218,31 @@ std::shared_ptr<sframe_rows> execution_node::get_next(size_t consumer_id, bool s
   DASSERT_LT(consumer_id, m_consumer_pos.size());
 
   // consume from source when queue is empty and there is more in source
-  while (m_output_queue.empty() && m_source) {
-    m_source();
+  if (m_profile) {
+    uint64_t wall = profile_clock_ns();
+    uint64_t cpu = profile_thread_cpu_ns();
+    size_t decoded = v2_block_impl::thread_decoded_bytes();
+    if (m_counters.first_call_ns == 0) {
+      m_counters.first_call_ns = wall;
+      m_counters.thread = std::this_thread::get_id();
+    }
+    while (m_output_queue.empty() && has_more_output()) {
+      if (m_block_mode) execute_next_block();
+      else m_source();
+    }
+    m_counters.last_return_ns = profile_clock_ns();
+    m_counters.wall_ns += m_counters.last_return_ns - wall;
+    m_counters.cpu_ns += profile_thread_cpu_ns() - cpu;
+    m_counters.bytes_decoded += v2_block_impl::thread_decoded_bytes() - decoded;
+    if (skip) ++m_counters.blocks_skipped;
+  } else {
+    while (m_output_queue.empty() && has_more_output()) {
+      if (m_block_mode) execute_next_block();
+      else m_source();
+    }
   }
   // end of data
-  if (m_output_queue.empty() && !m_source) return nullptr;
+  if (m_output_queue.empty() && !has_more_output()) return nullptr;
 
   // The only case in which a consumer does not appear in lock-step
   // is if the last thing it consumed was an incomplete block.
@@ -203,7 +264,7 @@ std::shared_ptr<sframe_rows> execution_node::get_next(size_t consumer_id, bool s
   //  This results in consumer misalignment since the same operator reads twice
   //  in a row. We thus catch this scenario here, and return a nullptr: 
   //  indicated completion of read.
-  if (m_consumer_pos[consumer_id] > m_head && !m_source) return nullptr;
+  if (m_consumer_pos[consumer_id] > m_head && !has_more_output()) return nullptr;
 
   // all consumers must consume in lock step
   ASSERT_EQ(m_consumer_pos[consumer_id], m_head);
@@ -223,14 +284,75 @@ std::shared_ptr<sframe_rows> execution_node::get_next(size_t consumer_id, bool s
   else return ret;
 }
 
+void execution_node::execute_next_block() {
+  try {
+    if (m_inputs.empty()) {
+      // a source
+      if (m_skip_next_block) {
+        if (m_operator->has_block(m_block_index, m_block_size)) {
+          add_operator_output(nullptr);
+        } else {
+          m_block_done = true;
+        }
+      } else if (m_operator->execute_block(m_block_inputs, m_block_index,
+                                           m_block_size, *m_block_buffer)) {
+        add_operator_output(m_block_buffer);
+      } else {
+        m_block_done = true;
+      }
+    } else if (m_skip_next_block) {
+      // as for the linear operators which do not support skipping, consume
+      // the input blocks and produce a fake output
+      for (size_t i = 0;i < num_inputs(); ++i) {
+        get_next_from_input(i, true);
+      }
+      add_operator_output(nullptr);
+    } else {
+      bool any_null = false, all_null = true;
+      for (size_t i = 0;i < num_inputs(); ++i) {
+        m_block_inputs[i] = get_next_from_input(i, false);
+        if (m_block_inputs[i] == nullptr) any_null = true;
+        else all_null = false;
+      }
+      if (any_null) {
+        ASSERT_TRUE(all_null);
+        m_block_done = true;
+      } else {
+        m_operator->execute_block(m_block_inputs, m_block_index,
+                                  m_block_size, *m_block_buffer);
+        add_operator_output(m_block_buffer);
+      }
+    }
+  } catch(...) {
+    m_exception_occured = true;
+    m_exception = std::current_exception();
+    m_block_done = true;
+  }
+  ++m_block_index;
+}
+
 void execution_node::add_operator_output(const std::shared_ptr<sframe_rows>& rows) {
+  if (m_profile && rows) {
+    m_counters.rows_out += rows->num_rows();
+    ++m_counters.batches_out;
+  }
   m_output_queue.push(rows);
 }
 
 std::shared_ptr<sframe_rows> execution_node::get_next_from_input(size_t input_id, bool skip) {
   ASSERT_LT(input_id, m_inputs.size());
   auto& input = m_inputs[input_id];
-  return input.m_node->get_next(input.m_consumer_id, skip);
+  if (!m_profile) return input.m_node->get_next(input.m_consumer_id, skip);
+
+  uint64_t wall = profile_clock_ns();
+  uint64_t cpu = profile_thread_cpu_ns();
+  size_t decoded = v2_block_impl::thread_decoded_bytes();
+  auto ret = input.m_node->get_next(input.m_consumer_id, skip);
+  m_counters.input_wall_ns += profile_clock_ns() - wall;
+  m_counters.input_cpu_ns += profile_thread_cpu_ns() - cpu;
+  m_counters.input_bytes_decoded += v2_block_impl::thread_decoded_bytes() - decoded;
+  if (ret) m_counters.rows_in += ret->num_rows();
+  return ret;
 }
 
 size_t execution_node::register_consumer() {
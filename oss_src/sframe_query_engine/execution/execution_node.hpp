@@ -11,8 +11,10 @@
 #include <memory>
 #include <vector>
 #include <queue>
+#include <thread>
 #include <boost/coroutine/coroutine.hpp>
 #include <flexible_type/flexible_type.hpp>
+#include <sframe/sframe_config.hpp>
 #include <sframe_query_engine/operators/operator.hpp>
 
 namespace graphlab { 
@@ -20,6 +22,16 @@ class sframe_rows;
 
 namespace query_eval {
 class query_context;
+struct operator_profile;
+
+/**
+ * If non-zero (the default), the operators which support block execution
+ * (see query_operator::execute_block) run without a coroutine: the
+ * execution node calls them for each block it is asked for. The plans made
+ * only of such operators are run by the subplan executor as a single loop,
+ * without execution nodes at all.
+ */
+extern size_t SFRAME_QUERY_BLOCK_EXECUTION;
 /**
  * The execution node provides a wrapper around an operator. It
  *  - manages the coroutine context for the operator
@@ -79,7 +91,8 @@ class query_context;
  * switch for every row, so our unit of communication across coroutines
  * is an \ref sframe_rows object which represents a collection of rows, but
  * represented columnar-wise. Every communicated block must be of a constant
- * number of rows (i.e. SFRAME_READ_BATCH_SIZE. ex: 256), except for the last
+ * number of rows (chosen for the whole pipeline by \ref choose_block_size,
+ * see \ref SFRAME_QUERY_BLOCK_BYTES), except for the last
  * block which may be smaller. Operators which perform filtering for instance,
  * must hence make sure to buffer accordingly.
  *
@@ -117,6 +130,15 @@ class query_context;
  * any operator is called, it is guaranteed that any previous data it generated
  * has already been consumed.
  *
+ * \subsection execution_node_block_execution Block Execution
+ * Coroutines are only needed by the operators which consume their inputs
+ * and produce their outputs at different rates (filters, appends), or run
+ * work asynchronously (lambda transforms). The other operators (sources,
+ * transforms, projections and unions) compute an output block from one
+ * block of each input, and implement query_operator::execute_block. Their
+ * execution nodes skip the coroutine: get_next() pulls one block from each
+ * input and calls execute_block directly.
+ *
  * \subsection execution_node_usage execution_node Usage
  *
  * The execution_node is not generally used directly (see the hierarchy of
@@ -149,6 +171,9 @@ class execution_node  : public std::enable_shared_from_this<execution_node> {
   execution_node(execution_node&&) = default;
   execution_node& operator=( execution_node&&) = default;
 
+  /// Adds the counters collected to the profile, if profiling
+  ~execution_node();
+
   execution_node(const execution_node&) = delete;
   execution_node& operator=(const execution_node&) = delete;
   
@@ -172,6 +197,19 @@ class execution_node  : public std::enable_shared_from_this<execution_node> {
    */
   std::shared_ptr<sframe_rows> get_next(size_t consumer_id, bool skip=false);
 
+  /**
+   * Collects runtime counters into the profile. Must be called before
+   * the node is first executed.
+   */
+  void enable_profiling(const std::shared_ptr<operator_profile>& profile);
+
+  /**
+   * Sets the number of rows of the blocks the operator emits. All the
+   * connected nodes must use the same block size (see \ref
+   * choose_block_size). Must be called before the node is first executed.
+   */
+  void set_block_size(size_t block_size);
+
   /**
    * Returns the number of inputs of the execution node
    */
@@ -223,6 +261,18 @@ class execution_node  : public std::enable_shared_from_this<execution_node> {
    */
   void start_coroutines();
 
+  /**
+   * Computes the next block of an operator run in block execution mode,
+   * adding it to the operator output. Sets m_block_done when the inputs are
+   * exhausted.
+   */
+  void execute_next_block();
+
+  /// True if the operator may produce more output
+  inline bool has_more_output() const {
+    return m_block_mode ? !m_block_done : bool(m_source);
+  }
+
   /// The operator implementation
   std::shared_ptr<query_operator> m_operator;
 
@@ -250,6 +300,14 @@ class execution_node  : public std::enable_shared_from_this<execution_node> {
   size_t m_head = 0; 
   bool m_coroutines_started = false;
   bool m_skip_next_block = false;
+  size_t m_block_size = sframe_config::SFRAME_READ_BATCH_SIZE;
+
+  /// Block execution state (see \ref execution_node_block_execution)
+  bool m_block_mode = false;
+  bool m_block_done = false;
+  size_t m_block_index = 0;
+  std::shared_ptr<sframe_rows> m_block_buffer;
+  std::vector<std::shared_ptr<const sframe_rows>> m_block_inputs;
 
   /// m_consumer_pos[i] is the ID which consumer i is consuming next.
   std::vector<size_t> m_consumer_pos;
@@ -258,6 +316,30 @@ class execution_node  : public std::enable_shared_from_this<execution_node> {
   bool m_exception_occured = false;
   std::exception_ptr m_exception;
 
+  /**
+   * Profiling. The counters are accumulated locally, and added to
+   * m_profile when the node is destroyed. The time spent in the coroutine
+   * includes the time spent pulling from the inputs, which is accumulated
+   * separately and subtracted.
+   */
+  struct profile_counters {
+    size_t rows_in = 0;
+    size_t rows_out = 0;
+    size_t batches_out = 0;
+    size_t blocks_skipped = 0;
+    uint64_t wall_ns = 0;
+    uint64_t cpu_ns = 0;
+    size_t bytes_decoded = 0;
+    uint64_t input_wall_ns = 0;
+    uint64_t input_cpu_ns = 0;
+    size_t input_bytes_decoded = 0;
+    uint64_t first_call_ns = 0;
+    uint64_t last_return_ns = 0;
+    std::thread::id thread;
+  };
+  std::shared_ptr<operator_profile> m_profile;
+  profile_counters m_counters;
+
   friend class query_context;
 };
 
@@ -0,0 +1,209 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <time.h>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <fileio/fixed_size_cache_manager.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/operators/operator_properties.hpp>
+#include <sframe_query_engine/execution/query_profile.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+static const char* PROFILE_KEY = "__profile__";
+
+uint64_t profile_clock_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t profile_thread_cpu_ns() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void operator_profile::add_span(const span& s) {
+  std::lock_guard<mutex> guard(lock);
+  spans.push_back(s);
+}
+
+void query_profile::start() {
+  m_begin_ns = profile_clock_ns();
+  m_spilled_begin = fileio::fixed_size_cache_manager::get_instance().get_spilled_bytes();
+}
+
+void query_profile::stop() {
+  m_end_ns = profile_clock_ns();
+  m_spilled_end = fileio::fixed_size_cache_manager::get_instance().get_spilled_bytes();
+}
+
+std::shared_ptr<operator_profile>
+query_profile::get_operator_profile(const planner_node& node) {
+  auto iter = node.any_operator_parameters.find(PROFILE_KEY);
+  if (iter == node.any_operator_parameters.end()) return nullptr;
+  return iter->second.as<std::shared_ptr<operator_profile>>();
+}
+
+size_t query_profile::record_node(const std::shared_ptr<planner_node>& node,
+                                  std::map<planner_node*, size_t>& visited) {
+  auto visited_iter = visited.find(node.get());
+  if (visited_iter != visited.end()) return visited_iter->second;
+
+  std::vector<size_t> inputs;
+  for (const auto& input: node->inputs) inputs.push_back(record_node(input, visited));
+
+  // a node which ran in an earlier stage keeps its counters
+  size_t id = 0;
+  auto counters = get_operator_profile(*node);
+  if (counters && m_node_index.count(counters.get())) {
+    id = m_node_index.at(counters.get());
+  } else {
+    pnode_tagger get_tag = [&](std::shared_ptr<planner_node> p) -> std::string {
+      auto iter = m_tags.find(p);
+      if (iter != m_tags.end()) return iter->second;
+      std::string tag = "N" + std::to_string(m_tags.size());
+      m_tags[p] = tag;
+      return tag;
+    };
+    // a node rewritten since an earlier stage is a different operator
+    m_tags.erase(node);
+    node_record record;
+    record.label = planner_node_repr(node, get_tag);
+    record.stage = m_num_stages;
+    record.inputs = inputs;
+    record.counters = std::make_shared<operator_profile>();
+    node->any_operator_parameters[PROFILE_KEY] = record.counters;
+    id = m_nodes.size();
+    m_node_index[record.counters.get()] = id;
+    m_nodes.push_back(std::move(record));
+  }
+  visited[node.get()] = id;
+  return id;
+}
+
+void query_profile::add_stage(const std::shared_ptr<planner_node>& tip) {
+  std::lock_guard<mutex> guard(m_lock);
+  ++m_num_stages;
+  std::map<planner_node*, size_t> visited;
+  record_node(tip, visited);
+}
+
+namespace {
+
+std::string format_bytes(size_t bytes) {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  if (bytes >= 1024 * 1024) ss << bytes / (1024.0 * 1024) << "MB";
+  else if (bytes >= 1024) ss << bytes / 1024.0 << "KB";
+  else ss << bytes << "B";
+  return ss.str();
+}
+
+std::string format_ms(uint64_t ns) {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(3) << ns / 1e6 << "ms";
+  return ss.str();
+}
+
+/// Escapes a string for a double quoted dot label or JSON string
+std::string escape(const std::string& s) {
+  std::string ret;
+  for (char c: s) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+      ret += c;
+    } else if (c == '\n') {
+      ret += "\\n";
+    } else if ((unsigned char)c >= 0x20) {
+      ret += c;
+    }
+  }
+  return ret;
+}
+
+} // anonymous namespace
+
+std::string query_profile::annotated_plan() const {
+  std::lock_guard<mutex> guard(m_lock);
+  std::stringstream out;
+  out << "// query time " << format_ms(elapsed_ns())
+      << ", " << m_num_stages << " stages"
+      << ", " << format_bytes(spilled_bytes()) << " spilled to disk\n";
+  out << "digraph G {\n";
+  for (size_t stage = 1; stage <= m_num_stages; ++stage) {
+    out << "\tsubgraph cluster_" << stage << " {\n"
+        << "\t\tlabel=\"stage " << stage << "\"\n";
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+      const auto& node = m_nodes[i];
+      if (node.stage != stage) continue;
+      const auto& c = *node.counters;
+      std::stringstream label;
+      label << node.label << "\n"
+            << "rows in " << c.rows_in.value
+            << ", out " << c.rows_out.value
+            << " in " << c.batches_out.value << " batches"
+            << " (" << c.num_instances.value << " segments)\n"
+            << "wall " << format_ms(c.wall_time_ns.value)
+            << ", cpu " << format_ms(c.cpu_time_ns.value) << "\n"
+            << "decoded " << format_bytes(c.bytes_decoded.value)
+            << ", skipped " << c.blocks_skipped.value << " blocks";
+      out << "\t\t\"" << i << "\" [label=\"" << escape(label.str()) << "\"]\n";
+    }
+    out << "\t}\n";
+  }
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    for (size_t input: m_nodes[i].inputs) {
+      out << "\t\"" << input << "\" -> \"" << i << "\"\n";
+    }
+  }
+  out << "}";
+  return out.str();
+}
+
+std::string query_profile::chrome_trace() const {
+  std::lock_guard<mutex> guard(m_lock);
+  std::map<std::thread::id, size_t> thread_numbers;
+  std::stringstream out;
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  out << "{\"name\":\"query\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":0,"
+      << "\"dur\":" << elapsed_ns() / 1000 << ","
+      << "\"args\":{\"spilled_bytes\":" << spilled_bytes() << "}}";
+  for (const auto& node: m_nodes) {
+    auto& c = *node.counters;
+    std::lock_guard<mutex> span_guard(c.lock);
+    for (const auto& span: c.spans) {
+      if (thread_numbers.count(span.thread) == 0) {
+        size_t n = thread_numbers.size() + 1;
+        thread_numbers[span.thread] = n;
+      }
+      uint64_t begin = span.begin_ns > m_begin_ns ? span.begin_ns - m_begin_ns : 0;
+      out << ",{\"name\":\"" << escape(node.label) << "\","
+          << "\"cat\":\"stage " << node.stage << "\","
+          << "\"ph\":\"X\",\"pid\":0,"
+          << "\"tid\":" << thread_numbers[span.thread] << ","
+          << "\"ts\":" << begin / 1000 << ","
+          << "\"dur\":" << (span.end_ns - span.begin_ns) / 1000 << ","
+          << "\"args\":{"
+          << "\"rows_in\":" << c.rows_in.value << ","
+          << "\"rows_out\":" << c.rows_out.value << ","
+          << "\"batches_out\":" << c.batches_out.value << ","
+          << "\"blocks_skipped\":" << c.blocks_skipped.value << ","
+          << "\"wall_time_ns\":" << c.wall_time_ns.value << ","
+          << "\"cpu_time_ns\":" << c.cpu_time_ns.value << ","
+          << "\"bytes_decoded\":" << c.bytes_decoded.value << "}}";
+    }
+  }
+  out << "]}";
+  return out.str();
+}
+
+} // namespace query_eval
+} // namespace graphlab
@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_QUERY_ENGINE_QUERY_PROFILE_HPP
+#define GRAPHLAB_SFRAME_QUERY_ENGINE_QUERY_PROFILE_HPP
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <parallel/mutex.hpp>
+#include <parallel/atomic.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+struct planner_node;
+
+/**
+ * Runtime counters of one operator of a query plan, summed over all the
+ * execution nodes (one per parallel segment) running it.
+ *
+ * Times and decoded bytes are exclusive: the time an operator spends
+ * waiting for its inputs is charged to the inputs.
+ */
+struct operator_profile {
+  atomic<size_t> num_instances;
+  atomic<size_t> rows_in;
+  atomic<size_t> rows_out;
+  atomic<size_t> batches_out;
+  /// Output blocks the consumers asked to skip
+  atomic<size_t> blocks_skipped;
+  atomic<size_t> wall_time_ns;
+  atomic<size_t> cpu_time_ns;
+  /// Bytes of sarray blocks decoded
+  atomic<size_t> bytes_decoded;
+
+  /// The time an execution node was active, for the trace
+  struct span {
+    std::thread::id thread;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+  };
+  void add_span(const span& s);
+
+  mutex lock;
+  std::vector<span> spans;
+};
+
+/**
+ * The profile of a materialization, collected when
+ * materialize_options::profile is set.
+ *
+ * The planner calls \ref add_stage with every plan it executes (the
+ * optimized plan, and the plans run by partial materialization), which
+ * attaches an \ref operator_profile to every node of the plan. The
+ * execution nodes fill the counters in as they run.
+ */
+class query_profile {
+ public:
+  /// Records the start of the query
+  void start();
+
+  /// Records the end of the query
+  void stop();
+
+  /**
+   * Attaches counters to the nodes of a plan about to be executed, and
+   * records the shape of the plan.
+   */
+  void add_stage(const std::shared_ptr<planner_node>& tip);
+
+  /**
+   * Returns the counters attached to a planner node, or nullptr if the
+   * node is not being profiled.
+   */
+  static std::shared_ptr<operator_profile> get_operator_profile(const planner_node& node);
+
+  /**
+   * Returns the executed plans as a dot graph, with one cluster per stage,
+   * each operator annotated with its counters.
+   */
+  std::string annotated_plan() const;
+
+  /**
+   * Returns the profile in the Chrome trace event format (JSON), which can
+   * be loaded in chrome://tracing.
+   */
+  std::string chrome_trace() const;
+
+  /// Wall time of the query
+  uint64_t elapsed_ns() const { return m_end_ns - m_begin_ns; }
+
+  /**
+   * The bytes spilled to disk by the query: the bytes written to temp
+   * storage by the spill sessions of the query (see \ref spill_manager),
+   * plus the bytes the fileio cache wrote to disk while the query ran.
+   */
+  size_t spilled_bytes() const {
+    return (m_spilled_end - m_spilled_begin) + m_operator_spilled_bytes->value;
+  }
+
+  /**
+   * The counter of the bytes spilled by the spill sessions of the query,
+   * for the spill_accounting_scope the planner opens while it runs.
+   */
+  const std::shared_ptr<atomic<size_t>>& operator_spill_counter() const {
+    return m_operator_spilled_bytes;
+  }
+
+ private:
+  struct node_record {
+    std::string label;
+    size_t stage = 0;
+    std::vector<size_t> inputs;
+    std::shared_ptr<operator_profile> counters;
+  };
+
+  size_t record_node(const std::shared_ptr<planner_node>& node,
+                     std::map<planner_node*, size_t>& visited);
+
+  std::vector<node_record> m_nodes;
+  std::map<const operator_profile*, size_t> m_node_index;
+  /// Names of the nodes in the labels, shared by all stages
+  std::map<std::shared_ptr<planner_node>, std::string> m_tags;
+  size_t m_num_stages = 0;
+  uint64_t m_begin_ns = 0;
+  uint64_t m_end_ns = 0;
+  /// The bytes the fileio cache spilled when the query started and ended
+  size_t m_spilled_begin = 0;
+  size_t m_spilled_end = 0;
+  std::shared_ptr<atomic<size_t>> m_operator_spilled_bytes =
+      std::make_shared<atomic<size_t>>();
+  mutable mutex m_lock;
+};
+
+/// A monotonic clock, in nanoseconds
+uint64_t profile_clock_ns();
+
+/// The CPU time used by the calling thread, in nanoseconds
+uint64_t profile_thread_cpu_ns();
+
+} // namespace query_eval
+} // namespace graphlab
+#endif
@@ -0,0 +1,48 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <sframe_query_engine/execution/running_queries.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+void running_query_info::begin_stage(int64_t expected_rows) {
+  stage_rows_output.value = 0;
+  stage_expected_rows.value = expected_rows;
+  num_stages.inc();
+}
+
+running_queries& running_queries::get_instance() {
+  static running_queries* instance = new running_queries();
+  return *instance;
+}
+
+std::shared_ptr<running_query_info>
+running_queries::add(const std::string& description) {
+  auto info = std::make_shared<running_query_info>();
+  info->description = description;
+  info->stage_expected_rows.value = -1;
+  std::lock_guard<mutex> guard(m_lock);
+  info->id = m_next_id++;
+  m_queries[info->id] = info;
+  return info;
+}
+
+void running_queries::remove(size_t id) {
+  std::lock_guard<mutex> guard(m_lock);
+  if (m_queries.erase(id)) m_num_completed.inc();
+}
+
+std::vector<std::shared_ptr<running_query_info>> running_queries::list() const {
+  std::lock_guard<mutex> guard(m_lock);
+  std::vector<std::shared_ptr<running_query_info>> ret;
+  for (const auto& query: m_queries) ret.push_back(query.second);
+  return ret;
+}
+
+} // namespace query_eval
+} // namespace graphlab
@@ -0,0 +1,81 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_QUERY_ENGINE_RUNNING_QUERIES_HPP
+#define GRAPHLAB_SFRAME_QUERY_ENGINE_RUNNING_QUERIES_HPP
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <parallel/mutex.hpp>
+#include <parallel/atomic.hpp>
+#include <timer/timer.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+/**
+ * The progress of a query run by planner::materialize.
+ *
+ * A query runs as a sequence of stages: the partial materializations
+ * of the plan, then the final stage. The progress of a stage is the number
+ * of rows it has output, out of the length of its output when it is known.
+ */
+struct running_query_info {
+  size_t id = 0;
+  /// The operator at the tip of the plan
+  std::string description;
+  timer elapsed;
+
+  atomic<size_t> num_stages;
+  atomic<size_t> stage_rows_output;
+  /// -1 if the length of the output of the stage is not known
+  atomic<int64_t> stage_expected_rows;
+
+  /// The bytes the spill sessions of the query wrote to temp storage
+  std::shared_ptr<atomic<size_t>> spilled_bytes =
+      std::make_shared<atomic<size_t>>();
+
+  /// Called by the planner when it starts a stage
+  void begin_stage(int64_t expected_rows);
+
+  /// Called by the executor when a stage outputs rows
+  void add_rows_output(size_t num_rows) { stage_rows_output.inc(num_rows); }
+};
+
+/**
+ * The global registry of the running queries, see running_query_scope.
+ * Only top level queries are registered: the materializations a query runs
+ * on its own thread (e.g. a sort materializing its input) are part of it.
+ */
+class running_queries {
+ public:
+  static running_queries& get_instance();
+
+  /// Registers a query, which stays listed until \ref remove is called
+  std::shared_ptr<running_query_info> add(const std::string& description);
+
+  void remove(size_t id);
+
+  /// Returns the queries running right now, oldest first
+  std::vector<std::shared_ptr<running_query_info>> list() const;
+
+  /// The number of queries run to completion (or failure) so far
+  size_t num_completed() const { return m_num_completed.value; }
+
+ private:
+  running_queries() = default;
+
+  mutable mutex m_lock;
+  size_t m_next_id = 0;
+  std::map<size_t, std::shared_ptr<running_query_info>> m_queries;
+  atomic<size_t> m_num_completed;
+};
+
+} // namespace query_eval
+} // namespace graphlab
+#endif
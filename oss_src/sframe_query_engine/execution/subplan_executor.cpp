@@ -6,8 +6,12 @@
  * of the BSD license. See the LICENSE file for details.
  */
 #include <parallel/lambda_omp.hpp>
+#include <cppipc/cppipc.hpp>
 #include <sframe_query_engine/execution/subplan_executor.hpp>
 #include <sframe_query_engine/execution/execution_node.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
+#include <sframe_query_engine/execution/query_profile.hpp>
+#include <sframe_query_engine/execution/running_queries.hpp>
 #include <sframe_query_engine/operators/operator_properties.hpp> 
 
 namespace graphlab { namespace query_eval {
@@ -16,6 +20,7 @@ namespace graphlab { namespace query_eval {
 
 static std::shared_ptr<execution_node> get_executor(
     const std::shared_ptr<planner_node>& p,
+    size_t block_size,
     std::map<std::shared_ptr<planner_node>, 
              std::shared_ptr<execution_node> >& memo) {
   // See if things are cached; if so, just return that.
@@ -25,11 +30,15 @@ static std::shared_ptr<execution_node> get_executor(
   std::vector<std::shared_ptr<execution_node> > inputs(p->inputs.size());
 
   for(size_t i = 0; i < p->inputs.size(); ++i) {
-    inputs[i] = get_executor(p->inputs[i], memo);
+    inputs[i] = get_executor(p->inputs[i], block_size, memo);
   }
   // Make the operator.
   std::shared_ptr<query_operator> op = planner_node_to_operator(p);
   memo[p] = std::make_shared<execution_node>(op, inputs);
+  memo[p]->set_block_size(block_size);
+  if (auto profile = query_profile::get_operator_profile(*p)) {
+    memo[p]->enable_profiling(profile);
+  }
   return memo[p]; 
 }
 
@@ -82,13 +91,95 @@ find_earliest_exception(std::shared_ptr<execution_node> tip,
   }
 }
 
+/**
+ * Runs a plan made only of operators supporting block execution (see
+ * query_operator::execute_block) as a single loop, pushing the blocks
+ * through the operators: each iteration computes one block of every
+ * operator in topological order, and passes the block of the tip to
+ * out_function. There is no coroutine, and no queue between the operators.
+ *
+ * Returns false without running anything if some operator of the plan does
+ * not support block execution, or is being profiled.
+ */
+static bool try_run_block_pipeline(const std::shared_ptr<planner_node>& plan,
+                                   size_t block_size,
+                                   size_t output_segment_id,
+                                   execution_callback out_function,
+                                   running_query_info* progress) {
+  if (!SFRAME_QUERY_BLOCK_EXECUTION) return false;
+
+  // the operators in topological order, and the positions of their inputs
+  std::vector<std::shared_ptr<query_operator>> ops;
+  std::vector<std::vector<size_t>> op_inputs;
+  std::map<const planner_node*, size_t> position;
+  bool supported = true;
+  std::function<size_t(const std::shared_ptr<planner_node>&)> visit =
+      [&](const std::shared_ptr<planner_node>& p)->size_t {
+    auto iter = position.find(p.get());
+    if (iter != position.end()) return iter->second;
+    std::vector<size_t> inputs;
+    for (const auto& input: p->inputs) {
+      inputs.push_back(visit(input));
+      if (!supported) return 0;
+    }
+    auto op = planner_node_to_operator(p);
+    if (!op->supports_block_execution() || query_profile::get_operator_profile(*p)) {
+      supported = false;
+      return 0;
+    }
+    ops.push_back(op);
+    op_inputs.push_back(inputs);
+    position[p.get()] = ops.size() - 1;
+    return ops.size() - 1;
+  };
+  visit(plan);
+  if (!supported) return false;
+
+  // every operator has a single output buffer, reused for all the blocks
+  std::vector<std::shared_ptr<sframe_rows>> outputs(ops.size());
+  for (auto& output: outputs) output = std::make_shared<sframe_rows>();
+  std::vector<std::vector<std::shared_ptr<const sframe_rows>>> inputs(ops.size());
+  for (size_t i = 0;i < ops.size(); ++i) {
+    for (size_t input: op_inputs[i]) inputs[i].push_back(outputs[input]);
+  }
+
+  for (size_t block_index = 0; ; ++block_index) {
+    if (cppipc::must_cancel()) {
+      throw("Canceled by user");
+    }
+    bool done = false;
+    for (size_t i = 0;i < ops.size(); ++i) {
+      if (!ops[i]->execute_block(inputs[i], block_index, block_size, *outputs[i])) {
+        done = true;
+        break;
+      }
+    }
+    if (done) {
+      // all the sources must end together
+      for (size_t i = 0;i < ops.size(); ++i) {
+        if (op_inputs[i].empty()) ASSERT_FALSE(ops[i]->has_block(block_index, block_size));
+      }
+      break;
+    }
+    if (progress) progress->add_rows_output(outputs.back()->num_rows());
+    if (out_function(output_segment_id, outputs.back())) break;
+  }
+  return true;
+}
+
 void subplan_executor::generate_to_callback_function(
     const std::shared_ptr<planner_node>& plan,
     size_t output_segment_id,
-    execution_callback out_function) {
+    execution_callback out_function,
+    running_query_info* progress) {
+
+  size_t block_size = choose_block_size(plan);
+  if (try_run_block_pipeline(plan, block_size, output_segment_id, out_function, progress)) {
+    return;
+  }
 
   std::map<std::shared_ptr<planner_node>, std::shared_ptr<execution_node> > memo;
-  std::shared_ptr<execution_node> ex_op = get_executor(plan, memo);
+  std::shared_ptr<execution_node> ex_op = get_executor(plan, block_size, memo);
 
   size_t consumer_id = ex_op->register_consumer();
 
@@ -96,6 +187,7 @@ void subplan_executor::generate_to_callback_function(
     auto rows = ex_op->get_next(consumer_id);
     if (rows == nullptr)
       break;
+    if (progress) progress->add_rows_output(rows->num_rows());
 
     bool done = out_function(output_segment_id, rows);
     if(done)
@@ -119,7 +211,8 @@ void subplan_executor::generate_to_callback_function(
 
 void subplan_executor::generate_to_sframe_segment(const std::shared_ptr<planner_node>& plan,
                                           sframe& out,
-                                          size_t output_segment_id) {
+                                          size_t output_segment_id,
+                                          running_query_info* progress) {
 
   auto outiter = out.get_output_iterator(output_segment_id);
 
@@ -128,7 +221,8 @@ void subplan_executor::generate_to_sframe_segment(const std::shared_ptr<planner_
       [&](size_t segment_idx, const std::shared_ptr<sframe_rows>& rows) {
         (*outiter) = *rows;
         return false;
-      });
+      },
+      progress);
 }
 
 
@@ -136,7 +230,8 @@ sframe subplan_executor::run(const std::shared_ptr<planner_node>& pnode,
                              const materialize_options& exec_params) {
 
   if(exec_params.write_callback != nullptr) {
-    generate_to_callback_function(pnode, 0, exec_params.write_callback);
+    generate_to_callback_function(pnode, 0, exec_params.write_callback,
+                                  exec_params.progress.get());
 
     sframe ret;
     return ret;
@@ -144,7 +239,7 @@ sframe subplan_executor::run(const std::shared_ptr<planner_node>& pnode,
     sframe out = get_output_sframe_schema(pnode, 
                                           1, // just 1 segment will do
                                           exec_params.output_index_file); 
-    generate_to_sframe_segment(pnode, out, 0);
+    generate_to_sframe_segment(pnode, out, 0, exec_params.progress.get());
     out.close();
     return out;
   }
@@ -177,7 +272,8 @@ sframe subplan_executor::run_concat(
     execution_callback exec_f = exec_params.write_callback;
 
     parallel_for(0, stuff_to_run_in_parallel.size(), [&](size_t i) {
-        generate_to_callback_function(stuff_to_run_in_parallel[i], i, exec_f);
+        generate_to_callback_function(stuff_to_run_in_parallel[i], i, exec_f,
+                                      exec_params.progress.get());
       });
 
     // make an empty sframe and return
@@ -191,7 +287,8 @@ sframe subplan_executor::run_concat(
                                           exec_params.output_column_names);
 
     parallel_for(0, stuff_to_run_in_parallel.size(), [&](size_t i) {
-        generate_to_sframe_segment(stuff_to_run_in_parallel[i], ret, i);
+        generate_to_sframe_segment(stuff_to_run_in_parallel[i], ret, i,
+                                   exec_params.progress.get());
       });
 
     ret.close();
@@ -87,7 +87,8 @@ class subplan_executor {
   */
   void generate_to_sframe_segment(const std::shared_ptr<planner_node>& run_this,
                                   sframe& out, 
-                                  size_t output_segment_id);
+                                  size_t output_segment_id,
+                                  running_query_info* progress);
 
   /**
    * \internal
@@ -96,7 +97,8 @@ class subplan_executor {
   void generate_to_callback_function(
     const std::shared_ptr<planner_node>& plan,
     size_t output_segment_id,
-    execution_callback out_f);
+    execution_callback out_f,
+    running_query_info* progress);
 };
 
 }}
@@ -21,6 +21,7 @@
 #include <sframe_query_engine/operators/union.hpp>
 #include <sframe_query_engine/operators/generalized_union_project.hpp>
 #include <sframe_query_engine/operators/reduce.hpp>
+#include <sframe_query_engine/operators/sample_mask.hpp>
 #include <sframe_query_engine/operators/lambda_transform.hpp>
 #include <sframe_query_engine/operators/optonly_identity_operator.hpp>
 
@@ -56,33 +56,36 @@ class operator_impl<planner_node_type::BINARY_TRANSFORM_NODE> : public query_ope
       auto rows_right = context.get_next(1);
       if (rows_left == nullptr && rows_right == nullptr) break;
       ASSERT_TRUE(rows_left != nullptr && rows_right != nullptr);
-      ASSERT_EQ(rows_left->num_rows(), rows_right->num_rows());
-      ASSERT_EQ(rows_left->num_columns(), 1);
-      ASSERT_EQ(rows_right->num_columns(), 1);
       auto output_buffer = context.get_output_buffer();
-      output_buffer->resize(1, rows_left->num_rows());
-
-      auto left_iter = rows_left->cbegin();
-      auto right_iter = rows_right->cbegin();
-      auto out_iter = output_buffer->begin();
-      while(left_iter != rows_left->cend()) {
-        (*out_iter)[0] = m_transform_fn((*left_iter), (*right_iter));
-        ++left_iter;
-        ++right_iter;
-        ++out_iter;
-      }
+      transform_block(*rows_left, *rows_right, *output_buffer);
       context.emit(output_buffer);
     }
   }
 
+  bool supports_block_execution() const { return true; }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    transform_block(*inputs[0], *inputs[1], output);
+    return true;
+  }
+
+  /**
+   * If fingerprint is not empty, it identifies the function: binary
+   * transforms of the same inputs with the same fingerprint compute the
+   * same values, and the planner computes them once.
+   */
   static std::shared_ptr<planner_node> make_planner_node(
       std::shared_ptr<planner_node> left,
       std::shared_ptr<planner_node> right,
-        binary_transform_type fn,
-      flex_type_enum output_type) {
-    
+      binary_transform_type fn,
+      flex_type_enum output_type,
+      const std::string& fingerprint = "") {
+    std::map<std::string, flexible_type> params{{"output_type", (int)(output_type)}};
+    if (!fingerprint.empty()) params["fingerprint"] = fingerprint;
     return planner_node::make_shared(planner_node_type::BINARY_TRANSFORM_NODE, 
-                                     {{"output_type", (int)(output_type)}},
+                                     params,
                                      {{"function", any(fn)}},
                                      {left, right});
   }
@@ -114,6 +117,24 @@ class operator_impl<planner_node_type::BINARY_TRANSFORM_NODE> : public query_ope
   }
   
  private:
+  void transform_block(const sframe_rows& rows_left, const sframe_rows& rows_right,
+                       sframe_rows& output) {
+    ASSERT_EQ(rows_left.num_rows(), rows_right.num_rows());
+    ASSERT_EQ(rows_left.num_columns(), 1);
+    ASSERT_EQ(rows_right.num_columns(), 1);
+    output.resize(1, rows_left.num_rows());
+
+    auto left_iter = rows_left.cbegin();
+    auto right_iter = rows_right.cbegin();
+    auto out_iter = output.begin();
+    while(left_iter != rows_left.cend()) {
+      (*out_iter)[0] = m_transform_fn((*left_iter), (*right_iter));
+      ++left_iter;
+      ++right_iter;
+      ++out_iter;
+    }
+  }
+
    binary_transform_type m_transform_fn;
    flex_type_enum m_output_type;
 };
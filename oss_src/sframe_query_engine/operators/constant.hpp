@@ -69,6 +69,22 @@ struct operator_impl<planner_node_type::CONSTANT_NODE> : public query_operator {
     }
   }
 
+  bool supports_block_execution() const { return true; }
+
+  bool has_block(size_t block_index, size_t block_size) const {
+    return block_index * block_size < m_len;
+  }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    if (!has_block(block_index, block_size)) return false;
+    size_t start = block_index * block_size;
+    output.resize(1, std::min(m_len - start, block_size));
+    for (auto& value: *(output.get_columns()[0])) value = m_value;
+    return true;
+  }
+
   static std::shared_ptr<planner_node> make_planner_node(const flexible_type& val,
                                             flex_type_enum type,
                                             size_t count) {
@@ -46,33 +46,40 @@ class operator_impl<planner_node_type::GENERALIZED_TRANSFORM_NODE> : public quer
   { }
   
   inline std::shared_ptr<query_operator> clone() const {
-    return std::make_shared<operator_impl>(*this);
+    auto ret = std::make_shared<operator_impl>(*this);
+    ret->m_seeded = false;
+    return ret;
   }
 
   inline void execute(query_context& context) {
     if (m_random_seed != -1){
       random::get_source().seed(m_random_seed + thread::thread_id());
     }
-    std::vector<flexible_type> ret;
     while(1) {
       auto rows = context.get_next(0);
       if (rows == nullptr)
         break;
       auto output = context.get_output_buffer();
-      output->resize(m_output_types.size(), rows->num_rows());
-
-      auto iter = rows->cbegin();
-      auto output_iter = output->begin();
-      while(iter != rows->cend()) {
-        m_transform_fn((*iter), (*output_iter));
-        ++output_iter;
-        ++iter;
-      }
-      output->type_check_inplace(m_output_types);
+      transform_block(*rows, *output);
       context.emit(output);
     }
   }
 
+  bool supports_block_execution() const { return true; }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    // seeded on the first block this instance runs, which need not be
+    // block 0 when blocks are skipped
+    if (!m_seeded && m_random_seed != -1) {
+      random::get_source().seed(m_random_seed + thread::thread_id());
+      m_seeded = true;
+    }
+    transform_block(*inputs[0], output);
+    return true;
+  }
+
   static std::shared_ptr<planner_node> make_planner_node(
       std::shared_ptr<planner_node> source,
       generalized_transform_type fn,
@@ -140,9 +147,24 @@ class operator_impl<planner_node_type::GENERALIZED_TRANSFORM_NODE> : public quer
   }
 
  private:
+  void transform_block(const sframe_rows& rows, sframe_rows& output) {
+    output.resize(m_output_types.size(), rows.num_rows());
+
+    auto iter = rows.cbegin();
+    auto output_iter = output.begin();
+    while(iter != rows.cend()) {
+      m_transform_fn((*iter), (*output_iter));
+      ++output_iter;
+      ++iter;
+    }
+    output.type_check_inplace(m_output_types);
+  }
+
   generalized_transform_type m_transform_fn;
   std::vector<flex_type_enum> m_output_types;
   int m_random_seed;
+  /// True once execute_block has seeded the random source
+  bool m_seeded = false;
 };
 
 typedef operator_impl<planner_node_type::GENERALIZED_TRANSFORM_NODE> op_generalized_transform; 
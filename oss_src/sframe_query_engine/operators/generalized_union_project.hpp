@@ -44,11 +44,6 @@ struct operator_impl<planner_node_type::GENERALIZED_UNION_PROJECT_NODE> : public
   inline void execute(query_context& context) {
     std::vector<std::shared_ptr<const sframe_rows> > input_v(num_inputs);
 
-    std::vector<
-      std::vector<
-        std::shared_ptr<
-          std::vector<graphlab::flexible_type> > > > input_columns(num_inputs);
-
     while(1) {
       bool all_null = true, any_null = false;
       for(size_t i = 0; i < num_inputs; ++i) {
@@ -64,20 +59,24 @@ struct operator_impl<planner_node_type::GENERALIZED_UNION_PROJECT_NODE> : public
         break;
       }
 
-      for(size_t i = 0; i < num_inputs; ++i) {
-        input_columns[i] = std::move(input_v[i]->get_columns());
-      }
-
       auto out = context.get_output_buffer();
-      auto& out_columns = out->get_columns();
-      out_columns.clear();
+      execute_block(input_v, 0, context.block_size(), *out);
+      context.emit(out);
+    }
+  }
 
-      for(const std::pair<size_t, size_t>& p : index_map) {
-        out_columns.push_back(input_columns[p.first][p.second]);
-      }
+  bool supports_block_execution() const { return true; }
 
-      context.emit(out);
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    auto& out_columns = output.get_columns();
+    out_columns.clear();
+
+    for(const std::pair<size_t, size_t>& p : index_map) {
+      out_columns.push_back(inputs[p.first]->get_columns()[p.second]);
     }
+    return true;
   }
 
  private:
@@ -7,18 +7,37 @@
  */
 #ifndef GRAPHLAB_SFRAME_QUERY_MANAGER_LAMBDA_TRANSFORM_HPP
 #define GRAPHLAB_SFRAME_QUERY_MANAGER_LAMBDA_TRANSFORM_HPP
+#include <deque>
+#include <future>
 #include <flexible_type/flexible_type.hpp>
 #include <sframe_query_engine/operators/operator.hpp>
 #include <sframe_query_engine/execution/query_context.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
 #include <sframe_query_engine/operators/operator_properties.hpp>
 #include <lambda/pylambda_function.hpp>
+#include <lambda/lambda_master.hpp>
+#include <lambda/lambda_constants.hpp>
 #include <exceptions/error_types.hpp>
+#include <util/cityhash_gl.hpp>
 namespace graphlab { 
 namespace query_eval {
 
 /**
  * A "transform" operator that applies a python lambda function to a 
  * single stream of input.
+ *
+ * Up to LAMBDA_MAX_INFLIGHT_BATCHES input blocks are evaluated
+ * asynchronously at the same time, on the dispatch threads of the
+ * lambda_master, so that the lambda workers are kept busy while the
+ * pipeline reads the next blocks. Results are emitted in input order.
+ *
+ * A block which the consumer skips is not dispatched: the operator skips
+ * its input block instead, unless blocks are still in flight.
+ *
+ * The blocks have the size chosen for the pipeline (see \ref
+ * choose_block_size); the width of the values returned by the lambda is
+ * recorded from the first block, so that the later queries running the
+ * same lambda size their blocks by it.
  */
 template<>
 class operator_impl<planner_node_type::LAMBDA_TRANSFORM_NODE> : public query_operator {
@@ -30,7 +49,11 @@ class operator_impl<planner_node_type::LAMBDA_TRANSFORM_NODE> : public query_ope
 
   static query_operator_attributes attributes() {
     query_operator_attributes ret;
-    ret.attribute_bitfield = query_operator_attributes::LINEAR;
+    // Supports skipping, since the execution node cannot bypass an operator
+    // which has already consumed the inputs of the blocks in flight. Once
+    // nothing is in flight, skipped blocks are skipped on the input.
+    ret.attribute_bitfield = query_operator_attributes::LINEAR |
+        query_operator_attributes::SUPPORTS_SKIPPING;
     ret.num_inputs = 1;
     return ret;
   }
@@ -38,38 +61,86 @@ class operator_impl<planner_node_type::LAMBDA_TRANSFORM_NODE> : public query_ope
   ////////////////////////////////////////////////////////////////////////////////
   inline operator_impl(std::shared_ptr<lambda::pylambda_function> lambda,
                        flex_type_enum output_type,
-                       const std::vector<std::string>& column_names = {})
+                       const std::vector<std::string>& column_names = {},
+                       uint64_t lambda_key = 0)
       : m_lambda(lambda), m_output_type(output_type),
-        m_column_names(column_names) { }
+        m_column_names(column_names), m_lambda_key(lambda_key) { }
 
   inline std::shared_ptr<query_operator> clone() const {
     return std::make_shared<operator_impl>(*this);
   }
 
   inline void execute(query_context& context) {
+    size_t max_inflight = std::max<size_t>(LAMBDA_MAX_INFLIGHT_BATCHES, 1);
+    std::deque<std::future<std::vector<flexible_type>>> inflight;
+    emit_state state = context.initial_state();
+
+    // waits for the oldest batch in flight and emits it
+    bool width_recorded = (m_lambda_key == 0);
+    auto emit_oldest = [&]() {
+      std::vector<flexible_type> out = inflight.front().get();
+      inflight.pop_front();
+      if (!width_recorded && !out.empty()) {
+        size_t bytes = 0;
+        for (const auto& val: out) bytes += estimate_value_bytes(val);
+        record_observed_value_bytes(m_lambda_key, bytes / out.size());
+        width_recorded = true;
+      }
+      if (state == emit_state::SKIP_NEXT_BLOCK) {
+        state = context.emit(nullptr);
+        return;
+      }
+      auto output = context.get_output_buffer();
+      output->resize(1, out.size());
+      for (size_t i = 0;i < out.size(); ++i) {
+        (*output)[i][0] = std::move(out[i]);
+      }
+      state = context.emit(output);
+    };
+
     while(1) {
+      if (state == emit_state::SKIP_NEXT_BLOCK) {
+        if (inflight.empty()) {
+          // the next block is skipped: do not read nor evaluate it
+          context.skip_next(0);
+          state = context.emit(nullptr);
+        } else {
+          // the oldest block in flight is dropped
+          emit_oldest();
+        }
+        continue;
+      }
       auto rows = context.get_next(0);
       if (rows == nullptr)
         break;
 
-      auto output = context.get_output_buffer();
-      output->resize(1, rows->num_rows());
-      std::vector<flexible_type> out;
-
-      // TODO exception handling
-      if (m_column_names.empty()) {
-        // evalute on sarray
-        m_lambda->eval(*rows, out);
-      } else {
-        // need column names to evalute on sframe
-        m_lambda->eval(m_column_names, *rows, out);
-      }
-    
-      for (size_t i = 0;i < out.size(); ++i) {
-        (*output)[i][0] = convert_value_to_output_type(out[i], m_output_type);
-      }
-      context.emit(output);
+      // the input buffer is reused by the producer, so take a
+      // (copy on write) copy of it for the evaluation.
+      auto lambda = m_lambda;
+      auto column_names = m_column_names;
+      auto output_type = m_output_type;
+      sframe_rows input = *rows;
+      auto task = std::make_shared<std::packaged_task<std::vector<flexible_type>()>>(
+        [lambda, column_names, output_type, input]() {
+          std::vector<flexible_type> out;
+          if (column_names.empty()) {
+            // evalute on sarray
+            lambda->eval(input, out);
+          } else {
+            // need column names to evalute on sframe
+            lambda->eval(column_names, input, out);
+          }
+          for (auto& val : out) {
+            val = convert_value_to_output_type(val, output_type);
+          }
+          return out;
+        });
+      inflight.push_back(task->get_future());
+      lambda::lambda_master::get_instance().launch_dispatch([task]() { (*task)(); });
+
+      if (inflight.size() >= max_inflight) emit_oldest();
     }
+    while (!inflight.empty()) emit_oldest();
   }
 
   static std::shared_ptr<planner_node> make_planner_node(
@@ -113,7 +184,9 @@ class operator_impl<planner_node_type::LAMBDA_TRANSFORM_NODE> : public query_ope
 
     auto fn = pnode->any_operator_parameters["lambda_fn"]
                             .as<std::shared_ptr<lambda::pylambda_function>>();
-    return std::make_shared<operator_impl>(fn, output_type, column_names);
+    uint64_t lambda_key =
+        hash64(pnode->operator_parameters["lambda_str"].get<flex_string>());
+    return std::make_shared<operator_impl>(fn, output_type, column_names, lambda_key);
   }
 
   static std::vector<flex_type_enum> infer_type(std::shared_ptr<planner_node> pnode) {
@@ -151,6 +224,7 @@ class operator_impl<planner_node_type::LAMBDA_TRANSFORM_NODE> : public query_ope
   std::shared_ptr<lambda::pylambda_function> m_lambda;
   flex_type_enum m_output_type;
   std::vector<std::string> m_column_names;
+  uint64_t m_lambda_key = 0;
 
  private:
   /**
@@ -11,8 +11,10 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
 #include <util/any.hpp>
 #include <flexible_type/flexible_type.hpp>
+#include <sframe/sframe_rows.hpp>
 #include <sframe_query_engine/planning/planner_node.hpp>
 #include <sframe_query_engine/operators/operator_properties.hpp>
 namespace graphlab {
@@ -125,6 +127,41 @@ class query_operator {
    */
   virtual void execute(query_context& context) { ASSERT_TRUE(false); }
 
+  /**
+   * Returns true if the operator can be executed a block at a time by
+   * \ref execute_block, without a coroutine of its own. This is the case of
+   * the sources, and of the linear operators which compute each output
+   * block from one block of each input and keep no state across blocks.
+   */
+  virtual bool supports_block_execution() const { return false; }
+
+  /**
+   * Computes the output block number block_index (of block_size rows but
+   * for the last) into output, from the corresponding block of each input
+   * in inputs.
+   *
+   * A source gets no inputs, and returns false if it has no rows at
+   * block_index. Other operators always return true; they are not called
+   * once their inputs are exhausted.
+   *
+   * The output buffer is reused across blocks: it may hold the previous
+   * block of the operator.
+   */
+  virtual bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                             size_t block_index, size_t block_size,
+                             sframe_rows& output) {
+    ASSERT_TRUE(false);
+    return false;
+  }
+
+  /**
+   * For a source supporting block execution: returns true if it has rows
+   * at block_index, without reading them. Used to skip blocks.
+   */
+  virtual bool has_block(size_t block_index, size_t block_size) const {
+    return true;
+  }
+
   /** The base case -- the logical-only nodes don't use this.
    *
    */
@@ -50,6 +50,8 @@ RetType extract_field(planner_node_type ptype, CallArgs... call_args) {
       return FieldExtractionVisitor<planner_node_type::REDUCE_NODE>::get(call_args...);
     case planner_node_type::GENERALIZED_UNION_PROJECT_NODE:
       return FieldExtractionVisitor<planner_node_type::GENERALIZED_UNION_PROJECT_NODE>::get(call_args...);
+    case planner_node_type::SAMPLE_MASK_NODE:
+      return FieldExtractionVisitor<planner_node_type::SAMPLE_MASK_NODE>::get(call_args...);
     case planner_node_type::IDENTITY_NODE:
       return FieldExtractionVisitor<planner_node_type::IDENTITY_NODE>::get(call_args...);
     case planner_node_type::INVALID:
@@ -69,7 +71,7 @@ template <planner_node_type PType> struct visitor_infer_type {
 };
 
 std::vector<flex_type_enum> infer_planner_node_type(pnode_ptr pnode) {
-  std::lock_guard<recursive_mutex> GLOBAL_LOCK(global_query_lock);
+  std::lock_guard<recursive_mutex> GRAPH_LOCK(planner_graph_lock);
 
   if (pnode->any_operator_parameters.count("__type_memo__")) {
     return pnode->any_operator_parameters["__type_memo__"].as<std::vector<flex_type_enum>>();
@@ -93,7 +95,7 @@ template <planner_node_type PType> struct visitor_infer_length {
 };
 
 int64_t infer_planner_node_length(pnode_ptr pnode) {
-  std::lock_guard<recursive_mutex> GLOBAL_LOCK(global_query_lock);
+  std::lock_guard<recursive_mutex> GRAPH_LOCK(planner_graph_lock);
   
   if (pnode->any_operator_parameters.count("__length_memo__")) {
     return pnode->any_operator_parameters["__length_memo__"].as<int64_t>();
@@ -129,7 +131,7 @@ static void _fill_dependency_set(pnode_ptr tip, std::set<pnode_ptr>& seen_nodes)
 /** Returns the number of nodes in this planning graph, including pnode. 
  */
 size_t infer_planner_node_num_dependency_nodes(std::shared_ptr<planner_node> pnode) {
-  std::lock_guard<recursive_mutex> GLOBAL_LOCK(global_query_lock);
+  std::lock_guard<recursive_mutex> GRAPH_LOCK(planner_graph_lock);
 
   std::set<pnode_ptr> seen_node_memo;
   _fill_dependency_set(pnode, seen_node_memo);
@@ -371,6 +373,11 @@ std::string planner_node_repr(const std::shared_ptr<planner_node>& node) {
     }
   };
 
+  return planner_node_repr(node, get_tag);
+}
+
+std::string planner_node_repr(const std::shared_ptr<planner_node>& node,
+                              pnode_tagger& get_tag) {
   return get_tag(node) + ": " + extract_field<visitor_repr, std::string>(node->operator_type, node, get_tag);
 }
 
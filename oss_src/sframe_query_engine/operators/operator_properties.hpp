@@ -38,6 +38,7 @@ enum class planner_node_type : int {
     UNION_NODE,
     GENERALIZED_UNION_PROJECT_NODE,
     REDUCE_NODE,
+    SAMPLE_MASK_NODE,
 
       // These are used as logical-node-only types.  Do not actually become an operator.
       IDENTITY_NODE,
@@ -135,6 +136,12 @@ typedef std::function<std::string(std::shared_ptr<planner_node>)> pnode_tagger;
  */
 std::string planner_node_repr(const std::shared_ptr<planner_node>& node);
 
+/** Representation of the node as a string, naming the node and the nodes
+ *  it refers to with get_tag.
+ */
+std::string planner_node_repr(const std::shared_ptr<planner_node>& node,
+                              pnode_tagger& get_tag);
+
 
 std::ostream& operator<<(std::ostream&,
                       const std::shared_ptr<planner_node>& node);
@@ -56,17 +56,25 @@ struct operator_impl<planner_node_type::PROJECT_NODE> : public query_operator {
         break;
 
       auto out = context.get_output_buffer();
-      auto& rows_columns = rows->cget_columns();
-      auto& out_columns = out->get_columns();
-      out_columns.clear();
-      for (size_t i = 0;i < m_indices.size(); ++i) {
-        DASSERT_LT(i, m_indices.size()); 
-        out_columns.push_back(rows_columns[m_indices[i]]);
-      }
+      execute_block({rows}, 0, context.block_size(), *out);
       context.emit(out);
     }
   };
 
+  bool supports_block_execution() const { return true; }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    auto& rows_columns = inputs[0]->cget_columns();
+    auto& out_columns = output.get_columns();
+    out_columns.clear();
+    for (size_t i = 0;i < m_indices.size(); ++i) {
+      out_columns.push_back(rows_columns[m_indices[i]]);
+    }
+    return true;
+  }
+
   static std::shared_ptr<planner_node> make_planner_node(
       std::shared_ptr<planner_node> input,
       const std::vector<size_t>& indices) {
@@ -32,7 +32,10 @@ struct operator_impl<planner_node_type::RANGE_NODE> : public query_operator {
     return ret;
   }
   
-  inline operator_impl(flex_int begin_index, flex_int end_index) { ASSERT_LE(begin_index, end_index); };
+  inline operator_impl(flex_int begin_index, flex_int end_index)
+      : m_begin_index(begin_index), m_end_index(end_index) {
+    ASSERT_LE(begin_index, end_index);
+  };
   
   inline std::string print() const {
     return name() + "(" + std::to_string(m_begin_index) + ", " + std::to_string(m_end_index) + ")";
@@ -58,6 +61,25 @@ struct operator_impl<planner_node_type::RANGE_NODE> : public query_operator {
     }
   };
 
+  bool supports_block_execution() const { return true; }
+
+  bool has_block(size_t block_index, size_t block_size) const {
+    return m_begin_index + (flex_int)(block_index * block_size) < m_end_index;
+  }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    if (!has_block(block_index, block_size)) return false;
+    flex_int iter = m_begin_index + (flex_int)(block_index * block_size);
+    output.resize(1, std::min<size_t>(m_end_index - iter, block_size));
+    for (auto& value: *(output.get_columns()[0])) {
+      value = iter;
+      ++iter;
+    }
+    return true;
+  }
+
   static std::shared_ptr<planner_node> make_planner_node(
       flex_int begin_index, flex_int end_index) {
     return planner_node::make_shared(planner_node_type::RANGE_NODE, 
@@ -0,0 +1,321 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_QUERY_MANAGER_SAMPLE_MASK_HPP
+#define GRAPHLAB_SFRAME_QUERY_MANAGER_SAMPLE_MASK_HPP
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+#include <logger/assertions.hpp>
+#include <flexible_type/flexible_type.hpp>
+#include <util/cityhash_gl.hpp>
+#include <sframe_query_engine/operators/operator.hpp>
+#include <sframe_query_engine/execution/query_context.hpp>
+#include <sframe_query_engine/operators/operator_properties.hpp>
+namespace graphlab {
+namespace query_eval {
+
+/**
+ * A "sample_mask" operator which generates the 0/1 mask of a random sample
+ * of the rows [0, length), to be used as the filter of a logical_filter.
+ * It is either:
+ *  - a Bernoulli sample: every row is drawn with probability fraction
+ *    (or, with complement, every row not drawn), or
+ *  - a given sorted list of rows, such as a fixed size sample drawn by
+ *    \ref sample_rows.
+ *
+ * The Bernoulli sample does not draw every row: it draws the geometric gap
+ * to the next row sampled, so a block costs the number of rows sampled in
+ * it. A logical_filter skips reading the blocks of its input which have no
+ * row sampled, which is most of them at low rates. \ref sampled_rows
+ * draws the same rows up front, for the samples sparse enough to be read
+ * row by row (see \ref sample).
+ *
+ * The sample only depends on the seed: the rows are cut into strata of
+ * STRATUM_SIZE rows, the draws of a stratum being seeded by the seed and
+ * the index of the stratum. The sample is thus the same whichever way the
+ * rows are sliced into segments and blocks.
+ */
+template <>
+struct operator_impl<planner_node_type::SAMPLE_MASK_NODE> : public query_operator {
+ public:
+  /// The number of rows whose draws are seeded together
+  static constexpr size_t STRATUM_SIZE = 1 << 16;
+
+  planner_node_type type() const { return planner_node_type::SAMPLE_MASK_NODE; }
+
+  static std::string name() { return "sample_mask"; }
+
+  static query_operator_attributes attributes() {
+    query_operator_attributes ret;
+    ret.attribute_bitfield = query_operator_attributes::SOURCE |
+        query_operator_attributes::SUPPORTS_SKIPPING;
+    ret.num_inputs = 0;
+    return ret;
+  }
+
+  inline operator_impl(size_t begin_index, size_t end_index,
+                       double fraction, flex_int seed, bool complement)
+      : m_begin_index(begin_index), m_end_index(end_index),
+        m_fraction(fraction), m_seed_hash(seed_hash(seed)),
+        m_complement(complement) {
+    ASSERT_LE(begin_index, end_index);
+    if (m_fraction > 0 && m_fraction < 1) m_log_q = std::log1p(-m_fraction);
+  }
+
+  inline operator_impl(size_t begin_index, size_t end_index,
+                       std::shared_ptr<const std::vector<size_t>> indices)
+      : m_begin_index(begin_index), m_end_index(end_index),
+        m_indices(indices) {
+    ASSERT_LE(begin_index, end_index);
+  }
+
+  inline std::string print() const {
+    std::ostringstream out;
+    if (m_indices) out << name() << "(" << m_indices->size() << " rows)";
+    else out << name() << "(" << m_fraction << (m_complement ? ", complement)" : ")");
+    return out.str();
+  }
+
+  inline std::shared_ptr<query_operator> clone() const {
+    return std::make_shared<operator_impl>(*this);
+  }
+
+  inline void execute(query_context& context) {
+    size_t start = m_begin_index;
+    bool skip_next_block = false;
+    emit_state state = context.initial_state();
+    while (start != m_end_index) {
+      size_t end = std::min(start + context.block_size(), m_end_index);
+      if (skip_next_block == false) {
+        auto rows = context.get_output_buffer();
+        fill(start, end, *rows);
+        state = context.emit(rows);
+      } else {
+        state = context.emit(nullptr);
+      }
+      skip_next_block = state == emit_state::SKIP_NEXT_BLOCK;
+      start = end;
+    }
+  }
+
+  bool supports_block_execution() const { return true; }
+
+  bool has_block(size_t block_index, size_t block_size) const {
+    return m_begin_index + block_index * block_size < m_end_index;
+  }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    if (!has_block(block_index, block_size)) return false;
+    size_t start = m_begin_index + block_index * block_size;
+    fill(start, std::min(start + block_size, m_end_index), output);
+    return true;
+  }
+
+  /**
+   * Returns the next draw of a uniform value in (0, 1] of the generator
+   * state (a splitmix64 generator).
+   */
+  static double next_uniform(uint64_t& state) {
+    state += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+    return ((z >> 11) + 1) * (1.0 / 9007199254740992.0);
+  }
+
+  /// The hash of a seed, from which all the draws are seeded
+  static uint64_t seed_hash(flex_int seed) {
+    return hash64((uint64_t)seed, 0x5a3d1c4e9b7f2806ULL);
+  }
+
+  /**
+   * Returns the rows of [0, length) sampled by the Bernoulli sample with
+   * probability fraction, in order: the rows whose mask is 1, drawn without
+   * going through the mask.
+   */
+  static std::vector<size_t> sampled_rows(size_t length, double fraction,
+                                          flex_int seed) {
+    std::vector<size_t> ret;
+    if (fraction >= 1) {
+      ret.resize(length);
+      for (size_t i = 0; i < length; ++i) ret[i] = i;
+    }
+    if (fraction <= 0 || fraction >= 1) return ret;
+    ret.reserve(length * fraction * 1.1 + 16);
+    operator_impl draws(0, length, fraction, seed, false);
+    for (size_t row = 0; row < length; row = draws.m_consumed_row) {
+      size_t stratum_end = std::min((row / STRATUM_SIZE + 1) * STRATUM_SIZE, length);
+      draws.seek(row);
+      for (; draws.m_next_row < stratum_end; draws.advance()) {
+        ret.push_back(draws.m_next_row);
+      }
+      draws.m_consumed_row = stratum_end;
+    }
+    return ret;
+  }
+
+  /**
+   * A Bernoulli sample of rows [0, length) with probability fraction. With
+   * complement, the mask of the rows not sampled.
+   */
+  static std::shared_ptr<planner_node> make_planner_node(
+      size_t length, double fraction, flex_int seed, bool complement = false) {
+    return planner_node::make_shared(planner_node_type::SAMPLE_MASK_NODE,
+                                     {{"fraction", fraction},
+                                      {"seed", seed},
+                                      {"complement", (flex_int)complement},
+                                      {"begin_index", 0},
+                                      {"end_index", length}});
+  }
+
+  /**
+   * The sample of rows [0, length) made of the given rows, which must be
+   * sorted.
+   */
+  static std::shared_ptr<planner_node> make_planner_node(
+      size_t length, std::shared_ptr<const std::vector<size_t>> indices) {
+    DASSERT_TRUE(std::is_sorted(indices->begin(), indices->end()));
+    // identifies the rows for the common subplan elimination
+    flex_int fingerprint = hash64((const char*)indices->data(),
+                                  indices->size() * sizeof(size_t));
+    return planner_node::make_shared(planner_node_type::SAMPLE_MASK_NODE,
+                                     {{"fingerprint", fingerprint},
+                                      {"begin_index", 0},
+                                      {"end_index", length}},
+                                     {{"indices", any(indices)}});
+  }
+
+  static std::shared_ptr<query_operator> from_planner_node(
+      std::shared_ptr<planner_node> pnode) {
+    ASSERT_EQ((int)pnode->operator_type, (int)planner_node_type::SAMPLE_MASK_NODE);
+    size_t begin_index = pnode->operator_parameters.at("begin_index");
+    size_t end_index = pnode->operator_parameters.at("end_index");
+    if (pnode->any_operator_parameters.count("indices")) {
+      return std::make_shared<operator_impl>(
+          begin_index, end_index,
+          pnode->any_operator_parameters.at("indices")
+              .as<std::shared_ptr<const std::vector<size_t>>>());
+    }
+    return std::make_shared<operator_impl>(
+        begin_index, end_index,
+        pnode->operator_parameters.at("fraction").get<flex_float>(),
+        pnode->operator_parameters.at("seed").get<flex_int>(),
+        pnode->operator_parameters.at("complement").get<flex_int>() != 0);
+  }
+
+  static std::vector<flex_type_enum> infer_type(
+      std::shared_ptr<planner_node> pnode) {
+    ASSERT_EQ((int)pnode->operator_type, (int)planner_node_type::SAMPLE_MASK_NODE);
+    return {flex_type_enum::INTEGER};
+  }
+
+  static int64_t infer_length(std::shared_ptr<planner_node> pnode) {
+    ASSERT_EQ((int)pnode->operator_type, (int)planner_node_type::SAMPLE_MASK_NODE);
+    flex_int begin_index = pnode->operator_parameters.at("begin_index");
+    flex_int end_index = pnode->operator_parameters.at("end_index");
+    return end_index - begin_index;
+  }
+
+  static std::string repr(std::shared_ptr<planner_node> pnode, pnode_tagger&) {
+    ASSERT_EQ((int)pnode->operator_type, (int)planner_node_type::SAMPLE_MASK_NODE);
+    size_t begin_index = pnode->operator_parameters.at("begin_index");
+    size_t end_index = pnode->operator_parameters.at("end_index");
+    std::ostringstream out;
+    if (pnode->any_operator_parameters.count("indices")) {
+      auto indices = pnode->any_operator_parameters.at("indices")
+          .as<std::shared_ptr<const std::vector<size_t>>>();
+      out << "Sample(" << indices->size() << " rows)";
+    } else {
+      out << "Sample(" << pnode->operator_parameters.at("fraction")
+          << ", seed=" << pnode->operator_parameters.at("seed");
+      if (pnode->operator_parameters.at("complement").get<flex_int>()) out << ", complement";
+      out << ")";
+    }
+    out << "[" << begin_index << "," << end_index << "]";
+    return out.str();
+  }
+
+ private:
+  /// Writes the mask of the rows [start, end) to output
+  void fill(size_t start, size_t end, sframe_rows& output) {
+    output.resize(1, end - start);
+    auto& column = *(output.get_columns()[0]);
+    if (m_indices) {
+      for (auto& value: column) value = 0;
+      auto iter = std::lower_bound(m_indices->begin(), m_indices->end(), start);
+      for (; iter != m_indices->end() && *iter < end; ++iter) column[*iter - start] = 1;
+      return;
+    }
+    flex_int sampled = m_complement ? 0 : 1;
+    if (m_fraction <= 0 || m_fraction >= 1) {
+      flex_int all = (m_fraction >= 1) ? sampled : 1 - sampled;
+      for (auto& value: column) value = all;
+      return;
+    }
+    for (auto& value: column) value = 1 - sampled;
+    size_t row = start;
+    while (row < end) {
+      size_t stratum = row / STRATUM_SIZE;
+      size_t stratum_end = std::min((stratum + 1) * STRATUM_SIZE, end);
+      seek(row);
+      for (; m_next_row < stratum_end; advance()) column[m_next_row - start] = sampled;
+      m_consumed_row = stratum_end;
+      row = stratum_end;
+    }
+  }
+
+  /// Returns the number of rows skipped before the next row sampled
+  size_t draw_gap() {
+    double gap = std::floor(std::log(next_uniform(m_state)) / m_log_q);
+    if (gap >= STRATUM_SIZE) return STRATUM_SIZE;
+    return gap;
+  }
+
+  void advance() { m_next_row += 1 + draw_gap(); }
+
+  /**
+   * Moves the draws to the first row sampled at or after row. The draws are
+   * restarted at the beginning of the stratum of row, unless they already
+   * are in the stratum, before row: the blocks are mostly read in order.
+   */
+  void seek(size_t row) {
+    size_t stratum = row / STRATUM_SIZE;
+    if (stratum != m_stratum || row < m_consumed_row) {
+      m_stratum = stratum;
+      m_state = hash64(m_seed_hash, stratum);
+      m_next_row = stratum * STRATUM_SIZE + draw_gap();
+    }
+    while (m_next_row < row) advance();
+  }
+
+  size_t m_begin_index = 0;
+  size_t m_end_index = 0;
+  double m_fraction = 0;
+  double m_log_q = 0;
+  uint64_t m_seed_hash = 0;
+  bool m_complement = false;
+  std::shared_ptr<const std::vector<size_t>> m_indices;
+
+  /// The position of the draws
+  size_t m_stratum = (size_t)(-1);
+  uint64_t m_state = 0;
+  size_t m_next_row = 0;
+  /// The rows before it are written
+  size_t m_consumed_row = 0;
+};
+
+typedef operator_impl<planner_node_type::SAMPLE_MASK_NODE> op_sample_mask;
+
+} // query_eval
+} // graphlab
+
+#endif // GRAPHLAB_SFRAME_QUERY_MANAGER_SAMPLE_MASK_HPP
@@ -71,6 +71,22 @@ struct operator_impl<planner_node_type::SFRAME_SOURCE_NODE> : public query_opera
     }
   }
 
+  bool supports_block_execution() const { return true; }
+
+  bool has_block(size_t block_index, size_t block_size) const {
+    return m_begin_index + block_index * block_size < m_end_index;
+  }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    if (!has_block(block_index, block_size)) return false;
+    size_t start = m_begin_index + block_index * block_size;
+    if (!m_reader) m_reader = m_source.get_reader();
+    m_reader->read_rows(start, std::min(start + block_size, m_end_index), output);
+    return true;
+  }
+
   static std::shared_ptr<planner_node> make_planner_node(
       sframe source, size_t begin_index = 0, size_t _end_index = -1) {
     std::stringstream strm;
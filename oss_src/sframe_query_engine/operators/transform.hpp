@@ -45,7 +45,9 @@ class operator_impl<planner_node_type::TRANSFORM_NODE> : public query_operator {
   { }
   
   inline std::shared_ptr<query_operator> clone() const {
-    return std::make_shared<operator_impl>(*this);
+    auto ret = std::make_shared<operator_impl>(*this);
+    ret->m_seeded = false;
+    return ret;
   }
 
   inline void execute(query_context& context) {
@@ -57,36 +59,42 @@ class operator_impl<planner_node_type::TRANSFORM_NODE> : public query_operator {
       if (rows == nullptr)
         break;
       auto output = context.get_output_buffer();
-      output->resize(1, rows->num_rows());
-
-      auto iter = rows->cbegin();
-      auto output_iter = output->begin();
-      while(iter != rows->cend()) {
-        auto outval = m_transform_fn((*iter));
-        if (m_output_type == flex_type_enum::UNDEFINED || 
-            outval.get_type() == m_output_type || 
-            outval.get_type() == flex_type_enum::UNDEFINED) {
-          (*output_iter)[0] = outval;
-        } else {
-          flexible_type f(m_output_type);
-          f.soft_assign(outval);
-          (*output_iter)[0] = f;
-        }
-        ++output_iter;
-        ++iter;
-      }
+      transform_block(*rows, *output);
       context.emit(output);
     }
   }
 
+  bool supports_block_execution() const { return true; }
+
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    // seeded on the first block this instance runs, which need not be
+    // block 0 when blocks are skipped
+    if (!m_seeded && m_random_seed != -1) {
+      random::get_source().seed(m_random_seed + thread::thread_id());
+      m_seeded = true;
+    }
+    transform_block(*inputs[0], output);
+    return true;
+  }
+
+  /**
+   * If fingerprint is not empty, it identifies the function: transforms of
+   * the same input with the same fingerprint compute the same values, and
+   * the planner computes them once (see common_subplans.hpp).
+   */
   static std::shared_ptr<planner_node> make_planner_node(
       std::shared_ptr<planner_node> source,
       transform_type fn,
       flex_type_enum output_type,
-      int random_seed=-1) {
+      int random_seed=-1,
+      const std::string& fingerprint = "") {
+    std::map<std::string, flexible_type> params{{"output_type", (int)(output_type)},
+                                                {"random_seed", random_seed}};
+    if (!fingerprint.empty()) params["fingerprint"] = fingerprint;
     return planner_node::make_shared(planner_node_type::TRANSFORM_NODE, 
-                                     {{"output_type", (int)(output_type)},
-                                      {"random_seed", random_seed}},
+                                     params,
                                      {{"function", any(fn)}},
                                      {source});
   }
@@ -117,9 +125,32 @@ class operator_impl<planner_node_type::TRANSFORM_NODE> : public query_operator {
   }
   
  private:
+  void transform_block(const sframe_rows& rows, sframe_rows& output) {
+    output.resize(1, rows.num_rows());
+
+    auto iter = rows.cbegin();
+    auto output_iter = output.begin();
+    while(iter != rows.cend()) {
+      auto outval = m_transform_fn((*iter));
+      if (m_output_type == flex_type_enum::UNDEFINED || 
+          outval.get_type() == m_output_type || 
+          outval.get_type() == flex_type_enum::UNDEFINED) {
+        (*output_iter)[0] = outval;
+      } else {
+        flexible_type f(m_output_type);
+        f.soft_assign(outval);
+        (*output_iter)[0] = f;
+      }
+      ++output_iter;
+      ++iter;
+    }
+  }
+
   transform_type m_transform_fn;
   flex_type_enum m_output_type;
   int m_random_seed;
+  /// True once execute_block has seeded the random source
+  bool m_seeded = false;
 };
 
 typedef operator_impl<planner_node_type::TRANSFORM_NODE> op_transform; 
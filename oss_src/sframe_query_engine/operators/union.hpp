@@ -60,16 +60,24 @@ struct operator_impl<planner_node_type::UNION_NODE> : public query_operator {
       }
 
       auto out = context.get_output_buffer();
-      auto& out_columns = out->get_columns();
-      out_columns.clear();
+      execute_block(input_v, 0, context.block_size(), *out);
+      context.emit(out);
+    }
+  }
 
-      for(size_t i = 0; i < num_inputs; ++i) {
-        std::copy(input_v[i]->get_columns().begin(), input_v[i]->get_columns().end(),
-                  std::back_inserter(out_columns));
-      }
+  bool supports_block_execution() const { return true; }
 
-      context.emit(out);
+  bool execute_block(const std::vector<std::shared_ptr<const sframe_rows>>& inputs,
+                     size_t block_index, size_t block_size,
+                     sframe_rows& output) {
+    auto& out_columns = output.get_columns();
+    out_columns.clear();
+
+    for(size_t i = 0; i < num_inputs; ++i) {
+      std::copy(inputs[i]->get_columns().begin(), inputs[i]->get_columns().end(),
+                std::back_inserter(out_columns));
     }
+    return true;
   }
 
  private:
@@ -0,0 +1,156 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <logger/logger.hpp>
+#include <globals/globals.hpp>
+#include <serialization/serialization_includes.hpp>
+#include <sframe_query_engine/operators/operator_properties.hpp>
+#include <sframe_query_engine/operators/sframe_source.hpp>
+#include <sframe_query_engine/planning/common_subplans.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+size_t SFRAME_QUERY_RESULT_CACHE_SIZE = 0;
+
+REGISTER_GLOBAL(int64_t, SFRAME_QUERY_RESULT_CACHE_SIZE, true);
+
+/**
+ * True if the parameters of a node identify its computation. The any
+ * parameters (the functions) of a node cannot be compared; they are
+ * described by the parameters of the sources (their index files) and of
+ * the lambda transforms (the pickled lambda), and must otherwise come with
+ * a fingerprint.
+ */
+static bool parameters_identify_node(const planner_node& n) {
+  switch (n.operator_type) {
+    case planner_node_type::SFRAME_SOURCE_NODE:
+    case planner_node_type::SARRAY_SOURCE_NODE:
+    case planner_node_type::LAMBDA_TRANSFORM_NODE:
+      return true;
+    default:
+      break;
+  }
+  if (n.operator_parameters.count("fingerprint")) return true;
+  for (const auto& param: n.any_operator_parameters) {
+    // annotations such as the profile counters
+    if (param.first.compare(0, 2, "__") == 0) continue;
+    return false;
+  }
+  return true;
+}
+
+uint128_t planner_node_structural_hash(const pnode_ptr& n, plan_hashes& hashes) {
+  auto iter = hashes.find(n.get());
+  if (iter != hashes.end()) return iter->second;
+
+  bool identified = parameters_identify_node(*n);
+  std::vector<uint128_t> input_hashes;
+  for (const auto& input: n->inputs) {
+    input_hashes.push_back(planner_node_structural_hash(input, hashes));
+    if (input_hashes.back() == 0) identified = false;
+  }
+
+  uint128_t ret = 0;
+  if (identified) {
+    oarchive oarc;
+    oarc << (int)n->operator_type << n->operator_parameters;
+    for (auto h: input_hashes) oarc << (uint64_t)(h >> 64) << (uint64_t)h;
+    ret = hash128(oarc.buf, oarc.off);
+    free(oarc.buf);
+    // 0 means not identified
+    if (ret == 0) ret = 1;
+  }
+  hashes[n.get()] = ret;
+  return ret;
+}
+
+static pnode_ptr merge_common_subplans_impl(const pnode_ptr& n,
+                                            const plan_hashes& hashes,
+                                            std::map<uint128_t, pnode_ptr>& canonical,
+                                            std::map<const planner_node*, pnode_ptr>& visited) {
+  auto iter = visited.find(n.get());
+  if (iter != visited.end()) return iter->second;
+
+  for (auto& input: n->inputs) {
+    input = merge_common_subplans_impl(input, hashes, canonical, visited);
+  }
+
+  pnode_ptr ret = n;
+  uint128_t h = hashes.at(n.get());
+  if (h != 0) {
+    auto canonical_iter = canonical.find(h);
+    if (canonical_iter != canonical.end()) {
+      ret = canonical_iter->second;
+    } else {
+      sframe cached;
+      if (!is_source_node(n) &&
+          query_result_cache::get_instance().find(h, cached)) {
+        logstream(LOG_INFO) << "Reusing the cached result of "
+                            << planner_node_type_to_name(n->operator_type) << std::endl;
+        ret = op_sframe_source::make_planner_node(cached);
+      }
+      canonical[h] = ret;
+    }
+  }
+  visited[n.get()] = ret;
+  return ret;
+}
+
+pnode_ptr merge_common_subplans(pnode_ptr tip, plan_hashes& hashes) {
+  planner_node_structural_hash(tip, hashes);
+  std::map<uint128_t, pnode_ptr> canonical;
+  std::map<const planner_node*, pnode_ptr> visited;
+  return merge_common_subplans_impl(tip, hashes, canonical, visited);
+}
+
+query_result_cache& query_result_cache::get_instance() {
+  static query_result_cache* instance = new query_result_cache();
+  return *instance;
+}
+
+bool query_result_cache::find(uint128_t plan_hash, sframe& sf) {
+  if (SFRAME_QUERY_RESULT_CACHE_SIZE == 0) return false;
+  std::lock_guard<mutex> guard(m_lock);
+  auto iter = m_index.find(plan_hash);
+  if (iter == m_index.end()) return false;
+  // most recently used first
+  m_results.splice(m_results.begin(), m_results, iter->second);
+  sf = iter->second->second;
+  ++m_hits;
+  return true;
+}
+
+void query_result_cache::insert(uint128_t plan_hash, const sframe& sf) {
+  if (plan_hash == 0 || SFRAME_QUERY_RESULT_CACHE_SIZE == 0) return;
+  std::lock_guard<mutex> guard(m_lock);
+  auto iter = m_index.find(plan_hash);
+  if (iter != m_index.end()) {
+    m_results.erase(iter->second);
+    m_index.erase(iter);
+  }
+  m_results.emplace_front(plan_hash, sf);
+  m_index[plan_hash] = m_results.begin();
+  while (m_results.size() > SFRAME_QUERY_RESULT_CACHE_SIZE) {
+    m_index.erase(m_results.back().first);
+    m_results.pop_back();
+  }
+}
+
+void query_result_cache::clear() {
+  std::lock_guard<mutex> guard(m_lock);
+  m_index.clear();
+  m_results.clear();
+}
+
+size_t query_result_cache::size() const {
+  std::lock_guard<mutex> guard(m_lock);
+  return m_results.size();
+}
+
+} // namespace query_eval
+} // namespace graphlab
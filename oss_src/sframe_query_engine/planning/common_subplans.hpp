@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SFRAME_QUERY_ENGINE_COMMON_SUBPLANS_HPP
+#define GRAPHLAB_SFRAME_QUERY_ENGINE_COMMON_SUBPLANS_HPP
+#include <map>
+#include <list>
+#include <memory>
+#include <util/cityhash_gl.hpp>
+#include <parallel/mutex.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+/**
+ * The number of materialized intermediate results the planner keeps for
+ * reuse by later queries (see \ref query_result_cache). 0 disables the
+ * cache.
+ */
+extern size_t SFRAME_QUERY_RESULT_CACHE_SIZE;
+
+/**
+ * Structural hashes of the nodes of a plan, by node.
+ */
+typedef std::map<const planner_node*, uint128_t> plan_hashes;
+
+/**
+ * Returns a hash of the computation performed by the plan ending at tip:
+ * two plans with the same hash compute the same values, whether or not
+ * they share nodes. The hash covers the type and the parameters of every
+ * node, and the data sources by their index files.
+ *
+ * Returns 0 if the computation cannot be identified, which is the case of
+ * the plans running a C++ function (a transform, binary transform,
+ * generalized transform or reduce node) created without a fingerprint.
+ * Python lambdas are identified by their pickled code and seed.
+ *
+ * The hashes of all the nodes visited are stored in hashes.
+ */
+uint128_t planner_node_structural_hash(const pnode_ptr& tip, plan_hashes& hashes);
+
+/**
+ * Rewrites a private plan graph (see copy_planner_graph) so that
+ * structurally identical subplans are shared, and are thus computed once,
+ * and replaces the subplans whose results are in the \ref
+ * query_result_cache by sources reading the results.
+ *
+ * Returns the new tip, and fills hashes with the structural hashes of the
+ * nodes of the original graph.
+ */
+pnode_ptr merge_common_subplans(pnode_ptr tip, plan_hashes& hashes);
+
+/**
+ * A bounded, least recently used cache of materialized query results,
+ * keyed by the structural hash of the plan which computed them.
+ *
+ * Notebook users tend to re-run the same expensive prefix of a pipeline
+ * many times, building new (but identical) lazy plans each time. With the
+ * cache enabled (SFRAME_QUERY_RESULT_CACHE_SIZE > 0), the planner keeps
+ * the results it materializes, and reads them back in place of any
+ * identical subplan of a later query.
+ *
+ * The cache holds references to the results, which keeps their files on
+ * disk until they are evicted.
+ */
+class query_result_cache {
+ public:
+  static query_result_cache& get_instance();
+
+  /**
+   * Looks for the result of a plan. Returns true and the result in sf if
+   * found.
+   */
+  bool find(uint128_t plan_hash, sframe& sf);
+
+  /**
+   * Stores the result of a plan, evicting the least recently used results
+   * beyond SFRAME_QUERY_RESULT_CACHE_SIZE.
+   */
+  void insert(uint128_t plan_hash, const sframe& sf);
+
+  /// Drops all the results
+  void clear();
+
+  /// The number of results held
+  size_t size() const;
+
+  /// The number of lookups which found a result so far
+  size_t num_hits() const { return m_hits; }
+
+ private:
+  query_result_cache() = default;
+
+  typedef std::list<std::pair<uint128_t, sframe>> lru_list;
+  lru_list m_results;
+  std::map<uint128_t, lru_list::iterator> m_index;
+  size_t m_hits = 0;
+  mutable mutex m_lock;
+};
+
+} // namespace query_eval
+} // namespace graphlab
+#endif
@@ -17,6 +17,9 @@ namespace graphlab {
 class sframe_rows;
 namespace query_eval {
 
+class query_profile;
+struct running_query_info;
+
 /**  
  * Materialization options.
  *
@@ -89,6 +92,18 @@ struct materialize_options {
    * This argument has no effect if \ref write_callback is set.
    */
   std::vector<std::string> output_column_names;
+
+  /**
+   * If set, runtime counters of every operator executed are collected
+   * into the profile. See \ref query_profile.
+   */
+  std::shared_ptr<query_profile> profile;
+
+  /**
+   * Set by planner::materialize: the executors count the rows output
+   * into it.
+   */
+  std::shared_ptr<running_query_info> progress;
 };
 
 } // query_eval
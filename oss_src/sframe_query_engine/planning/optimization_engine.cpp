@@ -12,7 +12,6 @@
 #include <sframe_query_engine/operators/operator_properties.hpp>
 
 #include <sframe_query_engine/planning/optimizations/optimization_transforms.hpp>
-#include <sframe_query_engine/query_engine_lock.hpp>
 
 ////////////////////////////////////////////////////////////////////////////////
 // Test chaining transforms
@@ -97,11 +96,16 @@ static std::shared_ptr<const optimization_transform_registry> get_transform_regi
  */
 pnode_ptr optimization_engine::optimize_planner_graph(
     pnode_ptr tip, const materialize_options& exec_params) {
+  // The nodes may be shared with other queries, and the optimizer rewrites
+  // the inputs of the nodes it visits.
+  std::map<pnode_ptr, pnode_ptr> originals;
+  return optimize_private_planner_graph(copy_planner_graph(tip, originals), exec_params);
+}
 
-  auto transform_registry = get_transform_registry();
+pnode_ptr optimization_engine::optimize_private_planner_graph(
+    pnode_ptr tip, const materialize_options& exec_params) {
 
-  // Yes, currently need to deal with this global lock thing...
-  std::lock_guard<recursive_mutex> GLOBAL_LOCK(global_query_lock);
+  auto transform_registry = get_transform_registry();
 
   // Run it.
   return optimization_engine(transform_registry)._run(tip, exec_params);
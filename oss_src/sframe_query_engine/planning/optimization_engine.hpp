@@ -53,10 +53,16 @@ struct optimization_transform_registry {
 class optimization_engine {
  public:
 
-  /**  The main function to optimize the graph.
+  /**  The main function to optimize the graph.  The graph ending at
+   *   tip is not modified; the optimization works on a copy.
    */
   static pnode_ptr optimize_planner_graph(pnode_ptr tip, const materialize_options& exec_params);
 
+  /**  Optimizes a graph which no other query can see, such as one
+   *   returned by copy_planner_graph, rewriting its nodes in place.
+   */
+  static pnode_ptr optimize_private_planner_graph(pnode_ptr tip, const materialize_options& exec_params);
+
  private:
 
   /** Use should only be through the above optimize_planner_graph
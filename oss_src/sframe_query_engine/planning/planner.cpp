@@ -9,12 +9,17 @@
 #include <sframe_query_engine/execution/execution_node.hpp>
 #include <sframe_query_engine/planning/planner_node.hpp>
 #include <sframe_query_engine/execution/subplan_executor.hpp> 
+#include <sframe_query_engine/execution/query_profile.hpp>
+#include <sframe_query_engine/execution/running_queries.hpp>
 #include <sframe_query_engine/operators/operator_transformations.hpp>
 #include <sframe_query_engine/operators/all_operators.hpp>
 #include <sframe_query_engine/planning/planner.hpp>
 #include <sframe_query_engine/planning/optimization_engine.hpp>
+#include <sframe_query_engine/planning/common_subplans.hpp>
 #include <sframe_query_engine/query_engine_lock.hpp>
 #include <globals/globals.hpp>
+#include <fileio/spill_manager.hpp>
+#include <parallel/atomic.hpp>
 #include <sframe/sframe.hpp>
 
 namespace graphlab { namespace query_eval {
@@ -23,12 +28,61 @@ size_t SFRAME_MAX_LAZY_NODE_SIZE = 10000;
 
 REGISTER_GLOBAL(int64_t, SFRAME_MAX_LAZY_NODE_SIZE, true);
 
+/**
+ * The number of threads running a query (see running_query_scope).
+ * Concurrent queries split the cores between them, rather than each
+ * running cpu_count() segments.
+ */
+static atomic<size_t> num_running_queries;
+static __thread size_t materialize_depth = 0;
+
+/// The outermost query scope open on the thread
+static __thread running_query_scope* current_query_scope = nullptr;
+
+running_query_scope::running_query_scope(const std::string& description) {
+  if (materialize_depth++ == 0) {
+    num_running_queries.inc();
+    m_info = running_queries::get_instance().add(description);
+    m_spill_scope.reset(new spill_accounting_scope(m_info->spilled_bytes));
+    current_query_scope = this;
+  }
+}
+
+running_query_scope::~running_query_scope() {
+  m_spill_scope.reset();
+  if (--materialize_depth == 0) {
+    current_query_scope = nullptr;
+    num_running_queries.dec();
+    running_queries::get_instance().remove(m_info->id);
+  }
+}
+
+std::shared_ptr<running_query_info> running_query_scope::current_query() {
+  if (current_query_scope == nullptr) return nullptr;
+  return current_query_scope->m_info;
+}
+
+/**
+ * The default number of segments to run a query with: the query's share
+ * of the cores.
+ */
+static size_t query_segment_budget() {
+  return std::max<size_t>(1, thread::cpu_count() / std::max<size_t>(1, num_running_queries));
+}
+
 
 /**
  * Directly executes a linear query plan potentially parallelizing it if possible.
  * No fast path optimizations. You should use execute_node.
  */
 static sframe execute_node_impl(pnode_ptr input_n, const materialize_options& exec_params) {
+  // attach the counters before segmenting, so that all the segments of
+  // an operator share them.
+  if (exec_params.profile) exec_params.profile->add_stage(input_n);
+  if (exec_params.progress) {
+    exec_params.progress->begin_stage(infer_planner_node_length(input_n));
+  }
+
   // Either run directly, or split it up into a parallel section
   if(is_parallel_slicable(input_n) && (exec_params.num_segments != 0)) {
 
@@ -125,7 +179,7 @@ static sframe execute_node(pnode_ptr input_n, const materialize_options& exec_pa
           auto new_exec_params = exec_params;
           new_exec_params.output_column_names.clear();
           input_n = op_project::make_planner_node(input_n, columns_to_materialize);
-          input_n = optimization_engine::optimize_planner_graph(input_n, new_exec_params);
+          input_n = optimization_engine::optimize_private_planner_graph(input_n, new_exec_params);
           logstream(LOG_INFO) << "Materializing only column subset: " << input_n << std::endl;
 
           sframe new_columns = execute_node_impl(input_n, new_exec_params);
@@ -222,7 +276,7 @@ static pnode_ptr partial_materialize_impl(pnode_ptr n,
     // materialize all inputs into this node
     for(auto& i: n->inputs) {
       // logprogress_stream << "Partial Materializing: " << i << std::endl;
-      auto optimized_i = optimization_engine::optimize_planner_graph(i, exec_params);
+      auto optimized_i = optimization_engine::optimize_private_planner_graph(i, exec_params);
       (*i) = (*op_sframe_source::make_planner_node(execute_node(optimized_i, exec_params)));
     }
     // logprogress_stream << "Reduced Plan: " << n << std::endl;
@@ -237,7 +291,7 @@ static pnode_ptr partial_materialize_impl(pnode_ptr n,
 
   // logprogress_stream << "Partial Materializing: " << n << std::endl;
   // Otherwise, instantiate this node.
-  auto optimized_n = optimization_engine::optimize_planner_graph(n, exec_params);
+  auto optimized_n = optimization_engine::optimize_private_planner_graph(n, exec_params);
   (*n) = (*op_sframe_source::make_planner_node(execute_node(optimized_n, exec_params)));
   memo[n] = n;
   return memo[n];
@@ -278,19 +332,59 @@ static pnode_ptr partial_materialize(pnode_ptr ptip,
 }
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Replaces the nodes of the shared graph whose private copy was
+ * materialized by the query, so that later queries reuse the results.
+ * The results are also offered to the query_result_cache, under the
+ * structural hashes the copies had before they were materialized.
+ */
+static void write_back_materialized_nodes(const std::map<pnode_ptr, pnode_ptr>& originals,
+                                          const plan_hashes& hashes) {
+  std::lock_guard<recursive_mutex> GRAPH_LOCK(planner_graph_lock);
+  for (const auto& copy_and_original : originals) {
+    const auto& copy = copy_and_original.first;
+    const auto& original = copy_and_original.second;
+    if (copy->operator_type == planner_node_type::SFRAME_SOURCE_NODE &&
+        !is_source_node(original)) {
+      (*original) = (*copy);
+      auto hash_iter = hashes.find(copy.get());
+      if (hash_iter != hashes.end()) {
+        query_result_cache::get_instance().insert(
+            hash_iter->second, copy->any_operator_parameters.at("sframe").as<sframe>());
+      }
+    }
+  }
+}
+
 sframe planner::materialize(pnode_ptr ptip, 
                             materialize_options exec_params) {
-  std::lock_guard<recursive_mutex> GLOBAL_LOCK(global_query_lock);
+  running_query_scope query_scope(planner_node_type_to_name(ptip->operator_type));
+  // the stages of an operator's materializations are its query's progress
+  if (!exec_params.progress) exec_params.progress = running_query_scope::current_query();
+  std::unique_ptr<spill_accounting_scope> profile_spills;
+  if (exec_params.profile) {
+    profile_spills.reset(new spill_accounting_scope(
+        exec_params.profile->operator_spill_counter()));
+    exec_params.profile->start();
+  }
   if (exec_params.num_segments == 0) {
-    exec_params.num_segments = thread::cpu_count();
+    exec_params.num_segments = query_segment_budget();
   }
   auto original_ptip = ptip;
   // Optimize Query Plan
   if (!is_source_node(ptip)) {
     logstream(LOG_INFO) << "Materializing: " << ptip << std::endl;
   }
+  // The query runs on its own copy of the graph, which it is free to
+  // rewrite. Other queries may be running on the same nodes.
+  std::map<pnode_ptr, pnode_ptr> originals;
+  ptip = copy_planner_graph(ptip, originals);
+  plan_hashes hashes;
+  uint128_t tip_hash = 0;
   if(!exec_params.disable_optimization) {
-    ptip = optimization_engine::optimize_planner_graph(ptip, exec_params);
+    tip_hash = planner_node_structural_hash(ptip, hashes);
+    ptip = merge_common_subplans(ptip, hashes);
+    ptip = optimization_engine::optimize_private_planner_graph(ptip, exec_params);
     if (!is_source_node(ptip)) {
       logstream(LOG_INFO) << "Optimized As: " << ptip << std::endl;
     }
@@ -304,7 +398,7 @@ sframe planner::materialize(pnode_ptr ptip,
   // Only a subset of execution paramets matter to the partial materialization calls.
   if (exec_params.partial_materialize) {
     materialize_options recursive_exec_params = exec_params;
-    recursive_exec_params.num_segments = thread::cpu_count();
+    recursive_exec_params.num_segments = query_segment_budget();
     recursive_exec_params.output_index_file = ""; // no forced output location
     recursive_exec_params.write_callback = nullptr;
     final_node = partial_materialize(ptip, recursive_exec_params);
@@ -314,11 +408,26 @@ sframe planner::materialize(pnode_ptr ptip,
     // no write callback
     // Rewrite the query node to be materialized source node
     auto ret_sf = execute_node(final_node, exec_params);
+    if (exec_params.profile) exec_params.profile->stop();
+    write_back_materialized_nodes(originals, hashes);
+    if (exec_params.output_index_file.empty()) {
+      query_result_cache::get_instance().insert(tip_hash, ret_sf);
+      // a cached result has the column names of the query which made it
+      if (exec_params.output_column_names.size() == ret_sf.num_columns()) {
+        for (size_t i = 0; i < ret_sf.num_columns(); ++i) {
+          ret_sf.set_column_name(i, exec_params.output_column_names[i]);
+        }
+      }
+    }
+    std::lock_guard<recursive_mutex> GRAPH_LOCK(planner_graph_lock);
     (*original_ptip) = (*(op_sframe_source::make_planner_node(ret_sf)));
     return ret_sf;
   } else {
     // there is a callback. push it through to execute parameters.
-    return execute_node(final_node, exec_params);
+    auto ret_sf = execute_node(final_node, exec_params);
+    if (exec_params.profile) exec_params.profile->stop();
+    write_back_materialized_nodes(originals, hashes);
+    return ret_sf;
   }
 }
 
@@ -17,6 +17,9 @@
 #include <sframe_query_engine/planning/planner_node.hpp>
 
 namespace graphlab { 
+
+class spill_accounting_scope;
+
 namespace query_eval { 
 
 class query_planner;
@@ -85,7 +88,32 @@ class planner {
   
 };
 
+/**
+ * Runs the calling thread's work as a query for the lifetime of the scope,
+ * unless the thread is already running one (e.g. a sort materializing its
+ * input). The query is listed in \ref running_queries with its progress,
+ * takes its share of the cores split between concurrent queries, and is
+ * attributed the spills of the spill_sessions created on the thread.
+ *
+ * planner::materialize opens one. The operators which create their
+ * spill_session before materializing their input (sort, groupby, join,
+ * shuffle) open one first, so that their spills are counted on the query.
+ */
+class running_query_scope {
+ public:
+  explicit running_query_scope(const std::string& description);
+  ~running_query_scope();
+
+  running_query_scope(const running_query_scope&) = delete;
+  running_query_scope& operator=(const running_query_scope&) = delete;
 
+  /// The query the calling thread is running, or nullptr if none
+  static std::shared_ptr<running_query_info> current_query();
+
+ private:
+  std::shared_ptr<running_query_info> m_info;
+  std::unique_ptr<spill_accounting_scope> m_spill_scope;
+};
 
 
 } // namespace query_eval
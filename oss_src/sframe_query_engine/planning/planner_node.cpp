@@ -5,3 +5,33 @@
  * This software may be modified and distributed under the terms
  * of the BSD license. See the LICENSE file for details.
  */
+#include <parallel/mutex.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/query_engine_lock.hpp>
+
+namespace graphlab {
+namespace query_eval {
+
+static pnode_ptr copy_planner_graph_impl(pnode_ptr n,
+                                         std::map<pnode_ptr, pnode_ptr>& copies,
+                                         std::map<pnode_ptr, pnode_ptr>& originals) {
+  auto iter = copies.find(n);
+  if (iter != copies.end()) return iter->second;
+
+  auto ret = std::make_shared<planner_node>(*n);
+  for (auto& input : ret->inputs) {
+    input = copy_planner_graph_impl(input, copies, originals);
+  }
+  copies[n] = ret;
+  originals[ret] = n;
+  return ret;
+}
+
+pnode_ptr copy_planner_graph(pnode_ptr tip, std::map<pnode_ptr, pnode_ptr>& originals) {
+  std::lock_guard<recursive_mutex> GRAPH_LOCK(planner_graph_lock);
+  std::map<pnode_ptr, pnode_ptr> copies;
+  return copy_planner_graph_impl(tip, copies, originals);
+}
+
+} // namespace query_eval
+} // namespace graphlab
@@ -109,6 +109,16 @@ struct planner_node {
 // A handy typedef 
 typedef std::shared_ptr<planner_node> pnode_ptr; 
 
+/**
+ * Copies every node of the graph ending at tip, preserving shared inputs,
+ * and returns the copy of tip. originals is filled with the node each copy
+ * was made from.
+ *
+ * The optimizer and the planner rewrite the nodes of the graph they work
+ * on, so each query works on a copy. Takes planner_graph_lock.
+ */
+pnode_ptr copy_planner_graph(pnode_ptr tip, std::map<pnode_ptr, pnode_ptr>& originals);
+
 
 } // namespace query_eval
 } // namespace graphlab
@@ -8,6 +8,6 @@
 #include <parallel/mutex.hpp>
 namespace graphlab {
 namespace query_eval {
-recursive_mutex global_query_lock;
+recursive_mutex planner_graph_lock;
 } // query_eval
 } // graphlab
@@ -13,13 +13,17 @@ class recursive_mutex;
 namespace query_eval {
 
 /**
- * A global lock around all external entry points to the query execution.
- * For now, 
- * - materialize()
- * - infer_planner_node_type()
- * - infer_planner_node_length()
+ * Protects the contents of planner nodes, which may be shared by the graphs
+ * of several queries. It is held while
+ * - copying a planner graph (see \ref copy_planner_graph)
+ * - writing back materialized nodes into a shared graph
+ * - infer_planner_node_type() / infer_planner_node_length(), which memoize
+ *   into the nodes.
+ *
+ * It is never held while a query is optimized or executed: each query works
+ * on its own copy of the graph, so queries run concurrently.
  */
-extern recursive_mutex global_query_lock;
+extern recursive_mutex planner_graph_lock;
 } // query_eval
 } // graphlab
 #endif
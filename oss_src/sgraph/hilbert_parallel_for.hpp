@@ -9,7 +9,9 @@
 #define GRAPHLAB_SGRAPH_HILBERT_PARALLE_FOR_HPP
 #include <utility>
 #include <functional>
+#include <future>
 #include <parallel/lambda_omp.hpp>
+#include <timer/timer.hpp>
 #include <sgraph/hilbert_curve.hpp>
 #include <sgraph/sgraph_constants.hpp>
 #include <util/blocking_queue.hpp>
@@ -57,6 +59,112 @@ inline void hilbert_blocked_parallel_for(size_t n,
   }
 }
 
+/**
+ * Statistics collected by the prefetching \ref hilbert_blocked_parallel_for.
+ */
+struct hilbert_prefetch_stats {
+  /// Number of passes executed.
+  size_t num_passes = 0;
+  /// Number of prefetch calls issued.
+  size_t num_prefetches = 0;
+  /// Total time (secs) spent waiting on an outstanding prefetch before a
+  /// preamble could start. This is the time the workers sit idle.
+  double stall_time = 0;
+  /// Total time (secs) spent in the prefetch callbacks.
+  double prefetch_time = 0;
+  /// Total time (secs) spent in the preamble callbacks.
+  double preamble_time = 0;
+};
+
+/**
+ * Same as \ref hilbert_blocked_parallel_for, but overlaps the work of each
+ * pass with an asynchronous "prefetch" of the coordinates of the next
+ * lookahead passes.
+ *
+ * The function abstractly implements the following:
+ *
+ * \code
+ * for each pass p:
+ *   wait for the outstanding prefetch (if any)
+ *   preamble(coordinates(p))
+ *   async prefetch(coordinates(p+1) ... coordinates(p+lookahead))
+ *   parallel for over coordinate in coordinates(p):
+ *      fn(coordinate)
+ * \endcode
+ *
+ * The prefetch callback runs on a separate thread concurrently with fn, and
+ * is never concurrent with the preamble or with another prefetch. It is up
+ * to the callback to only touch state which is not used by the running pass,
+ * and to bound the amount of work (memory) it performs.
+ *
+ * Exceptions thrown by the prefetch are rethrown before the next preamble.
+ *
+ * n must be at least 2 and a power of 2.
+ */
+inline void hilbert_blocked_parallel_for(size_t n,
+                                  std::function<void(std::vector<std::pair<size_t, size_t> >) > preamble,
+                                  std::function<void(std::pair<size_t, size_t>)> fn,
+                                  std::function<void(std::vector<std::pair<size_t, size_t> >) > prefetch,
+                                  size_t lookahead,
+                                  hilbert_prefetch_stats* stats = NULL,
+                                  size_t parallel_limit = SGRAPH_HILBERT_CURVE_PARALLEL_FOR_NUM_THREADS) {
+  hilbert_prefetch_stats local_stats;
+  if (stats == NULL) stats = &local_stats;
+
+  std::vector<std::vector<std::pair<size_t, size_t> > > passes;
+  for (size_t i = 0;i < n*n; i += parallel_limit) {
+    std::vector<std::pair<size_t, size_t> >  coordinates;
+    size_t lastcoord_this_pass = std::min(i + parallel_limit, n*n);
+    for(size_t j = i; j < lastcoord_this_pass; ++j) {
+      coordinates.push_back(hilbert_index_to_coordinate(j, n));
+    }
+    passes.push_back(std::move(coordinates));
+  }
+
+  std::future<void> outstanding_prefetch;
+  // make sure the prefetch thread never outlives the referenced state,
+  // even when fn throws.
+  struct prefetch_guard {
+    std::future<void>& f;
+    ~prefetch_guard() {
+      if (f.valid()) {
+        try { f.get(); } catch (...) { }
+      }
+    }
+  } guard{outstanding_prefetch};
+
+  timer ti;
+  for (size_t p = 0; p < passes.size(); ++p) {
+    if (outstanding_prefetch.valid()) {
+      ti.start();
+      outstanding_prefetch.wait();
+      stats->stall_time += ti.current_time();
+      outstanding_prefetch.get();
+    }
+
+    ti.start();
+    preamble(passes[p]);
+    stats->preamble_time += ti.current_time();
+
+    std::vector<std::pair<size_t, size_t> > next_coordinates;
+    for (size_t q = p + 1; q < std::min(p + 1 + lookahead, passes.size()); ++q) {
+      next_coordinates.insert(next_coordinates.end(), passes[q].begin(), passes[q].end());
+    }
+    if (!next_coordinates.empty()) {
+      ++stats->num_prefetches;
+      outstanding_prefetch = std::async(std::launch::async,
+                                        [next_coordinates, prefetch, stats]() {
+                                          timer prefetch_timer;
+                                          prefetch(next_coordinates);
+                                          stats->prefetch_time += prefetch_timer.current_time();
+                                        });
+    }
+
+    parallel_for(passes[p].begin(), passes[p].end(), fn);
+    ++stats->num_passes;
+  }
+}
+
 /**
  * Non blocking version.
  */
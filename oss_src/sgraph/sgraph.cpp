@@ -12,6 +12,9 @@
 #include <sframe/sarray_sorted_buffer.hpp>
 #include <sframe/sarray_reader_buffer.hpp>
 #include <sframe/sframe_saving.hpp>
+#include <sketches/space_saving_flextype.hpp>
+#include <serialization/unordered_map.hpp>
+#include <numeric>
 #include <atomic>
 #include <timer/timer.hpp>
 #include <sparsehash/sparse_hash_set>
@@ -375,8 +378,8 @@ sframe sgraph::get_edges(const std::vector<flexible_type>& source_vids,
     for (size_t i = 0; i < source_vids.size(); ++i) {
       const flexible_type& source = source_vids[i];
       const flexible_type& target = target_vids[i];
-      size_t source_pid = source.hash() % m_num_partitions;
-      size_t target_pid = target.hash() % m_num_partitions;
+      size_t source_pid = get_vertex_partition(source, groupa);
+      size_t target_pid = get_vertex_partition(target, groupb);
       if (source.get_type() == flex_type_enum::UNDEFINED) {
         wild_target_vids[target_pid].insert(target);
       } else if (target.get_type() == flex_type_enum::UNDEFINED) {
@@ -456,7 +459,7 @@ bool sgraph::add_vertices(sframe vertices,
   std::vector<sframe> vertex_partitions =
     shuffle(vertices, m_num_partitions,
         [&](const std::vector<flexible_type>& row) {
-          return get_vertex_partition(row[id_column_idx]);
+          return get_vertex_partition(row[id_column_idx], group);
         });
   commit_vertex_buffer(group, vertex_partitions);
   logstream(LOG_EMPH) << "Num vertices for group " << group << ": " << num_vertices(group) << std::endl;
@@ -582,6 +585,10 @@ bool sgraph::add_edges(sframe edges,
 
   fast_validate_add_edges(edges, groupa, groupb);
 
+  if (m_ingress_strategy == ingress_strategy::DEGREE_AWARE) {
+    assign_high_degree_vertices(edges, groupa, groupb);
+  }
+
   commit_edge_buffer(groupa, groupb, edges);
   logstream(LOG_EMPH) << "Num vertices for group " << groupa << ": " << num_vertices(groupa) << "\n"
                       << "Num vertices for group " << groupb << ": " << num_vertices(groupb) << "\n"
@@ -672,8 +679,8 @@ void sgraph::commit_edge_buffer(size_t groupa,
         "Please use dropna() to drop the missing value from the input and try again";
       log_and_throw(error_message);
     }
-    size_t src_partition = get_vertex_partition(src_id);
-    size_t dst_partition = get_vertex_partition(dst_id);
+    size_t src_partition = get_vertex_partition(src_id, groupa);
+    size_t dst_partition = get_vertex_partition(dst_id, groupb);
     source_vid_buffers[src_partition]->add(src_id, thread_id);
     target_vid_buffers[dst_partition]->add(dst_id, thread_id);
   };
@@ -683,7 +690,7 @@ void sgraph::commit_edge_buffer(size_t groupa,
   std::vector<sframe> edge_partitions =
     shuffle(edges, m_num_partitions * m_num_partitions,
         [&](const std::vector<flexible_type>& row) {
-          return get_edge_partition(row[src_column_idx], row[dst_column_idx]);
+          return get_edge_partition(row[src_column_idx], row[dst_column_idx], groupa, groupb);
         },
         add_to_deduplication_buffer);
   DASSERT_EQ(edge_partitions.size(), m_num_partitions * m_num_partitions);
@@ -1025,6 +1032,7 @@ bool sgraph::clear() {
   m_vertex_group_names.clear();
   m_vertex_groups.clear();
   m_edge_groups.clear();
+  m_vertex_partition_overrides.clear();
 
   // Reinitialize with the given number of partitions
   m_num_partitions = 0;
@@ -1274,12 +1282,222 @@ size_t sgraph::get_edge_field_id(std::string column_name, size_t groupa, size_t
 }
 
 
+/**************************************************************************/
+/*                                                                        */
+/*                              Partitioning                              */
+/*                                                                        */
+/**************************************************************************/
+
+void sgraph::assign_high_degree_vertices(const sframe& edges,
+                                         size_t groupa, size_t groupb) {
+  timer local_timer;
+  if (m_vertex_partition_overrides.size() < m_num_groups) {
+    m_vertex_partition_overrides.resize(m_num_groups);
+  }
+  const size_t num_edge_partitions = m_num_partitions * m_num_partitions;
+  const size_t num_new_edges = edges.num_rows();
+  // A vertex whose edges alone fill an average edge partition is a hub.
+  const size_t degree_threshold =
+      std::max<size_t>(SGRAPH_INGRESS_HIGH_DEGREE_MIN_DEGREE,
+                       num_new_edges / num_edge_partitions);
+  if (num_new_edges < degree_threshold) return;
+
+  // Pass 1: find the candidate hubs with one heavy hitter sketch
+  // per thread, for each end of the edges.
+  sframe id_columns = edges.select_columns({SRC_COLUMN_NAME, DST_COLUMN_NAME});
+  auto reader = id_columns.get_reader();
+  double epsilon = 1.0 / (4 * num_edge_partitions);
+  size_t nthreads = thread::cpu_count();
+  std::vector<sketches::space_saving_flextype> src_sketches(nthreads, sketches::space_saving_flextype(epsilon));
+  std::vector<sketches::space_saving_flextype> dst_sketches(nthreads, sketches::space_saving_flextype(epsilon));
+  in_parallel([&](size_t threadid, size_t num_threads) {
+    size_t row_start = reader->num_rows() * threadid / num_threads;
+    size_t row_end = reader->num_rows() * (threadid + 1) / num_threads;
+    std::vector<std::vector<flexible_type>> rows;
+    while (row_start < row_end) {
+      size_t nrows = std::min<size_t>(SGRAPH_TRIPLE_APPLY_EDGE_BATCH_SIZE, row_end - row_start);
+      reader->read_rows(row_start, row_start + nrows, rows);
+      for (const auto& row : rows) {
+        src_sketches[threadid].add(row[0]);
+        dst_sketches[threadid].add(row[1]);
+      }
+      row_start += nrows;
+    }
+  });
+  for (size_t i = 1; i < nthreads; ++i) {
+    src_sketches[0].combine(src_sketches[i]);
+    dst_sketches[0].combine(dst_sketches[i]);
+  }
+
+  // Estimated degree of each candidate per group.
+  std::map<size_t, std::unordered_map<flexible_type, size_t>> candidates;
+  for (const auto& item : src_sketches[0].frequent_items()) {
+    candidates[groupa][item.first] += item.second;
+  }
+  for (const auto& item : dst_sketches[0].frequent_items()) {
+    candidates[groupb][item.first] += item.second;
+  }
+
+  for (auto& group_candidates : candidates) {
+    size_t group = group_candidates.first;
+    auto& overrides = m_vertex_partition_overrides[group];
+
+    std::vector<std::pair<size_t, flexible_type>> hubs;
+    for (const auto& kv : group_candidates.second) {
+      if (kv.second >= degree_threshold && overrides.count(kv.first) == 0) {
+        hubs.push_back({kv.second, kv.first});
+      }
+    }
+    if (hubs.empty()) continue;
+
+    // Existing vertices can only be moved if no edges reference the group.
+    bool group_has_edges = false;
+    for (size_t other = 0; other < m_num_groups; ++other) {
+      group_has_edges |= num_edges(group, other) > 0 || num_edges(other, group) > 0;
+    }
+    if (group_has_edges) {
+      std::set<size_t> partitions_to_check;
+      for (const auto& hub : hubs) partitions_to_check.insert(get_vertex_partition(hub.second, group));
+      std::unordered_set<flexible_type> existing;
+      for (size_t partition : partitions_to_check) {
+        for (auto& vid : get_vertex_ids(partition, group)) existing.insert(vid);
+      }
+      hubs.erase(std::remove_if(hubs.begin(), hubs.end(),
+                                [&](const std::pair<size_t, flexible_type>& hub) {
+                                  return existing.count(hub.second) > 0;
+                                }), hubs.end());
+    }
+    if (hubs.empty()) continue;
+
+    // Greedy placement: largest hub first, onto the partition with the
+    // smallest estimated number of incident edges. Non hub edges
+    // are assumed to spread evenly by hashing.
+    size_t hub_degree_total = 0;
+    for (const auto& hub : hubs) hub_degree_total += hub.first;
+    size_t group_edge_ends = (groupa == groupb) ? 2 * num_new_edges : num_new_edges;
+    size_t base_load = (group_edge_ends - std::min(group_edge_ends, hub_degree_total)) / m_num_partitions;
+    std::vector<size_t> load(m_num_partitions, base_load);
+    std::sort(hubs.rbegin(), hubs.rend());
+
+    std::unordered_map<flexible_type, size_t> placement;
+    for (const auto& hub : hubs) {
+      size_t target = std::min_element(load.begin(), load.end()) - load.begin();
+      load[target] += hub.first;
+      placement[hub.second] = target;
+    }
+    if (!group_has_edges) relocate_vertices(group, placement);
+    for (const auto& kv : placement) overrides[kv.first] = kv.second;
+
+    logstream(LOG_EMPH) << "Degree aware ingress placed " << placement.size()
+                        << " high degree vertices in group " << group
+                        << " (degree >= " << degree_threshold << ")" << std::endl;
+  }
+  logstream(LOG_INFO) << "Done degree aware vertex placement in "
+                      << local_timer.current_time() << " secs" << std::endl;
+}
+
+void sgraph::relocate_vertices(size_t group,
+                               const std::unordered_map<flexible_type, size_t>& placement) {
+  auto& vgroup = vertex_group(group);
+  std::vector<std::vector<std::vector<flexible_type>>> moved_rows(m_num_partitions);
+  std::vector<mutex> moved_rows_lock(m_num_partitions);
+
+  parallel_for(0, m_num_partitions, [&](size_t partition) {
+    sframe& sf = vgroup[partition];
+    if (sf.size() == 0) return;
+    size_t vid_column_idx = sf.column_index(VID_COLUMN_NAME);
+    sframe kept;
+    kept.open_for_write(sf.column_names(), sf.column_types(), "", 1);
+    auto out = kept.get_output_iterator(0);
+    auto reader = sf.get_reader();
+    std::vector<std::vector<flexible_type>> rows;
+    size_t num_moved = 0;
+    for (size_t row_start = 0; row_start < reader->num_rows();
+         row_start += SGRAPH_TRIPLE_APPLY_EDGE_BATCH_SIZE) {
+      size_t row_end = std::min<size_t>(row_start + SGRAPH_TRIPLE_APPLY_EDGE_BATCH_SIZE,
+                                        reader->num_rows());
+      reader->read_rows(row_start, row_end, rows);
+      for (auto& row : rows) {
+        auto iter = placement.find(row[vid_column_idx]);
+        if (iter != placement.end() && iter->second != partition) {
+          std::lock_guard<mutex> guard(moved_rows_lock[iter->second]);
+          moved_rows[iter->second].push_back(std::move(row));
+          ++num_moved;
+        } else {
+          *out = row;
+          ++out;
+        }
+      }
+    }
+    kept.close();
+    if (num_moved > 0) sf = kept;
+  });
+
+  for (size_t partition = 0; partition < m_num_partitions; ++partition) {
+    if (moved_rows[partition].empty()) continue;
+    sframe& sf = vgroup[partition];
+    sframe moved;
+    moved.open_for_write(sf.column_names(), sf.column_types(), "", 1);
+    std::copy(moved_rows[partition].begin(), moved_rows[partition].end(),
+              moved.get_output_iterator(0));
+    moved.close();
+    sf = sf.append(moved);
+  }
+}
+
+size_t sgraph::num_high_degree_vertices(size_t group) const {
+  if (group >= m_vertex_partition_overrides.size()) return 0;
+  return m_vertex_partition_overrides[group].size();
+}
+
+sgraph::partition_balance_report
+sgraph::get_partition_balance_report(size_t groupa, size_t groupb) const {
+  auto imbalance = [](const std::vector<size_t>& sizes) {
+    size_t total = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+    if (total == 0) return 1.0;
+    size_t max_size = *std::max_element(sizes.begin(), sizes.end());
+    return (double)max_size * sizes.size() / total;
+  };
+
+  partition_balance_report ret;
+  for (const auto& sf : vertex_group(groupa)) {
+    ret.vertex_partition_sizes.push_back(sf.size());
+  }
+  std::vector<size_t> row_sizes(m_num_partitions, 0);
+  std::vector<size_t> column_sizes(m_num_partitions, 0);
+  const auto& egroup = edge_group(groupa, groupb);
+  for (size_t i = 0; i < m_num_partitions; ++i) {
+    for (size_t j = 0; j < m_num_partitions; ++j) {
+      size_t size = egroup[i * m_num_partitions + j].size();
+      ret.edge_partition_sizes.push_back(size);
+      row_sizes[i] += size;
+      column_sizes[j] += size;
+    }
+  }
+  ret.vertex_imbalance = imbalance(ret.vertex_partition_sizes);
+  ret.edge_imbalance = imbalance(ret.edge_partition_sizes);
+  ret.edge_row_imbalance = imbalance(row_sizes);
+  ret.edge_column_imbalance = imbalance(column_sizes);
+  ret.num_high_degree_vertices = num_high_degree_vertices(groupa);
+  return ret;
+}
+
+
 /**************************************************************************/
 /*                                                                        */
 /*                             Serialization                              */
 /*                                                                        */
 /**************************************************************************/
 
+/**
+ * Graphs using degree aware ingress are saved with a header beginning with
+ * this marker (never a valid number of partitions), followed by a version
+ * number, and the vertex partition overrides after the edge groups.
+ * All other graphs are saved in the original format.
+ */
+static const size_t SGRAPH_EXTENDED_FORMAT_MARKER = (size_t)(-1);
+static const size_t SGRAPH_EXTENDED_FORMAT_VERSION = 1;
+
 void parallel_save_sframes(const std::vector<sframe>& sf_vec,
                            oarchive& oarc,
                            bool save_reference) {
@@ -1304,6 +1522,13 @@ void parallel_save_sframes(const std::vector<sframe>& sf_vec,
  * Save to a directory oarchive.
  */
 void sgraph::save(oarchive& oarc) const {
+  bool extended_format = m_ingress_strategy != ingress_strategy::HASH;
+  for (const auto& overrides : m_vertex_partition_overrides) {
+    extended_format |= !overrides.empty();
+  }
+  if (extended_format) {
+    oarc << SGRAPH_EXTENDED_FORMAT_MARKER << SGRAPH_EXTENDED_FORMAT_VERSION;
+  }
   oarc << m_num_partitions << m_num_groups
        << m_num_vertices << m_num_edges << m_vid_type
        << m_vertex_group_names;
@@ -1319,10 +1544,20 @@ void sgraph::save(oarchive& oarc) const {
     oarc << kv.second.size();
     parallel_save_sframes(kv.second, oarc, save_reference);
   }
+  if (extended_format) {
+    oarc << (size_t)m_ingress_strategy << m_vertex_partition_overrides;
+  }
 }
 
 void sgraph::save_reference(oarchive& oarc) const {
   ASSERT_TRUE(oarc.dir != NULL);
+  bool extended_format = m_ingress_strategy != ingress_strategy::HASH;
+  for (const auto& overrides : m_vertex_partition_overrides) {
+    extended_format |= !overrides.empty();
+  }
+  if (extended_format) {
+    oarc << SGRAPH_EXTENDED_FORMAT_MARKER << SGRAPH_EXTENDED_FORMAT_VERSION;
+  }
   oarc << m_num_partitions << m_num_groups
        << m_num_vertices << m_num_edges << m_vid_type
        << m_vertex_group_names;
@@ -1338,6 +1573,9 @@ void sgraph::save_reference(oarchive& oarc) const {
     oarc << kv.second.size();
     parallel_save_sframes(kv.second, oarc, save_reference);
   }
+  if (extended_format) {
+    oarc << (size_t)m_ingress_strategy << m_vertex_partition_overrides;
+  }
 }
 
 /**
@@ -1347,7 +1585,18 @@ void sgraph::save_reference(oarchive& oarc) const {
  */
 void sgraph::load(iarchive& iarc) {
   clear();
-  iarc >> m_num_partitions >> m_num_groups
+  bool extended_format = false;
+  iarc >> m_num_partitions;
+  if (m_num_partitions == SGRAPH_EXTENDED_FORMAT_MARKER) {
+    size_t version = 0;
+    iarc >> version;
+    if (version > SGRAPH_EXTENDED_FORMAT_VERSION) {
+      log_and_throw("Graph was saved by a newer version and cannot be loaded");
+    }
+    extended_format = true;
+    iarc >> m_num_partitions;
+  }
+  iarc >> m_num_groups
        >> m_num_vertices >> m_num_edges >> m_vid_type
        >> m_vertex_group_names;
   for (size_t i = 0; i < m_num_groups; ++i) {
@@ -1363,6 +1612,11 @@ void sgraph::load(iarchive& iarc) {
       m_edge_groups[group_address] = std::move(egroup);
     }
   }
+  if (extended_format) {
+    size_t strategy = 0;
+    iarc >> strategy >> m_vertex_partition_overrides;
+    m_ingress_strategy = (ingress_strategy)strategy;
+  }
 }
 
 /**************************************************************************/
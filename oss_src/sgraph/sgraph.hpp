@@ -8,6 +8,7 @@
 #ifndef GRAPHLAB_SGRAPH_SGRAPH_HPP
 #define GRAPHLAB_SGRAPH_SGRAPH_HPP
 #include <memory>
+#include <unordered_map>
 #include <flexible_type/flexible_type.hpp>
 #include <sgraph/sgraph_constants.hpp>
 #include <sframe/sframe.hpp>
@@ -57,6 +58,21 @@ namespace distributed_sgraph_compute {
  *  the combination of the group ID and the Vertex ID. The vertex ID type MUST
  *  be consistent and identical across all groups.
  *
+ *  Power-law graphs place all edges of a few very high degree vertices in the
+ *  same row (and column) of the grid, making those edge partitions
+ *  stragglers. With the \ref ingress_strategy::DEGREE_AWARE strategy,
+ *  add_edges detects high degree vertices in the incoming edges and places
+ *  them greedily on the least loaded vertex partitions instead of hashing
+ *  them. The placement is remembered (and serialized) so that subsequent
+ *  add_vertices / add_edges calls agree on it.
+ *  See \ref get_partition_balance_report.
+ *
+ *  This is a placement, not a vertex cut: a vertex lives in exactly one
+ *  vertex partition (edge partitions refer to their end points by local
+ *  row id), so all edges of a single hub still land in one row (or column)
+ *  of the grid. Degree aware ingress spreads many hubs apart; it cannot
+ *  split one hub whose degree alone exceeds a row's share of the edges.
+ *
  *  Vertex grouping is implemented by having multiple of the vertex blocks, one
  *  for each group. Thus m_vertex_groups[0] contains a vector of SFrames for 
  *  vertex group 0 and so on. 
@@ -122,6 +138,37 @@ class sgraph {
     }
   };
 
+  /**
+   * Strategy used to assign vertices to vertex partitions on ingress.
+   */
+  enum class ingress_strategy {
+    /// partition = hash(vid) % num_partitions
+    HASH = 0,
+    /// Same as HASH, except that high degree vertices detected in each
+    /// add_edges call are assigned, whole, to the least loaded partitions.
+    DEGREE_AWARE = 1
+  };
+
+  /**
+   * Summary of how evenly vertices and edges are spread over partitions.
+   */
+  struct partition_balance_report {
+    /// Number of vertices in each vertex partition.
+    std::vector<size_t> vertex_partition_sizes;
+    /// Number of edges in each edge partition (row major).
+    std::vector<size_t> edge_partition_sizes;
+    /// max / mean of vertex_partition_sizes. 1.0 is perfectly balanced.
+    double vertex_imbalance = 1.0;
+    /// max / mean of edge_partition_sizes. 1.0 is perfectly balanced.
+    double edge_imbalance = 1.0;
+    /// max / mean of the total number of edges in each row of the grid.
+    double edge_row_imbalance = 1.0;
+    /// max / mean of the total number of edges in each column of the grid.
+    double edge_column_imbalance = 1.0;
+    /// Number of vertices placed by degree aware ingress.
+    size_t num_high_degree_vertices = 0;
+  };
+
 
  public:
   sgraph(const sgraph& other) = default;
@@ -497,6 +544,37 @@ class sgraph {
 
   inline flex_type_enum vertex_id_type() const { return m_vid_type; }
 
+/**************************************************************************/
+/*                                                                        */
+/*                              Partitioning                              */
+/*                                                                        */
+/**************************************************************************/
+  /**
+   * Sets the strategy used to place new vertices on add_edges.
+   * Only affects vertices which are not in the graph yet. (Or all vertices
+   * of a group, if no edges have been added to the group yet.)
+   */
+  inline void set_ingress_strategy(ingress_strategy strategy) {
+    m_ingress_strategy = strategy;
+  }
+
+  inline ingress_strategy get_ingress_strategy() const {
+    return m_ingress_strategy;
+  }
+
+  /**
+   * Returns the number of vertices in the group placed by degree aware
+   * ingress rather than by hashing.
+   */
+  size_t num_high_degree_vertices(size_t group = 0) const;
+
+  /**
+   * Returns the partition balance report of the vertex group groupa
+   * and the edges between groupa and groupb.
+   */
+  partition_balance_report get_partition_balance_report(size_t groupa = 0,
+                                                        size_t groupb = 0) const;
+
 /**************************************************************************/
 /*                                                                        */
 /*                             Serialization                              */
@@ -681,17 +759,40 @@ class sgraph {
   sframe merge_vertex_partition(sframe& current_vdata, sframe& new_vdata);
 
   /**
-   * Return the vertex partition number for given vertex id.
+   * Return the vertex partition number for given vertex id in the group.
    */
-  inline size_t get_vertex_partition(const flexible_type& vid) { return vid.hash() % m_num_partitions; }
+  inline size_t get_vertex_partition(const flexible_type& vid, size_t group = 0) const {
+    if (group < m_vertex_partition_overrides.size() &&
+        !m_vertex_partition_overrides[group].empty()) {
+      auto iter = m_vertex_partition_overrides[group].find(vid);
+      if (iter != m_vertex_partition_overrides[group].end()) return iter->second;
+    }
+    return vid.hash() % m_num_partitions;
+  }
 
   /**
    * Return the edge partition number for an edge.
    */
-  inline size_t get_edge_partition(const flexible_type& src, const flexible_type& dst) {
-    return get_vertex_partition(src) * m_num_partitions + get_vertex_partition(dst);
+  inline size_t get_edge_partition(const flexible_type& src, const flexible_type& dst,
+                                   size_t groupa = 0, size_t groupb = 0) const {
+    return get_vertex_partition(src, groupa) * m_num_partitions + get_vertex_partition(dst, groupb);
   }
 
+  /**
+   * Detects the high degree vertices among the edges to be added and
+   * assigns them to the least loaded vertex partitions. Vertices already
+   * in the graph are only moved if no edges reference the group yet.
+   */
+  void assign_high_degree_vertices(const sframe& edges, size_t groupa, size_t groupb);
+
+  /**
+   * Moves the given vertices of a group to the given partitions.
+   * Only valid when no edges reference the group, since edges
+   * store local vertex ids.
+   */
+  void relocate_vertices(size_t group,
+                         const std::unordered_map<flexible_type, size_t>& placement);
+
   /**
    * Returns a vector of vertex ids in the given partition and vertex group.
    */
@@ -742,6 +843,17 @@ class sgraph {
    */
   flex_type_enum m_vid_type = flex_type_enum::INTEGER;
 
+  /**
+   * Strategy used to place new vertices on add_edges.
+   */
+  ingress_strategy m_ingress_strategy = ingress_strategy::HASH;
+
+  /**
+   * For each group, the vertices whose partition is not hash(vid) % m_num_partitions.
+   * Filled by degree aware ingress.
+   */
+  std::vector<std::unordered_map<flexible_type, size_t>> m_vertex_partition_overrides;
+
   /**
    * An array of the same length as vertex_group_names. 
    * Each vertex group is represented as an array of sframes.
@@ -18,7 +18,10 @@ EXPORT size_t SGRAPH_BATCH_TRIPLE_APPLY_LOCK_ARRAY_SIZE = 1024 * 1024;
 EXPORT size_t SGRAPH_TRIPLE_APPLY_EDGE_BATCH_SIZE = 1024;
 EXPORT size_t SGRAPH_DEFAULT_NUM_PARTITIONS = 8;
 EXPORT size_t SGRAPH_INGRESS_VID_BUFFER_SIZE = 1024 * 1024 * 3;
+EXPORT size_t SGRAPH_INGRESS_HIGH_DEGREE_MIN_DEGREE = 1024;
 EXPORT size_t SGRAPH_HILBERT_CURVE_PARALLEL_FOR_NUM_THREADS = thread::cpu_count();
+EXPORT size_t SGRAPH_TRIPLE_APPLY_PREFETCH_LOOKAHEAD = 1;
+EXPORT size_t SGRAPH_TRIPLE_APPLY_PREFETCH_MEMORY_BUDGET = 1024LL * 1024 * 1024;
 
 REGISTER_GLOBAL_WITH_CHECKS(int64_t, 
                             SGRAPH_TRIPLE_APPLY_LOCK_ARRAY_SIZE, 
@@ -47,8 +50,23 @@ REGISTER_GLOBAL_WITH_CHECKS(int64_t,
                             true, 
                             +[](int64_t val){ return val >= 1; });
 
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SGRAPH_INGRESS_HIGH_DEGREE_MIN_DEGREE,
+                            true,
+                            +[](int64_t val){ return val >= 1; });
+
 REGISTER_GLOBAL_WITH_CHECKS(int64_t, 
                             SGRAPH_HILBERT_CURVE_PARALLEL_FOR_NUM_THREADS,
                             true,
                             +[](int64_t val){ return val >= 1; });
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SGRAPH_TRIPLE_APPLY_PREFETCH_LOOKAHEAD,
+                            true,
+                            +[](int64_t val){ return val >= 0; });
+
+REGISTER_GLOBAL_WITH_CHECKS(int64_t,
+                            SGRAPH_TRIPLE_APPLY_PREFETCH_MEMORY_BUDGET,
+                            true,
+                            +[](int64_t val){ return val >= 0; });
 }
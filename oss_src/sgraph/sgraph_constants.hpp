@@ -37,10 +37,28 @@ extern size_t SGRAPH_DEFAULT_NUM_PARTITIONS;
  */
 extern size_t SGRAPH_INGRESS_VID_BUFFER_SIZE;
 
+/**
+ * Minimum degree (within one add_edges call) of a vertex to be placed by
+ * degree aware ingress instead of by hashing.
+ */
+extern size_t SGRAPH_INGRESS_HIGH_DEGREE_MIN_DEGREE;
+
 /**
  * Number of threads used for hilber curve parallel for
  */
 extern size_t SGRAPH_HILBERT_CURVE_PARALLEL_FOR_NUM_THREADS;
+
+/**
+ * Number of hilbert curve passes whose vertex partitions triple_apply loads
+ * ahead of time, while the current pass is running. 0 disables prefetching.
+ */
+extern size_t SGRAPH_TRIPLE_APPLY_PREFETCH_LOOKAHEAD;
+
+/**
+ * Upper bound (in bytes, estimated) on the vertex data triple_apply may
+ * prefetch ahead of the current pass.
+ */
+extern size_t SGRAPH_TRIPLE_APPLY_PREFETCH_MEMORY_BUDGET;
 }
 
 #endif
@@ -121,6 +121,22 @@ namespace {
      */
     void unload_graph_vertex_blocks(const std::set<vertex_partition_address>& vertex_address);
 
+    /**
+     * Load a single vertex block if it is not already loaded.
+     */
+    void load_vertex_block(vertex_partition_address address);
+
+    /**
+     * Called asynchronously while the current hilbert pass is running.
+     * Loads the vertex blocks required by the coordinates of the upcoming
+     * passes which are not loaded yet, up to
+     * SGRAPH_TRIPLE_APPLY_PREFETCH_MEMORY_BUDGET (estimated) bytes.
+     *
+     * Blocks in use by the running pass are loaded, and therefore never
+     * touched here.
+     */
+    void prefetch_graph_vertex_blocks(const std::vector<std::pair<size_t, size_t>>& coordinates);
+
     /**
      * Perform the triple apply function on one partition. If \ref muateted_edge_fields
      * is not empty, the edge data sframe will be updated at the end of the call.
@@ -139,6 +155,10 @@ namespace {
     // storing vertex partition addresses that are currently loaded in memory.
     std::set<vertex_partition_address> m_loaded_vertex_block_address;
 
+    // vertex partition addresses loaded ahead of time by the prefetcher,
+    // which are not yet part of m_loaded_vertex_block_address.
+    std::set<vertex_partition_address> m_prefetched_vertex_block_address;
+
     std::vector<field_info> m_mutated_vertex_fields;
     std::vector<field_info> m_mutated_edge_fields;
 
@@ -147,6 +167,10 @@ namespace {
 
   template<typename EdgeVisitor>
   void triple_apply_impl::run(EdgeVisitor edge_visitor) {
+    // Snapshot of the loaded set for the prefetcher. The preamble and the
+    // prefetch are never concurrent, so this needs no locking.
+    m_prefetched_vertex_block_address.clear();
+
     // preamble function that load the vertex blocks associated with the
     // edge partitions to be visited.
     std::function<void(std::vector<std::pair<size_t, size_t>>)>
@@ -172,6 +196,9 @@ namespace {
         load_graph_vertex_blocks(vertex_partition_to_load);
 
         m_loaded_vertex_block_address = vertex_partition_to_load;
+        for (const auto& address: vertex_partition_to_load) {
+          m_prefetched_vertex_block_address.erase(address);
+        }
 
         std::stringstream message_ss;
         message_ss << "Vertex partitions in memory: ";
@@ -180,17 +207,42 @@ namespace {
         logstream(LOG_INFO) << message_ss.str() << std::endl;
       };
 
-    hilbert_blocked_parallel_for(
-        m_graph.get_num_partitions(),
-        preamble_fn,
-        [&](std::pair<size_t, size_t> coordinate) {
-          edge_partition_address partition_address(0, 0, coordinate.first, coordinate.second);
-          sframe& sf = m_graph.edge_partition(partition_address);
-          do_work_on_edge_partition(sf, partition_address, edge_visitor);
-        }
-    );
+    std::function<void(std::pair<size_t, size_t>)>
+      work_fn = [&](std::pair<size_t, size_t> coordinate) {
+        edge_partition_address partition_address(0, 0, coordinate.first, coordinate.second);
+        sframe& sf = m_graph.edge_partition(partition_address);
+        do_work_on_edge_partition(sf, partition_address, edge_visitor);
+      };
+
+    if (SGRAPH_TRIPLE_APPLY_PREFETCH_LOOKAHEAD > 0) {
+      hilbert_prefetch_stats stats;
+      hilbert_blocked_parallel_for(
+          m_graph.get_num_partitions(),
+          preamble_fn,
+          work_fn,
+          [&](std::vector<std::pair<size_t, size_t>> coordinates) {
+            prefetch_graph_vertex_blocks(coordinates);
+          },
+          SGRAPH_TRIPLE_APPLY_PREFETCH_LOOKAHEAD,
+          &stats);
+      logstream(LOG_INFO) << "Vertex block prefetch: " << stats.num_prefetches
+                          << " prefetches in " << stats.prefetch_time << " secs, "
+                          << "stalled " << stats.stall_time << " secs in "
+                          << stats.num_passes << " passes" << std::endl;
+    } else {
+      hilbert_blocked_parallel_for(
+          m_graph.get_num_partitions(),
+          preamble_fn,
+          work_fn);
+    }
     // unload and commit the remaining vertex block in the memory.
     preamble_fn({});
+    // release prefetched blocks which were never used. They are not
+    // modified so there is nothing to commit.
+    for (const auto& address: m_prefetched_vertex_block_address) {
+      m_vertex_data[address.partition].unload();
+    }
+    m_prefetched_vertex_block_address.clear();
   }
 
   void triple_apply_impl::init_data_structures(
@@ -240,23 +292,61 @@ namespace {
   void triple_apply_impl::load_graph_vertex_blocks(const std::set<vertex_partition_address>& vertex_address) {
     std::vector<vertex_partition_address> address_vec(vertex_address.begin(), vertex_address.end());
     parallel_for (0, address_vec.size(), [&](size_t i) {
-      vertex_partition_address address = address_vec[i];
-      if (!m_vertex_data[address.partition].is_loaded()) {
-        auto vertex_data_sf = m_graph.vertex_partition(address);
-        if (m_requires_vertex_id) {
-          m_vertex_data[address.partition].load(vertex_data_sf);
-        } else {
-          // Exclude the vid column from loading, and fill the id column
-          // in the loaded vertex data with undefined values.
-          size_t id_column_index = vertex_data_sf.column_index(sgraph::VID_COLUMN_NAME);
-          vertex_data_sf = vertex_data_sf.remove_column(id_column_index);
-          m_vertex_data[address.partition].load(vertex_data_sf);
-          for (auto& entry: m_vertex_data[address.partition].m_vertices) {
-            entry.insert(entry.begin() + id_column_index, FLEX_UNDEFINED);
-          }
+      load_vertex_block(address_vec[i]);
+    });
+  }
+
+  void triple_apply_impl::load_vertex_block(vertex_partition_address address) {
+    if (!m_vertex_data[address.partition].is_loaded()) {
+      auto vertex_data_sf = m_graph.vertex_partition(address);
+      if (m_requires_vertex_id) {
+        m_vertex_data[address.partition].load(vertex_data_sf);
+      } else {
+        // Exclude the vid column from loading, and fill the id column
+        // in the loaded vertex data with undefined values.
+        size_t id_column_index = vertex_data_sf.column_index(sgraph::VID_COLUMN_NAME);
+        vertex_data_sf = vertex_data_sf.remove_column(id_column_index);
+        m_vertex_data[address.partition].load(vertex_data_sf);
+        for (auto& entry: m_vertex_data[address.partition].m_vertices) {
+          entry.insert(entry.begin() + id_column_index, FLEX_UNDEFINED);
         }
       }
-    });
+    }
+  }
+
+  void triple_apply_impl::prefetch_graph_vertex_blocks(
+      const std::vector<std::pair<size_t, size_t>>& coordinates) {
+    // in hilbert order, so that the blocks needed first are loaded first.
+    std::vector<vertex_partition_address> address_vec;
+    std::set<vertex_partition_address> seen;
+    for (const auto& coordinate: coordinates) {
+      for (size_t partition : {coordinate.first, coordinate.second}) {
+        vertex_partition_address address(0, partition);
+        if (seen.insert(address).second &&
+            m_loaded_vertex_block_address.count(address) == 0) {
+          address_vec.push_back(address);
+        }
+      }
+    }
+
+    // estimate the memory held by blocks already prefetched
+    const size_t bytes_per_vertex =
+        m_graph.get_vertex_fields().size() * sizeof(flexible_type);
+    size_t prefetched_bytes = 0;
+    for (const auto& address: m_prefetched_vertex_block_address) {
+      prefetched_bytes += m_graph.vertex_partition(address).size() * bytes_per_vertex;
+    }
+
+    for (const auto& address: address_vec) {
+      if (m_vertex_data[address.partition].is_loaded()) continue;
+      size_t block_bytes = m_graph.vertex_partition(address).size() * bytes_per_vertex;
+      if (prefetched_bytes + block_bytes > SGRAPH_TRIPLE_APPLY_PREFETCH_MEMORY_BUDGET) {
+        break;
+      }
+      load_vertex_block(address);
+      m_prefetched_vertex_block_address.insert(address);
+      prefetched_bytes += block_bytes;
+    }
   }
 
   /**
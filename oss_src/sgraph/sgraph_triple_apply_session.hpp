@@ -0,0 +1,219 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_SGRAPH_SGRAPH_TRIPLE_APPLY_SESSION_HPP
+#define GRAPHLAB_SGRAPH_SGRAPH_TRIPLE_APPLY_SESSION_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <logger/logger.hpp>
+#include <parallel/lambda_omp.hpp>
+#include <sgraph/sgraph.hpp>
+#include <sgraph/sgraph_fast_triple_apply.hpp>
+
+namespace graphlab {
+namespace sgraph_compute {
+
+/**
+ * A multi-iteration compute session over an \ref sgraph which keeps a set of
+ * vertex fields resident in memory across many triple applies.
+ *
+ * Each call to \ref triple_apply goes through
+ * load_graph_vertex_blocks / unload_graph_vertex_blocks, which rereads the
+ * vertex sframes and writes every mutated field back out as new sarrays on
+ * every iteration. For iterative algorithms (pagerank, label propagation, ...)
+ * that cost dominates the edge processing.
+ *
+ * The session instead loads the requested vertex fields once into typed
+ * in-memory storage (one std::vector<T> per vertex partition, the same layout
+ * as \ref create_vertex_data), runs any number of \ref fast_triple_apply
+ * passes against that storage, and only writes the fields back to the graph
+ * on \ref checkpoint or \ref close.
+ *
+ * \code
+ * triple_apply_session<double, flex_float> session(g, {"pagerank"});
+ * auto& pr = session.field("pagerank");
+ * for (size_t iter = 0; iter < num_iterations; ++iter) {
+ *   session.triple_apply([&](fast_edge_scope& scope) {
+ *     auto src = scope.source_vertex_address();
+ *     ...  pr[src.partition_id][src.local_id] ...
+ *   });
+ * }
+ * session.close();
+ * \endcode
+ *
+ * Destroying an open session without calling \ref close discards all
+ * modifications made after the last \ref checkpoint.
+ *
+ * \tparam T The in-memory type of each vertex value.
+ * \tparam FLEX_TYPE The flexible_type value type that T converts from and to.
+ */
+template<typename T, typename FLEX_TYPE=T>
+class triple_apply_session {
+ public:
+  typedef std::vector<std::vector<T>> vertex_field_data;
+
+  /**
+   * Loads the given vertex fields of vertex group \p group into memory.
+   * Throws if any of the fields does not exist, or is the vertex id field.
+   */
+  triple_apply_session(sgraph& g,
+                       const std::vector<std::string>& vertex_fields,
+                       size_t group = 0)
+      : m_graph(g), m_group(group), m_field_names(vertex_fields) {
+    const auto& all_vertex_fields = m_graph.get_vertex_fields();
+    for (const auto& f: m_field_names) {
+      if (std::find(all_vertex_fields.begin(),
+                    all_vertex_fields.end(), f) == all_vertex_fields.end()) {
+        log_and_throw(std::string("Cannot find vertex field: ") + f);
+      }
+      if (f == sgraph::VID_COLUMN_NAME) {
+        log_and_throw(std::string("Id column cannot be mutable: ") + f);
+      }
+    }
+    m_num_partitions = m_graph.get_num_partitions();
+    m_field_data.resize(m_field_names.size());
+    for (size_t i = 0; i < m_field_names.size(); ++i) {
+      load_field(i);
+    }
+    m_is_open = true;
+  }
+
+  /**
+   * Returns the in-memory data of a pinned vertex field.
+   * Indexed as data[partition_id][local_id], matching the
+   * \ref vertex_address of a \ref fast_edge_scope.
+   *
+   * Non-const access marks the session as modified.
+   */
+  vertex_field_data& field(const std::string& name) {
+    return field(field_index(name));
+  }
+
+  vertex_field_data& field(size_t i) {
+    ASSERT_TRUE(m_is_open);
+    ASSERT_LT(i, m_field_data.size());
+    m_modified = true;
+    return m_field_data[i];
+  }
+
+  const vertex_field_data& field(const std::string& name) const {
+    return field(field_index(name));
+  }
+
+  const vertex_field_data& field(size_t i) const {
+    ASSERT_TRUE(m_is_open);
+    ASSERT_LT(i, m_field_data.size());
+    return m_field_data[i];
+  }
+
+  /**
+   * Runs one \ref fast_triple_apply pass over all edges of the graph.
+   * The apply function reads and writes the pinned vertex fields through
+   * \ref field; nothing is written back to the vertex sframes.
+   *
+   * Edge fields listed in \p mutated_edge_fields are committed to the edge
+   * partitions at the end of the pass, exactly as in \ref fast_triple_apply.
+   */
+  void triple_apply(fast_triple_apply_fn_type apply_fn,
+                    const std::vector<std::string>& edge_fields = {},
+                    const std::vector<std::string>& mutated_edge_fields = {}) {
+    ASSERT_TRUE(m_is_open);
+    if (m_graph.get_num_partitions() != m_num_partitions) {
+      log_and_throw("Graph was repartitioned while a triple apply session is open");
+    }
+    m_modified = true;
+    fast_triple_apply(m_graph, apply_fn, edge_fields, mutated_edge_fields);
+    ++m_num_iterations;
+  }
+
+  /**
+   * Writes the pinned vertex fields back to the graph as new sarrays.
+   * The in-memory data stays resident and the session remains usable.
+   * Does nothing if nothing has been modified since the last checkpoint.
+   */
+  void checkpoint() {
+    ASSERT_TRUE(m_is_open);
+    if (!m_modified) return;
+    for (size_t i = 0; i < m_field_names.size(); ++i) {
+      bool success = m_graph.template replace_vertex_field<T, FLEX_TYPE>(
+          m_field_data[i], m_field_names[i], m_group);
+      if (!success) {
+        log_and_throw(std::string("Unable to write back vertex field: ") + m_field_names[i]);
+      }
+    }
+    m_modified = false;
+    logstream(LOG_INFO) << "Triple apply session checkpointed "
+                        << m_field_names.size() << " vertex fields after "
+                        << m_num_iterations << " iterations" << std::endl;
+  }
+
+  /**
+   * Checkpoints and releases the in-memory vertex data.
+   * The session cannot be used afterwards.
+   */
+  void close() {
+    if (!m_is_open) return;
+    checkpoint();
+    m_field_data.clear();
+    m_field_data.shrink_to_fit();
+    m_is_open = false;
+  }
+
+  /// Returns true if the session has not been closed.
+  bool is_open() const { return m_is_open; }
+
+  /// Returns true if there are modifications not yet checkpointed.
+  bool is_modified() const { return m_is_open && m_modified; }
+
+  /// Returns the number of triple_apply passes run in this session.
+  size_t num_iterations() const { return m_num_iterations; }
+
+  /// Returns the names of the pinned vertex fields.
+  const std::vector<std::string>& field_names() const { return m_field_names; }
+
+ private:
+  size_t field_index(const std::string& name) const {
+    auto iter = std::find(m_field_names.begin(), m_field_names.end(), name);
+    if (iter == m_field_names.end()) {
+      log_and_throw(std::string("Vertex field is not pinned in this session: ") + name);
+    }
+    return iter - m_field_names.begin();
+  }
+
+  void load_field(size_t i) {
+    auto columns = m_graph.fetch_vertex_data_field(m_field_names[i], m_group);
+    m_field_data[i].resize(columns.size());
+    parallel_for(0, columns.size(), [&](size_t partition) {
+      std::vector<flexible_type> buffer;
+      columns[partition]->get_reader()->read_rows(0, columns[partition]->size(), buffer);
+      // assign element-wise so that non-copyable value types
+      // (e.g. std::atomic) can be pinned as well.
+      auto& out = m_field_data[i][partition];
+      out = std::vector<T>(buffer.size());
+      for (size_t j = 0; j < buffer.size(); ++j) {
+        out[j] = (FLEX_TYPE)(buffer[j]);
+      }
+    });
+  }
+
+  sgraph& m_graph;
+  size_t m_group;
+  size_t m_num_partitions = 0;
+  std::vector<std::string> m_field_names;
+  std::vector<vertex_field_data> m_field_data;
+
+  bool m_is_open = false;
+  bool m_modified = false;
+  size_t m_num_iterations = 0;
+};
+
+} // end of sgraph_compute
+} // end of graphlab
+
+#endif
@@ -127,6 +127,9 @@ void configure_global_environment(std::string argv0) {
     graphlab::sframe_config::SFRAME_SORT_BUFFER_SIZE = total_system_memory / 4;
     graphlab::fileio::FILEIO_MAXIMUM_CACHE_CAPACITY_PER_FILE = total_system_memory / 2;
     graphlab::fileio::FILEIO_MAXIMUM_CACHE_CAPACITY = total_system_memory / 2;
+    // The limits above are what each operator or cache may use on its own.
+    // The memory governor keeps them all together within the limit.
+    graphlab::fileio::FILEIO_MEMORY_GOVERNOR_BUDGET = total_system_memory;
   }
   graphlab::globals::initialize_globals_from_environment(argv0);
   
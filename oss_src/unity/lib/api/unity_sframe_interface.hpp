@@ -27,6 +27,7 @@ typedef std::map<std::string, std::shared_ptr<unity_sarray_base>> csv_parsing_er
 GENERATE_INTERFACE_AND_PROXY(unity_sframe_base, unity_sframe_proxy,
       (void, construct_from_dataframe, (const dataframe_t&))
       (void, construct_from_sframe_index, (std::string))
+      (void, construct_from_arrow_files, (const std::vector<std::string>&)(const std::vector<flexible_type>&)(const std::vector<std::string>&))
       (csv_parsing_errors, construct_from_csvs, (std::string)(csv_parsing_config_map)(str_flex_type_map))
       (void, clear, )
       (size_t, size, )
@@ -35,7 +36,10 @@ GENERATE_INTERFACE_AND_PROXY(unity_sframe_base, unity_sframe_proxy,
       (std::shared_ptr<unity_sframe_base>, flat_map, (const std::string&)(std::vector<std::string>)
                                      (std::vector<flex_type_enum>)(bool)(int))
       (void, save_frame, (std::string) )
+      (void, save_frame_with_compression, (std::string)(string_map) )
       (void, save_frame_reference, (std::string) )
+      (void, append_to_saved_frame, (std::string) )
+      (void, compact_saved_frame, (std::string) )
       (size_t, num_columns, )
       (std::vector<flex_type_enum>, dtype, )
       (std::vector<std::string>, column_names, )
@@ -57,6 +61,11 @@ GENERATE_INTERFACE_AND_PROXY(unity_sframe_base, unity_sframe_proxy,
       (void, save_as_csv, (const std::string&)(csv_parsing_config_map))
       (std::shared_ptr<unity_sframe_base>, sample, (float)(int))
       (std::list<std::shared_ptr<unity_sframe_base>>, random_split, (float)(int))
+      (std::shared_ptr<unity_sframe_base>, sample_rows, (size_t)(int))
+      (std::shared_ptr<unity_sframe_base>, shuffle, (int))
+      (flexible_type, export_to_arrow_file, (const std::string&)(const std::vector<std::string>&)(size_t)(size_t)(bool))
+      (void, build_key_index, (const std::string&)(const std::string&))
+      (std::shared_ptr<unity_sframe_base>, lookup_by_key_index, (const std::string&)(const std::vector<flexible_type>&))
       (std::shared_ptr<unity_sframe_base>, groupby_aggregate, (const std::vector<std::string>&)
                                               (const std::vector<std::vector<std::string>>&)
                                               (const std::vector<std::string>&)
@@ -66,7 +75,9 @@ GENERATE_INTERFACE_AND_PROXY(unity_sframe_base, unity_sframe_proxy,
       (bool, is_materialized, )
       (bool, has_size, )
       (std::string, query_plan_string, )
+      (std::string, explain_analyze, (const std::string&))
       (std::shared_ptr<unity_sframe_base>, join, (std::shared_ptr<unity_sframe_base>)(const std::string)(string_map))
+      (std::shared_ptr<unity_sframe_base>, join_many, (std::list<std::shared_ptr<unity_sframe_base>>)(const std::vector<std::string>&))
       (std::shared_ptr<unity_sframe_base>, sort, (const std::vector<std::string>&)(const std::vector<int>&))
       (std::shared_ptr<unity_sarray_base>, pack_columns, (const std::vector<std::string>&)(const std::vector<std::string>&)(flex_type_enum)(const flexible_type&))
       (std::shared_ptr<unity_sframe_base>, stack,  (const std::string&)(const std::vector<std::string>&)(const std::vector<flex_type_enum>&)(bool))
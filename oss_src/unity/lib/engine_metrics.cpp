@@ -0,0 +1,289 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <fileio/fileio_constants.hpp>
+#include <fileio/fixed_size_cache_manager.hpp>
+#include <fileio/memory_governor.hpp>
+#include <fileio/spill_manager.hpp>
+#include <fileio/temp_files.hpp>
+#include <sframe/sarray_v2_decoded_block_cache.hpp>
+#include <sframe_query_engine/execution/running_queries.hpp>
+#include <lambda/lambda_master.hpp>
+#include <metric/metrics_server.hpp>
+#include <unity/lib/engine_metrics.hpp>
+
+namespace graphlab {
+
+engine_metrics engine_metrics::collect() {
+  engine_metrics ret;
+  auto& queries = query_eval::running_queries::get_instance();
+  for (const auto& info: queries.list()) {
+    query q;
+    q.id = info->id;
+    q.description = info->description;
+    q.elapsed_seconds = info->elapsed.current_time();
+    q.stage = info->num_stages.value;
+    q.rows_output = info->stage_rows_output.value;
+    q.expected_rows = info->stage_expected_rows.value;
+    q.spilled_bytes = info->spilled_bytes->value;
+    ret.running_queries.push_back(q);
+  }
+  ret.completed_queries = queries.num_completed();
+
+  auto& cache = fileio::fixed_size_cache_manager::get_instance();
+  ret.fileio_cache_bytes = cache.get_cache_utilization();
+  ret.fileio_cache_capacity = fileio::FILEIO_MAXIMUM_CACHE_CAPACITY;
+  ret.fileio_spilled_bytes = cache.get_spilled_bytes();
+
+  auto block_stats = v2_block_impl::decoded_block_cache::get_instance().get_stats();
+  ret.block_cache_hits = block_stats.hits;
+  ret.block_cache_misses = block_stats.misses;
+  ret.block_cache_evictions = block_stats.evictions;
+  ret.block_cache_bytes = block_stats.bytes;
+  ret.block_cache_capacity = block_stats.capacity;
+
+  auto governor_stats = memory_governor::get_instance().get_stats();
+  ret.memory_budget = governor_stats.budget;
+  ret.memory_reserved = governor_stats.reserved_bytes;
+  ret.memory_num_waiting = governor_stats.num_waiting;
+
+  // do not start the lambda workers just to count them
+  if (lambda::lambda_master::is_instantiated()) {
+    auto& master = lambda::lambda_master::get_instance();
+    ret.lambda_workers = master.num_workers();
+    ret.lambda_workers_busy = ret.lambda_workers -
+        std::min(ret.lambda_workers, master.num_available_workers());
+  }
+
+  ret.spills = spill_manager::get_instance().get_stats();
+
+  auto temp_usage = get_current_process_temp_usage();
+  ret.temp_files = temp_usage.first;
+  ret.temp_file_bytes = temp_usage.second;
+  return ret;
+}
+
+namespace {
+
+std::string escape(const std::string& s) {
+  std::string ret;
+  for (char c: s) {
+    if (c == '"' || c == '\\') ret += '\\';
+    if ((unsigned char)c >= 0x20) ret += c;
+  }
+  return ret;
+}
+
+/// The fraction of the stage done, or -1 if not known
+double query_progress(const engine_metrics::query& q) {
+  if (q.expected_rows < 0) return -1;
+  if (q.expected_rows == 0) return 1;
+  return std::min(1.0, double(q.rows_output) / q.expected_rows);
+}
+
+double hit_rate(size_t hits, size_t misses) {
+  return hits + misses == 0 ? 0 : double(hits) / (hits + misses);
+}
+
+} // anonymous namespace
+
+std::string engine_metrics::to_json() const {
+  std::stringstream strm;
+  strm << "{\n"
+       << "  \"queries\": {\n"
+       << "    \"running\": " << running_queries.size() << ",\n"
+       << "    \"completed\": " << completed_queries << ",\n"
+       << "    \"list\": [";
+  for (size_t i = 0; i < running_queries.size(); ++i) {
+    const auto& q = running_queries[i];
+    strm << (i == 0 ? "\n" : ",\n")
+         << "      {\"id\": " << q.id
+         << ", \"operator\": \"" << escape(q.description) << "\""
+         << ", \"elapsed_seconds\": " << q.elapsed_seconds
+         << ", \"stage\": " << q.stage
+         << ", \"rows_output\": " << q.rows_output
+         << ", \"expected_rows\": " << q.expected_rows
+         << ", \"spilled_bytes\": " << q.spilled_bytes
+         << ", \"progress\": " << query_progress(q) << "}";
+  }
+  strm << "]\n"
+       << "  },\n"
+       << "  \"fileio_cache\": {\n"
+       << "    \"bytes\": " << fileio_cache_bytes << ",\n"
+       << "    \"capacity\": " << fileio_cache_capacity << ",\n"
+       << "    \"spilled_bytes\": " << fileio_spilled_bytes << "\n"
+       << "  },\n"
+       << "  \"block_cache\": {\n"
+       << "    \"hits\": " << block_cache_hits << ",\n"
+       << "    \"misses\": " << block_cache_misses << ",\n"
+       << "    \"hit_rate\": " << hit_rate(block_cache_hits, block_cache_misses) << ",\n"
+       << "    \"evictions\": " << block_cache_evictions << ",\n"
+       << "    \"bytes\": " << block_cache_bytes << ",\n"
+       << "    \"capacity\": " << block_cache_capacity << "\n"
+       << "  },\n"
+       << "  \"memory_governor\": {\n"
+       << "    \"budget\": " << memory_budget << ",\n"
+       << "    \"reserved_bytes\": " << memory_reserved << ",\n"
+       << "    \"waiting\": " << memory_num_waiting << "\n"
+       << "  },\n"
+       << "  \"lambda_workers\": {\n"
+       << "    \"workers\": " << lambda_workers << ",\n"
+       << "    \"busy\": " << lambda_workers_busy << "\n"
+       << "  },\n"
+       << "  \"spills\": {\n"
+       << "    \"consumers\": {";
+  for (size_t i = 0; i < (size_t)memory_consumer::NUM_CONSUMERS; ++i) {
+    strm << (i == 0 ? "\n" : ",\n")
+         << "      \"" << memory_consumer_name((memory_consumer)i) << "\": "
+         << "{\"spilled_bytes\": " << spills.spilled_bytes[i]
+         << ", \"runs\": " << spills.num_runs[i] << "}";
+  }
+  strm << "},\n"
+       << "    \"directories\": [";
+  for (size_t i = 0; i < spills.directories.size(); ++i) {
+    const auto& d = spills.directories[i];
+    strm << (i == 0 ? "\n" : ",\n")
+         << "      {\"path\": \"" << escape(d.path) << "\""
+         << ", \"runs\": " << d.num_runs
+         << ", \"bytes\": " << d.bytes << "}";
+  }
+  strm << "],\n"
+       << "    \"sessions\": [";
+  for (size_t i = 0; i < spills.sessions.size(); ++i) {
+    const auto& session = spills.sessions[i];
+    strm << (i == 0 ? "\n" : ",\n")
+         << "      {\"consumer\": \"" << memory_consumer_name(session.consumer) << "\""
+         << ", \"operator\": \"" << escape(session.description) << "\""
+         << ", \"spilled_bytes\": " << session.spilled_bytes
+         << ", \"memory_bytes\": " << session.memory_bytes
+         << ", \"runs\": " << session.num_runs << "}";
+  }
+  strm << "]\n"
+       << "  },\n"
+       << "  \"temp_files\": {\n"
+       << "    \"files\": " << temp_files << ",\n"
+       << "    \"bytes\": " << temp_file_bytes << "\n"
+       << "  }\n"
+       << "}\n";
+  return strm.str();
+}
+
+std::string engine_metrics::to_prometheus() const {
+  std::stringstream strm;
+  // byte counts are printed in full
+  strm << std::setprecision(15);
+  auto metric = [&](const std::string& name, const std::string& type,
+                    const std::string& help, double value) {
+    strm << "# HELP " << name << " " << help << "\n"
+         << "# TYPE " << name << " " << type << "\n"
+         << name << " " << value << "\n";
+  };
+  metric("sframe_queries_running", "gauge",
+         "Queries being materialized.", running_queries.size());
+  metric("sframe_queries_completed_total", "counter",
+         "Queries materialized so far.", completed_queries);
+
+  strm << "# HELP sframe_query_progress Fraction of the current stage of a "
+       << "running query done, -1 if not known.\n"
+       << "# TYPE sframe_query_progress gauge\n";
+  for (const auto& q: running_queries) {
+    strm << "sframe_query_progress{query=\"" << q.id << "\","
+         << "operator=\"" << escape(q.description) << "\","
+         << "stage=\"" << q.stage << "\"} " << query_progress(q) << "\n";
+  }
+  strm << "# HELP sframe_query_elapsed_seconds Time a running query has run for.\n"
+       << "# TYPE sframe_query_elapsed_seconds gauge\n";
+  for (const auto& q: running_queries) {
+    strm << "sframe_query_elapsed_seconds{query=\"" << q.id << "\"} "
+         << q.elapsed_seconds << "\n";
+  }
+
+  metric("sframe_fileio_cache_bytes", "gauge",
+         "Bytes held in the in-memory fileio cache.", fileio_cache_bytes);
+  metric("sframe_fileio_cache_capacity_bytes", "gauge",
+         "Configured capacity of the fileio cache.", fileio_cache_capacity);
+  metric("sframe_fileio_spilled_bytes_total", "counter",
+         "Bytes of the fileio cache written to disk.", fileio_spilled_bytes);
+  metric("sframe_block_cache_hits_total", "counter",
+         "Decoded block cache hits.", block_cache_hits);
+  metric("sframe_block_cache_misses_total", "counter",
+         "Decoded block cache misses.", block_cache_misses);
+  metric("sframe_block_cache_evictions_total", "counter",
+         "Decoded block cache evictions.", block_cache_evictions);
+  metric("sframe_block_cache_bytes", "gauge",
+         "Bytes held in the decoded block cache.", block_cache_bytes);
+  metric("sframe_block_cache_capacity_bytes", "gauge",
+         "Capacity of the decoded block cache.", block_cache_capacity);
+  metric("sframe_memory_budget_bytes", "gauge",
+         "Memory governor budget, 0 if disabled.", memory_budget);
+  metric("sframe_memory_reserved_bytes", "gauge",
+         "Working memory reserved by running operators.", memory_reserved);
+  metric("sframe_memory_waiting_operators", "gauge",
+         "Operators waiting for working memory.", memory_num_waiting);
+  metric("sframe_lambda_workers", "gauge",
+         "Lambda worker processes.", lambda_workers);
+  metric("sframe_lambda_workers_busy", "gauge",
+         "Lambda workers evaluating a lambda.", lambda_workers_busy);
+
+  strm << "# HELP sframe_spilled_bytes_total Bytes spilled to temp storage by "
+       << "the operators.\n"
+       << "# TYPE sframe_spilled_bytes_total counter\n";
+  for (size_t i = 0; i < (size_t)memory_consumer::NUM_CONSUMERS; ++i) {
+    strm << "sframe_spilled_bytes_total{consumer=\""
+         << memory_consumer_name((memory_consumer)i) << "\"} "
+         << spills.spilled_bytes[i] << "\n";
+  }
+  strm << "# HELP sframe_spill_runs_total Runs spilled to temp storage by "
+       << "the operators.\n"
+       << "# TYPE sframe_spill_runs_total counter\n";
+  for (size_t i = 0; i < (size_t)memory_consumer::NUM_CONSUMERS; ++i) {
+    strm << "sframe_spill_runs_total{consumer=\""
+         << memory_consumer_name((memory_consumer)i) << "\"} "
+         << spills.num_runs[i] << "\n";
+  }
+  strm << "# HELP sframe_spill_directory_bytes Bytes of the live spill runs "
+       << "on a temp directory.\n"
+       << "# TYPE sframe_spill_directory_bytes gauge\n";
+  for (const auto& d: spills.directories) {
+    strm << "sframe_spill_directory_bytes{directory=\"" << escape(d.path) << "\"} "
+         << d.bytes << "\n";
+  }
+  metric("sframe_spilling_operators", "gauge",
+         "Operators which may spill, running.", spills.sessions.size());
+  metric("sframe_temp_files", "gauge",
+         "Temp files of the process on local disk.", temp_files);
+  metric("sframe_temp_file_bytes", "gauge",
+         "Bytes of temp files of the process on local disk.", temp_file_bytes);
+  return strm.str();
+}
+
+static std::pair<std::string, std::string>
+engine_metrics_json(std::map<std::string, std::string>& vars) {
+  return std::make_pair(std::string("application/json"),
+                        engine_metrics::collect().to_json());
+}
+
+static std::pair<std::string, std::string>
+engine_metrics_prometheus(std::map<std::string, std::string>& vars) {
+  return std::make_pair(std::string("text/plain; version=0.0.4"),
+                        engine_metrics::collect().to_prometheus());
+}
+
+void register_engine_metric_pages() {
+  add_metric_server_callback("engine.json", engine_metrics_json);
+  add_metric_server_callback("metrics", engine_metrics_prometheus);
+}
+
+void unregister_engine_metric_pages() {
+  remove_metric_server_callback("engine.json");
+  remove_metric_server_callback("metrics");
+}
+
+} // namespace graphlab
@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#ifndef GRAPHLAB_UNITY_ENGINE_METRICS_HPP
+#define GRAPHLAB_UNITY_ENGINE_METRICS_HPP
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <fileio/spill_manager.hpp>
+
+namespace graphlab {
+
+/**
+ * A snapshot of the state of the SFrame engine, served on the metrics
+ * server (see \ref register_engine_metric_pages).
+ */
+struct engine_metrics {
+  struct query {
+    size_t id = 0;
+    std::string description;
+    double elapsed_seconds = 0;
+    size_t stage = 0;
+    size_t rows_output = 0;
+    /// -1 if not known
+    int64_t expected_rows = -1;
+    /// The bytes the operators of the query spilled to temp storage
+    size_t spilled_bytes = 0;
+  };
+  std::vector<query> running_queries;
+  size_t completed_queries = 0;
+
+  /// The fileio cache (cache:// files)
+  size_t fileio_cache_bytes = 0;
+  size_t fileio_cache_capacity = 0;
+  size_t fileio_spilled_bytes = 0;
+
+  /// The decoded block cache
+  size_t block_cache_hits = 0;
+  size_t block_cache_misses = 0;
+  size_t block_cache_evictions = 0;
+  size_t block_cache_bytes = 0;
+  size_t block_cache_capacity = 0;
+
+  /// The memory governor
+  size_t memory_budget = 0;
+  size_t memory_reserved = 0;
+  size_t memory_num_waiting = 0;
+
+  /// Lambda workers. All 0 if they have not been started.
+  size_t lambda_workers = 0;
+  size_t lambda_workers_busy = 0;
+
+  /// The runs spilled by the groupbys, joins and sorts
+  spill_manager::spill_stats spills;
+
+  /// Temp files of the process on local disk
+  size_t temp_files = 0;
+  size_t temp_file_bytes = 0;
+
+  /// Collects the current state of the engine
+  static engine_metrics collect();
+
+  std::string to_json() const;
+
+  /// The Prometheus text exposition format
+  std::string to_prometheus() const;
+};
+
+/**
+ * Registers the engine metric pages on the metrics server:
+ *  - engine.json: the \ref engine_metrics as JSON
+ *  - metrics: the \ref engine_metrics in the Prometheus text format
+ */
+void register_engine_metric_pages();
+
+/**
+ * Removes the pages registered by \ref register_engine_metric_pages.
+ */
+void unregister_engine_metric_pages();
+
+} // namespace graphlab
+#endif
@@ -179,9 +179,11 @@ gl_sarray gl_sarray::from_sequence(size_t start, size_t end, bool reverse) {
                                                 reverse);
 }
 
-gl_sarray gl_sarray::from_avro(const std::string& directory) {
+gl_sarray gl_sarray::from_avro(const std::string& directory,
+                               const std::vector<std::string>& fields,
+                               size_t row_limit) {
   gl_sarray ret;
-  ret.get_proxy()->construct_from_avro(directory);
+  ret.get_proxy()->construct_from_avro(directory, fields, row_limit);
   return ret;
 }
 
@@ -297,8 +297,14 @@ class gl_sarray {
 
   /**
    * Returns a gl_sarray of values parsed from an avro file.
+   *
+   * If fields is not empty, the records are read as dictionaries of only
+   * these fields. If row_limit is not 0, only the first row_limit records
+   * are read.
    */
-  static gl_sarray from_avro(const std::string& filename);
+  static gl_sarray from_avro(const std::string& filename,
+                             const std::vector<std::string>& fields = {},
+                             size_t row_limit = 0);
 
   /**************************************************************************/
   /*                                                                        */
@@ -36,6 +36,7 @@
 #include <unity/lib/auto_close_sarray.hpp>
 #include <unity/lib/unity_global.hpp>
 #include <unity/lib/image_util.hpp>
+#include <sframe_query_engine/algorithm/sample.hpp>
 #include <sframe_query_engine/operators/all_operators.hpp>
 #include <sframe_query_engine/operators/operator_properties.hpp>
 #include <sframe_query_engine/planning/planner.hpp>
@@ -240,6 +241,12 @@ void unity_sarray::construct_from_autodetect(std::string url, flex_type_enum typ
 }
 
 void unity_sarray::construct_from_avro(std::string url) {
+  construct_from_avro(url, {}, 0);
+}
+
+void unity_sarray::construct_from_avro(std::string url,
+                                       const std::vector<std::string>& fields,
+                                       size_t row_limit) {
   auto status = fileio::get_file_status(url);
   if (status == fileio::file_status::MISSING) {
     log_and_throw_io_failure(std::string("Cannot open ") + sanitize_url(url));
@@ -252,6 +259,8 @@ void unity_sarray::construct_from_avro(std::string url) {
     if (type == flex_type_enum::UNDEFINED)
       log_and_throw("Avro schema is undefined");
 
+    reader.select_fields(fields);
+
     logstream(LOG_INFO) << "Construct sarray from AVRO url: " << sanitize_url(url) <<  " type: "
                         << flex_type_enum_to_name(type) << std::endl;
 
@@ -265,7 +274,7 @@ void unity_sarray::construct_from_avro(std::string url) {
     size_t progress_interval = 10000;
 
     flexible_type record;
-    while (has_more) {
+    while (has_more && (row_limit == 0 || num_read < row_limit)) {
       if ((num_read >= progress_interval) && (num_read % progress_interval == 0)) {
         logprogress_stream << "Added " << num_read << " records to SArray"
                            << std::endl;
@@ -452,7 +461,8 @@ std::shared_ptr<unity_sarray_base> unity_sarray::transform_lambda(
     std::function<flexible_type(const flexible_type&)> function,
     flex_type_enum type,
     bool skip_undefined,
-    int seed) {
+    int seed,
+    const std::string& fingerprint) {
 
   auto fn = [function, type, skip_undefined](const sframe_rows::row& f)->flexible_type {
     if (skip_undefined && f[0].get_type() == flex_type_enum::UNDEFINED) {
@@ -471,7 +481,8 @@ std::shared_ptr<unity_sarray_base> unity_sarray::transform_lambda(
   auto ret_sarray = std::make_shared<unity_sarray>();
 
   ret_sarray->construct_from_planner_node(
-      query_eval::op_transform::make_planner_node(m_planner_node, fn, type, seed));
+      query_eval::op_transform::make_planner_node(m_planner_node, fn, type, seed,
+                                                  fingerprint));
 
   return ret_sarray;
 }
@@ -1430,6 +1441,12 @@ std::shared_ptr<unity_sarray_base> unity_sarray::scalar_operator(flexible_type o
 
   // create the lazy evalation transform operator from the source
   std::shared_ptr<unity_sarray> ret_unity_sarray(new unity_sarray());
+  // the operator and the exact scalar identify the transform
+  oarchive oarc;
+  oarc << other;
+  std::string fingerprint = std::string(right_operator ? "right " : "left ") + op +
+                            " " + std::string(oarc.buf, oarc.off);
+  free(oarc.buf);
   if (other.get_type() != flex_type_enum::UNDEFINED) {
     auto transformfn = [=](const flexible_type& f)->flexible_type {
           if (f.get_type() == flex_type_enum::UNDEFINED) {
@@ -1441,7 +1458,8 @@ std::shared_ptr<unity_sarray_base> unity_sarray::scalar_operator(flexible_type o
     return transform_lambda(transformfn, 
                             output_type,
                             true /*skip undefined*/, 
-                            0 /*random seed*/);
+                            0 /*random seed*/,
+                            fingerprint);
   } else {
     auto transformfn =  
         [=](const flexible_type& f)->flexible_type {
@@ -1451,7 +1469,8 @@ std::shared_ptr<unity_sarray_base> unity_sarray::scalar_operator(flexible_type o
     return transform_lambda(transformfn, 
                             output_type,
                             false/*skip undefined*/, 
-                            0 /*random seed*/);
+                            0 /*random seed*/,
+                            fingerprint);
   }
 
   return ret_unity_sarray;
@@ -1525,7 +1544,8 @@ std::shared_ptr<unity_sarray_base> unity_sarray::vector_operator(
       op_binary_transform::make_planner_node(m_planner_node,
                                              other_unity_sarray->m_planner_node,
                                              transform_fn_with_undefined_checking,
-                                             output_type));
+                                             output_type,
+                                             "binary " + op));
   return ret;
 }
 
@@ -1574,24 +1594,21 @@ std::shared_ptr<unity_sarray_base> unity_sarray::tail(size_t nrows) {
 std::shared_ptr<unity_sarray_base> unity_sarray::make_uniform_boolean_array(size_t size,
                                                                             float percent,
                                                                             int random_seed) {
-  // create a sequential sarray
-  auto seq = std::static_pointer_cast<unity_sarray>(
-    unity_sarray::create_sequential_sarray(size, 0, false));
-
-  flex_int seed_hash = flexible_type((flex_int)(random_seed)).hash();
-  size_t sample_limit = std::numeric_limits<size_t>::max() * percent;
-  auto filter_fn = [sample_limit, seed_hash](const flexible_type& val)->flexible_type {
-        size_t d = hash64(val.get<flex_int>() ^ seed_hash);
-        return d <= sample_limit;
-      };
-  return seq->transform_lambda(filter_fn, flex_type_enum::INTEGER, false, 0);
+  auto ret = std::make_shared<unity_sarray>();
+  ret->construct_from_planner_node(
+      op_sample_mask::make_planner_node(size, percent, random_seed));
+  return ret;
 }
 
 std::shared_ptr<unity_sarray_base> unity_sarray::sample(float percent, 
                                                         int random_seed) {
-  // create a sequential sarray
-  auto seq = make_uniform_boolean_array(size(), percent, random_seed);
-  return logical_filter(seq);
+  // a sparse sample reads its rows directly if the sarray is materialized:
+  // is_materialized reduces the plan to its source
+  if (percent < query_eval::SPARSE_SAMPLE_FRACTION) is_materialized();
+  auto ret = std::make_shared<unity_sarray>();
+  ret->construct_from_planner_node(
+      query_eval::sample(get_planner_node(), size(), percent, random_seed));
+  return ret;
 }
 
 std::shared_ptr<unity_sarray_base>
@@ -127,6 +127,15 @@ class unity_sarray: public unity_sarray_base {
    */
   void construct_from_avro(std::string url);
 
+  /**
+   * Like construct_from_avro(url), but only reads the first row_limit
+   * records (0 reads all of them), and if fields is not empty, only converts
+   * those fields of each record. The schema must then be a record.
+   */
+  void construct_from_avro(std::string url,
+                           const std::vector<std::string>& fields,
+                           size_t row_limit);
+
   /**
    * Saves a copy of the current sarray into a directory.
    * Does not modify the current sarray
@@ -207,10 +216,16 @@ class unity_sarray: public unity_sarray_base {
       bool skip_undefined,
       int seed);
 
+  /**
+   * Returns a new sarray which is a transform of this using a C++ function.
+   * A non-empty fingerprint identifies the function, so that identical
+   * transforms are computed once (see op_transform).
+   */
   std::shared_ptr<unity_sarray_base> transform_lambda(std::function<flexible_type(const flexible_type&)> lambda,
                                                       flex_type_enum type,
                                                       bool skip_undefined,
-                                                      int seed);
+                                                      int seed,
+                                                      const std::string& fingerprint = "");
 
   /**
    * Append all rows from "other" sarray to "this" sarray and returns a new sarray
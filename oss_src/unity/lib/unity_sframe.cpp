@@ -15,21 +15,27 @@
 #include <sframe/algorithm.hpp>
 #include <fileio/temp_files.hpp>
 #include <fileio/sanitize_url.hpp>
+#include <fileio/general_fstream.hpp>
 #include <unity/lib/unity_global.hpp>
 #include <unity/lib/unity_global_singleton.hpp>
 #include <sframe/groupby_aggregate.hpp>
 #include <sframe/groupby_aggregate_operators.hpp>
 #include <sframe/csv_line_tokenizer.hpp>
+#include <sframe/parallel_csv_parser.hpp>
 #include <sframe/csv_writer.hpp>
 #include <flexible_type/flexible_type_spirit_parser.hpp>
 #include <sframe/join.hpp>
+#include <sframe/sframe_key_index.hpp>
+#include <sframe/sframe_arrow.hpp>
 #include <unity/lib/auto_close_sarray.hpp>
 #include <sframe_query_engine/planning/planner.hpp>
 #include <sframe_query_engine/planning/optimization_engine.hpp>
+#include <sframe_query_engine/execution/query_profile.hpp>
 #include <sframe_query_engine/operators/all_operators.hpp>
 #include <sframe_query_engine/operators/operator_properties.hpp>
 #include <sframe_query_engine/algorithm/sort.hpp>
 #include <sframe_query_engine/algorithm/groupby_aggregate.hpp>
+#include <sframe_query_engine/algorithm/sample.hpp>
 #include <lambda/pylambda_function.hpp>
 #include <exceptions/error_types.hpp>
 
@@ -53,6 +59,20 @@ static std::shared_ptr<sframe> get_empty_sframe() {
   }
   return *sf;
 }
+/**
+ * The arguments of a CSV parse which has not been run yet.
+ */
+struct unity_sframe::deferred_csv_source {
+  std::string url;
+  csv_line_tokenizer tokenizer;
+  csv_file_handling_options options;
+  /// The names of the columns in the file, matching m_column_names, which
+  /// may have been renamed since
+  std::vector<std::string> file_column_names;
+  /// The types of the columns, matching m_column_names
+  std::vector<flex_type_enum> column_types;
+};
+
 unity_sframe::unity_sframe() {
   this->set_sframe(get_empty_sframe());
 }
@@ -114,6 +134,36 @@ void unity_sframe::construct_from_sframe_index(std::string location) {
   }
 }
 
+void unity_sframe::construct_from_arrow_files(
+    const std::vector<std::string>& files,
+    const std::vector<flexible_type>& layouts,
+    const std::vector<std::string>& columns) {
+  log_func_entry();
+  if (files.empty() || files.size() != layouts.size()) {
+    log_and_throw("Expected a layout for each of one or more Arrow batches");
+  }
+  std::vector<ArrowSchema> schemas(files.size());
+  std::vector<ArrowArray> arrays(files.size());
+  std::vector<ArrowArray*> batches;
+  try {
+    for (size_t i = 0; i < files.size(); ++i) {
+      schemas[i].release = nullptr;
+      arrays[i].release = nullptr;
+      read_arrow_from_file(files[i], layouts[i], &schemas[i], &arrays[i]);
+      batches.push_back(&arrays[i]);
+    }
+  } catch (...) {
+    for (size_t i = 0; i < files.size(); ++i) {
+      if (arrays[i].release) arrays[i].release(&arrays[i]);
+      if (schemas[i].release) schemas[i].release(&schemas[i]);
+    }
+    throw;
+  }
+  // the batches share the schema of the first one
+  for (size_t i = 1; i < files.size(); ++i) schemas[i].release(&schemas[i]);
+  construct_from_sframe(import_sframe_from_arrow(&schemas[0], batches, columns));
+}
+
 std::map<std::string, std::shared_ptr<unity_sarray_base>> unity_sframe::construct_from_csvs(
     std::string url,
     std::map<std::string, flexible_type> csv_parsing_config,
@@ -133,6 +183,7 @@ std::map<std::string, std::shared_ptr<unity_sarray_base>> unity_sframe::construc
   bool use_header = true;
   bool continue_on_failure = false;
   bool store_errors = false;
+  bool lazy = false;
   size_t row_limit = 0;
   size_t skip_rows = 0;
   std::vector<std::string> output_columns;
@@ -153,6 +204,9 @@ std::map<std::string, std::shared_ptr<unity_sarray_base>> unity_sframe::construc
   if (csv_parsing_config.count("store_errors")) {
     store_errors = !csv_parsing_config["store_errors"].is_zero();
   }
+  if (csv_parsing_config.count("lazy")) {
+    lazy = !csv_parsing_config["lazy"].is_zero();
+  }
   if (csv_parsing_config.count("row_limit")) {
     row_limit = (flex_int)(csv_parsing_config["row_limit"]);
   }
@@ -213,6 +267,25 @@ std::map<std::string, std::shared_ptr<unity_sarray_base>> unity_sframe::construc
 
   tokenizer.init();
 
+  if (lazy && !store_errors) {
+    auto source = std::make_shared<deferred_csv_source>();
+    source->url = url;
+    source->tokenizer = tokenizer;
+    source->options.use_header = use_header;
+    source->options.continue_on_failure = continue_on_failure;
+    source->options.column_type_hints = column_type_hints;
+    source->options.output_columns = output_columns;
+    source->options.row_limit = row_limit;
+    source->options.skip_rows = skip_rows;
+    auto schema = read_csv_schema(url, tokenizer, source->options);
+    source->file_column_names = schema.first;
+    source->column_types = schema.second;
+    m_planner_node.reset();
+    m_column_names = schema.first;
+    m_deferred_csv = source;
+    return {};
+  }
+
   auto sframe_ptr = std::make_shared<sframe>();
 
   auto errors = sframe_ptr->init_from_csvs(url,
@@ -256,16 +329,30 @@ void unity_sframe::construct_from_planner_node(std::shared_ptr<planner_node> nod
 }
 
 void unity_sframe::save_frame(std::string target_directory) {
-  try {
-    dir_archive dirarc;
-    dirarc.open_directory_for_write(target_directory);
-    dirarc.set_metadata("contents", "sframe");
-    std::string prefix = dirarc.get_next_write_prefix();
-    save_frame_by_index_file(prefix + ".frame_idx");
-    dirarc.close();
-  } catch(...) {
-    throw;
+  save_frame_with_compression(target_directory, {});
+}
+
+void unity_sframe::save_frame_with_compression(
+    std::string target_directory,
+    std::map<std::string, std::string> column_codecs) {
+  log_func_entry();
+  auto sf = get_underlying_sframe();
+  std::vector<std::string> codecs;
+  if (!column_codecs.empty()) {
+    codecs.resize(sf->num_columns());
+    for (const auto& codec: column_codecs) {
+      if (!sf->contains_column(codec.first)) {
+        log_and_throw("Column " + codec.first + " does not exist");
+      }
+      codecs[sf->column_index(codec.first)] = codec.second;
+    }
   }
+  dir_archive dirarc;
+  dirarc.open_directory_for_write(target_directory);
+  dirarc.set_metadata("contents", "sframe");
+  std::string prefix = dirarc.get_next_write_prefix();
+  sf->save(prefix + ".frame_idx", codecs);
+  dirarc.close();
 }
 
 
@@ -282,6 +369,34 @@ void unity_sframe::save_frame_reference(std::string target_directory) {
   }
 }
 
+/**
+ * Returns the frame index file of an SFrame saved into a directory with
+ * save_frame.
+ */
+static std::string get_saved_frame_index_file(std::string target_directory) {
+  dir_archive dirarc;
+  dirarc.open_directory_for_read(target_directory);
+  std::string content_value;
+  if (dirarc.get_metadata("contents", content_value) == false ||
+      content_value != "sframe") {
+    log_and_throw_io_failure("Archive does not contain an SFrame");
+  }
+  std::string prefix = dirarc.get_next_read_prefix();
+  dirarc.close();
+  return prefix + ".frame_idx";
+}
+
+void unity_sframe::append_to_saved_frame(std::string target_directory) {
+  log_func_entry();
+  sframe_append_saved(*get_underlying_sframe(),
+                      get_saved_frame_index_file(target_directory));
+}
+
+void unity_sframe::compact_saved_frame(std::string target_directory) {
+  log_func_entry();
+  sframe_compact_saved(get_saved_frame_index_file(target_directory));
+}
+
 void unity_sframe::save_frame_by_index_file(std::string index_file) {
   log_func_entry();
   auto sf = get_underlying_sframe();
@@ -307,6 +422,7 @@ void unity_sframe::load(iarchive& iarc) {
 
 void unity_sframe::clear() {
   m_planner_node.reset();
+  m_deferred_csv.reset();
   m_column_names.clear();
 }
 
@@ -487,6 +603,9 @@ void unity_sframe::set_column_name(size_t i, std::string name) {
       log_and_throw(std::string("Column name " + name + " already exists"));
     }
   }
+  // a deferred parse renames its columns from m_column_names, so the
+  // rename must not interleave with it
+  std::lock_guard<mutex> guard(m_deferred_csv_mutex);
   m_column_names[i] = name;
 }
 
@@ -675,6 +794,8 @@ std::shared_ptr<unity_sframe_base> unity_sframe::flat_map(
 
 std::vector<flex_type_enum> unity_sframe::dtype() {
   Dlog_func_entry();
+  auto source = deferred_csv();
+  if (source) return source->column_types;
   return infer_planner_node_type(this->get_planner_node());
 }
 
@@ -689,6 +810,16 @@ std::vector<std::string> unity_sframe::column_names() {
 std::shared_ptr<unity_sframe_base> unity_sframe::head(size_t nrows) {
   log_func_entry();
 
+  // Parse only the first rows, leaving this sframe deferred. With
+  // continue_on_failure, the row limit counts the lines which failed to
+  // parse, so we cannot use it.
+  auto source = deferred_csv();
+  if (source && nrows > 0 && !source->options.continue_on_failure) {
+    auto ret = narrow_deferred_csv(column_names(), nrows);
+    ret->get_planner_node();
+    return ret;
+  }
+
   // prepare for writing to the new sframe
   sframe sf_head;
   sf_head.open_for_write(column_names(), dtype(), "", 1);
@@ -999,17 +1130,88 @@ void unity_sframe::save_as_csv(const std::string& url,
 std::shared_ptr<unity_sframe_base> unity_sframe::sample(float percent,
                                                         int random_seed) {
   logstream(LOG_INFO) << "Args: " << percent << ", " << random_seed << std::endl;
-  auto logical_filter_array = std::static_pointer_cast<unity_sarray>(
-    unity_sarray::make_uniform_boolean_array(size(), percent, random_seed));
-  return logical_filter(logical_filter_array);
+  // a sparse sample reads its rows directly if the sframe is materialized:
+  // is_materialized reduces the plan to its source
+  if (percent < query_eval::SPARSE_SAMPLE_FRACTION) is_materialized();
+  std::shared_ptr<unity_sframe> ret(new unity_sframe());
+  ret->construct_from_planner_node(
+      query_eval::sample(get_planner_node(), size(), percent, random_seed),
+      column_names());
+  return ret;
+}
+
+std::shared_ptr<unity_sframe_base> unity_sframe::sample_rows(size_t num_rows,
+                                                             int random_seed) {
+  log_func_entry();
+  logstream(LOG_INFO) << "Args: " << num_rows << ", " << random_seed << std::endl;
+  // reduces a materialized sframe to its source, whose sampled rows are read
+  // directly
+  is_materialized();
+  std::shared_ptr<unity_sframe> ret(new unity_sframe());
+  ret->construct_from_planner_node(
+      query_eval::sample_rows(get_planner_node(), size(), num_rows, random_seed),
+      column_names());
+  return ret;
+}
+
+std::shared_ptr<unity_sframe_base> unity_sframe::shuffle(int random_seed) {
+  log_func_entry();
+  auto shuffled_sf = query_eval::shuffle(get_planner_node(),
+                                         column_names(),
+                                         random_seed);
+  std::shared_ptr<unity_sframe> ret(new unity_sframe());
+  ret->construct_from_sframe(*shuffled_sf);
+  return ret;
+}
+
+void unity_sframe::build_key_index(const std::string& column_name,
+                                   const std::string& index_file) {
+  log_func_entry();
+  auto index = std::make_shared<sframe_key_index>(
+      sframe_key_index::build(*get_underlying_sframe(), column_name));
+  index->save(index_file);
+  m_key_index = index;
+  m_key_index_file = index_file;
+}
+
+std::shared_ptr<unity_sframe_base> unity_sframe::lookup_by_key_index(
+    const std::string& index_file,
+    const std::vector<flexible_type>& keys) {
+  log_func_entry();
+  if (m_key_index == nullptr || m_key_index_file != index_file) {
+    m_key_index = std::make_shared<sframe_key_index>(
+        sframe_key_index::load(index_file));
+    m_key_index_file = index_file;
+  }
+  std::shared_ptr<unity_sframe> ret(new unity_sframe());
+  ret->construct_from_sframe(m_key_index->lookup(*get_underlying_sframe(), keys));
+  return ret;
+}
+
+flexible_type unity_sframe::export_to_arrow_file(
+    const std::string& file,
+    const std::vector<std::string>& columns,
+    size_t begin_row, size_t end_row,
+    bool dictionary_encode_strings) {
+  log_func_entry();
+  arrow_export_options options;
+  options.columns = columns;
+  options.begin_row = begin_row;
+  options.end_row = end_row;
+  options.dictionary_encode_strings = dictionary_encode_strings;
+  ArrowSchema schema;
+  ArrowArray array;
+  export_sframe_to_arrow(*get_underlying_sframe(), &schema, &array, options);
+  return write_arrow_to_file(&schema, &array, file);
 }
 
 void unity_sframe::materialize() {
-  query_eval::planner().materialize(m_planner_node);
+  query_eval::planner().materialize(get_planner_node());
 }
 
 
 bool unity_sframe::is_materialized() {
+  if (deferred_csv()) return false;
   auto optimized_node = optimization_engine::optimize_planner_graph(get_planner_node(),
                                                                     materialize_options());
   if (is_source_node(optimized_node)) {
@@ -1020,6 +1222,7 @@ bool unity_sframe::is_materialized() {
 }
 
 bool unity_sframe::has_size() {
+  if (deferred_csv()) return false;
   return infer_planner_node_length(m_planner_node) != -1;
 }
 
@@ -1029,14 +1232,40 @@ std::string unity_sframe::query_plan_string() {
   return ss.str();
 }
 
+std::string unity_sframe::explain_analyze(const std::string& trace_file) {
+  log_func_entry();
+  query_eval::materialize_options options;
+  options.profile = std::make_shared<query_eval::query_profile>();
+  query_eval::planner().materialize(get_planner_node(), options);
+  if (!trace_file.empty()) {
+    general_ofstream fout(trace_file);
+    if (!fout.good()) {
+      log_and_throw_io_failure("Unable to open " + sanitize_url(trace_file) + " for write");
+    }
+    fout << options.profile->chrome_trace();
+    fout.close();
+  }
+  return options.profile->annotated_plan();
+}
+
 std::list<std::shared_ptr<unity_sframe_base>>
 unity_sframe::random_split(float percent, int random_seed) {
   log_func_entry();
   logstream(LOG_INFO) << "Args: " << percent << ", " << random_seed << std::endl;
 
-  auto logical_filter_array = std::static_pointer_cast<unity_sarray>(
-    unity_sarray::make_uniform_boolean_array(size(), percent, random_seed));
-  return logical_filter_split(logical_filter_array);
+  // the two sides are the rows sampled and the rows not sampled by the
+  // same draws
+  std::list<std::shared_ptr<unity_sframe_base>> ret;
+  for (bool complement: {false, true}) {
+    auto mask = op_sample_mask::make_planner_node(size(), percent, random_seed,
+                                                  complement);
+    std::shared_ptr<unity_sframe> side(new unity_sframe());
+    side->construct_from_planner_node(
+        op_logical_filter::make_planner_node(get_planner_node(), mask),
+        column_names());
+    ret.push_back(side);
+  }
+  return ret;
 }
 
 std::shared_ptr<unity_sframe_base> unity_sframe::groupby_aggregate(
@@ -1104,6 +1333,8 @@ std::shared_ptr<unity_sframe_base> unity_sframe::join(
     const std::string join_type,
     std::map<std::string,std::string> join_keys) {
   log_func_entry();
+  // the spills of the join are counted on the query
+  query_eval::running_query_scope query_scope("join");
   std::shared_ptr<unity_sframe> ret(new unity_sframe());
   std::shared_ptr<unity_sframe> us_right = std::static_pointer_cast<unity_sframe>(right);
 
@@ -1117,6 +1348,22 @@ std::shared_ptr<unity_sframe_base> unity_sframe::join(
   return ret;
 }
 
+std::shared_ptr<unity_sframe_base> unity_sframe::join_many(
+    std::list<std::shared_ptr<unity_sframe_base>> others,
+    const std::vector<std::string>& join_keys) {
+  log_func_entry();
+  query_eval::running_query_scope query_scope("join");
+  std::vector<sframe> frames{*get_underlying_sframe()};
+  for (auto& other: others) {
+    auto us_other = std::static_pointer_cast<unity_sframe>(other);
+    frames.push_back(*us_other->get_underlying_sframe());
+  }
+  sframe joined_sf = graphlab::join(frames, join_keys);
+  std::shared_ptr<unity_sframe> ret(new unity_sframe());
+  ret->construct_from_sframe(joined_sf);
+  return ret;
+}
+
 std::shared_ptr<unity_sframe_base>
 unity_sframe::sort(const std::vector<std::string>& sort_keys,
                    const std::vector<int>& sort_ascending) {
@@ -1514,9 +1761,62 @@ void unity_sframe::delete_on_close() {
 }
 
 std::shared_ptr<planner_node> unity_sframe::get_planner_node() {
+  parse_deferred_csv();
   return m_planner_node;
 }
 
+std::shared_ptr<unity_sframe::deferred_csv_source> unity_sframe::deferred_csv() {
+  std::lock_guard<mutex> guard(m_deferred_csv_mutex);
+  return m_deferred_csv;
+}
+
+void unity_sframe::parse_deferred_csv() {
+  std::lock_guard<mutex> guard(m_deferred_csv_mutex);
+  if (!m_deferred_csv) return;
+  auto source = *m_deferred_csv;
+  auto sframe_ptr = std::make_shared<sframe>();
+  source.tokenizer.init();
+  parse_csvs_to_sframe(source.url, source.tokenizer, source.options, *sframe_ptr);
+  // the parsed columns carry the file's names; keep any renames
+  auto names = m_column_names;
+  this->set_sframe(sframe_ptr);
+  m_column_names = names;
+  m_deferred_csv.reset();
+}
+
+std::shared_ptr<unity_sframe> unity_sframe::narrow_deferred_csv(
+    const std::vector<std::string>& names, size_t row_limit) {
+  auto current = deferred_csv();
+  ASSERT_TRUE(current != nullptr);
+  auto source = std::make_shared<deferred_csv_source>(*current);
+  // the parser selects columns by their names in the file. The type hints
+  // are rebuilt by name, since positional hints no longer line up once the
+  // columns are narrowed
+  source->options.output_columns.clear();
+  source->options.column_type_hints.clear();
+  source->file_column_names.clear();
+  source->column_types.clear();
+  for (const auto& name: names) {
+    size_t i = column_index(name);
+    const auto& file_name = current->file_column_names[i];
+    auto type = current->column_types[i];
+    source->options.output_columns.push_back(file_name);
+    source->options.column_type_hints[file_name] = type;
+    source->file_column_names.push_back(file_name);
+    source->column_types.push_back(type);
+  }
+  if (row_limit > 0 &&
+      (source->options.row_limit == 0 || row_limit < source->options.row_limit)) {
+    source->options.row_limit = row_limit;
+  }
+
+  std::shared_ptr<unity_sframe> ret(new unity_sframe());
+  ret->clear();
+  ret->m_column_names = names;
+  ret->m_deferred_csv = source;
+  return ret;
+}
+
 /**
  * Generate a new column name given existing column names.
  * New column name is in the form of X.1
@@ -13,6 +13,7 @@
 #include <vector>
 #include <unity/lib/api/unity_sframe_interface.hpp>
 #include <unity/lib/unity_sarray.hpp>
+#include <parallel/mutex.hpp>
 #include <sframe/group_aggregate_value.hpp>
 #include <sframe/sframe_rows.hpp>
 
@@ -23,6 +24,7 @@ class sframe;
 class dataframe;
 class sframe_reader;
 class sframe_iterator;
+class sframe_key_index;
 
 namespace query_eval {
 class planner_node;
@@ -84,6 +86,16 @@ class unity_sframe : public unity_sframe_base {
    */
   void construct_from_sframe_index(std::string index_file);
 
+  /**
+   * Constructs an SFrame from Arrow record batches sharing a schema, each
+   * written to a file with write_arrow_to_file (see sframe_arrow.hpp) and
+   * described by its layout. Only the given columns are imported (all of
+   * them if empty). The files are not deleted.
+   */
+  void construct_from_arrow_files(const std::vector<std::string>& files,
+                                  const std::vector<flexible_type>& layouts,
+                                  const std::vector<std::string>& columns);
+
   /**
    * Constructs an SFrame from one or more csv files.
    * To keep the interface stable, the CSV parsing configuration read from a
@@ -110,6 +122,13 @@ class unity_sframe : public unity_sframe_base {
    *  - double_quote : True if not is zero()
    *  - quote_char : First character if flexible_type is a string
    *  - skip_initial_space : True if not is zero()
+   *  - output_columns : The list of columns to parse. Others are skipped.
+   *  - row_limit : The number of rows to parse. 0 parses all rows.
+   *  - lazy : True if not is_zero(). Defers parsing until the data is
+   *    needed. Until then, \ref select_columns and \ref select_column
+   *    only narrow the columns which will be parsed, and \ref head only
+   *    parses the first rows. Ignored when store_errors is set, since the
+   *    errors must be returned here.
    */
   std::map<std::string, std::shared_ptr<unity_sarray_base>> construct_from_csvs(
       std::string url,
@@ -125,6 +144,16 @@ class unity_sframe : public unity_sframe_base {
    */
   void save_frame(std::string target_directory);
 
+  /**
+   * Saves a copy of the current sframe into a directory, compressing the
+   * columns named in column_codecs with the given codec ("none", "lz4",
+   * "lz4hc[:level]" or "auto"). Other columns keep the codec they were
+   * written with, or use the default codec.
+   * Does not modify the current sframe.
+   */
+  void save_frame_with_compression(std::string target_directory,
+                                   std::map<std::string, std::string> column_codecs);
+
   /**
    * Performs an incomplete save of an existing SFrame into a directory.
    * This saved SFrame may reference SFrames in other locations *in the same
@@ -134,6 +163,21 @@ class unity_sframe : public unity_sframe_base {
    */
   void save_frame_reference(std::string target_directory);
 
+  /**
+   * Appends the rows of the current sframe to an SFrame previously saved
+   * into a directory with save_frame. The rows already saved are not
+   * rewritten.
+   *
+   * Does not modify the current sframe.
+   */
+  void append_to_saved_frame(std::string target_directory);
+
+  /**
+   * Merges the small segments left behind by repeated
+   * append_to_saved_frame calls on the SFrame saved in a directory.
+   */
+  void compact_saved_frame(std::string target_directory);
+
 
   /**
    * Saves a copy of the current sframe into a target location defined by
@@ -313,7 +357,14 @@ class unity_sframe : public unity_sframe_base {
   std::shared_ptr<sframe> get_underlying_sframe();
 
   /**
-   * Returns the underlying planner pointer
+   * Returns the underlying planner pointer.
+   *
+   * If the sframe is a deferred CSV source (see the lazy option of
+   * \ref construct_from_csvs), the CSV is parsed here, once, and every
+   * later call returns the parsed sframe. The deferred source is not a
+   * planner node itself: only \ref head, called before this, parses less
+   * (the first rows only). Every other use, including column selections,
+   * parses the whole CSV once, so that later uses share the parse.
    */
   std::shared_ptr<query_eval::planner_node> get_planner_node();
 
@@ -398,6 +449,52 @@ class unity_sframe : public unity_sframe_base {
    */
   std::shared_ptr<unity_sframe_base> sample(float percent, int random_seed);
 
+  /**
+   * Sample exactly num_rows rows of the sframe uniformly (all the rows if it
+   * has fewer), with seed = random_seed. The rows keep their order.
+   *
+   * Returns unity_sframe* containing the sampled rows.
+   */
+  std::shared_ptr<unity_sframe_base> sample_rows(size_t num_rows, int random_seed);
+
+  /**
+   * Shuffle the rows of the sframe into a random order, with seed = random_seed.
+   *
+   * Returns unity_sframe* containing the shuffled rows.
+   */
+  std::shared_ptr<unity_sframe_base> shuffle(int random_seed);
+
+  /**
+   * Exports the rows [begin_row, end_row) of the given columns (all of them
+   * if empty) as an Arrow record batch written to a file, and returns its
+   * layout. See export_sframe_to_arrow and write_arrow_to_file in
+   * sframe_arrow.hpp.
+   */
+  flexible_type export_to_arrow_file(const std::string& file,
+                                     const std::vector<std::string>& columns,
+                                     size_t begin_row, size_t end_row,
+                                     bool dictionary_encode_strings);
+
+  /**
+   * Builds a key index (see \ref sframe_key_index) on a column of the
+   * sframe, and saves it to index_file. The index is also kept for later
+   * lookups through this object.
+   */
+  void build_key_index(const std::string& column_name,
+                       const std::string& index_file);
+
+  /**
+   * Returns the rows of the sframe whose key is equal to any of the given
+   * keys, in their original order, using the key index saved in index_file
+   * (built on this sframe with \ref build_key_index). Only the blocks
+   * holding the rows are read.
+   *
+   * Returns unity_sframe* containing the matching rows.
+   */
+  std::shared_ptr<unity_sframe_base> lookup_by_key_index(
+      const std::string& index_file,
+      const std::vector<flexible_type>& keys);
+
   /**
    * materialize the sframe, this is different from save() as this is a temporary persist of
    * all sarrays underneath the sframe to speed up some computation (for example, lambda)
@@ -415,6 +512,14 @@ class unity_sframe : public unity_sframe_base {
    */
   std::string query_plan_string();
 
+  /**
+   * Materializes the sframe collecting runtime counters of every operator,
+   * and returns the executed plan as a dot graph annotated with them.
+   * If trace_file is not empty, a Chrome trace of the execution
+   * is also written to it.
+   */
+  std::string explain_analyze(const std::string& trace_file);
+
   /**
    * Return true if the sframe size is known.
    */
@@ -452,6 +557,15 @@ class unity_sframe : public unity_sframe_base {
                           const std::string join_type,
                           std::map<std::string,std::string> join_keys);
 
+  /**
+   * Inner joins this sframe with all the others on the key columns they
+   * all have. The order of the binary joins is chosen from the known
+   * statistics of the key columns. See the multi-way graphlab::join.
+   */
+  std::shared_ptr<unity_sframe_base> join_many(
+      std::list<std::shared_ptr<unity_sframe_base>> others,
+      const std::vector<std::string>& join_keys);
+
   std::shared_ptr<unity_sframe_base> sort(const std::vector<std::string>& sort_keys,
                           const std::vector<int>& sort_ascending);
 
@@ -556,12 +670,46 @@ class unity_sframe : public unity_sframe_base {
  private:
   /**
    * Pointer to the lazy evaluator logical operator node.
-   * Should never be NULL.
+   * Should never be NULL, unless m_deferred_csv is set.
    */
   std::shared_ptr<query_eval::planner_node> m_planner_node;
 
   std::vector<std::string> m_column_names;
 
+  /**
+   * A CSV source which has not been parsed yet. See the lazy option of
+   * \ref construct_from_csvs. It is parsed, and reset, by
+   * \ref parse_deferred_csv() on the first call to \ref get_planner_node().
+   */
+  struct deferred_csv_source;
+  std::shared_ptr<deferred_csv_source> m_deferred_csv;
+  mutex m_deferred_csv_mutex;
+
+  /**
+   * Returns m_deferred_csv, read under its lock. Callers use the returned
+   * pointer only, since a concurrent parse may reset m_deferred_csv.
+   */
+  std::shared_ptr<deferred_csv_source> deferred_csv();
+
+  /**
+   * Parses m_deferred_csv, if set, into an sframe which replaces it. The
+   * columns keep their current names. Safe to call concurrently: only the
+   * first caller parses.
+   */
+  void parse_deferred_csv();
+
+  /// The last key index built or loaded, and the file it is saved in
+  std::shared_ptr<sframe_key_index> m_key_index;
+  std::string m_key_index_file;
+
+  /**
+   * Returns a new unity_sframe with the deferred CSV source of this sframe,
+   * restricted to the given columns and to the first row_limit rows
+   * (0 keeps the current limit). Used by \ref head.
+   */
+  std::shared_ptr<unity_sframe> narrow_deferred_csv(
+      const std::vector<std::string>& names, size_t row_limit);
+
   /**
    * Supports \ref begin_iterator() and \ref iterator_get_next().
    * The next segment I will read. (i.e. the current segment I am reading
@@ -24,14 +24,26 @@ from .cy_unity cimport function_closure_info
 from .cy_unity cimport make_function_closure_info
 
 ctypedef map[string, unity_sarray_base_ptr] gl_error_map
+
+cdef extern from "<sframe/arrow_c_data_interface.hpp>":
+    cdef struct ArrowSchema:
+        pass
+    cdef struct ArrowArray:
+        pass
+
+cdef extern from "<sframe/sframe_arrow.hpp>" namespace 'graphlab':
+    flexible_type write_arrow_to_file(ArrowSchema*, ArrowArray*, const string&) nogil except +
+    void read_arrow_from_file(const string&, const flexible_type&, ArrowSchema*, ArrowArray*) nogil except +
  
 cdef extern from "<unity/lib/api/unity_sframe_interface.hpp>" namespace 'graphlab':
    cdef cppclass unity_sframe_proxy nogil:
         unity_sframe_proxy(comm_client) except +
         void construct_from_dataframe(const gl_dataframe&) except +
         void construct_from_sframe_index(string) except +
+        void construct_from_arrow_files(const vector[string]&, const vector[flexible_type]&, const vector[string]&) except +
         gl_error_map construct_from_csvs(string, gl_options_map, map[string, flex_type_enum]) except +
         void save_frame(string) except +
+        void save_frame_with_compression(string, map[string, string]) except +
         void save_frame_reference(string) except +
         void clear() except +
         size_t size() except +
@@ -56,13 +68,20 @@ cdef extern from "<unity/lib/api/unity_sframe_interface.hpp>" namespace 'graphla
         void save_as_csv(const string&, gl_options_map) except +
         unity_sframe_base_ptr sample(float, int) except +
         cpplist[unity_sframe_base_ptr] random_split(float, int) except +
+        unity_sframe_base_ptr sample_rows(size_t, int) except +
+        unity_sframe_base_ptr shuffle(int) except +
+        flexible_type export_to_arrow_file(const string&, const vector[string]&, size_t, size_t, bint) except +
+        void build_key_index(const string&, const string&) except +
+        unity_sframe_base_ptr lookup_by_key_index(const string&, const vector[flexible_type]&) except +
         unity_sframe_base_ptr groupby_aggregate(const vector[string]&, const vector[vector[string]]&, const vector[string]&, const vector[string]&) except +
         unity_sframe_base_ptr append(unity_sframe_base_ptr) except +
         void materialize() except +
         bint is_materialized() except +
         bint has_size() except +
         string query_plan_string() except +
+        string explain_analyze(const string&) except +
         unity_sframe_base_ptr join(unity_sframe_base_ptr, const string, map[string, string]) except +
+        unity_sframe_base_ptr join_many(cpplist[unity_sframe_base_ptr], const vector[string]&) except +
         unity_sarray_base_ptr pack_columns(const vector[string]&, const vector[string]&, flex_type_enum , const flexible_type&) except +
         unity_sframe_base_ptr stack (const string& , const vector[string]& , const vector[flex_type_enum]&, bint) except +
         unity_sframe_base_ptr sort(const vector[string]&, const vector[int]&) except +
@@ -83,9 +102,13 @@ cdef class UnitySFrameProxy:
     cpdef load_from_sframe_index(self, index_file)
 
     cpdef load_from_csvs(self, string url, object csv_config, object column_type_hints)
+
+    cpdef load_from_arrow_files(self, vector[string] files, object layouts, vector[string] columns)
     
     cpdef save(self, string index_file)
 
+    cpdef save_with_compression(self, string index_file, map[string, string] column_codecs)
+
     cpdef save_reference(self, string index_file)
 
     cpdef num_rows(self)
@@ -132,6 +155,16 @@ cdef class UnitySFrameProxy:
 
     cpdef random_split(self, float percent, int random_seed)
 
+    cpdef sample_rows(self, size_t num_rows, int random_seed)
+
+    cpdef shuffle(self, int random_seed)
+
+    cpdef export_to_arrow_file(self, string arrow_file, vector[string] columns, size_t begin_row, size_t end_row, bint dictionary_encode_strings)
+
+    cpdef build_key_index(self, string column_name, string index_file)
+
+    cpdef lookup_by_key_index(self, string index_file, object keys)
+
     cpdef groupby_aggregate(self, vector[string] key_columns, vector[vector[string]] group_columns, vector[string] group_output_columns, vector[string] column_ops)
     
     cpdef append(self, UnitySFrameProxy other)
@@ -144,8 +177,12 @@ cdef class UnitySFrameProxy:
 
     cpdef query_plan_string(self)
 
+    cpdef explain_analyze(self, string trace_file)
+
     cpdef join(self, UnitySFrameProxy right, string how, map[string, string] on)
 
+    cpdef join_many(self, object others, vector[string] on)
+
     cpdef pack_columns(self, vector[string] columns, vector[string] keys, dtype, fill_na)
 
     cpdef stack(self, string column_name, vector[string] new_column_names, new_column_types, drop_na)
@@ -53,6 +53,30 @@ cdef pydict_from_gl_error_map(PyCommClient cli, gl_error_map& d):
         inc(it)
     return ret
 
+def arrow_c_to_file(size_t schema_address, size_t array_address, string arrow_file):
+    """
+    Writes an Arrow record batch, exported with the Arrow C data interface
+    to the ArrowSchema and ArrowArray at the given addresses of this
+    process, to a file the server can read. Releases the structures, and
+    returns the layout of the batch in the file.
+    """
+    cdef flexible_type layout
+    with nogil:
+        layout = write_arrow_to_file(<ArrowSchema*>schema_address,
+                                     <ArrowArray*>array_address, arrow_file)
+    return pyobject_from_flexible_type(layout)
+
+def arrow_file_to_c(string arrow_file, object layout, size_t schema_address, size_t array_address):
+    """
+    Reads an Arrow record batch written by the server, given its layout,
+    into the ArrowSchema and ArrowArray at the given addresses of this
+    process, to be imported with the Arrow C data interface.
+    """
+    cdef flexible_type c_layout = flexible_type_from_pyobject(layout)
+    with nogil:
+        read_arrow_from_file(arrow_file, c_layout,
+                             <ArrowSchema*>schema_address, <ArrowArray*>array_address)
+
 cdef class UnitySFrameProxy:
 
     def __cinit__(self, PyCommClient cli, do_not_allocate=None):
@@ -89,10 +113,21 @@ cdef class UnitySFrameProxy:
             errors = self.thisptr.construct_from_csvs(url, csv_options, c_column_type_hints)
         return pydict_from_gl_error_map(self._cli, errors)
 
+    cpdef load_from_arrow_files(self, vector[string] files, object layouts, vector[string] columns):
+        cdef vector[flexible_type] c_layouts
+        for layout in layouts:
+            c_layouts.push_back(flexible_type_from_pyobject(layout))
+        with nogil:
+            self.thisptr.construct_from_arrow_files(files, c_layouts, columns)
+
     cpdef save(self, string index_file):
         with nogil:
             self.thisptr.save_frame(index_file)
 
+    cpdef save_with_compression(self, string index_file, map[string, string] column_codecs):
+        with nogil:
+            self.thisptr.save_frame_with_compression(index_file, column_codecs)
+
     cpdef save_reference(self, string index_file):
         with nogil:
             self.thisptr.save_frame_reference(index_file)
@@ -236,6 +271,35 @@ cdef class UnitySFrameProxy:
         second = create_proxy_wrapper_from_existing_proxy(self._cli, proxy_second)
         return (first, second)
 
+    cpdef sample_rows(self, size_t num_rows, int random_seed):
+        cdef unity_sframe_base_ptr proxy
+        with nogil:
+            proxy = self.thisptr.sample_rows(num_rows, random_seed)
+        return create_proxy_wrapper_from_existing_proxy(self._cli, proxy)
+
+    cpdef shuffle(self, int random_seed):
+        cdef unity_sframe_base_ptr proxy
+        with nogil:
+            proxy = self.thisptr.shuffle(random_seed)
+        return create_proxy_wrapper_from_existing_proxy(self._cli, proxy)
+
+    cpdef export_to_arrow_file(self, string arrow_file, vector[string] columns, size_t begin_row, size_t end_row, bint dictionary_encode_strings):
+        cdef flexible_type layout
+        with nogil:
+            layout = self.thisptr.export_to_arrow_file(arrow_file, columns, begin_row, end_row, dictionary_encode_strings)
+        return pyobject_from_flexible_type(layout)
+
+    cpdef build_key_index(self, string column_name, string index_file):
+        with nogil:
+            self.thisptr.build_key_index(column_name, index_file)
+
+    cpdef lookup_by_key_index(self, string index_file, object keys):
+        cdef flex_list c_keys = flex_list_from_iterable(keys)
+        cdef unity_sframe_base_ptr proxy
+        with nogil:
+            proxy = self.thisptr.lookup_by_key_index(index_file, c_keys)
+        return create_proxy_wrapper_from_existing_proxy(self._cli, proxy)
+
     cpdef groupby_aggregate(self, vector[string] key_columns, vector[vector[string]] group_column, vector[string] group_output_columns, vector[string] column_ops):
         cdef unity_sframe_base_ptr proxy
         with nogil:
@@ -260,6 +324,9 @@ cdef class UnitySFrameProxy:
     cpdef query_plan_string(self):
         return self.thisptr.query_plan_string()
 
+    cpdef explain_analyze(self, string trace_file):
+        return self.thisptr.explain_analyze(trace_file)
+
     cpdef join(self, UnitySFrameProxy right, string how, map[string,string] on):
         cdef unity_sframe_base_ptr proxy
         with nogil:
@@ -267,6 +334,18 @@ cdef class UnitySFrameProxy:
 
         return create_proxy_wrapper_from_existing_proxy(self._cli, proxy)
 
+    cpdef join_many(self, object others, vector[string] on):
+        cdef cpplist[unity_sframe_base_ptr] proxies
+        cdef UnitySFrameProxy other
+        cdef unity_sframe_base_ptr proxy
+        for i in others:
+            other = i
+            proxies.push_back(other._base_ptr)
+        with nogil:
+            proxy = (self.thisptr.join_many(proxies, on))
+
+        return create_proxy_wrapper_from_existing_proxy(self._cli, proxy)
+
     cpdef pack_columns(self, vector[string] column_names, vector[string] key_names, dtype, fill_na):
         cdef unity_sarray_base_ptr proxy
         cdef flex_type_enum fl_type = flex_type_enum_from_pytype(dtype)
@@ -19,6 +19,8 @@ from ..connect import main as glconnect
 from ..cython.cy_flexible_type import infer_type_of_list
 from ..cython.context import debug_trace as cython_context
 from ..cython.cy_sframe import UnitySFrameProxy
+from ..cython.cy_sframe import arrow_c_to_file as _arrow_c_to_file
+from ..cython.cy_sframe import arrow_file_to_c as _arrow_file_to_c
 from ..util import _make_internal_url
 from .sarray import SArray, _create_sequential_sarray
 from .. import aggregate
@@ -992,6 +994,11 @@ class SFrame(object):
         parsing_config["line_terminator"] = line_terminator
         parsing_config["output_columns"] = usecols
         parsing_config["skip_rows"] =skiprows
+        # Defer the parse until the data is used: the file is parsed once,
+        # on first use, and head() before that only parses the first rows.
+        # Bad lines then only surface at first use, so parse eagerly when
+        # they must raise.
+        parsing_config["lazy"] = not error_bad_lines
 
         if type(na_values) is str:
           na_values = [na_values]
@@ -1932,6 +1939,83 @@ class SFrame(object):
         sf.__proxy__.load_from_sframe_index(_make_internal_url(finalSFrameFilename))
         return sf
 
+    @classmethod
+    def from_arrow(cls, data, columns=None):
+        """
+        Convert Arrow record batches (a pyarrow Table, a RecordBatch, or a
+        list of RecordBatches sharing a schema) to an SFrame.
+
+        Integer and bool columns become int columns, floating point columns
+        float, string and binary columns str, timestamp and date columns
+        datetime, lists of numbers array, other lists list, and dictionary
+        encoded columns the type of their values. Nulls become missing values.
+
+        Parameters
+        ----------
+        data : pyarrow.Table | pyarrow.RecordBatch | list of pyarrow.RecordBatch
+            The data to convert.
+
+        columns : list of str, optional
+            The columns to convert. Only these are decoded. All columns are
+            converted by default.
+
+        Returns
+        -------
+        out : SFrame
+
+        Notes
+        -----
+        Requires pyarrow. The batches are handed over to the server through
+        temporary files, so the server must run on this machine.
+
+        See Also
+        --------
+        to_arrow
+
+        Examples
+        --------
+        >>> import pyarrow
+        >>> table = pyarrow.Table.from_pydict({'id': [1, 2, 3], 'name': ['a', 'b', None]})
+        >>> sf = graphlab.SFrame.from_arrow(table)
+        """
+        import pyarrow
+        import tempfile
+        from pyarrow.cffi import ffi
+        _mt._get_metric_tracker().track('sframe.from_arrow')
+        if isinstance(data, pyarrow.Table):
+            batches = data.to_batches()
+            if len(batches) == 0:
+                batches = [pyarrow.RecordBatch.from_arrays(
+                    [pyarrow.array([], type=f.type) for f in data.schema],
+                    names=data.schema.names)]
+        elif isinstance(data, pyarrow.RecordBatch):
+            batches = [data]
+        else:
+            batches = list(data)
+        if columns is None:
+            columns = []
+
+        files = []
+        try:
+            layouts = []
+            for batch in batches:
+                handle, path = tempfile.mkstemp(suffix='.arrow')
+                os.close(handle)
+                files.append(path)
+                c_schema = ffi.new("struct ArrowSchema*")
+                c_array = ffi.new("struct ArrowArray*")
+                schema_address = int(ffi.cast("uintptr_t", c_schema))
+                array_address = int(ffi.cast("uintptr_t", c_array))
+                batch._export_to_c(array_address, schema_address)
+                layouts.append(_arrow_c_to_file(schema_address, array_address, path))
+            proxy = UnitySFrameProxy(glconnect.get_client())
+            with cython_context():
+                proxy.load_from_arrow_files(files, layouts, columns)
+            return cls(_proxy=proxy)
+        finally:
+            for path in files:
+                os.remove(path)
+
     @classmethod
     def from_odbc(cls, db, sql, verbose=False):
         """
@@ -2481,6 +2565,84 @@ class SFrame(object):
                 df[column_name] = df[column_name].astype(self.column_types()[i])
         return df
 
+    def to_arrow(self, columns=None, batch_size=None, dictionary_encode_strings=False):
+        """
+        Convert this SFrame to a pyarrow Table.
+
+        The SFrame is converted a batch of rows at a time, and each batch is
+        read and converted a block at a time, so it is never held in memory
+        as Python objects.
+
+        int columns become int64, float columns float64, str columns utf8
+        (large_utf8 for batches holding 2GB of strings or more), datetime
+        columns timestamp[us] (time zones are not exported) and array columns
+        lists of float64. Missing values become nulls. Other column types
+        cannot be converted.
+
+        Parameters
+        ----------
+        columns : list of str, optional
+            The columns to convert. All columns are converted by default.
+
+        batch_size : int, optional
+            The number of rows of each record batch of the table. The whole
+            SFrame is one batch by default.
+
+        dictionary_encode_strings : bool, optional
+            If True, str columns are dictionary encoded.
+
+        Returns
+        -------
+        out : pyarrow.Table
+
+        Notes
+        -----
+        Requires pyarrow. The batches are handed over from the server through
+        temporary files, so the server must run on this machine.
+
+        See Also
+        --------
+        from_arrow
+
+        Examples
+        --------
+        >>> sf = graphlab.SFrame({'id': [1, 2, 3], 'name': ['a', 'b', None]})
+        >>> table = sf.to_arrow()
+        >>> import pyarrow.parquet
+        >>> pyarrow.parquet.write_table(table, 'out.parquet')
+        """
+        import pyarrow
+        import tempfile
+        from pyarrow.cffi import ffi
+        _mt._get_metric_tracker().track('sframe.to_arrow')
+        if columns is None:
+            columns = []
+        num_rows = self.num_rows()
+        if batch_size is None:
+            batch_size = max(num_rows, 1)
+        if batch_size <= 0:
+            raise ValueError('batch_size must be positive')
+        self.__materialize__()
+
+        batches = []
+        for begin in range(0, max(num_rows, 1), batch_size):
+            handle, path = tempfile.mkstemp(suffix='.arrow')
+            os.close(handle)
+            try:
+                with cython_context():
+                    layout = self.__proxy__.export_to_arrow_file(
+                        path, columns, begin, min(begin + batch_size, num_rows),
+                        dictionary_encode_strings)
+                c_schema = ffi.new("struct ArrowSchema*")
+                c_array = ffi.new("struct ArrowArray*")
+                schema_address = int(ffi.cast("uintptr_t", c_schema))
+                array_address = int(ffi.cast("uintptr_t", c_array))
+                _arrow_file_to_c(path, layout, schema_address, array_address)
+                batches.append(pyarrow.RecordBatch._import_from_c(array_address, schema_address))
+            finally:
+                os.remove(path)
+        return pyarrow.Table.from_batches(batches)
+
     def to_numpy(self):
         """
         Converts this SFrame to a numpy array
@@ -2812,6 +2974,166 @@ class SFrame(object):
             proxy_pair = self.__proxy__.random_split(fraction, seed)
             return (SFrame(data=[], _proxy=proxy_pair[0]), SFrame(data=[], _proxy=proxy_pair[1]))
 
+    def sample_rows(self, n, seed=None):
+        """
+        Sample exactly n rows of the current SFrame uniformly, without
+        replacement. The sampled rows keep their order.
+
+        Parameters
+        ----------
+        n : int
+            Number of rows to fetch. If the SFrame has fewer rows, all the rows
+            are returned.
+
+        seed : int, optional
+            Seed for the random number generator used to sample.
+
+        Returns
+        -------
+        out : SFrame
+            A new SFrame containing sampled rows of the current SFrame.
+
+        Examples
+        --------
+        >>> sf = graphlab.SFrame({'id': range(1024)})
+        >>> len(sf.sample_rows(100, seed=5))
+        100
+        """
+        if n < 0:
+            raise ValueError('Invalid number of rows: ' + str(n))
+
+        if seed is None:
+            seed = abs(hash("%0.20f" % time.time())) % (2 ** 31)
+
+        # The server side requires this to be an int, so cast if we can
+        try:
+            seed = int(seed)
+        except ValueError:
+            raise ValueError('The \'seed\' parameter must be of type int.')
+
+        _mt._get_metric_tracker().track('sframe.sample_rows')
+
+        if (self.num_rows() == 0 or self.num_cols() == 0):
+            return self
+        else:
+            with cython_context():
+                return SFrame(_proxy=self.__proxy__.sample_rows(n, seed))
+
+    def shuffle(self, seed=None):
+        """
+        Shuffle the rows of the current SFrame into a random order. The same
+        seed always gives the same order.
+
+        Parameters
+        ----------
+        seed : int, optional
+            Seed for the random number generator used to shuffle.
+
+        Returns
+        -------
+        out : SFrame
+            A new SFrame containing the rows of the current SFrame, shuffled.
+
+        Examples
+        --------
+        >>> sf = graphlab.SFrame({'id': range(1024)})
+        >>> sf_shuffled = sf.shuffle(seed=5)
+        >>> sorted(sf_shuffled['id']) == range(1024)
+        True
+        """
+        if seed is None:
+            seed = abs(hash("%0.20f" % time.time())) % (2 ** 31)
+
+        # The server side requires this to be an int, so cast if we can
+        try:
+            seed = int(seed)
+        except ValueError:
+            raise ValueError('The \'seed\' parameter must be of type int.')
+
+        _mt._get_metric_tracker().track('sframe.shuffle')
+
+        if (self.num_rows() == 0 or self.num_cols() == 0):
+            return self
+        else:
+            with cython_context():
+                return SFrame(_proxy=self.__proxy__.shuffle(seed))
+
+    def build_key_index(self, column_name, index_path):
+        """
+        Build a point lookup index on a key column of the current SFrame, and
+        save it to a file. The index is used by :py:func:`~SFrame.lookup` to
+        read the rows holding some keys without scanning the SFrame.
+
+        The index is only valid for this SFrame, and must be rebuilt if the
+        SFrame is replaced.
+
+        Parameters
+        ----------
+        column_name : str
+            The key column. It must be of type int, float, str or datetime.
+
+        index_path : str
+            The file to save the index to.
+
+        See Also
+        --------
+        lookup
+
+        Examples
+        --------
+        >>> sf = graphlab.SFrame({'user_id': [1, 2, 3, 2], 'x': ['a', 'b', 'c', 'd']})
+        >>> sf.build_key_index('user_id', 'user_id.kidx')
+        """
+        if not isinstance(column_name, str):
+            raise TypeError("column_name must be a string")
+        _mt._get_metric_tracker().track('sframe.build_key_index')
+        with cython_context():
+            self.__proxy__.build_key_index(column_name, _make_internal_url(index_path))
+
+    def lookup(self, index_path, keys):
+        """
+        Return the rows of the current SFrame whose key is equal to any of the
+        given keys, using an index built with
+        :py:func:`~SFrame.build_key_index`. Only the parts of the SFrame
+        holding the matching rows are read. The rows keep their order.
+
+        Parameters
+        ----------
+        index_path : str
+            The file the index was saved to.
+
+        keys : list
+            The keys to look up. None looks up missing values.
+
+        Returns
+        -------
+        out : SFrame
+            A new SFrame containing the matching rows.
+
+        See Also
+        --------
+        build_key_index
+
+        Examples
+        --------
+        >>> sf = graphlab.SFrame({'user_id': [1, 2, 3, 2], 'x': ['a', 'b', 'c', 'd']})
+        >>> sf.build_key_index('user_id', 'user_id.kidx')
+        >>> sf.lookup('user_id.kidx', [2])
+        +---------+---+
+        | user_id | x |
+        +---------+---+
+        |    2    | b |
+        |    2    | d |
+        +---------+---+
+        [2 rows x 2 columns]
+        """
+        if not hasattr(keys, '__iter__') or isinstance(keys, str):
+            keys = [keys]
+        _mt._get_metric_tracker().track('sframe.lookup')
+        with cython_context():
+            return SFrame(_proxy=self.__proxy__.lookup_by_key_index(
+                _make_internal_url(index_path), list(keys)))
+
     def topk(self, column_name, k=10, reverse=False):
         """
         Get top k rows according to the given column. Result is according to and
@@ -2871,7 +3193,7 @@ class SFrame(object):
         sf = self[self[column_name].topk_index(k, reverse)]
         return sf.sort(column_name, ascending=reverse)
 
-    def save(self, filename, format=None):
+    def save(self, filename, format=None, compression=None):
         """
         Save the SFrame to a file system for later use.
 
@@ -2890,6 +3212,15 @@ class SFrame(object):
             otherwise save as 'binary' format.
             See export_csv for more csv saving options.
 
+        compression : str | dict, optional
+            The compression codec of the saved columns, for the 'binary'
+            format only. One of 'none', 'lz4', 'lz4hc', 'lz4hc:<level>' (level
+            1 to 16) or 'auto', which keeps lz4 compression only for columns
+            it actually shrinks. A str applies to every column, a dict maps
+            column names to codecs. Columns without a codec keep the one they
+            were saved with, or use the
+            GRAPHLAB_SFRAME_DEFAULT_COMPRESSION_CODEC runtime config.
+
         See Also
         --------
         load_sframe, SFrame
@@ -2901,6 +3232,9 @@ class SFrame(object):
 
         >>> # Save the sframe into csv format
         >>> sf.save('data/training_data.csv', format='csv')
+
+        >>> # Compress the 'text' column harder than the rest
+        >>> sf.save('data/training_data_sframe', compression={'text': 'lz4hc:12'})
         """
 
         _mt._get_metric_tracker().track('sframe.save', properties={'format':format})
@@ -2916,12 +3250,23 @@ class SFrame(object):
             elif format is not 'binary' and format is not 'json':
                 raise ValueError("Invalid format: {}. Supported formats are 'csv' and 'binary' and 'json'".format(format))
 
+        if compression is not None:
+            if format is not 'binary':
+                raise ValueError("compression is only supported by the 'binary' format")
+            if type(compression) is str:
+                compression = dict((name, compression) for name in self.column_names())
+            elif type(compression) is not dict:
+                raise TypeError("compression must be a str or a dict")
+
         ## Save the SFrame
         url = _make_internal_url(filename)
 
         with cython_context():
             if format is 'binary':
-                self.__proxy__.save(url)
+                if compression is None:
+                    self.__proxy__.save(url)
+                else:
+                    self.__proxy__.save_with_compression(url, compression)
             elif format is 'csv':
                 assert filename.endswith(('.csv', '.csv.gz'))
                 self.__proxy__.save_as_csv(url, {})
@@ -3707,6 +4052,21 @@ class SFrame(object):
         """
         return self.__proxy__.query_plan_string()
 
+    def __explain_analyze__(self, trace_file=''):
+        """
+        Materializes the SFrame, and returns the executed query plan as a dot
+        graph string, each operator annotated with its runtime counters: rows
+        in and out, batches, wall and cpu time, and bytes decoded.
+
+        If trace_file is set, a trace of the execution in the Chrome trace
+        event format is also written to it, which can be loaded in
+        chrome://tracing.
+        """
+        if trace_file:
+            trace_file = _make_internal_url(trace_file)
+        with cython_context():
+            return self.__proxy__.explain_analyze(trace_file)
+
     def __iter__(self):
         """
         Provides an iterator to the rows of the SFrame.
@@ -4337,6 +4697,61 @@ class SFrame(object):
         with cython_context():
             return SFrame(_proxy=self.__proxy__.join(right.__proxy__, how, join_keys))
 
+    def join_many(self, others, on):
+        """
+        Inner join the current SFrame with several other SFrames on the join
+        keys they all have. This is the same as chaining inner joins, but
+        the SFrames are joined two at a time in the order with the smallest
+        intermediate results, as estimated from the statistics of the key
+        columns which are already known.
+
+        Parameters
+        ----------
+        others : list of SFrame
+            The SFrames to join with the current SFrame.
+
+        on : str | list of str
+            The name(s) of the key columns, present in every SFrame. The
+            other columns must have distinct names in all the SFrames.
+
+        Returns
+        -------
+        out : SFrame
+            The key columns, followed by the other columns of the current
+            SFrame and of each SFrame in ``others``, in order.
+
+        See Also
+        --------
+        join
+
+        Examples
+        --------
+        >>> names = graphlab.SFrame({'id': [1, 2, 3], 'name': ['dog', 'cat', 'cow']})
+        >>> sounds = graphlab.SFrame({'id': [1, 3], 'sound': ['woof', 'moo']})
+        >>> legs = graphlab.SFrame({'id': [1, 2, 3], 'legs': [4, 4, 4]})
+        >>> names.join_many([sounds, legs], on='id')
+        +----+------+-------+------+
+        | id | name | sound | legs |
+        +----+------+-------+------+
+        | 1  | dog  |  woof |  4   |
+        | 3  | cow  |  moo  |  4   |
+        +----+------+-------+------+
+        [2 rows x 4 columns]
+        """
+        _mt._get_metric_tracker().track('sframe.join_many')
+        if type(others) is not list or \
+                not all(isinstance(sf, SFrame) for sf in others):
+            raise TypeError("others must be a list of SFrames")
+        if type(on) is str:
+            on = [on]
+        if type(on) is not list or len(on) == 0 or \
+                not all(type(name) is str for name in on):
+            raise TypeError("Join keys must be a str or a non-empty list of str")
+
+        with cython_context():
+            return SFrame(_proxy=self.__proxy__.join_many(
+                [sf.__proxy__ for sf in others], on))
+
     def filter_by(self, values, column_name, exclude=False):
         """
         Filter an SFrame by values inside an iterable object. Result is an
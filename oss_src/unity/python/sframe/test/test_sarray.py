@@ -9,6 +9,7 @@ of the BSD license. See the LICENSE file for details.
 from ..data_structures.sarray import SArray
 from ..util.timezone import GMT
 from ..toolkits._main import ToolkitError
+from .. import get_runtime_config, set_runtime_config
 
 import pandas as pd
 import numpy as np
@@ -1667,6 +1668,26 @@ class SArrayTest(unittest.TestCase):
         rets = sa.apply(lambda x:sastr[x])
         self.assertEqual(list(rets), list(sastr))
 
+    def test_apply_batches_in_flight(self):
+        # small blocks, so that many batches of the lambda are in flight
+        config = get_runtime_config()
+        old_block_size = config['GRAPHLAB_SFRAME_QUERY_MAX_BLOCK_SIZE']
+        old_inflight = config['GRAPHLAB_LAMBDA_MAX_INFLIGHT_BATCHES']
+        set_runtime_config('GRAPHLAB_SFRAME_QUERY_MAX_BLOCK_SIZE', 100)
+        try:
+            sa = SArray(range(10007))
+            for inflight in [1, 4, 16]:
+                set_runtime_config('GRAPHLAB_LAMBDA_MAX_INFLIGHT_BATCHES', inflight)
+                # results come back in input order
+                self.assertEqual(list(sa.apply(lambda x: x + 1)), range(1, 10008))
+                # the filter skips whole blocks while batches are in flight
+                selected = sa.apply(lambda x: x + 1)[(sa / 500).astype(int) % 2 == 1]
+                self.assertEqual(list(selected),
+                                 [x + 1 for x in range(10007) if (x / 500) % 2 == 1])
+        finally:
+            set_runtime_config('GRAPHLAB_SFRAME_QUERY_MAX_BLOCK_SIZE', old_block_size)
+            set_runtime_config('GRAPHLAB_LAMBDA_MAX_INFLIGHT_BATCHES', old_inflight)
+
     def test_save_sarray(self):
         '''save lazily evaluated SArray should not matrialize to target folder
         '''
@@ -354,6 +354,22 @@ class SFrameTest(unittest.TestCase):
         del sf2
 
 
+    def test_save_load_compressed(self):
+        sf = SFrame(data=self.dataframe, format='dataframe')
+        for compression in ['none', 'lz4hc:12', 'auto',
+                            {'string_data': 'lz4hc', 'int_data': 'none'}]:
+            with util.TempDirectory() as f:
+                sf.save(f, compression=compression)
+                self.__test_equal(load_sframe(f), self.dataframe)
+
+        with util.TempDirectory() as f:
+            self.assertRaises(RuntimeError, lambda: sf.save(f, compression='gzip'))
+            self.assertRaises(RuntimeError,
+                              lambda: sf.save(f, compression={'no_such_column': 'lz4'}))
+            self.assertRaises(TypeError, lambda: sf.save(f, compression=['lz4']))
+        with self.assertRaises(ValueError):
+            sf.save('out.csv', compression='lz4')
+
     def test_save_load_reference(self):
 
         # Check top level load function, with no suffix
@@ -920,6 +936,109 @@ class SFrameTest(unittest.TestCase):
         self.assertEqual(len(SFrame().random_split(.4)[0]), 0)
         self.assertEqual(len(SFrame().random_split(.4)[1]), 0)
 
+    def test_sparse_sample(self):
+        sf = SFrame(data=self.__create_test_df(10000))
+        # a lazy frame is sampled through a mask, a materialized one reads
+        # the rows sampled: both sample the same rows
+        lazy_sf = SFrame({'int_data': sf['int_data'] + 0})
+        for fraction in [.001, .1]:
+            sample_sf = sf.sample(fraction, 3)
+            self.assertEqual(list(sample_sf['int_data']),
+                             list(lazy_sf.sample(fraction, 3)['int_data']))
+            self.assertEqual(list(sample_sf['string_data']),
+                             [str(i) for i in sample_sf['int_data']])
+        self.assertEqual(list(sf['int_data'].sample(.001, 3)),
+                         list(sf.sample(.001, 3)['int_data']))
+
+    def test_sample_rows(self):
+        sf = SFrame(data=self.__create_test_df(100))
+
+        sample_sf = sf.sample_rows(10, 9)
+        self.assertEqual(len(sample_sf), 10)
+        values = list(sample_sf['int_data'])
+        # the rows keep their order
+        self.assertEqual(values, sorted(set(values)))
+        self.assertEqual(list(sample_sf['string_data']), [str(i) for i in values])
+        self.assertEqual(list(sf.sample_rows(10, 9)['int_data']), values)
+        self.assertNotEqual(list(sf.sample_rows(10, 10)['int_data']), values)
+
+        lazy_sf = SFrame({'int_data': sf['int_data'] + 0})
+        self.assertEqual(list(lazy_sf.sample_rows(10, 9)['int_data']), values)
+
+        self.assertEqual(len(sf.sample_rows(1000, 9)), 100)
+        self.assertEqual(len(sf.sample_rows(0, 9)), 0)
+        self.assertEqual(len(SFrame().sample_rows(10, 9)), 0)
+
+        with self.assertRaises(ValueError):
+            sf.sample_rows(-1)
+
+        with self.assertRaises(ValueError):
+            sf.sample_rows(10, 'seed')
+
+    def test_shuffle(self):
+        sf = SFrame(data=self.__create_test_df(100))
+
+        shuffled_sf = sf.shuffle(9)
+        self.assertEqual(len(shuffled_sf), 100)
+        values = list(shuffled_sf['int_data'])
+        self.assertEqual(sorted(values), list(range(100)))
+        self.assertNotEqual(values, list(range(100)))
+        self.assertEqual(list(shuffled_sf['string_data']), [str(i) for i in values])
+        self.assertEqual(list(sf.shuffle(9)['int_data']), values)
+        self.assertNotEqual(list(sf.shuffle(10)['int_data']), values)
+
+        self.assertEqual(len(SFrame().shuffle(9)), 0)
+
+        with self.assertRaises(ValueError):
+            sf.shuffle('seed')
+
+    def test_arrow_round_trip(self):
+        try:
+            import pyarrow
+        except ImportError:
+            return
+        sf = SFrame({'id': range(1000),
+                     'score': [None if i % 5 == 0 else i * 0.5 for i in range(1000)],
+                     'name': [None if i % 7 == 0 else 'name%d' % (i % 13) for i in range(1000)],
+                     'embedding': [array.array('d', [i] * (i % 4)) for i in range(1000)]})
+        for dictionary in [False, True]:
+            table = sf.to_arrow(batch_size=300, dictionary_encode_strings=dictionary)
+            self.assertEqual(table.num_rows, 1000)
+            self.assertEqual(len(table.to_batches()), 4)
+            self.assertEqual(table.column('score').null_count, 200)
+            self.assertEqual(table.column('name').to_pylist(), list(sf['name']))
+            _assert_sframe_equal(SFrame.from_arrow(table)[sf.column_names()], sf)
+
+        table = sf.to_arrow(columns=['name', 'id'])
+        self.assertEqual(table.schema.names, ['name', 'id'])
+        imported = SFrame.from_arrow(table, columns=['id'])
+        self.assertEqual(imported.column_names(), ['id'])
+        self.assertEqual(list(imported['id']), range(1000))
+
+        self.assertEqual(SFrame({'id': []}).to_arrow().num_rows, 0)
+
+    def test_key_index_lookup(self):
+        sf = SFrame({'key': [i % 100 for i in range(10000)],
+                     'value': range(10000)})
+        index_dir = tempfile.mkdtemp()
+        try:
+            index_path = os.path.join(index_dir, 'key.kidx')
+            sf.build_key_index('key', index_path)
+
+            result = sf.lookup(index_path, [3, 42, 1000])
+            self.assertEqual(list(result['value']),
+                             [i for i in range(10000) if i % 100 in (3, 42)])
+            self.assertEqual(len(sf.lookup(index_path, [1000])), 0)
+            self.assertEqual(list(sf.lookup(index_path, 7)['key']), [7] * 100)
+
+            # a new SFrame object loads the index from the file
+            self.assertEqual(len(SFrame(sf).lookup(index_path, [5])), 100)
+
+            with self.assertRaises(RuntimeError):
+                sf.build_key_index('no_such_column', index_path)
+        finally:
+            shutil.rmtree(index_dir)
+
     # tests add_column, rename
     def test_edit_column_ops(self):
         sf = SFrame()
@@ -1650,6 +1769,27 @@ class SFrameTest(unittest.TestCase):
         res = bad_departments.join(self.employees_sf, on='dep_id', how='left')
         self.__assert_join_results_equal(res, no_pk_expected)
 
+    def test_join_many(self):
+        names = SFrame({'id': range(10), 'name': [str(i) for i in range(10)]})
+        evens = SFrame({'id': range(0, 10, 2), 'half': range(5)})
+        squares = SFrame({'id': [0, 1, 4, 9, 16], 'root': range(5)})
+
+        res = names.join_many([evens, squares], on='id').sort('id')
+        self.assertEqual(res.column_names(), ['id', 'name', 'half', 'root'])
+        self.assertEqual(list(res['id']), [0, 4])
+        self.assertEqual(list(res['name']), ['0', '4'])
+        self.assertEqual(list(res['half']), [0, 2])
+        self.assertEqual(list(res['root']), [0, 2])
+
+        # same as chaining the inner joins
+        chained = names.join(evens, on='id').join(squares, on='id').sort('id')
+        _assert_sframe_equal(res, chained[res.column_names()])
+
+        with self.assertRaises(TypeError):
+            names.join_many(evens, on='id')
+        with self.assertRaises(RuntimeError):
+            names.join_many([names], on='id')
+
     def test_big_composite_join(self):
         # Create a semi large SFrame with composite primary key (letter, number)
         letter_keys = []
@@ -25,6 +25,8 @@
 #include <unity/lib/unity_sketch.hpp>
 #include <unity/lib/version.hpp>
 #include <unity/lib/simple_model.hpp>
+#include <unity/lib/engine_metrics.hpp>
+#include <metric/metrics_server.hpp>
 #include <parallel/pthread_tools.hpp>
 #include <logger/logger.hpp>
 #include <logger/log_rotate.hpp>
@@ -209,9 +211,10 @@ int main(int argc, char** argv) {
                           "publishes status logs. OPTIONAL")
       ("metric_server_port", 
        po::value<size_t>(&metric_server_port)->default_value(metric_server_port),
-       "This is the port number the Metrics Server listens on. It will accept "
-       "connections to this port on all interfaces. If 0, will listen to a "
-       "randomly assigned port. Defaults to 0. [[Deprecated]]")
+       "If set, launches the Metrics Server on this port, serving the engine "
+       "metrics on /engine.json and /metrics (Prometheus text format). It will "
+       "accept connections to this port on all interfaces. If 0, will listen "
+       "to a randomly assigned port. OPTIONAL")
       ("secret_key",
        po::value<std::string>(&secret_key),
        "Secret key used to secure the communication. Client must know the public "
@@ -400,7 +403,11 @@ int main(int argc, char** argv) {
         return std::dynamic_pointer_cast<graphlab::unity_global_base>(unity_shared_ptr);
       });
 
-  // graphlab::launch_metric_server(metric_server_port);
+  bool metric_server_launched = false;
+  if (!vm["metric_server_port"].defaulted()) {
+    metric_server_launched = graphlab::launch_metric_server(metric_server_port) != 0;
+    if (metric_server_launched) graphlab::register_engine_metric_pages();
+  }
 
   init_extensions(program_name);
 
@@ -455,7 +462,10 @@ int main(int argc, char** argv) {
 
   // detach the progress observer
   global_logger().add_observer(LOG_PROGRESS, NULL);
-  //graphlab::stop_metric_server();
+  if (metric_server_launched) {
+    graphlab::unregister_engine_metric_pages();
+    graphlab::stop_metric_server();
+  }
   delete server;
   delete g_toolkit_functions;
 
@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <fileio/memory_governor.hpp>
+#include <fileio/fileio_constants.hpp>
+#include <parallel/pthread_tools.hpp>
+#include <parallel/mutex.hpp>
+#include <timer/timer.hpp>
+
+using namespace graphlab;
+
+class memory_governor_test: public CxxTest::TestSuite {
+  const size_t MB = 1024 * 1024;
+  size_t old_budget;
+  size_t old_min_grant;
+
+ public:
+  void setUp() {
+    old_budget = fileio::FILEIO_MEMORY_GOVERNOR_BUDGET;
+    old_min_grant = fileio::FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE;
+  }
+
+  void tearDown() {
+    fileio::FILEIO_MEMORY_GOVERNOR_BUDGET = old_budget;
+    fileio::FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE = old_min_grant;
+  }
+
+  void test_disabled() {
+    auto& governor = memory_governor::get_instance();
+    fileio::FILEIO_MEMORY_GOVERNOR_BUDGET = 0;
+    TS_ASSERT(!governor.enabled());
+    auto a = governor.acquire(memory_consumer::JOIN, 1000 * MB);
+    auto b = governor.acquire(memory_consumer::JOIN, 1000 * MB);
+    TS_ASSERT_EQUALS(a->bytes(), 1000 * MB);
+    TS_ASSERT_EQUALS(b->bytes(), 1000 * MB);
+    TS_ASSERT_EQUALS(governor.cache_capacity(memory_consumer::FILEIO_CACHE, 500 * MB),
+                     500 * MB);
+  }
+
+  void test_grants_share_the_budget() {
+    auto& governor = memory_governor::get_instance();
+    fileio::FILEIO_MEMORY_GOVERNOR_BUDGET = 400 * MB;
+    fileio::FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE = 1 * MB;
+    governor.cache_capacity(memory_consumer::DECODED_BLOCK_CACHE, 100 * MB);
+    // nothing is running: the caches get what they are configured with
+    TS_ASSERT_EQUALS(governor.cache_capacity(memory_consumer::FILEIO_CACHE, 300 * MB),
+                     300 * MB);
+    {
+      auto a = governor.acquire(memory_consumer::JOIN, 1000 * MB);
+      // 3/4 of the budget goes to the operators
+      TS_ASSERT_EQUALS(a->bytes(), 300 * MB);
+      {
+        auto b = governor.acquire(memory_consumer::SORT, 1000 * MB);
+        auto c = governor.acquire(memory_consumer::GROUPBY, 10 * MB);
+        TS_ASSERT_EQUALS(a->bytes(), 100 * MB);
+        TS_ASSERT_EQUALS(b->bytes(), 100 * MB);
+        // never more than requested
+        TS_ASSERT_EQUALS(c->bytes(), 10 * MB);
+        auto stats = governor.get_stats();
+        TS_ASSERT_EQUALS(stats.num_grants[(size_t)memory_consumer::JOIN], 1);
+        TS_ASSERT_EQUALS(stats.num_grants[(size_t)memory_consumer::SORT], 1);
+        TS_ASSERT_EQUALS(stats.reserved_bytes, 300 * MB);
+      }
+      TS_ASSERT_EQUALS(a->bytes(), 300 * MB);
+      // the caches split the last quarter, in proportion to their capacities
+      TS_ASSERT_EQUALS(governor.cache_capacity(memory_consumer::FILEIO_CACHE, 300 * MB),
+                       75 * MB);
+      TS_ASSERT_EQUALS(governor.cache_capacity(memory_consumer::DECODED_BLOCK_CACHE, 100 * MB),
+                       25 * MB);
+    }
+    TS_ASSERT_EQUALS(governor.cache_capacity(memory_consumer::FILEIO_CACHE, 300 * MB),
+                     300 * MB);
+  }
+
+  void test_admission_control() {
+    auto& governor = memory_governor::get_instance();
+    fileio::FILEIO_MEMORY_GOVERNOR_BUDGET = 400 * MB;
+    // at most 3 operators at a time
+    fileio::FILEIO_MEMORY_GOVERNOR_MIN_GRANT_SIZE = 100 * MB;
+    mutex lock;
+    size_t running = 0;
+    size_t max_running = 0;
+    thread_group threads;
+    for (size_t i = 0; i < 8; ++i) {
+      threads.launch([&]() {
+        auto grant = governor.acquire(memory_consumer::JOIN, 1000 * MB);
+        {
+          std::lock_guard<mutex> guard(lock);
+          ++running;
+          max_running = std::max(max_running, running);
+        }
+        // a nested operator on the same thread is never queued
+        auto nested = governor.acquire(memory_consumer::SORT, 1 * MB);
+        timer::sleep_ms(50);
+        std::lock_guard<mutex> guard(lock);
+        --running;
+      });
+    }
+    threads.join();
+    TS_ASSERT_LESS_THAN_EQUALS(max_running, 3);
+    TS_ASSERT_LESS_THAN(0, governor.get_stats().num_queued);
+    TS_ASSERT_EQUALS(governor.get_stats().num_waiting, 0);
+  }
+};
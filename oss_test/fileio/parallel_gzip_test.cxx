@@ -0,0 +1,180 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cstring>
+#include <zlib.h>
+#include <cxxtest/TestSuite.h>
+#include <fileio/general_fstream.hpp>
+#include <fileio/parallel_gzip_decompressor.hpp>
+#include <fileio/fileio_constants.hpp>
+#include <fileio/temp_files.hpp>
+
+using namespace graphlab;
+
+class parallel_gzip_test: public CxxTest::TestSuite {
+  size_t old_window_size;
+
+ public:
+  void setUp() {
+    old_window_size = fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE;
+    // small windows, so that members span windows
+    fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE = 64 * 1024;
+  }
+
+  void tearDown() {
+    fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE = old_window_size;
+  }
+
+  /**
+   * Compresses data as a single gzip member. If bgzip is set, the header
+   * carries the bgzip "BC" block size subfield.
+   */
+  std::string gzip_member(const std::string& data, bool bgzip) {
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    deflateInit2(&z, 6, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    gz_header header;
+    memset(&header, 0, sizeof(header));
+    unsigned char extra[6] = {'B', 'C', 2, 0, 0, 0};
+    if (bgzip) {
+      header.extra = extra;
+      header.extra_len = 6;
+      deflateSetHeader(&z, &header);
+    }
+    std::string out(deflateBound(&z, data.size()) + 64, 0);
+    z.next_in = (Bytef*)data.data();
+    z.avail_in = data.size();
+    z.next_out = (Bytef*)&out[0];
+    z.avail_out = out.size();
+    deflate(&z, Z_FINISH);
+    out.resize(out.size() - z.avail_out);
+    deflateEnd(&z);
+    if (bgzip) {
+      // BSIZE is the member size - 1, at offset 16
+      out[16] = (out.size() - 1) & 0xff;
+      out[17] = (out.size() - 1) >> 8;
+    }
+    return out;
+  }
+
+  std::string make_csv(size_t num_lines) {
+    std::string data;
+    for (size_t i = 0; i < num_lines; ++i) {
+      data += std::to_string(i) + "," + std::to_string(i * 7919 % 1000) + ",abc\n";
+    }
+    return data;
+  }
+
+  /**
+   * Like make_csv, but with random values, so that the compressed data is
+   * large enough to be split into several runs.
+   */
+  std::string make_random_csv(size_t num_lines) {
+    std::mt19937_64 gen(42);
+    std::string data;
+    for (size_t i = 0; i < num_lines; ++i) {
+      data += std::to_string(gen()) + "," + std::to_string(gen()) + "\n";
+    }
+    return data;
+  }
+
+  std::string write_file(const std::string& contents) {
+    std::string path = get_temp_name() + ".gz";
+    std::ofstream fout(path, std::ios_base::binary);
+    fout.write(contents.data(), contents.size());
+    return path;
+  }
+
+  std::string read_file(const std::string& path) {
+    general_ifstream fin(path);
+    std::string ret, line;
+    while (std::getline(fin, line)) ret += line + "\n";
+    return ret;
+  }
+
+  /**
+   * Decompresses with a parallel_gzip_decompressor directly, so that the
+   * number of threads does not depend on the machine. Sets num_runs to the
+   * number of runs inflated.
+   */
+  std::string decompress(const std::string& compressed, size_t num_threads,
+                         size_t& num_runs) {
+    fileio_impl::parallel_gzip_decompressor decompressor(
+        std::make_shared<std::istringstream>(compressed), num_threads);
+    std::string ret;
+    std::vector<char> buffer(64 * 1024);
+    std::streamsize count = 0;
+    while ((count = decompressor.read(buffer.data(), buffer.size())) >= 0) {
+      ret.append(buffer.data(), count);
+    }
+    num_runs = decompressor.get_num_runs();
+    return ret;
+  }
+
+  void test_single_member() {
+    std::string data = make_csv(200000);
+    TS_ASSERT_EQUALS(read_file(write_file(gzip_member(data, false))), data);
+  }
+
+  void test_multiple_members() {
+    std::string data = make_csv(200000);
+    for (bool bgzip: {false, true}) {
+      std::string compressed;
+      for (size_t pos = 0; pos < data.size(); pos += 50000) {
+        compressed += gzip_member(data.substr(pos, 50000), bgzip);
+      }
+      TS_ASSERT_EQUALS(read_file(write_file(compressed)), data);
+      // trailing zeros are ignored
+      TS_ASSERT_EQUALS(read_file(write_file(compressed + std::string(100, '\0'))), data);
+    }
+  }
+
+  void test_parallel_runs() {
+    // windows of several minimum run sizes (256KB), so that they are split
+    const size_t window_size = 1024 * 1024;
+    fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE = window_size;
+    std::string data = make_random_csv(200000);
+    // plain members are found by searching for headers, bgzip members by
+    // following the chain of block sizes
+    for (bool bgzip: {false, true}) {
+      std::string compressed;
+      for (size_t pos = 0; pos < data.size(); pos += 50000) {
+        compressed += gzip_member(data.substr(pos, 50000), bgzip);
+      }
+      size_t num_windows = (compressed.size() + window_size - 1) / window_size;
+      TS_ASSERT_LESS_THAN(1, num_windows);
+
+      size_t num_runs = 0;
+      TS_ASSERT_EQUALS(decompress(compressed, 4, num_runs), data);
+      // more runs than windows: some windows were split
+      TS_ASSERT_LESS_THAN(num_windows, num_runs);
+
+      TS_ASSERT_EQUALS(decompress(compressed, 1, num_runs), data);
+      TS_ASSERT_LESS_THAN_EQUALS(num_runs, num_windows);
+    }
+  }
+
+  void test_invalid_streams() {
+    std::string compressed = gzip_member(make_csv(100000), false);
+    std::string truncated = write_file(compressed.substr(0, compressed.size() / 2));
+    TS_ASSERT_THROWS_ANYTHING(read_file(truncated));
+    TS_ASSERT_THROWS_ANYTHING(read_file(write_file("not gzip")));
+
+    // the stream ends exactly at the end of a window, in the middle of a
+    // member carried across windows
+    size_t window_size = fileio::FILEIO_GZIP_DECOMPRESSION_WINDOW_SIZE;
+    TS_ASSERT_LESS_THAN(2 * window_size, compressed.size());
+    size_t num_runs = 0;
+    TS_ASSERT_THROWS_ANYTHING(decompress(compressed.substr(0, 2 * window_size),
+                                         1, num_runs));
+    TS_ASSERT_THROWS_ANYTHING(read_file(write_file(compressed.substr(0, 2 * window_size))));
+  }
+};
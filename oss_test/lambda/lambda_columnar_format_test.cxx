@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <cxxtest/TestSuite.h>
+#include <lambda/lambda_columnar_format.hpp>
+
+using namespace graphlab;
+using namespace graphlab::lambda;
+
+class lambda_columnar_format_test : public CxxTest::TestSuite {
+ public:
+  /**
+   * Writes the columns behind a header of the given length, and returns
+   * a view over the written block.
+   */
+  columnar_block_view write_and_view(const std::vector<std::vector<flexible_type>>& columns,
+                                     size_t header_length,
+                                     oarchive& oarc) {
+    for (size_t i = 0; i < header_length; ++i) oarc << (char)(i);
+    sframe_rows rows;
+    for (const auto& col : columns) {
+      rows.add_decoded_column(std::make_shared<std::vector<flexible_type>>(col));
+    }
+    write_columnar_block(oarc, rows);
+    size_t block_start = columnar_align(header_length);
+    TS_ASSERT_EQUALS(block_start % COLUMNAR_ALIGNMENT, 0);
+    return columnar_block_view(oarc.buf + block_start, oarc.off - block_start);
+  }
+
+  void check_roundtrip(const std::vector<std::vector<flexible_type>>& columns,
+                       const std::vector<columnar_encoding>& expected_encodings) {
+    for (size_t header_length : {0, 1, 7, 13}) {
+      oarchive oarc;
+      auto block = write_and_view(columns, header_length, oarc);
+      TS_ASSERT_EQUALS(block.num_columns(), columns.size());
+      TS_ASSERT_EQUALS(block.size_bytes(), oarc.off - columnar_align(header_length));
+      for (size_t j = 0; j < columns.size(); ++j) {
+        TS_ASSERT_EQUALS(block.num_rows(), columns[j].size());
+        TS_ASSERT(block.column(j).encoding() == expected_encodings[j]);
+        std::vector<flexible_type> decoded;
+        block.column(j).decode(decoded);
+        TS_ASSERT_EQUALS(decoded.size(), columns[j].size());
+        for (size_t i = 0; i < decoded.size(); ++i) {
+          TS_ASSERT_EQUALS(decoded[i].get_type(), columns[j][i].get_type());
+          TS_ASSERT(decoded[i] == columns[j][i] ||
+                    decoded[i].get_type() == flex_type_enum::UNDEFINED);
+          TS_ASSERT_EQUALS(block.column(j).is_null(i),
+                           columns[j][i].get_type() == flex_type_enum::UNDEFINED);
+        }
+      }
+      free(oarc.buf);
+    }
+  }
+
+  void test_typed_columns() {
+    std::vector<flexible_type> ints, floats, strings;
+    for (size_t i = 0; i < 200; ++i) {
+      ints.push_back(i % 7 == 0 ? FLEX_UNDEFINED : flexible_type(flex_int(i) - 100));
+      floats.push_back(i % 5 == 0 ? FLEX_UNDEFINED : flexible_type(i * 0.5));
+      strings.push_back(i % 3 == 0 ? FLEX_UNDEFINED : flexible_type(std::string(i % 11, 'a' + i % 26)));
+    }
+    check_roundtrip({ints, floats, strings},
+                    {columnar_encoding::INTEGER,
+                     columnar_encoding::FLOAT,
+                     columnar_encoding::STRING});
+
+    // typed arrays are readable in place
+    oarchive oarc;
+    auto block = write_and_view({ints}, 3, oarc);
+    const int64_t* values = block.column(0).int_data();
+    for (size_t i = 0; i < ints.size(); ++i) {
+      if (!block.column(0).is_null(i)) TS_ASSERT_EQUALS(values[i], ints[i].get<flex_int>());
+    }
+    free(oarc.buf);
+  }
+
+  void test_generic_columns() {
+    std::vector<flexible_type> mixed = {1, 2.5, "foo", FLEX_UNDEFINED,
+                                        flex_vec{1.0, 2.0}, flex_list{1, "a"},
+                                        flex_dict{{"a", 1}}};
+    std::vector<flexible_type> vectors = {flex_vec{1.0}, flex_vec{}, FLEX_UNDEFINED};
+    std::vector<flexible_type> empty_strings = {"", "", ""};
+    check_roundtrip({mixed}, {columnar_encoding::GENERIC});
+    check_roundtrip({vectors, empty_strings},
+                    {columnar_encoding::GENERIC, columnar_encoding::STRING});
+  }
+
+  void test_empty_and_missing() {
+    check_roundtrip({}, {});
+    check_roundtrip({{}}, {columnar_encoding::INTEGER});
+    check_roundtrip({{FLEX_UNDEFINED, FLEX_UNDEFINED}}, {columnar_encoding::INTEGER});
+  }
+
+  void test_single_column_block() {
+    std::vector<flexible_type> result = {1, FLEX_UNDEFINED, 3};
+    oarchive oarc;
+    oarc << (char)(1);
+    write_columnar_block(oarc, result);
+    iarchive iarc(oarc.buf, oarc.off);
+    char c;
+    iarc >> c;
+    size_t block_start = columnar_align(iarc.off);
+    columnar_block_view block(oarc.buf + block_start, oarc.off - block_start);
+    TS_ASSERT_EQUALS(block.num_columns(), 1);
+    std::vector<flexible_type> decoded;
+    block.column(0).decode(decoded);
+    TS_ASSERT_EQUALS(decoded.size(), 3);
+    TS_ASSERT_EQUALS(decoded[0], 1);
+    TS_ASSERT_EQUALS(decoded[1].get_type(), flex_type_enum::UNDEFINED);
+    TS_ASSERT_EQUALS(decoded[2], 3);
+    free(oarc.buf);
+  }
+
+  void test_truncated_block() {
+    std::vector<flexible_type> result = {1, 2, 3};
+    oarchive oarc;
+    write_columnar_block(oarc, result);
+    TS_ASSERT_THROWS_ANYTHING(columnar_block_view(oarc.buf, oarc.off - 8));
+    free(oarc.buf);
+  }
+};
@@ -0,0 +1,272 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <map>
+#include <set>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cxxtest/TestSuite.h>
+#include <sframe/sframe.hpp>
+#include <sframe/join.hpp>
+#include <sframe/sframe_constants.hpp>
+#include <sframe/testing_utils.hpp>
+#include <sframe/column_statistics.hpp>
+#include <sframe/groupby_aggregate_operators.hpp>
+#include <sframe_query_engine/algorithm/groupby_aggregate.hpp>
+#include <sframe_query_engine/operators/sframe_source.hpp>
+#include <fileio/temp_files.hpp>
+#include <parallel/pthread_tools.hpp>
+
+using namespace graphlab;
+
+class column_statistics_test: public CxxTest::TestSuite {
+ public:
+  std::vector<std::vector<flexible_type>> read_all(sframe sf) {
+    std::vector<std::vector<flexible_type>> rows;
+    sf.get_reader()->read_rows(0, sf.size(), rows);
+    std::sort(rows.begin(), rows.end());
+    return rows;
+  }
+
+  void test_compute() {
+    std::vector<std::vector<flexible_type>> rows;
+    for (size_t i = 0; i < 10000; ++i) {
+      rows.push_back({flex_int(i / 10), flex_int((i * 7919) % 1000)});
+    }
+    rows[5000][1] = FLEX_UNDEFINED;
+    sframe sf = make_testing_sframe({"sorted", "shuffled"},
+                                    {flex_type_enum::INTEGER, flex_type_enum::INTEGER}, rows);
+
+    auto sorted = compute_column_statistics(*sf.select_column(0));
+    TS_ASSERT_EQUALS(sorted.num_rows, 10000);
+    TS_ASSERT_EQUALS(sorted.num_undefined, 0);
+    TS_ASSERT(sorted.sorted);
+    TS_ASSERT_EQUALS(sorted.min_value, 0);
+    TS_ASSERT_EQUALS(sorted.max_value, 999);
+    // the hyperloglog estimate is within a few percent
+    TS_ASSERT_DELTA((double)sorted.num_distinct, 1000.0, 50.0);
+
+    auto shuffled = compute_column_statistics(*sf.select_column(1));
+    TS_ASSERT_EQUALS(shuffled.num_undefined, 1);
+    TS_ASSERT(!shuffled.sorted);
+    TS_ASSERT_EQUALS(shuffled.min_value, 0);
+    TS_ASSERT_EQUALS(shuffled.max_value, 999);
+
+    column_statistics parsed;
+    TS_ASSERT(column_statistics::from_string(sorted.to_string(), parsed));
+    TS_ASSERT_EQUALS(parsed.to_string(), sorted.to_string());
+    TS_ASSERT(!column_statistics::from_string("rows=1;sorted", parsed));
+  }
+
+  void test_gathered_on_write() {
+    std::vector<std::vector<flexible_type>> rows;
+    for (size_t i = 0; i < 10000; ++i) {
+      rows.push_back({flex_int(i / 10), flex_int((i * 7919) % 1000), 
+                      std::to_string(i % 3)});
+    }
+    rows[5000][1] = FLEX_UNDEFINED;
+    sframe sf = make_testing_sframe({"sorted", "shuffled", "str"},
+                                    {flex_type_enum::INTEGER, flex_type_enum::INTEGER,
+                                     flex_type_enum::STRING}, rows);
+    // the statistics gathered by the writer match those of a scan
+    for (size_t i = 0; i < sf.num_columns(); ++i) {
+      column_statistics written;
+      TS_ASSERT(find_column_statistics(sf.select_column(i), written));
+      auto scanned = compute_column_statistics(*sf.select_column(i));
+      TS_ASSERT_EQUALS(written.num_rows, scanned.num_rows);
+      TS_ASSERT_EQUALS(written.num_undefined, scanned.num_undefined);
+      TS_ASSERT_EQUALS(written.sorted, scanned.sorted);
+      TS_ASSERT_EQUALS(written.min_value, scanned.min_value);
+      TS_ASSERT_EQUALS(written.max_value, scanned.max_value);
+      TS_ASSERT_DELTA((double)written.num_distinct, (double)scanned.num_distinct,
+                      0.15 * scanned.num_distinct + 1);
+    }
+
+    // values of different types have no range and are not sorted
+    std::vector<segment_statistics> segments(2);
+    segments[0].add(1); segments[0].add(2);
+    segments[1].add(3.5); 
+    auto mixed = combine_segment_statistics(segments);
+    TS_ASSERT_EQUALS(mixed.num_rows, 3);
+    TS_ASSERT(!mixed.has_range());
+    TS_ASSERT(!mixed.sorted);
+
+    // nothing is gathered with the cost based optimization off
+    SFRAME_COST_BASED_OPTIMIZATION = false;
+    sframe unknown = make_testing_sframe({"a"}, {flex_type_enum::INTEGER},
+                                         {{flex_int(1)}, {flex_int(2)}});
+    SFRAME_COST_BASED_OPTIMIZATION = true;
+    column_statistics stats;
+    TS_ASSERT(!find_column_statistics(unknown.select_column(0), stats));
+  }
+
+  void test_saved_with_sframe() {
+    std::vector<std::vector<flexible_type>> rows;
+    for (size_t i = 0; i < 1000; ++i) rows.push_back({flex_int(i), flex_float(i / 2.0)});
+    sframe sf = make_testing_sframe({"a", "b"}, {flex_type_enum::INTEGER, flex_type_enum::FLOAT}, rows);
+    std::string written;
+    TS_ASSERT(sf.select_column(0)->get_metadata(COLUMN_STATISTICS_METADATA_KEY, written));
+
+    std::string path = get_temp_name() + ".sidx";
+    sf.save(path);
+    sframe loaded(path);
+    std::string saved;
+    TS_ASSERT(loaded.select_column(0)->get_metadata(COLUMN_STATISTICS_METADATA_KEY, saved));
+    TS_ASSERT_EQUALS(saved, written);
+    column_statistics stats;
+    TS_ASSERT(find_column_statistics(loaded.select_column(1), stats));
+    TS_ASSERT(stats.sorted);
+    TS_ASSERT_EQUALS(stats.min_value, 0.0);
+    TS_ASSERT_EQUALS(stats.max_value, 499.5);
+
+    // statistics computed by a scan of a column written without them are 
+    // saved too
+    SFRAME_COST_BASED_OPTIMIZATION = false;
+    sframe unknown = make_testing_sframe({"a"}, {flex_type_enum::INTEGER},
+                                         {{flex_int(1)}, {flex_int(2)}});
+    SFRAME_COST_BASED_OPTIMIZATION = true;
+    TS_ASSERT(!unknown.select_column(0)->get_metadata(COLUMN_STATISTICS_METADATA_KEY, saved));
+    auto computed = get_column_statistics(unknown.select_column(0));
+    path = get_temp_name() + ".sidx";
+    unknown.save(path);
+    TS_ASSERT(sframe(path).select_column(0)->get_metadata(COLUMN_STATISTICS_METADATA_KEY, saved));
+    TS_ASSERT_EQUALS(saved, computed.to_string());
+  }
+
+  void test_planning_from_saved_statistics() {
+    // a plain save and load: nothing calls get_column_statistics
+    std::vector<std::vector<flexible_type>> left_rows, right_rows, group_rows;
+    for (size_t i = 0; i < 1000; ++i) {
+      left_rows.push_back({flex_int(i), flex_int(i * 2)});
+      right_rows.push_back({flex_int(i + 1000), "x"});
+    }
+    for (size_t i = 0; i < 20000; ++i) {
+      group_rows.push_back({flex_int(i / 7), flex_int(i)});
+    }
+    auto save_and_load = [](sframe sf) {
+      std::string path = get_temp_name() + ".sidx";
+      sf.save(path);
+      return sframe(path);
+    };
+    sframe left = save_and_load(make_testing_sframe(
+        {"id", "a"}, {flex_type_enum::INTEGER, flex_type_enum::INTEGER}, left_rows));
+    sframe right = save_and_load(make_testing_sframe(
+        {"id", "b"}, {flex_type_enum::INTEGER, flex_type_enum::STRING}, right_rows));
+    sframe grouped = save_and_load(make_testing_sframe(
+        {"key", "value"}, {flex_type_enum::INTEGER, flex_type_enum::INTEGER}, group_rows));
+
+    // the join sees disjoint key ranges
+    column_statistics left_stats, right_stats;
+    TS_ASSERT(find_column_statistics(left.select_column(0), left_stats));
+    TS_ASSERT(find_column_statistics(right.select_column(0), right_stats));
+    TS_ASSERT(key_ranges_disjoint(left_stats, right_stats));
+    TS_ASSERT_EQUALS(join(left, right, "inner", {{"id", "id"}}).num_rows(), 0);
+    TS_ASSERT_EQUALS(join(left, right, "left", {{"id", "id"}}).num_rows(), 1000);
+
+    // the groupby streams the sorted key: its output has one segment per
+    // cpu, where the hash groupby has cpu_count * log2(cpu_count)
+    column_statistics key_stats;
+    TS_ASSERT(find_column_statistics(grouped.select_column(0), key_stats));
+    TS_ASSERT(key_stats.sorted);
+    auto result = query_eval::groupby_aggregate(
+        query_eval::op_sframe_source::make_planner_node(grouped),
+        grouped.column_names(), {"key"}, {"count"},
+        {{{}, std::make_shared<groupby_operators::count>()}});
+    TS_ASSERT_EQUALS(result->num_rows(), 20000 / 7 + 1);
+    if (thread::cpu_count() >= 4) {
+      TS_ASSERT_EQUALS(result->num_segments(), thread::cpu_count());
+    }
+  }
+
+  void test_estimates() {
+    TS_ASSERT_EQUALS(estimate_join_rows(1000, 100, 50, 50), 500);
+    TS_ASSERT_EQUALS(estimate_join_rows(1000, 100, 50, 50, true, false), 1000);
+    TS_ASSERT_EQUALS(estimate_join_rows(0, 0, 50, 50, true, true), 50);
+
+    column_statistics low, high;
+    low.min_value = 0; low.max_value = 10;
+    high.min_value = 11; high.max_value = 20;
+    TS_ASSERT(key_ranges_disjoint(low, high));
+    high.min_value = 10;
+    TS_ASSERT(!key_ranges_disjoint(low, high));
+  }
+
+  void test_disjoint_join() {
+    std::vector<std::vector<flexible_type>> left_rows, right_rows;
+    for (size_t i = 0; i < 1000; ++i) {
+      left_rows.push_back({flex_int(i), flex_int(i * 2)});
+      right_rows.push_back({flex_int(i + 1000), "x"});
+    }
+    // frames written without statistics
+    SFRAME_COST_BASED_OPTIMIZATION = false;
+    sframe left = make_testing_sframe({"id", "a"}, {flex_type_enum::INTEGER, flex_type_enum::INTEGER}, left_rows);
+    sframe right = make_testing_sframe({"id", "b"}, {flex_type_enum::INTEGER, flex_type_enum::STRING}, right_rows);
+    SFRAME_COST_BASED_OPTIMIZATION = true;
+    // without known statistics the join does not scan its keys
+    column_statistics stats;
+    TS_ASSERT_EQUALS(join(left, right, "inner", {{"id", "id"}}).num_rows(), 0);
+    TS_ASSERT(!find_column_statistics(left.select_column(0), stats));
+
+    get_column_statistics(left.select_column(0));
+    get_column_statistics(right.select_column(0));
+    sframe joined = join(left, right, "inner", {{"id", "id"}});
+    TS_ASSERT_EQUALS(joined.num_rows(), 0);
+    TS_ASSERT_EQUALS(joined.column_names(), std::vector<std::string>({"id", "a", "b"}));
+    TS_ASSERT_EQUALS(join(left, right, "outer", {{"id", "id"}}).num_rows(), 2000);
+  }
+
+  void test_multiway_join() {
+    std::vector<std::vector<flexible_type>> a_rows, b_rows, c_rows;
+    for (size_t i = 0; i < 2000; ++i) a_rows.push_back({flex_int(i % 500), flex_int(i)});
+    for (size_t i = 0; i < 500; ++i) b_rows.push_back({flex_int(i), std::to_string(i)});
+    for (size_t i = 0; i < 20; ++i) c_rows.push_back({flex_int(i * 3), flex_float(i)});
+    sframe a = make_testing_sframe({"k", "a"}, {flex_type_enum::INTEGER, flex_type_enum::INTEGER}, a_rows);
+    sframe b = make_testing_sframe({"k", "b"}, {flex_type_enum::INTEGER, flex_type_enum::STRING}, b_rows);
+    sframe c = make_testing_sframe({"c", "k"}, {flex_type_enum::FLOAT, flex_type_enum::INTEGER}, c_rows);
+
+    sframe joined = join(std::vector<sframe>{a, b, c}, {"k"});
+    TS_ASSERT_EQUALS(joined.column_names(), std::vector<std::string>({"k", "a", "b", "c"}));
+    std::vector<std::vector<flexible_type>> expected;
+    for (size_t i = 0; i < 2000; ++i) {
+      size_t k = i % 500;
+      if (k % 3 == 0 && k / 3 < 20) {
+        expected.push_back({flex_int(k), flex_int(i), std::to_string(k), flex_float(k / 3)});
+      }
+    }
+    std::sort(expected.begin(), expected.end());
+    TS_ASSERT_EQUALS(read_all(joined), expected);
+
+    TS_ASSERT_THROWS_ANYTHING(join(std::vector<sframe>{a, a}, {"k"}));
+  }
+
+  void test_sorted_groupby() {
+    std::vector<std::vector<flexible_type>> rows;
+    // groups of varying lengths, some spanning segment boundaries
+    for (size_t i = 0; i < 20000; ++i) {
+      rows.push_back({flex_int((i * i) / 20011), flex_int(i)});
+    }
+    sframe sf = make_testing_sframe({"key", "value"}, {flex_type_enum::INTEGER, flex_type_enum::INTEGER}, rows);
+    TS_ASSERT(get_column_statistics(sf.select_column(0)).sorted);
+
+    auto run = [&]() {
+      return *query_eval::groupby_aggregate(
+          query_eval::op_sframe_source::make_planner_node(sf),
+          sf.column_names(), {"key"}, {"sum", "count"},
+          {{{"value"}, std::make_shared<groupby_operators::sum>()},
+           {{}, std::make_shared<groupby_operators::count>()}});
+    };
+    auto sorted_result = read_all(run());
+    SFRAME_COST_BASED_OPTIMIZATION = false;
+    auto hash_result = read_all(run());
+    SFRAME_COST_BASED_OPTIMIZATION = true;
+    TS_ASSERT_EQUALS(sorted_result, hash_result);
+    std::set<flexible_type> keys;
+    for (const auto& row: rows) keys.insert(row[0]);
+    TS_ASSERT_EQUALS(sorted_result.size(), keys.size());
+  }
+};
@@ -19,6 +19,7 @@
 #include <sframe/sarray_v2_block_manager.hpp>
 #include <sframe/sarray_file_format_v2.hpp>
 #include <sframe/sarray_index_file.hpp>
+#include <sframe/sarray_v2_decoded_block_cache.hpp>
 #include <timer/timer.hpp>
 #include <random/random.hpp>
 
@@ -434,4 +435,233 @@ class sarray_file_format_v2_test: public CxxTest::TestSuite {
     }
   }
 
+  void test_shared_decoded_block_cache(void) {
+    using v2_block_impl::decoded_block_cache;
+    std::string test_file_name = get_temp_name() + ".sidx";
+    sarray_group_format_writer_v2<flexible_type> group_writer;
+    group_writer.open(test_file_name, 4, 1);
+    size_t v = 0;
+    for (size_t i = 0;i < 4; ++i) {
+      for (size_t j = 0;j < 100000; ++j) {
+        group_writer.write_segment(0, i, std::to_string(v));
+        ++v;
+      }
+    }
+    group_writer.close();
+    group_writer.write_index_file();
+
+    auto& cache = decoded_block_cache::get_instance();
+    cache.clear();
+
+    // small random reads keep the blocks encoded and publish nothing
+    {
+      sarray_format_reader_v2<flexible_type> random_reader;
+      random_reader.open(test_file_name + ":0");
+      std::vector<flexible_type> vals;
+      for (size_t i = 1; i < v; i += 9973) {
+        random_reader.read_rows(i, i + 10, vals);
+        TS_ASSERT_EQUALS(vals[0], std::to_string(i));
+      }
+      TS_ASSERT_EQUALS(cache.get_stats().num_blocks, 0);
+    }
+
+    // two readers of the same array. The second one is served by the
+    // blocks decoded by the first one.
+    sarray_format_reader_v2<flexible_type> reader;
+    reader.open(test_file_name + ":0");
+    sarray_format_reader_v2<flexible_type> reader2;
+    reader2.open(test_file_name + ":0");
+    std::vector<flexible_type> vals;
+    reader.read_rows(0, v, vals);
+    auto stats = cache.get_stats();
+    TS_ASSERT(stats.num_blocks > 0);
+    TS_ASSERT_EQUALS(stats.insertions, stats.num_blocks);
+    TS_ASSERT(stats.bytes <= stats.capacity);
+
+    size_t hits_before = stats.hits;
+    std::vector<flexible_type> vals2;
+    for (size_t i = 0; i < v; i += 1000) {
+      reader2.read_rows(i, i + 1000, vals2);
+      for (size_t j = 0; j < vals2.size(); ++j) {
+        TS_ASSERT_EQUALS(vals2[j], std::to_string(i + j));
+      }
+    }
+    stats = cache.get_stats();
+    TS_ASSERT_EQUALS(stats.hits - hits_before, stats.num_blocks);
+
+    // reading shared blocks in small pieces releases each block once its
+    // last row is served, whether the reads are sequential (from 0) or
+    // not (from the middle of the first block)
+    {
+      sarray_format_reader_v2<flexible_type> chunk_reader;
+      chunk_reader.open(test_file_name + ":0");
+      for (size_t start: {0, 50}) {
+        for (size_t i = start; i < v; i += 100) {
+          chunk_reader.read_rows(i, i + 100, vals2);
+          for (size_t j = 0; j < vals2.size(); ++j) {
+            TS_ASSERT_EQUALS(vals2[j], std::to_string(i + j));
+          }
+          TS_ASSERT(chunk_reader.num_cached_blocks() <= 1);
+        }
+        TS_ASSERT_EQUALS(chunk_reader.num_cached_blocks(), 0);
+      }
+      chunk_reader.close();
+    }
+
+    // a small budget evicts
+    size_t old_capacity = SFRAME_DECODED_BLOCK_CACHE_CAPACITY;
+    SFRAME_DECODED_BLOCK_CACHE_CAPACITY = stats.bytes / 2;
+    sarray_format_reader_v2<flexible_type> reader3;
+    cache.clear();
+    reader3.open(test_file_name + ":0");
+    reader3.read_rows(0, v, vals);
+    stats = cache.get_stats();
+    TS_ASSERT(stats.evictions > 0);
+    TS_ASSERT(stats.bytes <= SFRAME_DECODED_BLOCK_CACHE_CAPACITY);
+    for (size_t j = 0; j < vals.size(); ++j) {
+      TS_ASSERT_EQUALS(vals[j], std::to_string(j));
+    }
+
+    // disabled
+    SFRAME_DECODED_BLOCK_CACHE_CAPACITY = 0;
+    cache.clear();
+    sarray_format_reader_v2<flexible_type> reader4;
+    reader4.open(test_file_name + ":0");
+    reader4.read_rows(0, v, vals);
+    TS_ASSERT_EQUALS(cache.get_stats().num_blocks, 0);
+    TS_ASSERT_EQUALS(vals.size(), v);
+    SFRAME_DECODED_BLOCK_CACHE_CAPACITY = old_capacity;
+
+    // closing the readers drops the blocks of the array
+    reader.read_rows(0, v, vals);
+    TS_ASSERT(cache.get_stats().num_blocks > 0);
+    reader.close(); reader2.close(); reader3.close(); reader4.close();
+    TS_ASSERT_EQUALS(cache.get_stats().num_blocks, 0);
+  }
+
+  void test_block_manager_prefetch(void) {
+    using v2_block_impl::block_address;
+    std::string test_file_name = get_temp_name() + ".sidx";
+    sarray_group_format_writer_v2<flexible_type> group_writer;
+    group_writer.open(test_file_name, 4, 1);
+    size_t v = 0;
+    for (size_t i = 0;i < 4; ++i) {
+      for (size_t j = 0;j < 100000; ++j) {
+        group_writer.write_segment(0, i, v);
+        ++v;
+      }
+    }
+    group_writer.close();
+    group_writer.write_index_file();
+
+    // prefetched blocks read back the same as synchronously read blocks
+    auto& manager = v2_block_impl::block_manager::get_instance();
+    auto index = read_index_file(test_file_name + ":0");
+    for (auto segment_file: index.segment_files) {
+      auto column = manager.open_column(segment_file);
+      size_t nblocks = manager.num_blocks_in_column(column);
+      TS_ASSERT(nblocks > 1);
+      std::vector<block_address> addrs;
+      for (size_t i = 0;i < nblocks; ++i) {
+        addrs.push_back(block_address{std::get<0>(column), std::get<1>(column), i});
+      }
+      manager.prefetch_blocks(addrs);
+      // duplicate requests are ignored
+      manager.prefetch_blocks(addrs);
+      for (auto addr: addrs) {
+        std::vector<flexible_type> prefetched, direct;
+        TS_ASSERT(manager.read_typed_block(addr, prefetched));
+        TS_ASSERT(manager.read_typed_block(addr, direct));
+        TS_ASSERT(prefetched == direct);
+      }
+      // closing with prefetches outstanding
+      manager.prefetch_blocks(addrs);
+      manager.close_column(column);
+    }
+
+    // sequential reads with read-ahead, bypassing the shared block cache
+    size_t old_capacity = SFRAME_DECODED_BLOCK_CACHE_CAPACITY;
+    size_t old_read_ahead = SFRAME_READ_AHEAD_BLOCKS;
+    SFRAME_DECODED_BLOCK_CACHE_CAPACITY = 0;
+    SFRAME_READ_AHEAD_BLOCKS = 8;
+    sarray_format_reader_v2<flexible_type> reader;
+    reader.open(test_file_name + ":0");
+    std::vector<flexible_type> vals;
+    for (size_t pass = 0; pass < 2; ++pass) {
+      for (size_t i = 0; i < v; i += 1000) {
+        reader.read_rows(i, i + 1000, vals);
+        TS_ASSERT_EQUALS(vals.size(), 1000);
+        for (size_t j = 0; j < vals.size(); ++j) {
+          TS_ASSERT_EQUALS(vals[j], i + j);
+        }
+      }
+    }
+    reader.close();
+    SFRAME_DECODED_BLOCK_CACHE_CAPACITY = old_capacity;
+    SFRAME_READ_AHEAD_BLOCKS = old_read_ahead;
+  }
+
+  void test_compression_codecs(void) {
+    using namespace v2_block_impl;
+    std::string test_file_name = get_temp_name() + ".sidx";
+    std::string segment_file = 
+        test_file_name.substr(0, test_file_name.length() - 5) + ".0000";
+    block_writer writer;
+    writer.init(test_file_name, 1, 4);
+    writer.open_segment(0, segment_file);
+    writer.set_column_compression(0, parse_compression_options("none"));
+    writer.set_column_compression(1, parse_compression_options("lz4hc:12"));
+    writer.set_column_compression(2, parse_compression_options("auto"));
+    writer.set_column_compression(3, parse_compression_options("lz4"));
+    TS_ASSERT_THROWS_ANYTHING(parse_compression_options("lz4hc:100"));
+    TS_ASSERT_THROWS_ANYTHING(parse_compression_options("lz4:3"));
+    TS_ASSERT_THROWS_ANYTHING(parse_compression_options("gzip"));
+
+    // compressible text, and incompressible random bytes for 
+    // the auto column
+    std::vector<char> text, noise;
+    for (size_t i = 0; i < 65536; ++i) {
+      text.push_back('a' + (i % 7) + ((i / 1000) % 3));
+      noise.push_back(random::fast_uniform<char>(-128, 127));
+    }
+    const size_t NUM_BLOCKS = 8;
+    for (size_t b = 0; b < NUM_BLOCKS; ++b) {
+      block_info info;
+      info.block_size = text.size();
+      info.num_elem = text.size();
+      writer.write_block(0, 0, text.data(), info);
+      writer.write_block(0, 1, text.data(), info);
+      writer.write_block(0, 2, noise.data(), info);
+      writer.write_block(0, 3, text.data(), info);
+    }
+    TS_ASSERT(writer.get_column_compression(2).codec == compression_codec::NONE);
+    writer.close_segment(0);
+    writer.write_index_file();
+
+    // every codec reads back through the same path
+    auto& manager = block_manager::get_instance();
+    size_t compressed_length[4] = {0, 0, 0, 0};
+    for (size_t c = 0; c < 4; ++c) {
+      auto column = manager.open_column(segment_file + ":" + std::to_string(c));
+      TS_ASSERT_EQUALS(manager.num_blocks_in_column(column), NUM_BLOCKS);
+      for (size_t b = 0; b < NUM_BLOCKS; ++b) {
+        block_info* info = NULL;
+        auto data = manager.read_block(
+            block_address{std::get<0>(column), std::get<1>(column), b}, &info);
+        TS_ASSERT(data != nullptr);
+        TS_ASSERT(*data == (c == 2 ? noise : text));
+        compressed_length[c] += info->length;
+        bool lz4 = info->flags & LZ4_COMPRESSION;
+        bool lz4hc = info->flags & LZ4HC_COMPRESSION;
+        if (c == 0 || c == 2) TS_ASSERT(!lz4 && !lz4hc);
+        if (c == 1) TS_ASSERT(lz4 && lz4hc);
+        if (c == 3) TS_ASSERT(lz4 && !lz4hc);
+      }
+      manager.close_column(column);
+    }
+    TS_ASSERT_EQUALS(compressed_length[0], NUM_BLOCKS * text.size());
+    TS_ASSERT(compressed_length[1] <= compressed_length[3]);
+    TS_ASSERT(compressed_length[3] < compressed_length[0]);
+  }
+
 };
@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cxxtest/TestSuite.h>
+#include <fileio/temp_files.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_arrow.hpp>
+#include <sframe/testing_utils.hpp>
+
+using namespace graphlab;
+
+class sframe_arrow_test: public CxxTest::TestSuite {
+ public:
+  sframe make_frame(size_t num_rows) {
+    std::vector<std::vector<flexible_type> > data;
+    for (size_t i = 0; i < num_rows; ++i) {
+      data.push_back({
+          flex_int(i),
+          i % 5 == 0 ? FLEX_UNDEFINED : flexible_type(i * 0.5),
+          i % 7 == 0 ? FLEX_UNDEFINED : flexible_type("name" + std::to_string(i % 13)),
+          flex_date_time(1445000000 + i, flex_date_time::EMPTY_TIMEZONE, i % 1000),
+          flex_vec(i % 4, double(i))});
+    }
+    return make_testing_sframe({"id", "score", "name", "time", "embedding"},
+                               {flex_type_enum::INTEGER, flex_type_enum::FLOAT,
+                                flex_type_enum::STRING, flex_type_enum::DATETIME,
+                                flex_type_enum::VECTOR},
+                               data);
+  }
+
+  std::vector<std::vector<flexible_type> > read_all(const sframe& sf) {
+    std::vector<std::vector<flexible_type> > rows;
+    sf.get_reader()->read_rows(0, sf.size(), rows);
+    return rows;
+  }
+
+  void check_equal(const sframe& expected, const sframe& actual) {
+    TS_ASSERT_EQUALS(expected.column_names(), actual.column_names());
+    TS_ASSERT_EQUALS(expected.column_types(), actual.column_types());
+    auto a = read_all(expected);
+    auto b = read_all(actual);
+    TS_ASSERT_EQUALS(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+      for (size_t j = 0; j < a[i].size(); ++j) {
+        TS_ASSERT_EQUALS(a[i][j].get_type(), b[i][j].get_type());
+        if (a[i][j].get_type() != flex_type_enum::UNDEFINED) {
+          TS_ASSERT(a[i][j] == b[i][j]);
+        }
+      }
+    }
+  }
+
+  void test_round_trip() {
+    sframe sf = make_frame(10000);
+    for (bool dictionary: {false, true}) {
+      ArrowSchema schema;
+      ArrowArray array;
+      arrow_export_options options;
+      options.dictionary_encode_strings = dictionary;
+      export_sframe_to_arrow(sf, &schema, &array, options);
+      TS_ASSERT_EQUALS(std::string(schema.format), "+s");
+      TS_ASSERT_EQUALS(schema.n_children, 5);
+      TS_ASSERT_EQUALS(array.length, 10000);
+      TS_ASSERT_EQUALS(array.children[1]->null_count, 2000);
+      TS_ASSERT_EQUALS(schema.children[2]->dictionary != nullptr, dictionary);
+
+      sframe imported = import_sframe_from_arrow(&schema, {&array});
+      TS_ASSERT(schema.release == nullptr);
+      TS_ASSERT(array.release == nullptr);
+      check_equal(sf, imported);
+    }
+  }
+
+  void test_batches_and_projection() {
+    sframe sf = make_frame(1000);
+    ArrowSchema schema;
+    std::vector<ArrowArray> arrays(3);
+    std::vector<ArrowArray*> batches;
+    size_t bounds[] = {0, 10, 600, 1000};
+    for (size_t b = 0; b < 3; ++b) {
+      arrow_export_options options;
+      options.begin_row = bounds[b];
+      options.end_row = bounds[b + 1];
+      if (b == 0) {
+        export_sframe_to_arrow(sf, &schema, &arrays[b], options);
+      } else {
+        ArrowSchema unused;
+        export_sframe_to_arrow(sf, &unused, &arrays[b], options);
+        unused.release(&unused);
+      }
+      batches.push_back(&arrays[b]);
+    }
+    sframe imported = import_sframe_from_arrow(&schema, batches, {"name", "id"});
+    check_equal(sf.select_columns({"name", "id"}), imported);
+
+    ArrowSchema schema2;
+    ArrowArray array2;
+    export_sframe_to_arrow(sf, &schema2, &array2);
+    TS_ASSERT_THROWS_ANYTHING(import_sframe_from_arrow(&schema2, {&array2}, {"missing"}));
+    // ownership was taken even on failure
+    TS_ASSERT(schema2.release == nullptr);
+    TS_ASSERT(array2.release == nullptr);
+  }
+
+  void test_file_transfer() {
+    sframe sf = make_frame(3000);
+    for (bool dictionary: {false, true}) {
+      std::vector<std::string> files;
+      std::vector<flexible_type> layouts;
+      size_t bounds[] = {0, 1000, 3000};
+      for (size_t b = 0; b < 2; ++b) {
+        ArrowSchema schema;
+        ArrowArray array;
+        arrow_export_options options;
+        options.begin_row = bounds[b];
+        options.end_row = bounds[b + 1];
+        options.dictionary_encode_strings = dictionary;
+        export_sframe_to_arrow(sf, &schema, &array, options);
+        files.push_back(get_temp_name() + ".arrow");
+        layouts.push_back(write_arrow_to_file(&schema, &array, files.back()));
+        TS_ASSERT(schema.release == nullptr);
+        TS_ASSERT(array.release == nullptr);
+      }
+
+      std::vector<ArrowSchema> schemas(2);
+      std::vector<ArrowArray> arrays(2);
+      for (size_t b = 0; b < 2; ++b) {
+        read_arrow_from_file(files[b], layouts[b], &schemas[b], &arrays[b]);
+      }
+      TS_ASSERT_EQUALS(arrays[1].length, 2000);
+      TS_ASSERT_EQUALS(arrays[1].children[1]->null_count, 400);
+      TS_ASSERT_EQUALS(schemas[0].children[2]->dictionary != nullptr, dictionary);
+      schemas[1].release(&schemas[1]);
+      sframe imported = import_sframe_from_arrow(&schemas[0], {&arrays[0], &arrays[1]});
+      check_equal(sf, imported);
+    }
+
+    // a bad layout fails without leaking
+    ArrowSchema schema;
+    ArrowArray array;
+    export_sframe_to_arrow(sf, &schema, &array);
+    std::string file = get_temp_name() + ".arrow";
+    flexible_type layout = write_arrow_to_file(&schema, &array, file);
+    layout.mutable_get<flex_dict>()[5].second = 
+        flex_list{flex_list{0, 1 << 30}};
+    TS_ASSERT_THROWS_ANYTHING(read_arrow_from_file(file, layout, &schema, &array));
+    TS_ASSERT(schema.release == nullptr);
+    TS_ASSERT(array.release == nullptr);
+  }
+
+  /**
+   * Builds arrays by hand, as another Arrow producer would: a sliced int32
+   * column with nulls, and a bool column.
+   */
+  void test_import_foreign_arrays() {
+    int32_t values[] = {10, 11, 12, 13, 14, 15};
+    uint8_t validity[] = {0x3B};  // 111011: element 2 is null
+    uint8_t bools[] = {0x05};     // 000101
+    const void* int_buffers[] = {validity, values};
+    const void* bool_buffers[] = {nullptr, bools};
+
+    ArrowSchema int_schema{"i", "x", nullptr, ARROW_FLAG_NULLABLE, 0, nullptr, nullptr, nullptr, nullptr};
+    ArrowSchema bool_schema{"b", "flag", nullptr, 0, 0, nullptr, nullptr, nullptr, nullptr};
+    ArrowSchema* children_schema[] = {&int_schema, &bool_schema};
+    ArrowSchema schema{"+s", "", nullptr, 0, 2, children_schema, nullptr, nullptr, nullptr};
+
+    ArrowArray int_array{5, 1, 1, 2, 0, int_buffers, nullptr, nullptr, nullptr, nullptr};
+    ArrowArray bool_array{5, 0, 1, 2, 0, bool_buffers, nullptr, nullptr, nullptr, nullptr};
+    ArrowArray* children[] = {&int_array, &bool_array};
+    const void* struct_buffers[] = {nullptr};
+    ArrowArray array{4, 0, 0, 1, 2, struct_buffers, children, nullptr, nullptr, nullptr};
+
+    sframe imported = import_sframe_from_arrow(&schema, {&array});
+    TS_ASSERT_EQUALS(imported.column_types(),
+                     std::vector<flex_type_enum>({flex_type_enum::INTEGER,
+                                                  flex_type_enum::INTEGER}));
+    auto rows = read_all(imported);
+    TS_ASSERT_EQUALS(rows.size(), 4);
+    // the children are offset by 1
+    TS_ASSERT_EQUALS(rows[0][0], 11);
+    TS_ASSERT_EQUALS(rows[1][0].get_type(), flex_type_enum::UNDEFINED);
+    TS_ASSERT_EQUALS(rows[2][0], 13);
+    TS_ASSERT_EQUALS(rows[3][0], 14);
+    TS_ASSERT_EQUALS(rows[0][1], 0);
+    TS_ASSERT_EQUALS(rows[1][1], 1);
+    TS_ASSERT_EQUALS(rows[2][1], 0);
+    TS_ASSERT_EQUALS(rows[3][1], 0);
+  }
+};
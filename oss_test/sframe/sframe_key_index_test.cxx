@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <vector>
+#include <string>
+#include <limits>
+#include <cxxtest/TestSuite.h>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_key_index.hpp>
+#include <sframe/testing_utils.hpp>
+#include <fileio/temp_files.hpp>
+
+using namespace graphlab;
+
+class sframe_key_index_test: public CxxTest::TestSuite {
+ public:
+  /**
+   * {user_id, feature}: user_id is i % 1000, or missing on every 997th row.
+   */
+  sframe make_frame(size_t num_rows) {
+    std::vector<std::vector<flexible_type> > data;
+    for (size_t i = 0; i < num_rows; ++i) {
+      flexible_type user_id = (i % 997 == 0) ? FLEX_UNDEFINED : flexible_type(i % 1000);
+      data.push_back({user_id, std::to_string(i)});
+    }
+    return make_testing_sframe({"user_id", "feature"},
+                               {flex_type_enum::INTEGER, flex_type_enum::STRING},
+                               data);
+  }
+
+  void test_find() {
+    const size_t NUM_ROWS = 100000;
+    sframe sf = make_frame(NUM_ROWS);
+    auto index = sframe_key_index::build(sf, "user_id");
+    TS_ASSERT_EQUALS(index.num_rows(), NUM_ROWS);
+    TS_ASSERT_EQUALS(index.num_keys(), 1001);
+
+    for (size_t key: {0, 1, 500, 999}) {
+      std::vector<size_t> expected;
+      for (size_t i = key; i < NUM_ROWS; i += 1000) {
+        if (i % 997 != 0) expected.push_back(i);
+      }
+      TS_ASSERT_EQUALS(index.find(flexible_type(key)), expected);
+      // numeric keys match across integer and float
+      TS_ASSERT_EQUALS(index.find(flexible_type(flex_float(key))), expected);
+    }
+    TS_ASSERT(index.find(flexible_type(1000)).empty());
+    TS_ASSERT(index.find(flexible_type(1.5)).empty());
+    TS_ASSERT(index.find(flexible_type("1")).empty());
+    TS_ASSERT_EQUALS(index.find(FLEX_UNDEFINED).size(), (NUM_ROWS + 996) / 997);
+
+    // IN: sorted and without duplicates
+    auto rows = index.find(std::vector<flexible_type>{7, 3, 7, 12345});
+    TS_ASSERT(std::is_sorted(rows.begin(), rows.end()));
+    TS_ASSERT_EQUALS(rows.size(), index.find(7).size() + index.find(3).size());
+
+    TS_ASSERT_THROWS_ANYTHING(sframe_key_index::build(sf, "no_such_column"));
+  }
+
+  void test_save_and_lookup() {
+    const size_t NUM_ROWS = 100000;
+    sframe sf = make_frame(NUM_ROWS);
+    std::string index_file = get_temp_name() + ".kidx";
+    sframe_key_index::build(sf, "user_id").save(index_file);
+    auto index = sframe_key_index::load(index_file);
+    TS_ASSERT_EQUALS(index.column_name(), "user_id");
+    TS_ASSERT_EQUALS(index.num_keys(), 1001);
+
+    sframe result = index.lookup(sf, {42, 43});
+    TS_ASSERT_EQUALS(result.column_names(), sf.column_names());
+    std::vector<std::vector<flexible_type> > rows;
+    result.get_reader()->read_rows(0, result.size(), rows);
+    TS_ASSERT_EQUALS(rows.size(), index.find(std::vector<flexible_type>{42, 43}).size());
+    size_t last_row = 0;
+    for (const auto& row: rows) {
+      TS_ASSERT(row[0] == 42 || row[0] == 43);
+      size_t row_number = std::stoul(row[1].get<flex_string>());
+      TS_ASSERT_EQUALS(row_number % 1000, (size_t)(flex_int)row[0]);
+      TS_ASSERT_LESS_THAN_EQUALS(last_row, row_number);
+      last_row = row_number;
+    }
+
+    TS_ASSERT_EQUALS(index.lookup(sf, {-1}).size(), 0);
+    TS_ASSERT_THROWS_ANYTHING(index.lookup(make_frame(100), {42}));
+    // a different frame of the same length
+    TS_ASSERT_THROWS_ANYTHING(index.lookup(make_frame(NUM_ROWS), {42}));
+  }
+
+  void test_float_keys_with_nan() {
+    flex_float nan = std::numeric_limits<flex_float>::quiet_NaN();
+    std::vector<std::vector<flexible_type> > data;
+    for (size_t i = 0; i < 1000; ++i) {
+      flexible_type key = flex_float(i % 10);
+      if (i % 7 == 0) key = nan;
+      if (i % 11 == 0) key = FLEX_UNDEFINED;
+      data.push_back({key, flex_int(i)});
+    }
+    sframe sf = make_testing_sframe({"key", "row"},
+                                    {flex_type_enum::FLOAT, flex_type_enum::INTEGER},
+                                    data);
+    auto index = sframe_key_index::build(sf, "key");
+    // 10 numbers, NaN and missing
+    TS_ASSERT_EQUALS(index.num_keys(), 12);
+
+    std::vector<size_t> nan_rows, three_rows;
+    for (size_t i = 0; i < 1000; ++i) {
+      if (i % 11 == 0) continue;
+      if (i % 7 == 0) nan_rows.push_back(i);
+      else if (i % 10 == 3) three_rows.push_back(i);
+    }
+    TS_ASSERT_EQUALS(index.find(flexible_type(nan)), nan_rows);
+    TS_ASSERT_EQUALS(index.find(flexible_type(3.0)), three_rows);
+    TS_ASSERT_EQUALS(index.find(flexible_type(3)), three_rows);
+    TS_ASSERT_EQUALS(index.find(FLEX_UNDEFINED).size(), (size_t)(1000 + 10) / 11);
+  }
+
+  void test_read_selected_rows() {
+    sframe sf = make_frame(10000);
+    std::vector<size_t> selected{0, 1, 2, 3, 500, 501, 9999};
+    sframe result = sframe_key_index::read_selected_rows(sf, selected);
+    std::vector<std::vector<flexible_type> > rows;
+    result.get_reader()->read_rows(0, result.size(), rows);
+    TS_ASSERT_EQUALS(rows.size(), selected.size());
+    for (size_t i = 0; i < selected.size(); ++i) {
+      TS_ASSERT_EQUALS(rows[i][1], std::to_string(selected[i]));
+    }
+  }
+};
@@ -0,0 +1,101 @@
+/*
+* Copyright (C) 2015 Dato, Inc.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Affero General Public License as
+* published by the Free Software Foundation, either version 3 of the
+* License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU Affero General Public License for more details.
+*
+* You should have received a copy of the GNU Affero General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <iostream>
+#include <set>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_saving.hpp>
+#include <fileio/temp_files.hpp>
+#include <fileio/general_fstream.hpp>
+#include <parallel/lambda_omp.hpp>
+#include <timer/timer.hpp>
+using namespace graphlab;
+
+/*
+ * Compares the throughput of the sframe save strategies.
+ * Either saves an existing sframe, or generates one with the given number 
+ * of columns and rows.
+ */
+
+static size_t total_segment_bytes(const sframe& sf) {
+  std::set<std::string> files;
+  for (size_t i = 0; i < sf.num_columns(); ++i) {
+    for (auto& f: sf.select_column(i)->get_index_info().segment_files) {
+      files.insert(parse_v2_segment_filename(f).first);
+    }
+  }
+  size_t ret = 0;
+  for (auto& f: files) ret += general_ifstream(f).file_size();
+  return ret;
+}
+
+static void run(const std::string& name, 
+                void (*save_fn)(const sframe&, std::string),
+                const sframe& sf, size_t nbytes) {
+  std::string index_file = get_temp_name() + ".frame_idx";
+  timer ti;
+  save_fn(sf, index_file);
+  double elapsed = ti.current_time();
+  std::cout << name << ": " << elapsed << " seconds, " 
+            << (nbytes / 1024.0 / 1024.0) / elapsed << " MB/s\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3) {
+    std::cout << argv[0] << " [sframe index file]\n";
+    std::cout << argv[0] << " [#columns] [#rows]\n";
+    return 0;
+  }
+  sframe sf;
+  if (argc == 2) {
+    sf = sframe(argv[1]);
+  } else {
+    size_t ncolumns = std::stoul(argv[1]);
+    size_t nrows = std::stoul(argv[2]);
+    std::vector<std::string> names;
+    std::vector<flex_type_enum> types;
+    for (size_t i = 0; i < ncolumns; ++i) {
+      names.push_back("X" + std::to_string(i));
+      types.push_back(i % 2 ? flex_type_enum::FLOAT : flex_type_enum::STRING);
+    }
+    timer ti;
+    sf.open_for_write(names, types);
+    parallel_for(0, sf.num_segments(), [&](size_t seg) {
+      auto out = sf.get_output_iterator(seg);
+      size_t begin = nrows * seg / sf.num_segments();
+      size_t end = nrows * (seg + 1) / sf.num_segments();
+      std::vector<flexible_type> row(ncolumns);
+      for (size_t r = begin; r < end; ++r) {
+        for (size_t i = 0; i < ncolumns; ++i) {
+          if (i % 2) row[i] = (double)(r * i) / 7.0;
+          else row[i] = std::to_string(r % (100 * (i + 1)));
+        }
+        *out = row;
+        ++out;
+      }
+    });
+    sf.close();
+    std::cout << "Generated in " << ti.current_time() << " seconds\n";
+  }
+  size_t nbytes = total_segment_bytes(sf);
+  std::cout << sf.num_columns() << " columns, " << sf.num_rows() << " rows, "
+            << nbytes / 1024 / 1024 << " MB\n";
+  run("sframe_save_blockwise", sframe_save_blockwise, sf, nbytes);
+  run("sframe_save_blockwise_parallel", 
+      [](const sframe& sf, std::string index_file) {
+        sframe_save_blockwise_parallel(sf, index_file);
+      }, sf, nbytes);
+}
@@ -27,6 +27,7 @@
 #include <sframe/groupby_aggregate.hpp>
 #include <sframe/groupby_aggregate_operators.hpp>
 #include <sframe/sframe_saving.hpp>
+#include <sframe/sarray_v2_block_manager.hpp>
 #include <cxxtest/TestSuite.h>
 
 using namespace graphlab;
@@ -422,6 +423,196 @@ class sframe_test : public CxxTest::TestSuite {
       TS_ASSERT_EQUALS(newsf.size(), 0);
     }
 
+    void test_sframe_save_blockwise_parallel() {
+      // 20 columns of different types
+      const size_t NUM_COLUMNS = 20;
+      const size_t NUM_ROWS = 200000;
+      std::vector<std::string> names;
+      std::vector<flex_type_enum> types;
+      for (size_t i = 0; i < NUM_COLUMNS; ++i) {
+        names.push_back("col" + std::to_string(i));
+        types.push_back(i % 2 ? flex_type_enum::INTEGER : flex_type_enum::STRING);
+      }
+      sframe sf;
+      sf.open_for_write(names, types, "", 4);
+      for (size_t seg = 0; seg < 4; ++seg) {
+        auto out = sf.get_output_iterator(seg);
+        for (size_t r = seg * NUM_ROWS / 4; r < (seg + 1) * NUM_ROWS / 4; ++r) {
+          std::vector<flexible_type> row;
+          for (size_t i = 0; i < NUM_COLUMNS; ++i) {
+            if (i % 2) row.push_back(r * i);
+            else row.push_back(std::to_string(r % (i + 10)));
+          }
+          *out = row;
+          ++out;
+        }
+      }
+      sf.close();
+      std::vector<std::vector<flexible_type> > frame;
+      graphlab::copy(sf, std::inserter(frame, frame.end()));
+
+      // default codec copies blocks as is, "none" decompresses them all
+      std::string old_codec = SFRAME_DEFAULT_COMPRESSION_CODEC;
+      for (std::string codec: {"lz4", "none"}) {
+        SFRAME_DEFAULT_COMPRESSION_CODEC = codec;
+        std::string index_file = get_temp_name() + ".frame_idx";
+        sframe_save_blockwise_parallel(sf, index_file);
+
+        sframe sf2(index_file);
+        TS_ASSERT_EQUALS(sf2.num_rows(), NUM_ROWS);
+        TS_ASSERT_EQUALS(sf2.num_columns(), NUM_COLUMNS);
+        TS_ASSERT_EQUALS(sf2.column_names(), names);
+        // rows are spread over the output segments
+        auto segment_sizes = sf2.select_column(0)->get_index_info().segment_sizes;
+        TS_ASSERT_EQUALS(segment_sizes.size(), SFRAME_DEFAULT_NUM_SEGMENTS);
+        TS_ASSERT(std::count(segment_sizes.begin(), segment_sizes.end(), 0) < 
+                  segment_sizes.size() - 1);
+
+        std::vector<std::vector<flexible_type> > new_frame;
+        graphlab::copy(sf2, std::inserter(new_frame, new_frame.end()));
+        TS_ASSERT_EQUALS(new_frame.size(), frame.size());
+        for (size_t i = 0;i < frame.size(); ++i) {
+          TS_ASSERT_EQUALS(new_frame[i], frame[i]);
+        }
+      }
+      SFRAME_DEFAULT_COMPRESSION_CODEC = old_codec;
+    }
+
+    void test_sframe_column_codecs() {
+      using namespace v2_block_impl;
+      // returns the LZ4 / LZ4HC flags shared by all blocks of a column
+      auto column_flags = [](const sframe& sf, size_t column) {
+        auto& manager = block_manager::get_instance();
+        size_t flags = LZ4_COMPRESSION | LZ4HC_COMPRESSION;
+        for (auto& segment_file: 
+             sf.select_column(column)->get_index_info().segment_files) {
+          auto address = manager.open_column(segment_file);
+          for (size_t b = 0; b < manager.num_blocks_in_column(address); ++b) {
+            flags &= manager.get_block_info(
+                block_address{std::get<0>(address), std::get<1>(address), b}).flags;
+          }
+          manager.close_column(address);
+        }
+        return flags;
+      };
+      auto column_codec = [](const sframe& sf, size_t column) {
+        auto metadata = sf.select_column(column)->get_index_info().metadata;
+        return metadata["__compression__"];
+      };
+
+      sframe bad_sf;
+      TS_ASSERT_THROWS_ANYTHING(
+          bad_sf.open_for_write({"a", "b"}, 
+                                {flex_type_enum::STRING, flex_type_enum::STRING},
+                                "", 1, true, {"gzip"}));
+      sframe sf;
+      sf.open_for_write({"a", "b", "c"}, 
+                        {flex_type_enum::STRING, flex_type_enum::STRING, 
+                         flex_type_enum::STRING},
+                        "", 1, true, {"none", "lz4hc:12"});
+      auto out = sf.get_output_iterator(0);
+      for (size_t r = 0; r < 50000; ++r) {
+        std::string val = std::to_string(r % 100);
+        *out = std::vector<flexible_type>{val, val, val};
+        ++out;
+      }
+      sf.close();
+      TS_ASSERT_EQUALS(column_codec(sf, 0), "none");
+      TS_ASSERT_EQUALS(column_codec(sf, 1), "lz4hc:12");
+      TS_ASSERT_EQUALS(column_codec(sf, 2), "");
+      TS_ASSERT_EQUALS(column_flags(sf, 0), (size_t)0);
+      TS_ASSERT_EQUALS(column_flags(sf, 1), LZ4_COMPRESSION | LZ4HC_COMPRESSION);
+      TS_ASSERT_EQUALS(column_flags(sf, 2), LZ4_COMPRESSION);
+
+      // a plain save keeps the codecs, naive or blockwise
+      for (bool naive: {false, true}) {
+        std::string index_file = get_temp_name() + ".frame_idx";
+        if (naive) sframe_save_naive(sf, index_file);
+        else sf.save(index_file);
+        sframe sf2(index_file);
+        TS_ASSERT_EQUALS(column_codec(sf2, 0), "none");
+        TS_ASSERT_EQUALS(column_codec(sf2, 1), "lz4hc:12");
+        TS_ASSERT_EQUALS(column_flags(sf2, 0), (size_t)0);
+        TS_ASSERT_EQUALS(column_flags(sf2, 1), LZ4_COMPRESSION | LZ4HC_COMPRESSION);
+        TS_ASSERT_EQUALS(column_flags(sf2, 2), LZ4_COMPRESSION);
+      }
+
+      // and a save can change them
+      std::string index_file = get_temp_name() + ".frame_idx";
+      sf.save(index_file, {"lz4", "", "none"});
+      sframe sf3(index_file);
+      TS_ASSERT_EQUALS(column_codec(sf3, 0), "lz4");
+      TS_ASSERT_EQUALS(column_codec(sf3, 1), "lz4hc:12");
+      TS_ASSERT_EQUALS(column_codec(sf3, 2), "none");
+      TS_ASSERT_EQUALS(column_flags(sf3, 0), LZ4_COMPRESSION);
+      TS_ASSERT_EQUALS(column_flags(sf3, 1), LZ4_COMPRESSION | LZ4HC_COMPRESSION);
+      TS_ASSERT_EQUALS(column_flags(sf3, 2), (size_t)0);
+      std::vector<std::vector<flexible_type> > frame, frame3;
+      graphlab::copy(sf, std::inserter(frame, frame.end()));
+      graphlab::copy(sf3, std::inserter(frame3, frame3.end()));
+      TS_ASSERT(frame == frame3);
+      TS_ASSERT_THROWS_ANYTHING(sf.save(get_temp_name() + ".frame_idx", 
+                                        {"lz4", "lz4", "lz4", "lz4"}));
+    }
+
+    void test_sframe_append_and_compact_saved() {
+      auto make_frame = [](size_t begin, size_t end) {
+        sframe sf;
+        sf.open_for_write({"id", "name"},
+                          {flex_type_enum::INTEGER, flex_type_enum::STRING}, "", 1);
+        auto out = sf.get_output_iterator(0);
+        for (size_t r = begin; r < end; ++r) {
+          *out = std::vector<flexible_type>{r, std::to_string(r)};
+          ++out;
+        }
+        sf.close();
+        return sf;
+      };
+      std::string index_file = get_temp_name() + ".frame_idx";
+      sframe_save(make_frame(0, 100000), index_file);
+      auto original_segments =
+          sframe(index_file).select_column(0)->get_index_info().segment_files;
+
+      // small appends add segments and leave the existing ones in place
+      const size_t NUM_APPENDS = 10;
+      for (size_t i = 0; i < NUM_APPENDS; ++i) {
+        sframe_append_saved(make_frame(100000 + i * 100, 100000 + (i + 1) * 100),
+                            index_file);
+      }
+      {
+        sframe sf(index_file);
+        TS_ASSERT_EQUALS(sf.num_rows(), 100000 + NUM_APPENDS * 100);
+        auto segment_files = sf.select_column(0)->get_index_info().segment_files;
+        TS_ASSERT_EQUALS(segment_files.size(),
+                         original_segments.size() + NUM_APPENDS);
+        for (size_t i = 0;i < original_segments.size(); ++i) {
+          TS_ASSERT_EQUALS(segment_files[i], original_segments[i]);
+        }
+      }
+      // schema mismatch
+      sframe other;
+      other.open_for_write({"id"}, {flex_type_enum::INTEGER}, "", 1);
+      other.close();
+      TS_ASSERT_THROWS_ANYTHING(sframe_append_saved(other, index_file));
+
+      // the appended segments are merged, the rest are untouched
+      size_t num_segments = sframe_compact_saved(index_file);
+      sframe sf(index_file);
+      auto segment_files = sf.select_column(0)->get_index_info().segment_files;
+      TS_ASSERT_EQUALS(segment_files.size(), num_segments);
+      TS_ASSERT_LESS_THAN(num_segments, original_segments.size() + NUM_APPENDS);
+      TS_ASSERT_EQUALS(sframe_compact_saved(index_file), num_segments);
+
+      TS_ASSERT_EQUALS(sf.num_rows(), 100000 + NUM_APPENDS * 100);
+      std::vector<std::vector<flexible_type> > rows;
+      graphlab::copy(sf, std::inserter(rows, rows.end()));
+      TS_ASSERT_EQUALS(rows.size(), sf.num_rows());
+      for (size_t i = 0;i < rows.size(); ++i) {
+        TS_ASSERT_EQUALS((size_t)(flex_int)rows[i][0], i);
+        TS_ASSERT_EQUALS(rows[i][1], std::to_string(i));
+      }
+    }
+
     void test_sframe_save_really_empty() {
       sframe sf;
       sf.open_for_write(std::vector<std::string>(), std::vector<flex_type_enum>());
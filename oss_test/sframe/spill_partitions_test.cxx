@@ -0,0 +1,223 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cxxtest/TestSuite.h>
+#include <fileio/fileio_constants.hpp>
+#include <fileio/spill_manager.hpp>
+#include <fileio/temp_files.hpp>
+#include <sframe/spill_partitions.hpp>
+
+using namespace graphlab;
+
+class spill_partitions_test: public CxxTest::TestSuite {
+ public:
+  /// The memory charged for a row written by fill
+  static const size_t ROW_BYTES = 100;
+
+  /**
+   * Writes partition p with p * 1000 + 3 rows of (int, string, list), and
+   * returns the rows written.
+   */
+  std::vector<std::vector<std::vector<flexible_type>>>
+  fill(spill_partitions& partitions) {
+    std::vector<std::vector<std::vector<flexible_type>>> ret(partitions.num_partitions());
+    for (size_t p = 0; p < partitions.num_partitions(); ++p) {
+      for (size_t i = 0; i < p * 1000 + 3; ++i) {
+        std::vector<flexible_type> row{flex_int(i), std::to_string(p),
+                                       flex_list{flex_int(p), 1.5}};
+        if (i % 7 == 0) row[1] = FLEX_UNDEFINED;
+        partitions.write(p, row, ROW_BYTES);
+        ret[p].push_back(row);
+      }
+    }
+    partitions.close();
+    return ret;
+  }
+
+  void test_write_read() {
+    spill_session session(memory_consumer::SORT, "test");
+    {
+      spill_partitions partitions(session, {flex_type_enum::INTEGER,
+                                            flex_type_enum::STRING,
+                                            flex_type_enum::LIST}, 5);
+      TS_ASSERT_EQUALS(partitions.num_partitions(), 5);
+      TS_ASSERT_EQUALS(partitions.num_columns(), 3);
+      auto expected = fill(partitions);
+      size_t total = 0;
+      for (size_t p = 0; p < 5; ++p) {
+        TS_ASSERT_EQUALS(partitions.partition_length(p), expected[p].size());
+        total += expected[p].size();
+
+        std::vector<std::vector<flexible_type>> rows;
+        partitions.read_partition(p, rows);
+        TS_ASSERT_EQUALS(rows, expected[p]);
+        TS_ASSERT_EQUALS(rows[1][0].get_type(), flex_type_enum::INTEGER);
+        TS_ASSERT_EQUALS(rows[1][2].get_type(), flex_type_enum::LIST);
+
+        // a small buffer to go through several prefetches
+        rows.clear();
+        auto reader = partitions.get_reader(p, 0, (size_t)(-1), 64);
+        TS_ASSERT_EQUALS(reader.size(), expected[p].size());
+        while (reader.has_next()) rows.push_back(reader.next());
+        TS_ASSERT_EQUALS(rows, expected[p]);
+      }
+      TS_ASSERT_EQUALS(partitions.size(), total);
+
+      // a range of rows of a partition
+      auto reader = partitions.get_reader(3, 100, 1050, 100);
+      TS_ASSERT_EQUALS(reader.size(), 950);
+      for (size_t i = 100; i < 1050; ++i) {
+        TS_ASSERT(reader.has_next());
+        TS_ASSERT_EQUALS(reader.next(), expected[3][i]);
+      }
+      TS_ASSERT(!reader.has_next());
+
+      // a range past the end of the partition is clipped
+      TS_ASSERT_EQUALS(partitions.get_reader(0, 2, 1000).size(), 1);
+      TS_ASSERT_EQUALS(partitions.get_reader(0, 5, 1000).size(), 0);
+    }
+    TS_ASSERT_LESS_THAN(0, session.spilled_bytes());
+    TS_ASSERT_LESS_THAN(0, session.num_runs());
+  }
+
+  /**
+   * Checks that each partition reads back as written, whole and from the
+   * middle.
+   */
+  void check_partitions(const spill_partitions& partitions,
+                        const std::vector<std::vector<std::vector<flexible_type>>>& expected) {
+    for (size_t p = 0; p < partitions.num_partitions(); ++p) {
+      TS_ASSERT_EQUALS(partitions.partition_length(p), expected[p].size());
+      std::vector<std::vector<flexible_type>> rows;
+      partitions.read_partition(p, rows);
+      TS_ASSERT_EQUALS(rows, expected[p]);
+
+      rows.clear();
+      auto reader = partitions.get_reader(p, expected[p].size() / 3,
+                                          (size_t)(-1), 64);
+      while (reader.has_next()) rows.push_back(reader.next());
+      TS_ASSERT(std::equal(rows.begin(), rows.end(),
+                           expected[p].begin() + expected[p].size() / 3));
+      TS_ASSERT_EQUALS(rows.size(), expected[p].size() - expected[p].size() / 3);
+    }
+  }
+
+  void test_memory_budget() {
+    std::vector<flex_type_enum> types{flex_type_enum::INTEGER,
+                                      flex_type_enum::STRING,
+                                      flex_type_enum::LIST};
+    {
+      // everything fits in memory: nothing is written to disk
+      spill_session session(memory_consumer::SORT, "in memory");
+      session.set_memory_budget(size_t(1) << 30);
+      spill_partitions partitions(session, types, 5);
+      auto expected = fill(partitions);
+      check_partitions(partitions, expected);
+      TS_ASSERT_EQUALS(session.num_runs(), 0);
+      TS_ASSERT_EQUALS(session.spilled_bytes(), 0);
+      TS_ASSERT_EQUALS(session.memory_bytes(), partitions.size() * ROW_BYTES);
+    }
+    {
+      // about half fits: the rest goes to disk
+      spill_session session(memory_consumer::SORT, "half in memory");
+      session.set_memory_budget(500 * 1000);
+      {
+        spill_partitions partitions(session, types, 5);
+        auto expected = fill(partitions);
+        check_partitions(partitions, expected);
+        TS_ASSERT_LESS_THAN(0, session.num_runs());
+        TS_ASSERT_LESS_THAN(0, session.spilled_bytes());
+        TS_ASSERT_LESS_THAN(0, session.memory_bytes());
+        TS_ASSERT_LESS_THAN_EQUALS(session.memory_bytes(), 500 * 1000);
+      }
+      // the budget is returned
+      TS_ASSERT_EQUALS(session.memory_bytes(), 0);
+    }
+  }
+
+  void test_accounting_scope() {
+    std::vector<flex_type_enum> types{flex_type_enum::INTEGER,
+                                      flex_type_enum::STRING,
+                                      flex_type_enum::LIST};
+    auto counter = std::make_shared<atomic<size_t>>();
+    spill_session outside(memory_consumer::SORT, "outside the query");
+    {
+      spill_accounting_scope scope(counter);
+      spill_session session(memory_consumer::SORT, "in the query");
+      {
+        spill_partitions partitions(session, types, 3);
+        fill(partitions);
+      }
+      // the spills of sessions created outside the scope are not counted
+      {
+        spill_partitions partitions(outside, types, 3);
+        fill(partitions);
+      }
+      TS_ASSERT_LESS_THAN(0, session.spilled_bytes());
+      TS_ASSERT_LESS_THAN(0, outside.spilled_bytes());
+      TS_ASSERT_EQUALS(counter->value, session.spilled_bytes());
+    }
+    size_t counted = counter->value;
+    spill_session after(memory_consumer::SORT, "after the query");
+    {
+      spill_partitions partitions(after, types, 3);
+      fill(partitions);
+    }
+    TS_ASSERT_EQUALS(counter->value, counted);
+  }
+
+  void test_striping() {
+    auto old_locations = fileio::get_cache_file_locations();
+    auto base = get_temp_directories()[0];
+    std::string dir_a = base + "/spill_test_a";
+    std::string dir_b = base + "/spill_test_b";
+    boost::filesystem::create_directories(dir_a);
+    boost::filesystem::create_directories(dir_b);
+    fileio::set_cache_file_locations(dir_a + ":" + dir_b);
+
+    auto& manager = spill_manager::get_instance();
+    size_t spilled_before = manager.total_spilled_bytes();
+    {
+      spill_session session(memory_consumer::GROUPBY, "striping test");
+      TS_ASSERT_EQUALS(manager.get_stats().sessions.back().description,
+                       "striping test");
+      spill_partitions partitions(session, {flex_type_enum::INTEGER,
+                                            flex_type_enum::STRING,
+                                            flex_type_enum::LIST}, 4);
+      auto expected = fill(partitions);
+      for (size_t p = 0; p < 4; ++p) {
+        std::vector<std::vector<flexible_type>> rows;
+        partitions.read_partition(p, rows);
+        TS_ASSERT_EQUALS(rows, expected[p]);
+      }
+
+      // one run on each directory
+      auto stats = manager.get_stats();
+      TS_ASSERT_EQUALS(stats.directories.size(), 2);
+      for (const auto& dir: stats.directories) {
+        TS_ASSERT_EQUALS(dir.num_runs, 1);
+        TS_ASSERT_LESS_THAN(0, dir.bytes);
+      }
+      TS_ASSERT_EQUALS(session.num_runs(), 2);
+      TS_ASSERT_EQUALS(manager.total_spilled_bytes() - spilled_before,
+                       session.spilled_bytes());
+    }
+    // the runs are released
+    auto stats = manager.get_stats();
+    for (const auto& dir: stats.directories) {
+      TS_ASSERT_EQUALS(dir.num_runs, 0);
+      TS_ASSERT_EQUALS(dir.bytes, 0);
+    }
+    for (const auto& session: stats.sessions) {
+      TS_ASSERT_DIFFERS(session.description, "striping test");
+    }
+    fileio::set_cache_file_locations(old_locations);
+  }
+};
@@ -8,8 +8,10 @@
 #include <sframe_query_engine/planning/planner.hpp>
 #include <sframe_query_engine/planning/planner_node.hpp>
 #include <sframe_query_engine/operators/all_operators.hpp>
+#include <sframe_query_engine/execution/query_profile.hpp>
 #include <sframe_query_engine/util/aggregates.hpp>
 #include <sframe/sarray.hpp>
+#include <parallel/pthread_tools.hpp>
 #include <cxxtest/TestSuite.h>
 
 using namespace graphlab;
@@ -157,4 +159,84 @@ class basic_end_to_end: public CxxTest::TestSuite {
                                    0);
     TS_ASSERT_EQUALS(m, TEST_LENGTH - 1);
   }
+
+  void test_concurrent_queries() {
+    const size_t TEST_LENGTH = 100000;
+    std::vector<flexible_type> data;
+    for (size_t i = 0;i < TEST_LENGTH; ++i) data.push_back(i);
+    auto sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+
+    auto root = op_sarray_source::make_planner_node(sa);
+    // shared by all the queries
+    auto add_one =
+        op_transform::make_planner_node(
+            root,
+            [](const sframe_rows::row& a)->flexible_type {
+              return a[0] + 1;
+            },
+            flex_type_enum::INTEGER);
+
+    const size_t NUM_QUERIES = 8;
+    std::vector<flex_int> sums(NUM_QUERIES, 0);
+    thread_group threads;
+    for (size_t q = 0; q < NUM_QUERIES; ++q) {
+      threads.launch([&, q]() {
+        auto times_q =
+            op_transform::make_planner_node(
+                add_one,
+                [q](const sframe_rows::row& a)->flexible_type {
+                  return a[0] * (flex_int)q;
+                },
+                flex_type_enum::INTEGER);
+        auto res = planner().materialize(times_q);
+        std::vector<flexible_type> all_rows;
+        res.select_column(0)->get_reader()->read_rows(0, res.size(), all_rows);
+        for (auto& v: all_rows) sums[q] += v.get<flex_int>();
+      });
+    }
+    threads.join();
+    flex_int expected = TEST_LENGTH * (TEST_LENGTH + 1) / 2;
+    for (size_t q = 0; q < NUM_QUERIES; ++q) {
+      TS_ASSERT_EQUALS(sums[q], expected * (flex_int)q);
+    }
+    TS_ASSERT_EQUALS(planner().materialize(add_one).size(), TEST_LENGTH);
+  }
+
+  void test_profile() {
+    const size_t TEST_LENGTH = 100000;
+    std::vector<flexible_type> data;
+    for (size_t i = 0;i < TEST_LENGTH; ++i) data.push_back(i);
+    auto sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+
+    auto root = op_sarray_source::make_planner_node(sa);
+    auto add_one =
+        op_transform::make_planner_node(
+            root,
+            [](const sframe_rows::row& a)->flexible_type {
+              return a[0] + 1;
+            },
+            flex_type_enum::INTEGER);
+
+    materialize_options options;
+    options.profile = std::make_shared<query_profile>();
+    auto res = planner().materialize(add_one, options);
+    TS_ASSERT_EQUALS(res.size(), TEST_LENGTH);
+
+    std::string plan = options.profile->annotated_plan();
+    TS_ASSERT(plan.find("digraph G") != std::string::npos);
+    TS_ASSERT(plan.find("cluster_1") != std::string::npos);
+    // the source and the transform both output every row
+    TS_ASSERT(plan.find("rows in 0, out 100000") != std::string::npos);
+    TS_ASSERT(plan.find("rows in 100000, out 100000") != std::string::npos);
+
+    std::string trace = options.profile->chrome_trace();
+    TS_ASSERT(trace.find("\"traceEvents\"") != std::string::npos);
+    TS_ASSERT(trace.find("\"rows_out\":100000") != std::string::npos);
+  }
 };
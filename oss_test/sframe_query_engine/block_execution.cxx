@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <sframe_query_engine/planning/planner.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/execution/execution_node.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
+#include <sframe_query_engine/operators/all_operators.hpp>
+#include <sframe/sarray.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace graphlab;
+using namespace graphlab::query_eval;
+
+class block_execution_test: public CxxTest::TestSuite {
+  static const size_t TEST_LENGTH = 10007;
+  std::shared_ptr<sarray<flexible_type>> sa;
+
+ public:
+  void setUp() {
+    std::vector<flexible_type> data;
+    for (size_t i = 0;i < TEST_LENGTH; ++i) data.push_back(i);
+    sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+  }
+
+  void tearDown() {
+    SFRAME_QUERY_BLOCK_EXECUTION = true;
+  }
+
+  pnode_ptr plus(const pnode_ptr& input, flex_int value) {
+    return op_transform::make_planner_node(
+        input,
+        [value](const sframe_rows::row& a)->flexible_type { return a[0] + value; },
+        flex_type_enum::INTEGER);
+  }
+
+  std::vector<std::vector<flexible_type>> run(const pnode_ptr& node, bool block_execution) {
+    SFRAME_QUERY_BLOCK_EXECUTION = block_execution;
+    auto res = planner().materialize(node);
+    std::vector<std::vector<flexible_type>> rows;
+    res.get_reader()->read_rows(0, res.size(), rows);
+    return rows;
+  }
+
+  /**
+   * A plan made only of operators supporting block execution, run as a
+   * single loop.
+   */
+  void test_block_pipeline() {
+    auto source = op_sarray_source::make_planner_node(sa);
+    auto sum = op_binary_transform::make_planner_node(
+        plus(source, 1), op_range::make_planner_node(0, TEST_LENGTH),
+        [](const sframe_rows::row& a, const sframe_rows::row& b)->flexible_type {
+          return a[0] + b[0];
+        },
+        flex_type_enum::INTEGER);
+    auto all = op_union::make_planner_node(
+        {sum, op_constant::make_planner_node(7, flex_type_enum::INTEGER, TEST_LENGTH), source});
+    auto node = op_project::make_planner_node(all, {2, 0});
+
+    // run at several block sizes, including one which does not divide the
+    // length
+    size_t old_max_block_size = SFRAME_QUERY_MAX_BLOCK_SIZE;
+    for (size_t max_block_size: {4096, 100, 8}) {
+      SFRAME_QUERY_MAX_BLOCK_SIZE = max_block_size;
+      auto rows = run(node, true);
+      TS_ASSERT_EQUALS(rows.size(), TEST_LENGTH);
+      for (flex_int i = 0;i < (flex_int)rows.size(); ++i) {
+        TS_ASSERT_EQUALS(rows[i][0], i);
+        TS_ASSERT_EQUALS(rows[i][1], 2 * i + 1);
+      }
+      TS_ASSERT_EQUALS(rows, run(node, false));
+    }
+    SFRAME_QUERY_MAX_BLOCK_SIZE = old_max_block_size;
+  }
+
+  /**
+   * Operators run without coroutines feeding, and fed by, operators which
+   * need them, with blocks being skipped.
+   */
+  void test_mixed_pipeline() {
+    auto source = op_sarray_source::make_planner_node(sa);
+    auto selector = op_transform::make_planner_node(
+        source,
+        [](const sframe_rows::row& a)->flexible_type { return (a[0] / 500) % 2; },
+        flex_type_enum::INTEGER);
+    auto left = op_logical_filter::make_planner_node(plus(source, 1), selector);
+    auto right = op_logical_filter::make_planner_node(source, selector);
+    auto sum = op_binary_transform::make_planner_node(
+        left, plus(right, 2),
+        [](const sframe_rows::row& a, const sframe_rows::row& b)->flexible_type {
+          return a[0] + b[0];
+        },
+        flex_type_enum::INTEGER);
+    auto node = op_append::make_planner_node(sum, plus(source, 0));
+
+    auto rows = run(node, true);
+    TS_ASSERT_EQUALS(rows, run(node, false));
+    std::vector<std::vector<flexible_type>> expected;
+    for (flex_int i = 0;i < (flex_int)TEST_LENGTH; ++i) {
+      if ((i / 500) % 2) expected.push_back({2 * i + 3});
+    }
+    for (flex_int i = 0;i < (flex_int)TEST_LENGTH; ++i) expected.push_back({i});
+    TS_ASSERT_EQUALS(rows, expected);
+  }
+
+  void test_block_pipeline_exception() {
+    auto node = op_transform::make_planner_node(
+        op_sarray_source::make_planner_node(sa),
+        [](const sframe_rows::row& a)->flexible_type {
+          if (a[0] == 5000) throw std::string("bad row");
+          return a[0];
+        },
+        flex_type_enum::INTEGER);
+    SFRAME_QUERY_BLOCK_EXECUTION = true;
+    TS_ASSERT_THROWS_ANYTHING(planner().materialize(node));
+  }
+};
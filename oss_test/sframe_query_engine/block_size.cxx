@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <sframe_query_engine/planning/planner.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
+#include <sframe_query_engine/operators/all_operators.hpp>
+#include <sframe/sarray.hpp>
+#include <sframe/sframe_config.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace graphlab;
+using namespace graphlab::query_eval;
+
+class block_size_test: public CxxTest::TestSuite {
+ public:
+  std::shared_ptr<sarray<flexible_type>> make_sarray(const std::vector<flexible_type>& data,
+                                                     flex_type_enum type) {
+    auto sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    sa->set_type(type);
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+    return sa;
+  }
+
+  void test_value_bytes() {
+    TS_ASSERT_EQUALS(estimate_value_bytes(flexible_type(1)), sizeof(flexible_type));
+    size_t vec_bytes = estimate_value_bytes(flexible_type(flex_vec(200, 1.0)));
+    TS_ASSERT_LESS_THAN(200 * sizeof(double), vec_bytes);
+    TS_ASSERT_LESS_THAN(estimate_value_bytes(flexible_type("a")),
+                        estimate_value_bytes(flexible_type(std::string(1000, 'a'))));
+  }
+
+  void test_block_size_follows_row_width() {
+    std::vector<flexible_type> narrow, wide;
+    for (size_t i = 0;i < 1000; ++i) {
+      narrow.push_back(i);
+      wide.push_back(flex_vec(200, i));
+    }
+    auto narrow_node = op_sarray_source::make_planner_node(
+        make_sarray(narrow, flex_type_enum::INTEGER));
+    auto wide_node = op_sarray_source::make_planner_node(
+        make_sarray(wide, flex_type_enum::VECTOR));
+
+    size_t narrow_block = choose_block_size(narrow_node);
+    size_t wide_block = choose_block_size(wide_node);
+    TS_ASSERT_EQUALS(narrow_block, SFRAME_QUERY_MAX_BLOCK_SIZE);
+    TS_ASSERT_LESS_THAN(wide_block, narrow_block);
+    TS_ASSERT_LESS_THAN_EQUALS(SFRAME_QUERY_MIN_BLOCK_SIZE, wide_block);
+    TS_ASSERT_LESS_THAN_EQUALS(wide_block * 200 * sizeof(double), SFRAME_QUERY_BLOCK_BYTES);
+
+    // the columns selected from a union keep the width of their source
+    auto both = op_union::make_planner_node(narrow_node, wide_node);
+    auto narrow_only = op_project::make_planner_node(both, {0});
+    std::map<const planner_node*, std::vector<size_t>> memo;
+    auto widths = estimate_row_bytes(narrow_only, memo);
+    TS_ASSERT_EQUALS(widths.size(), 1);
+    TS_ASSERT_EQUALS(widths[0], sizeof(flexible_type));
+
+    size_t old_block_bytes = SFRAME_QUERY_BLOCK_BYTES;
+    SFRAME_QUERY_BLOCK_BYTES = 0;
+    TS_ASSERT_EQUALS(choose_block_size(wide_node), sframe_config::SFRAME_READ_BATCH_SIZE);
+    SFRAME_QUERY_BLOCK_BYTES = old_block_bytes;
+  }
+
+  void test_wide_rows_materialize() {
+    std::vector<flexible_type> wide;
+    for (size_t i = 0;i < 5000; ++i) wide.push_back(flex_vec(200, i));
+    auto source = op_sarray_source::make_planner_node(make_sarray(wide, flex_type_enum::VECTOR));
+    auto first = op_transform::make_planner_node(
+        source,
+        [](const sframe_rows::row& a)->flexible_type {
+          return a[0].get<flex_vec>()[0];
+        },
+        flex_type_enum::FLOAT);
+    auto selector = op_transform::make_planner_node(
+        first,
+        [](const sframe_rows::row& a)->flexible_type { return ((flex_int)a[0]) % 3 == 0; },
+        flex_type_enum::INTEGER);
+    auto filtered = op_logical_filter::make_planner_node(first, selector);
+    auto res = planner().materialize(filtered);
+
+    std::vector<flexible_type> all_rows;
+    res.select_column(0)->get_reader()->read_rows(0, res.size(), all_rows);
+    TS_ASSERT_EQUALS(all_rows.size(), 1667);
+    for (size_t i = 0;i < all_rows.size(); ++i) {
+      TS_ASSERT_EQUALS(all_rows[i], 3 * i);
+    }
+  }
+};
@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <sframe_query_engine/planning/planner.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/planning/common_subplans.hpp>
+#include <sframe_query_engine/operators/all_operators.hpp>
+#include <sframe/sarray.hpp>
+#include <parallel/atomic.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace graphlab;
+using namespace graphlab::query_eval;
+
+class common_subplans_test: public CxxTest::TestSuite {
+  static const size_t TEST_LENGTH = 10000;
+  std::shared_ptr<sarray<flexible_type>> sa;
+  atomic<size_t> num_calls;
+
+ public:
+  void setUp() {
+    std::vector<flexible_type> data;
+    for (size_t i = 0;i < TEST_LENGTH; ++i) data.push_back(i);
+    sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+    num_calls = 0;
+  }
+
+  void tearDown() {
+    SFRAME_QUERY_RESULT_CACHE_SIZE = 0;
+    query_result_cache::get_instance().clear();
+  }
+
+  /**
+   * Builds sa + 1 from scratch, with a transform counting its calls.
+   */
+  pnode_ptr add_one(const std::string& fingerprint) {
+    auto calls = &num_calls;
+    return op_transform::make_planner_node(
+        op_sarray_source::make_planner_node(sa),
+        [calls](const sframe_rows::row& a)->flexible_type {
+          calls->inc();
+          return a[0] + 1;
+        },
+        flex_type_enum::INTEGER, -1, fingerprint);
+  }
+
+  void test_structural_hash() {
+    plan_hashes hashes;
+    uint128_t h1 = planner_node_structural_hash(add_one("add 1"), hashes);
+    uint128_t h2 = planner_node_structural_hash(add_one("add 1"), hashes);
+    uint128_t h3 = planner_node_structural_hash(add_one("add 2"), hashes);
+    TS_ASSERT(h1 != 0);
+    TS_ASSERT(h1 == h2);
+    TS_ASSERT(h1 != h3);
+    // a function without a fingerprint cannot be identified
+    TS_ASSERT(planner_node_structural_hash(add_one(""), hashes) == 0);
+  }
+
+  void test_common_subplans_computed_once() {
+    auto sum = op_binary_transform::make_planner_node(
+        add_one("add 1"), add_one("add 1"),
+        [](const sframe_rows::row& a, const sframe_rows::row& b)->flexible_type {
+          return a[0] + b[0];
+        },
+        flex_type_enum::INTEGER);
+    auto res = planner().materialize(sum);
+    std::vector<flexible_type> all_rows;
+    res.select_column(0)->get_reader()->read_rows(0, res.size(), all_rows);
+    TS_ASSERT_EQUALS(all_rows.size(), TEST_LENGTH);
+    for (flex_int i = 0;i < (flex_int)TEST_LENGTH; ++i) {
+      TS_ASSERT_EQUALS(all_rows[i], 2 * (i + 1));
+    }
+    TS_ASSERT_EQUALS(num_calls.value, TEST_LENGTH);
+  }
+
+  void test_result_cache() {
+    SFRAME_QUERY_RESULT_CACHE_SIZE = 2;
+    auto first = planner().materialize(add_one("add 1"));
+    TS_ASSERT_EQUALS(num_calls.value, TEST_LENGTH);
+    TS_ASSERT_EQUALS(query_result_cache::get_instance().size(), 1);
+
+    // an identical plan built again reads the cached result
+    auto second = planner().materialize(add_one("add 1"));
+    TS_ASSERT_EQUALS(num_calls.value, TEST_LENGTH);
+    TS_ASSERT_EQUALS(second.size(), TEST_LENGTH);
+    TS_ASSERT_EQUALS(query_result_cache::get_instance().num_hits(), 1);
+
+    // and so does a plan containing it
+    auto times_two = op_transform::make_planner_node(
+        add_one("add 1"),
+        [](const sframe_rows::row& a)->flexible_type { return a[0] * 2; },
+        flex_type_enum::INTEGER);
+    auto res = planner().materialize(times_two);
+    TS_ASSERT_EQUALS(num_calls.value, TEST_LENGTH);
+    std::vector<flexible_type> all_rows;
+    res.select_column(0)->get_reader()->read_rows(0, res.size(), all_rows);
+    TS_ASSERT_EQUALS(all_rows[10], 22);
+
+    // the cache is bounded
+    planner().materialize(add_one("add 2"));
+    planner().materialize(add_one("add 3"));
+    TS_ASSERT_EQUALS(query_result_cache::get_instance().size(), 2);
+    planner().materialize(add_one("add 1"));
+    TS_ASSERT_EQUALS(num_calls.value, 4 * TEST_LENGTH);
+  }
+};
@@ -5,9 +5,11 @@
  * This software may be modified and distributed under the terms
  * of the BSD license. See the LICENSE file for details.
  */
+#include <sframe_query_engine/planning/planner.hpp>
 #include <sframe_query_engine/execution/execution_node.hpp>
-#include <sframe_query_engine/operators/sarray_source.hpp>
-#include <sframe_query_engine/operators/lambda_transform.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
+#include <sframe_query_engine/operators/all_operators.hpp>
+#include <lambda/lambda_constants.hpp>
 #include <sframe/sarray.hpp>
 #include <sframe/algorithm.hpp>
 #include <cxxtest/TestSuite.h>
@@ -47,7 +49,82 @@ class transform_test: public CxxTest::TestSuite {
     check_node(node, expected);
   }
 
+  /**
+   * With several batches in flight, the results are still emitted in the
+   * order of the input blocks.
+   */
+  void test_inflight_ordering() {
+    const size_t length = 10007;
+    auto source = op_sarray_source::make_planner_node(make_sarray(length));
+    auto node = op_lambda_transform::make_planner_node(source, PLUS_ONE_LAMBDA_STRING,
+                                                       flex_type_enum::INTEGER);
+    size_t old_max_inflight = LAMBDA_MAX_INFLIGHT_BATCHES;
+    size_t old_max_block_size = SFRAME_QUERY_MAX_BLOCK_SIZE;
+    SFRAME_QUERY_MAX_BLOCK_SIZE = 100;
+    for (size_t max_inflight: {1, 4, 16}) {
+      LAMBDA_MAX_INFLIGHT_BATCHES = max_inflight;
+      auto rows = run(node);
+      TS_ASSERT_EQUALS(rows.size(), length);
+      for (flex_int i = 0;i < (flex_int)rows.size(); ++i) {
+        TS_ASSERT_EQUALS(rows[i], i + 1);
+      }
+    }
+    SFRAME_QUERY_MAX_BLOCK_SIZE = old_max_block_size;
+    LAMBDA_MAX_INFLIGHT_BATCHES = old_max_inflight;
+  }
+
+  /**
+   * A filter skips whole blocks of the lambda's output while batches are
+   * in flight: the batches in flight are dropped, and the following
+   * blocks are skipped on the input.
+   */
+  void test_filter_skips_inflight() {
+    const size_t length = 10007;
+    auto source = op_sarray_source::make_planner_node(make_sarray(length));
+    auto selector = op_transform::make_planner_node(
+        source,
+        [](const sframe_rows::row& a)->flexible_type { return (a[0] / 500) % 2; },
+        flex_type_enum::INTEGER);
+    auto node = op_logical_filter::make_planner_node(
+        op_lambda_transform::make_planner_node(source, PLUS_ONE_LAMBDA_STRING,
+                                               flex_type_enum::INTEGER),
+        selector);
+    std::vector<flexible_type> expected;
+    for (flex_int i = 0;i < (flex_int)length; ++i) {
+      if ((i / 500) % 2) expected.push_back(i + 1);
+    }
+
+    size_t old_max_inflight = LAMBDA_MAX_INFLIGHT_BATCHES;
+    size_t old_max_block_size = SFRAME_QUERY_MAX_BLOCK_SIZE;
+    SFRAME_QUERY_MAX_BLOCK_SIZE = 100;
+    for (size_t max_inflight: {1, 4}) {
+      LAMBDA_MAX_INFLIGHT_BATCHES = max_inflight;
+      TS_ASSERT_EQUALS(run(node), expected);
+    }
+    SFRAME_QUERY_MAX_BLOCK_SIZE = old_max_block_size;
+    LAMBDA_MAX_INFLIGHT_BATCHES = old_max_inflight;
+  }
+
  private:
+  std::shared_ptr<sarray<flexible_type>> make_sarray(size_t length) {
+    std::vector<flexible_type> data;
+    for (size_t i = 0;i < length; ++i) data.push_back(i);
+    auto sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+    return sa;
+  }
+
+  std::vector<flexible_type> run(const std::shared_ptr<planner_node>& node) {
+    auto res = planner().materialize(node);
+    std::vector<std::vector<flexible_type>> rows;
+    res.get_reader()->read_rows(0, res.size(), rows);
+    std::vector<flexible_type> ret;
+    for (const auto& row: rows) ret.push_back(row[0]);
+    return ret;
+  }
+
   std::shared_ptr<execution_node> make_node(const op_sarray_source& source,
                                             const std::string& lambda_str, flex_type_enum type) {
     auto lambda_fn = std::make_shared<lambda::pylambda_function>(lambda_str);
@@ -0,0 +1,152 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <sframe_query_engine/algorithm/partitioned_sframe.hpp>
+#include <sframe/sframe.hpp>
+#include <fileio/temp_files.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace graphlab;
+using namespace graphlab::query_eval;
+
+class partitioned_sframe_test: public CxxTest::TestSuite {
+ public:
+
+  /**
+   * Makes a frame with columns {id, day, region}, with rows spread over
+   * 3 days and 2 regions. Every 7th region is missing.
+   */
+  sframe make_events(size_t num_rows, size_t id_offset = 0) {
+    sframe sf;
+    sf.open_for_write({"id", "day", "region"},
+                      {flex_type_enum::INTEGER,
+                       flex_type_enum::INTEGER,
+                       flex_type_enum::STRING}, "", 2);
+    auto iter = sf.get_output_iterator(0);
+    for (size_t i = 0; i < num_rows; ++i) {
+      flexible_type region = (i % 7 == 0) ? FLEX_UNDEFINED :
+          flexible_type((i % 2) ? "us/west" : "eu");
+      *iter = std::vector<flexible_type>{flex_int(i + id_offset),
+                                         flex_int(20151015 + i % 3),
+                                         region};
+      ++iter;
+    }
+    sf.close();
+    return sf;
+  }
+
+  std::vector<std::vector<flexible_type> > read_sorted(const sframe& sf) {
+    std::vector<std::vector<flexible_type> > rows;
+    sf.get_reader()->read_rows(0, sf.size(), rows);
+    std::sort(rows.begin(), rows.end(),
+              [](const std::vector<flexible_type>& a,
+                 const std::vector<flexible_type>& b) {
+                return (flex_int)a[0] < (flex_int)b[0];
+              });
+    return rows;
+  }
+
+  void test_round_trip() {
+    std::string dir = get_temp_name();
+    sframe events = make_events(1000);
+    partitioned_sframe::write(events, dir, {"day", "region"});
+
+    partitioned_sframe ps(dir);
+    TS_ASSERT_EQUALS(ps.num_partitions(), 9);
+    TS_ASSERT(ps.column_names() == events.column_names());
+    TS_ASSERT(ps.column_types() == events.column_types());
+
+    sframe result = ps.to_sframe();
+    TS_ASSERT_EQUALS(result.size(), events.size());
+    TS_ASSERT(result.column_names() == events.column_names());
+    auto expected = read_sorted(events);
+    auto actual = read_sorted(result);
+    TS_ASSERT_EQUALS(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        TS_ASSERT_EQUALS(expected[i][j].get_type(), actual[i][j].get_type());
+        if (expected[i][j].get_type() != flex_type_enum::UNDEFINED) {
+          TS_ASSERT_EQUALS(expected[i][j], actual[i][j]);
+        }
+      }
+    }
+  }
+
+  void test_partition_pruning() {
+    std::string dir = get_temp_name();
+    partitioned_sframe::write(make_events(1000), dir, {"day", "region"});
+    partitioned_sframe ps(dir);
+
+    partition_predicate day;
+    day.column = "day";
+    day.op = partition_predicate::comparison::GE;
+    day.value = 20151016;
+    partition_predicate region;
+    region.column = "region";
+    region.value = "us/west";
+
+    TS_ASSERT_EQUALS(ps.select_partitions({day}).size(), 6);
+    TS_ASSERT_EQUALS(ps.select_partitions({day, region}).size(), 2);
+
+    sframe result = ps.to_sframe({day, region});
+    for (const auto& row: read_sorted(result)) {
+      TS_ASSERT_LESS_THAN_EQUALS(20151016, (flex_int)row[1]);
+      TS_ASSERT_EQUALS(row[2], "us/west");
+    }
+    size_t expected = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+      if (i % 3 != 0 && i % 7 != 0 && i % 2 == 1) ++expected;
+    }
+    TS_ASSERT_EQUALS(result.size(), expected);
+
+    // missing keys are only matched by a missing value
+    partition_predicate missing_region;
+    missing_region.column = "region";
+    missing_region.value = FLEX_UNDEFINED;
+    TS_ASSERT_EQUALS(ps.select_partitions({missing_region}).size(), 3);
+
+    partition_predicate days_in;
+    days_in.column = "day";
+    days_in.op = partition_predicate::comparison::IN;
+    days_in.value = flex_list{20151015, 20151017};
+    TS_ASSERT_EQUALS(ps.select_partitions({days_in}).size(), 6);
+
+    // nothing selected still gives the right schema
+    day.op = partition_predicate::comparison::GT;
+    day.value = 20160000;
+    sframe empty = ps.to_sframe({day});
+    TS_ASSERT_EQUALS(empty.size(), 0);
+    TS_ASSERT(empty.column_names() == ps.column_names());
+
+    partition_predicate not_a_key;
+    not_a_key.column = "id";
+    not_a_key.value = 1;
+    TS_ASSERT_THROWS_ANYTHING(ps.select_partitions({not_a_key}));
+  }
+
+  void test_append() {
+    std::string dir = get_temp_name();
+    partitioned_sframe::write(make_events(300), dir, {"day"});
+    partitioned_sframe::write(make_events(300, 300), dir, {"day"});
+
+    partitioned_sframe ps(dir);
+    TS_ASSERT_EQUALS(ps.num_partitions(), 3);
+    for (size_t i = 0; i < ps.num_partitions(); ++i) {
+      TS_ASSERT_EQUALS(ps.get_partition(i).frame_files.size(), 2);
+    }
+    auto rows = read_sorted(ps.to_sframe());
+    TS_ASSERT_EQUALS(rows.size(), 600);
+    for (size_t i = 0; i < rows.size(); ++i) {
+      TS_ASSERT_EQUALS((flex_int)rows[i][0], i);
+    }
+
+    // appending with different partition columns is rejected
+    TS_ASSERT_THROWS_ANYTHING(
+        partitioned_sframe::write(make_events(10), dir, {"region"}));
+  }
+};
@@ -0,0 +1,202 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <algorithm>
+#include <parallel/mutex.hpp>
+#include <sframe_query_engine/planning/planner.hpp>
+#include <sframe_query_engine/planning/planner_node.hpp>
+#include <sframe_query_engine/execution/execution_node.hpp>
+#include <sframe_query_engine/execution/block_size.hpp>
+#include <sframe_query_engine/execution/running_queries.hpp>
+#include <sframe_query_engine/operators/all_operators.hpp>
+#include <sframe_query_engine/algorithm/sample.hpp>
+#include <sframe/sarray.hpp>
+#include <sframe/sframe.hpp>
+#include <sframe/sframe_config.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace graphlab;
+using namespace graphlab::query_eval;
+
+class sample_test: public CxxTest::TestSuite {
+  static const size_t TEST_LENGTH = 10007;
+  // spans several strata of the mask
+  static const size_t MASK_LENGTH = 300007;
+  std::shared_ptr<sarray<flexible_type>> sa;
+
+ public:
+  void setUp() {
+    std::vector<flexible_type> data;
+    for (size_t i = 0;i < TEST_LENGTH; ++i) data.push_back(i);
+    sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+  }
+
+  std::vector<flexible_type> run(const pnode_ptr& node,
+                                 materialize_options options = materialize_options()) {
+    auto res = planner().materialize(node, options);
+    std::vector<std::vector<flexible_type>> rows;
+    res.get_reader()->read_rows(0, res.size(), rows);
+    std::vector<flexible_type> ret;
+    for (const auto& row: rows) ret.push_back(row[0]);
+    return ret;
+  }
+
+  /**
+   * The mask is the same whichever way the rows are sliced into segments
+   * and blocks.
+   */
+  void test_mask_determinism() {
+    auto node = op_sample_mask::make_planner_node(MASK_LENGTH, 0.01, 5);
+    auto mask = run(node);
+    TS_ASSERT_EQUALS(mask.size(), MASK_LENGTH);
+    size_t count = std::count(mask.begin(), mask.end(), 1);
+    TS_ASSERT_LESS_THAN(2700, count);
+    TS_ASSERT_LESS_THAN(count, 3300);
+
+    materialize_options options;
+    options.num_segments = 7;
+    TS_ASSERT_EQUALS(run(node, options), mask);
+
+    size_t old_max_block_size = SFRAME_QUERY_MAX_BLOCK_SIZE;
+    for (size_t max_block_size: {4096, 1000}) {
+      SFRAME_QUERY_MAX_BLOCK_SIZE = max_block_size;
+      for (size_t block_execution: {1, 0}) {
+        SFRAME_QUERY_BLOCK_EXECUTION = block_execution;
+        TS_ASSERT_EQUALS(run(node), mask);
+      }
+    }
+    SFRAME_QUERY_MAX_BLOCK_SIZE = old_max_block_size;
+    SFRAME_QUERY_BLOCK_EXECUTION = true;
+
+    TS_ASSERT_DIFFERS(run(op_sample_mask::make_planner_node(MASK_LENGTH, 0.01, 6)), mask);
+  }
+
+  void test_mask_complement() {
+    auto mask = run(op_sample_mask::make_planner_node(MASK_LENGTH, 0.3, 2));
+    auto complement = run(op_sample_mask::make_planner_node(MASK_LENGTH, 0.3, 2, true));
+    TS_ASSERT_EQUALS(complement.size(), MASK_LENGTH);
+    for (size_t i = 0;i < MASK_LENGTH; ++i) {
+      TS_ASSERT_EQUALS(mask[i] + complement[i], 1);
+    }
+    auto none = run(op_sample_mask::make_planner_node(100, 0.0, 2));
+    auto all = run(op_sample_mask::make_planner_node(100, 1.0, 2));
+    TS_ASSERT_EQUALS(std::count(none.begin(), none.end(), 0), 100);
+    TS_ASSERT_EQUALS(std::count(all.begin(), all.end(), 1), 100);
+  }
+
+  void test_reservoir_sample_rows() {
+    auto rows = reservoir_sample_rows(1000000, 500, 3);
+    TS_ASSERT_EQUALS(rows.size(), 500);
+    TS_ASSERT(std::is_sorted(rows.begin(), rows.end()));
+    TS_ASSERT(std::adjacent_find(rows.begin(), rows.end()) == rows.end());
+    TS_ASSERT_LESS_THAN(rows.back(), 1000000);
+    TS_ASSERT_EQUALS(reservoir_sample_rows(1000000, 500, 3), rows);
+    TS_ASSERT_DIFFERS(reservoir_sample_rows(1000000, 500, 4), rows);
+
+    TS_ASSERT_EQUALS(reservoir_sample_rows(10, 20, 3).size(), 10);
+    TS_ASSERT_EQUALS(reservoir_sample_rows(10, 0, 3).size(), 0);
+  }
+
+  void test_sample_rows() {
+    auto node = sample_rows(op_sarray_source::make_planner_node(sa), TEST_LENGTH, 100, 7);
+    auto values = run(node);
+    auto rows = reservoir_sample_rows(TEST_LENGTH, 100, 7);
+    TS_ASSERT_EQUALS(values.size(), rows.size());
+    for (size_t i = 0;i < values.size(); ++i) {
+      TS_ASSERT_EQUALS(values[i], rows[i]);
+    }
+  }
+
+  void test_sparse_sample() {
+    // the rows drawn up front are the rows of the mask
+    auto mask = run(op_sample_mask::make_planner_node(MASK_LENGTH, 0.01, 5));
+    std::vector<size_t> mask_rows;
+    for (size_t i = 0;i < mask.size(); ++i) if (mask[i] == 1) mask_rows.push_back(i);
+    TS_ASSERT_EQUALS(op_sample_mask::sampled_rows(MASK_LENGTH, 0.01, 5), mask_rows);
+
+    // a sparse sample of a source is read directly, with the same rows
+    auto source = op_sarray_source::make_planner_node(sa);
+    for (double fraction: {0.001, 0.1}) {
+      auto filtered = run(op_logical_filter::make_planner_node(
+          source, op_sample_mask::make_planner_node(TEST_LENGTH, fraction, 9)));
+      auto node = sample(source, TEST_LENGTH, fraction, 9);
+      TS_ASSERT_EQUALS(node->operator_type == planner_node_type::SARRAY_SOURCE_NODE,
+                       fraction < SPARSE_SAMPLE_FRACTION);
+      TS_ASSERT_EQUALS(run(node), filtered);
+    }
+
+    // the rows of a slice of a source
+    auto slice = op_sarray_source::make_planner_node(sa, 100, 5100);
+    auto values = run(sample(slice, 5000, 0.002, 9));
+    auto rows = op_sample_mask::sampled_rows(5000, 0.002, 9);
+    TS_ASSERT_EQUALS(values.size(), rows.size());
+    for (size_t i = 0;i < values.size(); ++i) {
+      TS_ASSERT_EQUALS(values[i], rows[i] + 100);
+    }
+  }
+
+  std::vector<flexible_type> shuffled(flex_int seed) {
+    auto sf = shuffle(op_sarray_source::make_planner_node(sa), {"a"}, seed);
+    std::vector<std::vector<flexible_type>> rows;
+    sf->get_reader()->read_rows(0, sf->size(), rows);
+    std::vector<flexible_type> ret;
+    for (const auto& row: rows) ret.push_back(row[0]);
+    return ret;
+  }
+
+  void check_permutation(std::vector<flexible_type> values) {
+    TS_ASSERT_EQUALS(values.size(), TEST_LENGTH);
+    std::sort(values.begin(), values.end());
+    for (size_t i = 0;i < values.size(); ++i) TS_ASSERT_EQUALS(values[i], i);
+  }
+
+  void test_shuffle() {
+    auto values = shuffled(1);
+    check_permutation(values);
+    TS_ASSERT_EQUALS(shuffled(1), values);
+    TS_ASSERT_DIFFERS(shuffled(2), values);
+
+    // the same permutation when shuffled through spill partitions
+    size_t old_sort_buffer_size = sframe_config::SFRAME_SORT_BUFFER_SIZE;
+    sframe_config::SFRAME_SORT_BUFFER_SIZE = 64 * 1024;
+    auto spilled = shuffled(1);
+    sframe_config::SFRAME_SORT_BUFFER_SIZE = old_sort_buffer_size;
+    TS_ASSERT_EQUALS(spilled, values);
+  }
+
+  /**
+   * The spills of a shuffle are counted on the query running it. The
+   * input is read through a transform which catches the running query.
+   */
+  void test_shuffle_spills_counted_on_query() {
+    mutex lock;
+    std::shared_ptr<running_query_info> query;
+    auto input = op_transform::make_planner_node(
+        op_sarray_source::make_planner_node(sa),
+        [&](const sframe_rows::row& row)->flexible_type {
+          std::lock_guard<mutex> guard(lock);
+          if (!query) {
+            for (const auto& info: running_queries::get_instance().list()) {
+              if (info->description == "shuffle") query = info;
+            }
+          }
+          return row[0];
+        },
+        flex_type_enum::INTEGER);
+
+    size_t old_sort_buffer_size = sframe_config::SFRAME_SORT_BUFFER_SIZE;
+    sframe_config::SFRAME_SORT_BUFFER_SIZE = 64 * 1024;
+    auto sf = shuffle(input, {"a"}, 1);
+    sframe_config::SFRAME_SORT_BUFFER_SIZE = old_sort_buffer_size;
+    TS_ASSERT_EQUALS(sf->size(), TEST_LENGTH);
+    TS_ASSERT(query != nullptr);
+    if (query) TS_ASSERT_LESS_THAN(0, query->spilled_bytes->value);
+  }
+};
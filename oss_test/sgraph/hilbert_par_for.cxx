@@ -47,6 +47,49 @@ class hilbert_par_for_test: public CxxTest::TestSuite {
   }
 
 
+  void test_prefetch_runner(size_t n, size_t threads, size_t lookahead) {
+    std::vector<std::pair<size_t, size_t> > preamble_hits;
+    std::vector<std::pair<size_t, size_t> > prefetch_hits;
+    std::set<std::pair<size_t, size_t> > executed;
+    mutex lock;
+    size_t num_prefetch_errors = 0;
+    sgraph_compute::hilbert_prefetch_stats stats;
+    sgraph_compute::hilbert_blocked_parallel_for(n,
+                                 [&](std::vector<std::pair<size_t, size_t> > v) {
+                                   std::copy(v.begin(), v.end(), std::inserter(preamble_hits, preamble_hits.end()));
+                                 },
+                                 [&](std::pair<size_t, size_t> v) {
+                                   lock.lock();
+                                   executed.insert(v);
+                                   lock.unlock();
+                                 },
+                                 [&](std::vector<std::pair<size_t, size_t> > v) {
+                                   // prefetched coordinates are always ahead of the preamble
+                                   lock.lock();
+                                   for (auto& c : v) {
+                                     if (executed.count(c)) ++num_prefetch_errors;
+                                   }
+                                   lock.unlock();
+                                   std::copy(v.begin(), v.end(), std::inserter(prefetch_hits, prefetch_hits.end()));
+                                 },
+                                 lookahead, &stats, threads);
+    TS_ASSERT_EQUALS(num_prefetch_errors, 0);
+    TS_ASSERT_EQUALS(preamble_hits.size(), n * n);
+    TS_ASSERT_EQUALS(executed.size(), n * n);
+    size_t num_passes = (n * n + threads - 1) / threads;
+    TS_ASSERT_EQUALS(stats.num_passes, num_passes);
+    TS_ASSERT_EQUALS(stats.num_prefetches, num_passes - 1);
+    // every coordinate but those of the first pass is prefetched at least once
+    std::set<std::pair<size_t, size_t> > unique_prefetch(prefetch_hits.begin(), prefetch_hits.end());
+    TS_ASSERT_EQUALS(unique_prefetch.size(), n * n - std::min(n * n, threads));
+  }
+
+  void test_hilbert_par_for_prefetch() {
+    test_prefetch_runner(4, 4, 1);
+    test_prefetch_runner(16, 3, 2);
+    test_prefetch_runner(16, 1, 1);
+  }
+
   void test_hilbert_par_for() {
     test_runner(4, 4);
     // try an odd number
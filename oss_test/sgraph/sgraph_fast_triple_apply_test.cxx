@@ -16,6 +16,8 @@
 */
 #include <sgraph/sgraph.hpp>
 #include <sgraph/sgraph_fast_triple_apply.hpp>
+#include <sgraph/sgraph_triple_apply_session.hpp>
+#include <parallel/mutex.hpp>
 #include <cxxtest/TestSuite.h>
 
 #include "sgraph_test_util.hpp"
@@ -69,6 +71,38 @@ std::vector<std::pair<flexible_type, flexible_type>> triple_apply_degree_count(
   return ret;
 }
 
+// Implement pagerank using a triple apply session, keeping the "vdata"
+// field in memory across iterations.
+void session_pagerank(sgraph& g, size_t num_iterations) {
+  auto out_degree = sgraph_compute::create_vertex_data<std::atomic<size_t>>(g);
+  sgraph_compute::fast_triple_apply(g,
+                                    [&](sgraph_compute::fast_edge_scope& scope) {
+                                      auto src_addr = scope.source_vertex_address();
+                                      out_degree[src_addr.partition_id][src_addr.local_id]++;
+                                    }, {}, {});
+
+  sgraph_compute::triple_apply_session<double, flex_float> session(g, {"vdata"});
+  TS_ASSERT(!session.is_modified());
+  auto& pagerank = session.field("vdata");
+  graphlab::mutex lock;
+  for (size_t iter = 0; iter < num_iterations; ++iter) {
+    auto accum = sgraph_compute::create_vertex_data_from_const<double>(g, 0.15);
+    session.triple_apply([&](sgraph_compute::fast_edge_scope& scope) {
+                           auto src_addr = scope.source_vertex_address();
+                           auto dst_addr = scope.target_vertex_address();
+                           double contrib = 0.85 * pagerank[src_addr.partition_id][src_addr.local_id]
+                               / out_degree[src_addr.partition_id][src_addr.local_id];
+                           std::lock_guard<graphlab::mutex> guard(lock);
+                           accum[dst_addr.partition_id][dst_addr.local_id] += contrib;
+                         });
+    pagerank.swap(accum);
+  }
+  TS_ASSERT_EQUALS(session.num_iterations(), num_iterations);
+  TS_ASSERT(session.is_modified());
+  session.close();
+  TS_ASSERT(!session.is_open());
+}
+
 class sgraph_triple_apply_test : public CxxTest::TestSuite {
 
 public:
@@ -109,4 +143,40 @@ void test_triple_apply_edge_data_modification() {
   g.remove_edge_field("id_sum");
 }
 
+void test_triple_apply_session_pagerank() {
+  check_pagerank(session_pagerank);
+}
+
+void test_triple_apply_session_checkpoint() {
+  size_t n_vertex = 100;
+  size_t n_partition = 4;
+  sgraph g = create_ring_graph(n_vertex, n_partition, false /* one direction */);
+  g.init_vertex_field("in_count", flex_int(0));
+
+  sgraph_compute::triple_apply_session<std::atomic<size_t>, flex_int> session(g, {"in_count"});
+  auto& in_count = session.field("in_count");
+  for (size_t iter = 0; iter < 3; ++iter) {
+    session.triple_apply([&](sgraph_compute::fast_edge_scope& scope) {
+                           auto dst_addr = scope.target_vertex_address();
+                           in_count[dst_addr.partition_id][dst_addr.local_id]++;
+                         });
+    if (iter == 0) {
+      // Nothing is written back before a checkpoint.
+      for (auto& partition : g.fetch_vertex_data_field_in_memory("in_count")) {
+        for (auto& v : partition) TS_ASSERT_EQUALS(v, 0);
+      }
+      session.checkpoint();
+      for (auto& partition : g.fetch_vertex_data_field_in_memory("in_count")) {
+        for (auto& v : partition) TS_ASSERT_EQUALS(v, 1);
+      }
+    }
+  }
+  session.close();
+  for (auto& partition : g.fetch_vertex_data_field_in_memory("in_count")) {
+    for (auto& v : partition) TS_ASSERT_EQUALS(v, 3);
+  }
+  TS_ASSERT_THROWS_ANYTHING(
+      (sgraph_compute::triple_apply_session<double, flex_float>(g, {"not_a_field"})));
+}
+
 };
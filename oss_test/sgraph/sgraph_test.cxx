@@ -273,6 +273,45 @@ class sgraph_test : public CxxTest::TestSuite {
     }
   }
 
+  void test_degree_aware_ingress() {
+    // two hubs, each with an in-edge from every leaf
+    size_t nleaves = 200;
+    std::vector<flexible_type> sources, targets;
+    for (size_t i = 2; i < nleaves + 2; ++i) {
+      sources.push_back(i); targets.push_back(0);
+      sources.push_back(i); targets.push_back(1);
+    }
+    sframe edges = create_sframe({
+        {"source", flex_type_enum::INTEGER, sources},
+        {"target", flex_type_enum::INTEGER, targets}});
+
+    size_t old_min_degree = SGRAPH_INGRESS_HIGH_DEGREE_MIN_DEGREE;
+    SGRAPH_INGRESS_HIGH_DEGREE_MIN_DEGREE = 10;
+    sgraph g(4);
+    g.set_ingress_strategy(sgraph::ingress_strategy::DEGREE_AWARE);
+    g.add_edges(edges, "source", "target");
+    SGRAPH_INGRESS_HIGH_DEGREE_MIN_DEGREE = old_min_degree;
+
+    TS_ASSERT_EQUALS(g.num_vertices(), nleaves + 2);
+    TS_ASSERT_EQUALS(g.num_edges(), 2 * nleaves);
+    TS_ASSERT_EQUALS(g.num_high_degree_vertices(), 2);
+
+    // the hubs are placed on different partitions, so no column of the
+    // grid holds more than half of the edges.
+    auto report = g.get_partition_balance_report();
+    TS_ASSERT_EQUALS(report.num_high_degree_vertices, 2);
+    TS_ASSERT_EQUALS(report.vertex_partition_sizes.size(), 4);
+    TS_ASSERT_EQUALS(report.edge_partition_sizes.size(), 16);
+    TS_ASSERT_LESS_THAN_EQUALS(report.edge_column_imbalance, 2.0);
+
+    // adding the hubs again as vertices must not duplicate them
+    g.add_vertices(create_sframe({{"id", flex_type_enum::INTEGER, {0, 1}}}), "id");
+    TS_ASSERT_EQUALS(g.num_vertices(), nleaves + 2);
+
+    sframe all_edges = g.get_edges();
+    TS_ASSERT_EQUALS(all_edges.size(), 2 * nleaves);
+  }
+
   template<typename T>
   void assert_vector_equals(
       const std::vector<T>& a,
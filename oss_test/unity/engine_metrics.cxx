@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2015 Dato, Inc.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license. See the LICENSE file for details.
+ */
+#include <string>
+#include <vector>
+#include <sframe/sarray.hpp>
+#include <sframe/algorithm.hpp>
+#include <sframe_query_engine/planning/planner.hpp>
+#include <sframe_query_engine/operators/all_operators.hpp>
+#include <sframe_query_engine/execution/running_queries.hpp>
+#include <unity/lib/engine_metrics.hpp>
+#include <cxxtest/TestSuite.h>
+
+using namespace graphlab;
+using namespace graphlab::query_eval;
+
+class engine_metrics_test: public CxxTest::TestSuite {
+ public:
+  void test_running_query_progress() {
+    const size_t TEST_LENGTH = 100000;
+    std::vector<flexible_type> data;
+    for (size_t i = 0;i < TEST_LENGTH; ++i) data.push_back(i);
+    auto sa = std::make_shared<sarray<flexible_type>>();
+    sa->open_for_write();
+    graphlab::copy(data.begin(), data.end(), *sa);
+    sa->close();
+
+    auto add_one =
+        op_transform::make_planner_node(
+            op_sarray_source::make_planner_node(sa),
+            [](const sframe_rows::row& a)->flexible_type {
+              return a[0] + 1;
+            },
+            flex_type_enum::INTEGER);
+
+    size_t completed = running_queries::get_instance().num_completed();
+    // look at the metrics from inside the query
+    engine_metrics during_query;
+    mutex lock;
+    planner().materialize(
+        add_one,
+        [&](size_t segment_id, const std::shared_ptr<sframe_rows>& rows) {
+          std::lock_guard<mutex> guard(lock);
+          during_query = engine_metrics::collect();
+          return false;
+        },
+        1);
+
+    TS_ASSERT_EQUALS(during_query.running_queries.size(), 1);
+    const auto& q = during_query.running_queries[0];
+    TS_ASSERT_EQUALS(q.stage, 1);
+    TS_ASSERT_EQUALS(q.expected_rows, (int64_t)TEST_LENGTH);
+    TS_ASSERT_LESS_THAN(0, q.rows_output);
+    TS_ASSERT_LESS_THAN_EQUALS(q.rows_output, TEST_LENGTH);
+
+    auto after_query = engine_metrics::collect();
+    TS_ASSERT_EQUALS(after_query.running_queries.size(), 0);
+    TS_ASSERT_EQUALS(after_query.completed_queries, completed + 1);
+
+    std::string json = during_query.to_json();
+    TS_ASSERT(json.find("\"running\": 1") != std::string::npos);
+    TS_ASSERT(json.find("\"expected_rows\": 100000") != std::string::npos);
+    TS_ASSERT(json.find("\"block_cache\"") != std::string::npos);
+
+    std::string text = during_query.to_prometheus();
+    TS_ASSERT(text.find("# TYPE sframe_queries_running gauge\n"
+                        "sframe_queries_running 1\n") != std::string::npos);
+    TS_ASSERT(text.find("sframe_query_progress{query=\"" + std::to_string(q.id) + "\"")
+              != std::string::npos);
+    TS_ASSERT(text.find("sframe_temp_file_bytes ") != std::string::npos);
+  }
+};
@@ -16,6 +16,7 @@
 */
 #include <cstdio>
 #include <iostream>
+#include <fstream>
 #include <algorithm>
 #include <fileio/temp_files.hpp>
 #include <unity/lib/unity_sframe.hpp>
@@ -720,4 +721,103 @@ class unity_sframe_test: public CxxTest::TestSuite {
     TS_ASSERT_EQUALS(sf->size(), sf2->size());
     TS_ASSERT_EQUALS(sf->num_columns(), sf2->num_columns());
   }
+
+  void test_lazy_csv() {
+    std::string url = get_temp_name() + ".csv";
+    {
+      std::ofstream fout(url);
+      fout << "a,b,c\n";
+      for (size_t i = 0; i < 1000; ++i) {
+        fout << i << "," << i * 0.5 << ",str" << i << "\n";
+      }
+    }
+    std::map<std::string, flexible_type> config{{"lazy", 1}};
+    std::map<std::string, flex_type_enum> hints{{"a", flex_type_enum::INTEGER},
+                                                {"b", flex_type_enum::FLOAT}};
+    auto sf = std::make_shared<unity_sframe>();
+    sf->construct_from_csvs(url, config, hints);
+    // the schema is known without parsing
+    TS_ASSERT(!sf->is_materialized());
+    TS_ASSERT(!sf->has_size());
+    TS_ASSERT_EQUALS(sf->column_names(), std::vector<std::string>({"a", "b", "c"}));
+    TS_ASSERT_EQUALS(sf->dtype(),
+                     std::vector<flex_type_enum>({flex_type_enum::INTEGER,
+                                                  flex_type_enum::FLOAT,
+                                                  flex_type_enum::STRING}));
+
+    // the row limit of head is pushed into the parse, which leaves the
+    // source deferred
+    auto head = sf->head(10);
+    TS_ASSERT(head->is_materialized());
+    TS_ASSERT(!sf->is_materialized());
+    TS_ASSERT_EQUALS(head->size(), 10);
+    dataframe_t df = head->_head(10);
+    TS_ASSERT_EQUALS(df.values["c"][3], "str3");
+    TS_ASSERT_EQUALS(df.values["a"][3], 3);
+
+    // a column selection parses the whole file once, and later selections
+    // and heads reuse the parse
+    auto projected = sf->select_columns({"c", "a"});
+    TS_ASSERT(sf->is_materialized());
+    std::string parsed = sf->get_underlying_sframe()->select_column(0)->get_index_file();
+    auto column = sf->select_column("b");
+    TS_ASSERT_EQUALS(column->dtype(), flex_type_enum::FLOAT);
+    TS_ASSERT_EQUALS(column->size(), 1000);
+    df = sf->head(10)->_head(10);
+    TS_ASSERT_EQUALS(df.values["b"][3], 1.5);
+    TS_ASSERT_EQUALS(sf->get_underlying_sframe()->select_column(0)->get_index_file(), parsed);
+    df = projected->head(10)->_head(10);
+    TS_ASSERT_EQUALS(df.names, std::vector<std::string>({"c", "a"}));
+    TS_ASSERT_EQUALS(df.values["c"][3], "str3");
+    TS_ASSERT_EQUALS(projected->size(), 1000);
+
+    // positional output columns
+    config["output_columns"] = flex_list{"X3"};
+    config["lazy"] = 0;
+    auto positional = std::make_shared<unity_sframe>();
+    positional->construct_from_csvs(url, config, {});
+    TS_ASSERT_EQUALS(positional->column_names(), std::vector<std::string>({"X3"}));
+    TS_ASSERT_EQUALS(positional->_head(1).values["X3"][0], "str0");
+
+    sf->materialize();
+    TS_ASSERT_EQUALS(sf->size(), 1000);
+  }
+
+  void test_lazy_csv_rename() {
+    std::string url = get_temp_name() + ".csv";
+    {
+      std::ofstream fout(url);
+      fout << "a,b,c\n";
+      for (size_t i = 0; i < 100; ++i) {
+        fout << i << "," << i * 0.5 << ",str" << i << "\n";
+      }
+    }
+    std::map<std::string, flexible_type> config{{"lazy", 1}};
+    auto sf = std::make_shared<unity_sframe>();
+    sf->construct_from_csvs(url, config, {});
+    sf->set_column_name(0, "x");
+    sf->set_column_name(2, "z");
+    TS_ASSERT(!sf->is_materialized());
+
+    // the narrowed parse of head reads the columns by their names in the
+    // file
+    dataframe_t df = sf->head(5)->_head(5);
+    TS_ASSERT_EQUALS(df.names, std::vector<std::string>({"x", "b", "z"}));
+    TS_ASSERT_EQUALS(df.values["z"][3], "str3");
+    TS_ASSERT_EQUALS(df.values["x"][3], 3);
+    TS_ASSERT(!sf->is_materialized());
+
+    auto projected = sf->select_columns({"z", "x"});
+    df = projected->head(5)->_head(5);
+    TS_ASSERT_EQUALS(df.names, std::vector<std::string>({"z", "x"}));
+    TS_ASSERT_EQUALS(df.values["z"][3], "str3");
+
+    auto column = sf->select_column("z");
+    TS_ASSERT_EQUALS(column->size(), 100);
+
+    // the full parse keeps the renames
+    sf->materialize();
+    TS_ASSERT_EQUALS(sf->column_names(), std::vector<std::string>({"x", "b", "z"}));
+    TS_ASSERT_EQUALS(sf->_head(1).values["z"][0], "str0");
+  }
 };